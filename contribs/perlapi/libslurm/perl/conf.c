@@ -43,6 +43,8 @@ slurm_ctl_conf_to_hv(slurm_ctl_conf_t *conf, HV *hv)
 		STORE_FIELD(hv, conf, checkpoint_type, charp);
 	if(conf->cluster_name)
 		STORE_FIELD(hv, conf, cluster_name, charp);
+	if(conf->comm_params)
+		STORE_FIELD(hv, conf, comm_params, charp);
 	STORE_FIELD(hv, conf, complete_wait, uint16_t);
 	
 	if(conf->control_addr)
@@ -82,6 +84,8 @@ slurm_ctl_conf_to_hv(slurm_ctl_conf_t *conf, HV *hv)
 		STORE_FIELD(hv, conf, job_comp_host, charp);
 	if(conf->job_comp_loc)
 		STORE_FIELD(hv, conf, job_comp_loc, charp);
+	if(conf->job_comp_params)
+		STORE_FIELD(hv, conf, job_comp_params, charp);
 	/* job_comp_pass */
 	STORE_FIELD(hv, conf, job_comp_port, uint32_t);
 	if(conf->job_comp_type)
@@ -103,6 +107,7 @@ slurm_ctl_conf_to_hv(slurm_ctl_conf_t *conf, HV *hv)
 		STORE_FIELD(hv, conf, licenses, charp);
 	if(conf->mail_prog)
 		STORE_FIELD(hv, conf, mail_prog, charp);
+	STORE_FIELD(hv, conf, max_dbd_msgs, uint32_t);
 	STORE_FIELD(hv, conf, max_job_cnt, uint16_t);
 	STORE_FIELD(hv, conf, max_mem_per_cpu, uint32_t);
 	STORE_FIELD(hv, conf, max_tasks_per_node, uint16_t);
@@ -199,6 +204,7 @@ slurm_ctl_conf_to_hv(slurm_ctl_conf_t *conf, HV *hv)
 	if(conf->slurmd_spooldir)
 		STORE_FIELD(hv, conf, slurmd_spooldir, charp);
 	STORE_FIELD(hv, conf, slurmd_timeout, uint16_t);
+	STORE_FIELD(hv, conf, slurmstepd_pool_size, uint16_t);
 	if(conf->srun_epilog)
 		STORE_FIELD(hv, conf, srun_epilog, charp);
 	if(conf->srun_prolog)
@@ -265,6 +271,7 @@ hv_to_slurm_ctl_conf(HV *hv, slurm_ctl_conf_t *conf)
 	FETCH_FIELD(hv, conf, boot_time, time_t, TRUE);
 	FETCH_FIELD(hv, conf, checkpoint_type, charp, FALSE);
 	FETCH_FIELD(hv, conf, cluster_name, charp, FALSE);
+	FETCH_FIELD(hv, conf, comm_params, charp, FALSE);
 	FETCH_FIELD(hv, conf, complete_wait, uint16_t, TRUE);
 
 	FETCH_FIELD(hv, conf, control_addr, charp, FALSE);
@@ -293,6 +300,7 @@ hv_to_slurm_ctl_conf(HV *hv, slurm_ctl_conf_t *conf)
 	FETCH_FIELD(hv, conf, job_ckpt_dir, charp, FALSE);
 	FETCH_FIELD(hv, conf, job_comp_host, charp, FALSE);
 	FETCH_FIELD(hv, conf, job_comp_loc, charp, FALSE);
+	FETCH_FIELD(hv, conf, job_comp_params, charp, FALSE);
 	FETCH_FIELD(hv, conf, job_comp_port, uint32_t, TRUE);
 	FETCH_FIELD(hv, conf, job_comp_type, charp, FALSE);
 	FETCH_FIELD(hv, conf, job_comp_user, charp, FALSE);
@@ -306,6 +314,7 @@ hv_to_slurm_ctl_conf(HV *hv, slurm_ctl_conf_t *conf)
 	FETCH_FIELD(hv, conf, kill_wait, uint16_t, TRUE);
 	FETCH_FIELD(hv, conf, licenses, charp, FALSE);
 	FETCH_FIELD(hv, conf, mail_prog, charp, FALSE);
+	FETCH_FIELD(hv, conf, max_dbd_msgs, uint32_t, TRUE);
 	FETCH_FIELD(hv, conf, max_job_cnt, uint16_t, TRUE);
 	FETCH_FIELD(hv, conf, max_mem_per_cpu, uint32_t, TRUE);
 	FETCH_FIELD(hv, conf, max_tasks_per_node, uint16_t, TRUE);
@@ -376,6 +385,7 @@ hv_to_slurm_ctl_conf(HV *hv, slurm_ctl_conf_t *conf)
 	FETCH_FIELD(hv, conf, slurmd_port, uint32_t, TRUE);
 	FETCH_FIELD(hv, conf, slurmd_spooldir, charp, FALSE);
 	FETCH_FIELD(hv, conf, slurmd_timeout, uint16_t, TRUE);
+	FETCH_FIELD(hv, conf, slurmstepd_pool_size, uint16_t, FALSE);
 	FETCH_FIELD(hv, conf, srun_epilog, charp, FALSE);
 	FETCH_FIELD(hv, conf, srun_prolog, charp, FALSE);
 	FETCH_FIELD(hv, conf, state_save_location, charp, FALSE);
@@ -422,6 +432,8 @@ slurmd_status_to_hv(slurmd_status_t *status, HV *hv)
 	STORE_FIELD(hv, status, pid, uint32_t);
 	if (status->hostname)
 		STORE_FIELD(hv, status, hostname, charp);
+	if (status->rpc_lanes)
+		STORE_FIELD(hv, status, rpc_lanes, charp);
 	if (status->slurmd_logfile)
 		STORE_FIELD(hv, status, slurmd_logfile, charp);
 	if (status->step_list)
@@ -451,6 +463,7 @@ hv_to_slurmd_status(HV *hv, slurmd_status_t *status)
 	FETCH_FIELD(hv, status, actual_tmp_disk, uint32_t, TRUE);
 	FETCH_FIELD(hv, status, pid, uint32_t, TRUE);
 	FETCH_FIELD(hv, status, hostname, charp, FALSE);
+	FETCH_FIELD(hv, status, rpc_lanes, charp, FALSE);
 	FETCH_FIELD(hv, status, slurmd_logfile, charp, FALSE);
 	FETCH_FIELD(hv, status, step_list, charp, FALSE);
 	FETCH_FIELD(hv, status, version, charp, FALSE);
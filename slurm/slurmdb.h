@@ -255,6 +255,12 @@ typedef struct {
 	List groupid_list;	/* list of char * */
 	uint32_t nodes_max;     /* number of nodes high range */
 	uint32_t nodes_min;     /* number of nodes low range */
+	char *page_cluster;     /* with page_jobid the last job of the
+				 * previous page, NULL for the first.
+				 * Set to the last job returned if
+				 * there are more, else cleared */
+	uint32_t page_jobid;
+	uint32_t page_size;     /* max job records at once, 0 for all */
 	List partition_list;	/* list of char * */
 	List qos_list;  	/* list of char * */
 	List resv_list;		/* list of char * */
@@ -352,6 +358,10 @@ typedef struct {
 				once flushed from the database */
 	char *insert;     /* an sql statement to be ran containing the
 			     insert of jobs since past */
+	time_t period_end;   /* only load records from before this time
+				from archive_file, 0 for no limit */
+	time_t period_start; /* only load records from this time on
+				from archive_file */
 } slurmdb_archive_rec_t;
 
 /* slurmdb_association_cond_t is defined above alphabetical */
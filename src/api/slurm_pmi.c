@@ -58,6 +58,7 @@ int pmi_fd = -1;
 int pmi_time = 0;
 uint16_t srun_port = 0;
 slurm_addr_t srun_addr;
+int pmi_stepd = 0;	/* srun_addr is the local slurmstepd (PMI_AGGREGATE) */
 
 static void _delay_rpc(int pmi_rank, int pmi_size);
 static int  _forward_comm_set(struct kvs_comm_set *kvs_set_ptr);
@@ -77,6 +78,8 @@ static void _delay_rpc(int pmi_rank, int pmi_size)
 	uint32_t delta_time, error_time;
 	int retries = 0;
 
+	if (pmi_stepd)		/* only this node's tasks, no need */
+		return;
 	_set_pmi_time();
 
 again:	if (gettimeofday(&tv1, NULL)) {
@@ -129,6 +132,19 @@ static int _get_addr(void)
 	if (srun_port)
 		return SLURM_SUCCESS;
 
+	/* With PMI_AGGREGATE, the local slurmstepd exchanges the key-value
+	 * pairs of its node's tasks with srun on their behalf */
+	env_port = getenv("SLURM_PMI_STEPD_PORT");
+	if (env_port) {
+		char hostname[64];
+
+		gethostname_short(hostname, sizeof(hostname));
+		srun_port = (uint16_t) atol(env_port);
+		slurm_set_addr(&srun_addr, srun_port, hostname);
+		pmi_stepd = 1;
+		return SLURM_SUCCESS;
+	}
+
 	env_host = getenv("SLURM_SRUN_COMM_HOST");
 	env_port = getenv("SLURM_SRUN_COMM_PORT");
 	if (!env_host || !env_port)
@@ -401,4 +417,5 @@ void slurm_pmi_finalize(void)
 		pmi_fd = -1;
 	}
 	srun_port = 0;
+	pmi_stepd = 0;
 }
@@ -73,7 +73,7 @@ struct io_buf {
 	io_hdr_t header;
 };
 
-static struct io_buf *_alloc_io_buf(void);
+static struct io_buf *_alloc_io_buf(int size);
 #if 0
 static void     _free_io_buf(struct io_buf *buf);
 #endif
@@ -338,6 +338,21 @@ _server_read(eio_obj_t *obj, List objs)
 			s->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
+		if (s->header.length > s->cio->msg_len) {
+			error("Stdout/err message from task %u too long "
+			      "(%u > %u)", s->header.gtaskid,
+			      s->header.length, s->cio->msg_len);
+			if (s->cio->sls)
+				step_launch_notify_io_failure(s->cio->sls,
+							      s->node_id);
+			close(obj->fd);
+			obj->fd = -1;
+			s->in_eof = true;
+			s->out_eof = true;
+			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			s->in_msg = NULL;
+			return SLURM_SUCCESS;
+		}
 		s->in_remaining = s->header.length;
 		s->in_msg->length = s->header.length;
 		s->in_msg->header = s->header;
@@ -944,7 +959,7 @@ _wid(int n)
 }
 
 static struct io_buf *
-_alloc_io_buf(void)
+_alloc_io_buf(int size)
 {
 	struct io_buf *buf;
 
@@ -955,7 +970,7 @@ _alloc_io_buf(void)
 	buf->length = 0;
 	/* The following "+ 1" is just temporary so I can stick a \0 at
 	   the end and do a printf of the data pointer */
-	buf->data = xmalloc(MAX_MSG_LEN + io_hdr_packed_size() + 1);
+	buf->data = xmalloc(size + io_hdr_packed_size() + 1);
 	if (!buf->data) {
 		xfree(buf);
 		return NULL;
@@ -1026,7 +1041,7 @@ _incoming_buf_free(client_io_t *cio)
 	if (list_count(cio->free_incoming) > 0) {
 		return true;
 	} else if (cio->incoming_count < STDIO_MAX_FREE_BUF) {
-		buf = _alloc_io_buf();
+		buf = _alloc_io_buf(MAX_MSG_LEN);
 		if (buf != NULL) {
 			list_enqueue(cio->free_incoming, buf);
 			cio->incoming_count++;
@@ -1043,8 +1058,8 @@ _outgoing_buf_free(client_io_t *cio)
 
 	if (list_count(cio->free_outgoing) > 0) {
 		return true;
-	} else if (cio->outgoing_count < STDIO_MAX_FREE_BUF) {
-		buf = _alloc_io_buf();
+	} else if (cio->outgoing_count < cio->max_outgoing) {
+		buf = _alloc_io_buf(cio->msg_len);
 		if (buf != NULL) {
 			list_enqueue(cio->free_outgoing, buf);
 			cio->outgoing_count++;
@@ -1068,7 +1083,8 @@ client_io_handler_create(slurm_step_io_fds_t fds,
 			 int num_tasks,
 			 int num_nodes,
 			 slurm_cred_t *cred,
-			 bool label)
+			 bool label,
+			 uint32_t msg_len)
 {
 	client_io_t *cio;
 	int len;
@@ -1083,6 +1099,14 @@ client_io_handler_create(slurm_step_io_fds_t fds,
 	cio->num_tasks = num_tasks;
 	cio->num_nodes = num_nodes;
 
+	if (msg_len == 0)
+		msg_len = MAX_MSG_LEN;
+	cio->msg_len = MIN(MAX(msg_len, MAX_MSG_LEN), MAX_IO_MSG_LEN);
+	/* Keep the memory held in output buffers roughly the same as
+	 * with MAX_MSG_LEN sized messages */
+	cio->max_outgoing = STDIO_MAX_FREE_BUF / (cio->msg_len / MAX_MSG_LEN);
+	cio->max_outgoing = MAX(cio->max_outgoing, 16);
+
 	cio->label = label;
 	if (cio->label)
 		cio->label_width = _wid(cio->num_tasks);
@@ -1133,12 +1157,12 @@ client_io_handler_create(slurm_step_io_fds_t fds,
 	cio->free_incoming = list_create(NULL); /* FIXME! Needs destructor */
 	cio->incoming_count = 0;
 	for (i = 0; i < STDIO_MAX_FREE_BUF; i++) {
-		list_enqueue(cio->free_incoming, _alloc_io_buf());
+		list_enqueue(cio->free_incoming, _alloc_io_buf(MAX_MSG_LEN));
 	}
 	cio->free_outgoing = list_create(NULL); /* FIXME! Needs destructor */
 	cio->outgoing_count = 0;
-	for (i = 0; i < STDIO_MAX_FREE_BUF; i++) {
-		list_enqueue(cio->free_outgoing, _alloc_io_buf());
+	for (i = 0; i < cio->max_outgoing; i++) {
+		list_enqueue(cio->free_outgoing, _alloc_io_buf(cio->msg_len));
 	}
 	cio->sls = NULL;
 
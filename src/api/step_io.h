@@ -47,6 +47,7 @@ struct client_io {
 	bool label;
 	int label_width;
 	char *io_key;
+	uint32_t msg_len;	/* max stdout/err message payload */
 
 	/* internal variables */
 	pthread_t ioid;		/* stdio thread id 		  */
@@ -85,6 +86,8 @@ struct client_io {
 			         * including free_incoming buffers and
 			         * buffers in use.
 			         */
+	int max_outgoing;	/* Limit on outgoing_count, scaled down
+				 * for larger msg_len */
 
 	struct step_launch_state *sls; /* Used to notify the main thread of an
 				       I/O problem.  */
@@ -100,12 +103,15 @@ typedef struct client_io client_io_t;
  *	string from the credential.  The slurmstepd sends the signature back
  *	back to the client when it establishes the IO connection as a sort
  *	of validity check.
+ * IN msg_len - largest stdout/err message the slurmstepd will send,
+ *	0 for MAX_MSG_LEN
  */
 client_io_t *client_io_handler_create(slurm_step_io_fds_t fds,
 				      int num_tasks,
 				      int num_nodes,
 				      slurm_cred_t *cred,
-				      bool label);
+				      bool label,
+				      uint32_t msg_len);
 
 int client_io_handler_start(client_io_t *cio);
 
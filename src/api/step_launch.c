@@ -269,12 +269,14 @@ int slurm_step_launch (slurm_step_ctx_t *ctx,
 		launch.ifname = params->remote_input_filename;
 		launch.buffered_stdio = params->buffered_stdio ? 1 : 0;
 		launch.labelio = params->labelio ? 1 : 0;
+		launch.io_msg_len = params->io_msg_len;
 		ctx->launch_state->io.normal =
 			client_io_handler_create(params->local_fds,
 						 ctx->step_req->num_tasks,
 						 launch.nnodes,
 						 ctx->step_resp->cred,
-						 params->labelio);
+						 params->labelio,
+						 params->io_msg_len);
 		if (ctx->launch_state->io.normal == NULL) {
 			rc = SLURM_ERROR;
 			goto fail1;
@@ -0,0 +1,134 @@
+/*****************************************************************************\
+ *  digest.c - 128-bit digest of data blocks
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * MurmurHash3 x64 128-bit variant, after the public domain reference
+ * implementation by Austin Appleby. Input words are always read as little
+ * endian so that every node computes the same digest for the same data.
+ */
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "src/common/digest.h"
+
+#define SEED 0x736c75726dULL
+
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline uint64_t _get64(const unsigned char *p)
+{
+	return  ((uint64_t) p[0])        | ((uint64_t) p[1] << 8)  |
+		((uint64_t) p[2] << 16)  | ((uint64_t) p[3] << 24) |
+		((uint64_t) p[4] << 32)  | ((uint64_t) p[5] << 40) |
+		((uint64_t) p[6] << 48)  | ((uint64_t) p[7] << 56);
+}
+
+static inline uint64_t _fmix64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+extern void slurm_digest(const void *data, size_t len,
+			 slurm_digest_t *digest)
+{
+	const unsigned char *p = (const unsigned char *) data;
+	const uint64_t c1 = 0x87c37b91114253d5ULL;
+	const uint64_t c2 = 0x4cf5ad432745937fULL;
+	uint64_t h1 = SEED, h2 = SEED;
+	uint64_t k1, k2;
+	size_t i, nblocks = len / 16;
+	const unsigned char *tail;
+
+	for (i = 0; i < nblocks; i++, p += 16) {
+		k1 = _get64(p);
+		k2 = _get64(p + 8);
+
+		k1 *= c1; k1 = ROTL64(k1, 31); k1 *= c2; h1 ^= k1;
+		h1 = ROTL64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+		k2 *= c2; k2 = ROTL64(k2, 33); k2 *= c1; h2 ^= k2;
+		h2 = ROTL64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+	}
+
+	tail = p;
+	k1 = 0;
+	k2 = 0;
+	switch (len & 15) {
+	case 15: k2 ^= ((uint64_t) tail[14]) << 48;
+	case 14: k2 ^= ((uint64_t) tail[13]) << 40;
+	case 13: k2 ^= ((uint64_t) tail[12]) << 32;
+	case 12: k2 ^= ((uint64_t) tail[11]) << 24;
+	case 11: k2 ^= ((uint64_t) tail[10]) << 16;
+	case 10: k2 ^= ((uint64_t) tail[ 9]) << 8;
+	case  9: k2 ^= ((uint64_t) tail[ 8]);
+		k2 *= c2; k2 = ROTL64(k2, 33); k2 *= c1; h2 ^= k2;
+	case  8: k1 ^= ((uint64_t) tail[ 7]) << 56;
+	case  7: k1 ^= ((uint64_t) tail[ 6]) << 48;
+	case  6: k1 ^= ((uint64_t) tail[ 5]) << 40;
+	case  5: k1 ^= ((uint64_t) tail[ 4]) << 32;
+	case  4: k1 ^= ((uint64_t) tail[ 3]) << 24;
+	case  3: k1 ^= ((uint64_t) tail[ 2]) << 16;
+	case  2: k1 ^= ((uint64_t) tail[ 1]) << 8;
+	case  1: k1 ^= ((uint64_t) tail[ 0]);
+		k1 *= c1; k1 = ROTL64(k1, 31); k1 *= c2; h1 ^= k1;
+	}
+
+	h1 ^= (uint64_t) len;
+	h2 ^= (uint64_t) len;
+	h1 += h2;
+	h2 += h1;
+	h1 = _fmix64(h1);
+	h2 = _fmix64(h2);
+	h1 += h2;
+	h2 += h1;
+
+	digest->h1 = h1;
+	digest->h2 = h2;
+}
+
+extern int slurm_digest_eq(const slurm_digest_t *d1,
+			   const slurm_digest_t *d2)
+{
+	return ((d1->h1 == d2->h1) && (d1->h2 == d2->h2));
+}
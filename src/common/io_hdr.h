@@ -58,6 +58,7 @@
 #include "src/common/xmalloc.h"
 
 #define MAX_MSG_LEN 1024
+#define MAX_IO_MSG_LEN (64 * 1024)	/* limit on negotiated stdout/err size */
 #define SLURM_IO_KEY_SIZE 8
 
 #define SLURM_IO_STDIN 0
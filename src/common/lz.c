@@ -0,0 +1,194 @@
+/*****************************************************************************\
+ *  lz.c - fast LZ77 style compression of message buffers
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string.h>
+
+#include "src/common/lz.h"
+#include "src/common/xmalloc.h"
+
+#define LZ_HASH_LOG	14
+#define LZ_HASH_SIZE	(1 << LZ_HASH_LOG)
+#define LZ_MAX_LIT	(1 << 5)		/* longest literal run */
+#define LZ_MAX_OFF	(1 << 13)		/* farthest back reference */
+#define LZ_MAX_REF	((1 << 8) + (1 << 3))	/* longest back reference */
+
+#define LZ_HASH(p)	(((((uint32_t)(p)[0] << 16) |			\
+			   ((uint32_t)(p)[1] <<  8) |			\
+			    (uint32_t)(p)[2]) * 2654435761U)		\
+			 >> (32 - LZ_HASH_LOG))
+
+extern uint32_t lz_compress(const void *in_data, uint32_t in_len,
+			    void *out_data, uint32_t out_len)
+{
+	const uint8_t *ip = (const uint8_t *) in_data;
+	const uint8_t *in_end = ip + in_len;
+	const uint8_t **htab, *ref;
+	uint8_t *op = (uint8_t *) out_data;
+	uint8_t *out_end = op + out_len;
+	uint8_t *lit_ctrl;
+	uint32_t h, off, len, max_len;
+	int lit = 0;
+
+	if ((in_len < 4) || (out_len < 2))
+		return 0;
+
+	htab = xmalloc(sizeof(uint8_t *) * LZ_HASH_SIZE);
+	lit_ctrl = op++;
+
+	while (ip + 2 < in_end) {
+		h = LZ_HASH(ip);
+		ref = htab[h];
+		htab[h] = ip;
+
+		if (ref && ((off = ip - ref - 1) < LZ_MAX_OFF) &&
+		    (ref[0] == ip[0]) && (ref[1] == ip[1]) &&
+		    (ref[2] == ip[2])) {
+			max_len = in_end - ip;
+			if (max_len > LZ_MAX_REF)
+				max_len = LZ_MAX_REF;
+			for (len = 3; (len < max_len) && (ref[len] == ip[len]);
+			     len++)
+				;
+
+			/* close the pending literal run, drop it if empty */
+			if (lit)
+				*lit_ctrl = lit - 1;
+			else
+				op--;
+			if (op + 4 > out_end)
+				goto too_big;
+
+			len -= 2;
+			if (len < 7)
+				*op++ = (off >> 8) + (len << 5);
+			else {
+				*op++ = (off >> 8) + (7 << 5);
+				*op++ = len - 7;
+			}
+			*op++ = off;
+			ip += len + 2;
+
+			lit = 0;
+			lit_ctrl = op++;
+			continue;
+		}
+
+		if (op >= out_end)
+			goto too_big;
+		*op++ = *ip++;
+		if (++lit == LZ_MAX_LIT) {
+			*lit_ctrl = lit - 1;
+			lit = 0;
+			if (op >= out_end)
+				goto too_big;
+			lit_ctrl = op++;
+		}
+	}
+
+	while (ip < in_end) {
+		if (op >= out_end)
+			goto too_big;
+		*op++ = *ip++;
+		if (++lit == LZ_MAX_LIT) {
+			*lit_ctrl = lit - 1;
+			lit = 0;
+			if (op >= out_end)
+				goto too_big;
+			lit_ctrl = op++;
+		}
+	}
+	if (lit)
+		*lit_ctrl = lit - 1;
+	else
+		op--;
+
+	xfree(htab);
+	return (uint32_t) (op - (uint8_t *) out_data);
+
+too_big:
+	xfree(htab);
+	return 0;
+}
+
+extern uint32_t lz_decompress(const void *in_data, uint32_t in_len,
+			      void *out_data, uint32_t out_len)
+{
+	const uint8_t *ip = (const uint8_t *) in_data;
+	const uint8_t *in_end = ip + in_len;
+	uint8_t *op = (uint8_t *) out_data;
+	uint8_t *out_end = op + out_len;
+	uint8_t *ref;
+	uint32_t ctrl, len, off;
+
+	while (ip < in_end) {
+		ctrl = *ip++;
+
+		if (ctrl < LZ_MAX_LIT) {
+			len = ctrl + 1;
+			if ((op + len > out_end) || (ip + len > in_end))
+				return 0;
+			memcpy(op, ip, len);
+			op += len;
+			ip += len;
+			continue;
+		}
+
+		len = ctrl >> 5;
+		if (len == 7) {
+			if (ip >= in_end)
+				return 0;
+			len += *ip++;
+		}
+		if (ip >= in_end)
+			return 0;
+		len += 2;
+		off = ((ctrl & 0x1f) << 8) + *ip++ + 1;
+		if ((op + len > out_end) || (off > op - (uint8_t *) out_data))
+			return 0;
+
+		/* source and destination may overlap, copy bytewise */
+		ref = op - off;
+		while (len--)
+			*op++ = *ref++;
+	}
+
+	return (uint32_t) (op - (uint8_t *) out_data);
+}
@@ -0,0 +1,85 @@
+/*****************************************************************************\
+ *  lz.h - fast LZ77 style compression of message buffers
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _LZ_H
+#define _LZ_H
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#  if HAVE_INTTYPES_H
+#    include <inttypes.h>
+#  else
+#    if HAVE_STDINT_H
+#      include <stdint.h>
+#    endif
+#  endif  /* HAVE_INTTYPES_H */
+#else   /* !HAVE_CONFIG_H */
+#  include <inttypes.h>
+#endif  /*  HAVE_CONFIG_H */
+
+/*
+ * The compressed format is a sequence of literal runs and back references
+ * into the previously decompressed data (LZF compatible). It favors speed
+ * over compression ratio and needs no external library, which makes it
+ * suitable for compressing RPC bodies on the fly.
+ */
+
+/*
+ * lz_compress - compress a buffer
+ * IN in_data - data to compress
+ * IN in_len - size of in_data in bytes
+ * OUT out_data - where to write the compressed data
+ * IN out_len - size of out_data in bytes
+ * RET size of the compressed data or 0 if it would not fit in out_len
+ *     bytes (i.e. the data does not compress well enough)
+ */
+extern uint32_t lz_compress(const void *in_data, uint32_t in_len,
+			    void *out_data, uint32_t out_len);
+
+/*
+ * lz_decompress - decompress a buffer created by lz_compress()
+ * IN in_data - compressed data
+ * IN in_len - size of in_data in bytes
+ * OUT out_data - where to write the original data
+ * IN out_len - size of out_data in bytes
+ * RET size of the decompressed data or 0 if in_data is corrupt or its
+ *     contents will not fit in out_len bytes
+ */
+extern uint32_t lz_decompress(const void *in_data, uint32_t in_len,
+			      void *out_data, uint32_t out_len);
+
+#endif /* !_LZ_H */
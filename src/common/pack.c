@@ -98,6 +98,12 @@ strong_alias(unpackstr_array,	slurm_unpackstr_array);
 strong_alias(packmem_array,	slurm_packmem_array);
 strong_alias(unpackmem_array,	slurm_unpackmem_array);
 
+/* Memory handed out by the unpack functions comes from the buffer's arena,
+ * if it has one, else from the heap. Either way it is released with xfree */
+#define _buf_xmalloc(__buf, __sz) \
+	((__buf)->arena ? xarena_alloc((xarena_t)(__buf)->arena, __sz) : \
+			  xmalloc(__sz))
+
 /* Basic buffer management routines */
 /* create_buf - create a buffer with the supplied contents, contents must
  * be xalloc'ed */
@@ -356,7 +362,8 @@ int unpack16_array(uint16_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc((*size_val) * sizeof(uint16_t));
+	*valp = _buf_xmalloc(buffer,
+			      (*size_val) * sizeof(uint16_t));
 	for (i = 0; i < *size_val; i++) {
 		if (unpack16((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -385,7 +392,8 @@ int unpack32_array(uint32_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc((*size_val) * sizeof(uint32_t));
+	*valp = _buf_xmalloc(buffer,
+			      (*size_val) * sizeof(uint32_t));
 	for (i = 0; i < *size_val; i++) {
 		if (unpack32((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -580,7 +588,7 @@ int unpackmem_xmalloc(char **valp, uint32_t * size_valp, Buf buffer)
 	else if (*size_valp > 0) {
 		if (remaining_buf(buffer) < *size_valp)
 			return SLURM_ERROR;
-		*valp = xmalloc(*size_valp);
+		*valp = _buf_xmalloc(buffer, *size_valp);
 		memcpy(*valp, &buffer->head[buffer->processed],
 		       *size_valp);
 		buffer->processed += *size_valp;
@@ -674,7 +682,8 @@ int unpackstr_array(char ***valp, uint32_t * size_valp, Buf buffer)
 	if (*size_valp > MAX_PACK_ARRAY_LEN)
 		return SLURM_ERROR;
 	else if (*size_valp > 0) {
-		*valp = xmalloc(sizeof(char *) * (*size_valp + 1));
+		*valp = _buf_xmalloc(buffer,
+				      sizeof(char *) * (*size_valp + 1));
 		for (i = 0; i < *size_valp; i++) {
 			if (unpackmem_xmalloc(&(*valp)[i], &uint32_tmp, buffer))
 				return SLURM_ERROR;
@@ -68,6 +68,7 @@ struct slurm_buf {
 	char *head;
 	uint32_t size;
 	uint32_t processed;
+	void *arena;		/* xarena_t to unpack into, or NULL */
 };
 
 typedef struct slurm_buf * Buf;
@@ -187,6 +187,8 @@ typedef struct slurm_acct_storage_ops {
 				    List shares_used);
 	int (*flush_jobs)          (void *db_conn,
 				    time_t event_time);
+	int (*job_batch)           (void *db_conn, bool start,
+				    bool commit);
 } slurm_acct_storage_ops_t;
 
 typedef struct slurm_acct_storage_context {
@@ -275,7 +277,8 @@ static slurm_acct_storage_ops_t * _acct_storage_get_ops(
 		"jobacct_storage_p_archive",
 		"jobacct_storage_p_archive_load",
 		"acct_storage_p_update_shares_used",
-		"acct_storage_p_flush_jobs_on_cluster"
+		"acct_storage_p_flush_jobs_on_cluster",
+		"jobacct_storage_p_batch"
 	};
 	int n_syms = sizeof( syms ) / sizeof( char * );
 
@@ -1021,3 +1024,20 @@ extern int acct_storage_g_flush_jobs_on_cluster(
 		(db_conn, event_time);
 
 }
+
+/*
+ * Begin or end a batch of job and step records.  Between the two
+ * calls the storage may defer writing the records; ending the batch
+ * writes out anything deferred and commits it as one transaction.
+ * IN:  start - true to begin a batch, false to end it
+ * IN:  commit - when ending, false to discard the batch instead
+ * RET: SLURM_SUCCESS on success SLURM_ERROR else, on error none of
+ *      the records loaded since the batch began were stored
+ */
+extern int jobacct_storage_g_batch(void *db_conn, bool start, bool commit)
+{
+	if (slurm_acct_storage_init(NULL) < 0)
+		return SLURM_ERROR;
+	return (*(g_acct_storage_context->ops.job_batch))
+		(db_conn, start, commit);
+}
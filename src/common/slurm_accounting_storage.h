@@ -478,6 +478,17 @@ extern int jobacct_storage_g_step_start(void *db_conn,
 extern int jobacct_storage_g_step_complete(void *db_conn,
 					   struct step_record *step_ptr);
 
+/*
+ * Begin or end a batch of job and step records.  Between the two
+ * calls the storage may defer writing the records; ending the batch
+ * writes out anything deferred and commits it as one transaction.
+ * IN:  start - true to begin a batch, false to end it
+ * IN:  commit - when ending, false to discard the batch instead
+ * RET: SLURM_SUCCESS on success SLURM_ERROR else, on error none of
+ *      the records loaded since the batch began were stored
+ */
+extern int jobacct_storage_g_batch(void *db_conn, bool start, bool commit);
+
 /*
  * load into the storage a suspention of a job
  */
@@ -52,6 +52,7 @@
 
 #include "slurm/slurm_errno.h"
 #include "src/common/bitstring.h"
+#include "src/common/digest.h"
 #include "src/common/gres.h"
 #include "src/common/io_hdr.h"
 #include "src/common/job_resources.h"
@@ -81,15 +82,39 @@ typedef struct sbcast_cred sbcast_cred_t;		/* opaque data type */
 #define MAX_TIME 0x7fffffff
 #define SBCAST_CACHE_SIZE 64
 
+/*
+ * Buckets in the verifier's job and credential state tables, and
+ * slots in its cache of verified credential signatures.
+ */
+#define CRED_HASH_SIZE	1024
+#define SIG_CACHE_SIZE	256
+
+/*
+ * Bytes of state changes a verifier keeps between packs. Beyond this
+ * the changes are dropped and the whole context must be packed again.
+ */
+#define CRED_CHANGES_MAX (1024 * 1024)
+
+/*
+ * Types of the state change records kept by a verifier
+ */
+enum cred_change_type {
+	CRED_CHANGE_JOB = 1,	/* job state added or updated		*/
+	CRED_CHANGE_JOB_DEL,	/* job state removed			*/
+	CRED_CHANGE_CRED,	/* cred state added			*/
+	CRED_CHANGE_CRED_DEL	/* cred state removed			*/
+};
+
 /*
  * slurm job credential state
  *
  */
-typedef struct {
+typedef struct cred_state {
 	time_t   ctime;		/* Time that the cred was created	*/
 	time_t   expiration;    /* Time at which cred is no longer good	*/
 	uint32_t jobid;		/* SLURM job id for this credential	*/
 	uint32_t stepid;	/* SLURM step id for this credential	*/
+	struct cred_state *next;/* Next state in this hash bucket	*/
 } cred_state_t;
 
 /*
@@ -97,13 +122,28 @@ typedef struct {
  * tracks jobids for which all future credentials have been revoked
  *
  */
-typedef struct {
+typedef struct job_state {
 	time_t   ctime;         /* Time that this entry was created         */
 	time_t   expiration;    /* Time at which credentials can be purged  */
 	uint32_t jobid;         /* SLURM job id for this credential	*/
 	time_t   revoked;       /* Time at which credentials were revoked   */
+	struct job_state *next; /* Next state in this hash bucket           */
 } job_state_t;
 
+/*
+ * A credential whose signature has already been verified. The whole
+ * signed buffer and signature are kept so a hit is an exact match.
+ */
+typedef struct {
+	uint32_t jobid;		/* SLURM job id for this credential	*/
+	uint32_t stepid;	/* SLURM step id for this credential	*/
+	time_t   expiration;	/* Time at which cred is no longer good	*/
+	char    *data;		/* Packed credential, as signed		*/
+	uint32_t datalen;	/* Length of data in bytes		*/
+	char    *signature;	/* Credential signature			*/
+	uint32_t siglen;	/* Signature length in bytes		*/
+} sig_cache_t;
+
 
 /*
  * Completion of slurm credential context
@@ -139,8 +179,14 @@ struct slurm_cred_context {
 #endif
 	enum ctx_type  type;       /* type of context (creator or verifier) */
 	void          *key;        /* private or public key                 */
-	List           job_list;   /* List of used jobids (for verifier)    */
-	List           state_list; /* List of cred states (for verifier)    */
+	job_state_t  **job_hash;   /* Used jobids, by jobid (for verifier)  */
+	uint32_t       job_cnt;    /* Entries in job_hash                   */
+	time_t         job_sweep;  /* Time job_hash was last purged         */
+	cred_state_t **cred_hash;  /* Cred states, by job and step id       */
+	uint32_t       cred_cnt;   /* Entries in cred_hash                  */
+	time_t         cred_sweep; /* Time cred_hash was last purged        */
+	sig_cache_t   *sig_cache;  /* Verified signatures (for verifier)    */
+	Buf            changes;    /* State changes since last pack         */
 
 	int          expiry_window;/* expiration window for cached creds    */
 
@@ -243,12 +289,29 @@ static void           _job_state_destroy(job_state_t   *js);
 
 static job_state_t  * _find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid);
 static job_state_t  * _insert_job_state(slurm_cred_ctx_t ctx,  uint32_t jobid);
-static int            _find_cred_state(cred_state_t *c, slurm_cred_t *cred);
+static void           _add_job_state(slurm_cred_ctx_t ctx, job_state_t *j);
+static void           _remove_job_state(slurm_cred_ctx_t ctx, job_state_t *j);
+static cred_state_t * _find_cred_state(slurm_cred_ctx_t ctx, uint32_t jobid,
+				       uint32_t stepid, time_t ctime);
+static void           _add_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s);
+static void           _remove_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s);
 
 static void _insert_cred_state(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 static void _clear_expired_job_states(slurm_cred_ctx_t ctx);
 static void _clear_expired_credential_states(slurm_cred_ctx_t ctx);
 static void _verifier_ctx_init(slurm_cred_ctx_t ctx);
+static void _verifier_ctx_fini(slurm_cred_ctx_t ctx);
+
+static void _record_job_state(slurm_cred_ctx_t ctx, job_state_t *j);
+static void _record_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s);
+static void _record_removal(slurm_cred_ctx_t ctx, uint16_t type,
+			    uint32_t jobid, uint32_t stepid, time_t ctime);
+static void _apply_changes(slurm_cred_ctx_t ctx, Buf buffer);
+
+static sig_cache_t *_sig_cache_slot(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
+static bool _sig_cache_match(sig_cache_t *slot, slurm_cred_t *cred, Buf buffer);
+static void _sig_cache_add(slurm_cred_ctx_t ctx, sig_cache_t *slot,
+			   slurm_cred_t *cred, Buf buffer);
 
 static bool _credential_replayed(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 static bool _credential_revoked(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
@@ -529,10 +592,8 @@ slurm_cred_ctx_destroy(slurm_cred_ctx_t ctx)
 		(*(g_crypto_context->ops.crypto_destroy_key))(ctx->exkey);
 	if (ctx->key)
 		(*(g_crypto_context->ops.crypto_destroy_key))(ctx->key);
-	if (ctx->job_list)
-		list_destroy(ctx->job_list);
-	if (ctx->state_list)
-		list_destroy(ctx->state_list);
+	if (ctx->type == SLURM_CRED_VERIFIER)
+		_verifier_ctx_fini(ctx);
 
 	xassert(ctx->magic = ~CRED_CTX_MAGIC);
 
@@ -1037,6 +1098,7 @@ slurm_cred_insert_jobid(slurm_cred_ctx_t ctx, uint32_t jobid)
 int
 slurm_cred_rewind(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
+	cred_state_t *s = NULL;
 	int rc = 0;
 
 	xassert(ctx != NULL);
@@ -1046,8 +1108,11 @@ slurm_cred_rewind(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type  == SLURM_CRED_VERIFIER);
 
-	rc = list_delete_all(ctx->state_list,
-			     (ListFindF) _find_cred_state, cred);
+	if ((s = _find_cred_state(ctx, cred->jobid, cred->stepid,
+				  cred->ctime))) {
+		_remove_cred_state(ctx, s);
+		rc = 1;
+	}
 
 	slurm_mutex_unlock(&ctx->mutex);
 
@@ -1088,6 +1153,7 @@ slurm_cred_revoke(slurm_cred_ctx_t ctx, uint32_t jobid, time_t time,
 	}
 
 	j->revoked = time;
+	_record_job_state(ctx, j);
 
 	slurm_mutex_unlock(&ctx->mutex);
 	return SLURM_SUCCESS;
@@ -1123,6 +1189,7 @@ slurm_cred_begin_expiration(slurm_cred_ctx_t ctx, uint32_t jobid)
 	}
 
 	j->expiration  = time(NULL) + ctx->expiry_window;
+	_record_job_state(ctx, j);
 
 	debug2 ("set revoke expiration for jobid %u to %s",
 		j->jobid, timestr (&j->expiration, buf, 64) );
@@ -1438,13 +1505,69 @@ int
 slurm_cred_ctx_pack(slurm_cred_ctx_t ctx, Buf buffer)
 {
 	slurm_mutex_lock(&ctx->mutex);
+	_clear_expired_job_states(ctx);
+	_clear_expired_credential_states(ctx);
 	_job_state_pack(ctx, buffer);
 	_cred_state_pack(ctx, buffer);
+
+	/* Changes are now recorded relative to this state */
+	if (ctx->changes)
+		set_buf_offset(ctx->changes, 0);
+	else
+		ctx->changes = init_buf(4096);
 	slurm_mutex_unlock(&ctx->mutex);
 
 	return SLURM_SUCCESS;
 }
 
+int
+slurm_cred_ctx_pack_changes(slurm_cred_ctx_t ctx, Buf buffer)
+{
+	int rc = SLURM_SUCCESS;
+
+	xassert(ctx != NULL);
+	xassert(ctx->magic == CRED_CTX_MAGIC);
+	xassert(ctx->type  == SLURM_CRED_VERIFIER);
+
+	slurm_mutex_lock(&ctx->mutex);
+	if (ctx->changes == NULL)
+		rc = SLURM_ERROR;
+	else if (get_buf_offset(ctx->changes)) {
+		packmem(get_buf_data(ctx->changes),
+			get_buf_offset(ctx->changes), buffer);
+		set_buf_offset(ctx->changes, 0);
+	}
+	slurm_mutex_unlock(&ctx->mutex);
+
+	return rc;
+}
+
+int
+slurm_cred_ctx_unpack_changes(slurm_cred_ctx_t ctx, Buf buffer)
+{
+	char *data = NULL;
+	uint32_t data_size;
+	Buf changes;
+
+	xassert(ctx != NULL);
+	xassert(ctx->magic == CRED_CTX_MAGIC);
+	xassert(ctx->type  == SLURM_CRED_VERIFIER);
+
+	safe_unpackmem_xmalloc(&data, &data_size, buffer);
+	changes = create_buf(data, data_size);
+
+	slurm_mutex_lock(&ctx->mutex);
+	_apply_changes(ctx, changes);
+	slurm_mutex_unlock(&ctx->mutex);
+
+	free_buf(changes);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	xfree(data);
+	return SLURM_ERROR;
+}
+
 int
 slurm_cred_ctx_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 {
@@ -1456,7 +1579,7 @@ slurm_cred_ctx_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 
 	/*
 	 * Unpack job state list and cred state list from buffer
-	 * appening them onto ctx->state_list and ctx->job_list.
+	 * adding them to ctx->job_hash and ctx->cred_hash.
 	 */
 	_job_state_unpack(ctx, buffer);
 	_cred_state_unpack(ctx, buffer);
@@ -1514,12 +1637,53 @@ _verifier_ctx_init(slurm_cred_ctx_t ctx)
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type == SLURM_CRED_VERIFIER);
 
-	ctx->job_list   = list_create((ListDelF) _job_state_destroy);
-	ctx->state_list = list_create((ListDelF) _cred_state_destroy);
+	ctx->job_hash  = xmalloc(sizeof(job_state_t *)  * CRED_HASH_SIZE);
+	ctx->cred_hash = xmalloc(sizeof(cred_state_t *) * CRED_HASH_SIZE);
+	ctx->sig_cache = xmalloc(sizeof(sig_cache_t)    * SIG_CACHE_SIZE);
 
 	return;
 }
 
+static void
+_verifier_ctx_fini(slurm_cred_ctx_t ctx)
+{
+	job_state_t  *j;
+	cred_state_t *s;
+	int inx;
+
+	if (ctx->job_hash) {
+		for (inx = 0; inx < CRED_HASH_SIZE; inx++) {
+			while ((j = ctx->job_hash[inx])) {
+				ctx->job_hash[inx] = j->next;
+				_job_state_destroy(j);
+			}
+		}
+		xfree(ctx->job_hash);
+	}
+	if (ctx->cred_hash) {
+		for (inx = 0; inx < CRED_HASH_SIZE; inx++) {
+			while ((s = ctx->cred_hash[inx])) {
+				ctx->cred_hash[inx] = s->next;
+				_cred_state_destroy(s);
+			}
+		}
+		xfree(ctx->cred_hash);
+	}
+	if (ctx->sig_cache) {
+		for (inx = 0; inx < SIG_CACHE_SIZE; inx++) {
+			xfree(ctx->sig_cache[inx].data);
+			xfree(ctx->sig_cache[inx].signature);
+		}
+		xfree(ctx->sig_cache);
+	}
+	if (ctx->changes) {
+		free_buf(ctx->changes);
+		ctx->changes = NULL;
+	}
+	ctx->job_cnt  = 0;
+	ctx->cred_cnt = 0;
+}
+
 
 static int
 _ctx_update_private_key(slurm_cred_ctx_t ctx, const char *path)
@@ -1671,12 +1835,26 @@ static int
 _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
 	Buf            buffer;
+	sig_cache_t   *slot;
 	int            rc;
 
 	debug("Checking credential with %u bytes of sig data", cred->siglen);
 	buffer = init_buf(4096);
 	_pack_cred(cred, buffer);
 
+	/*
+	 * A credential seen before (e.g. one presented again after
+	 * slurm_cred_rewind()) needs no second trip through the crypto
+	 * plugin. The replay and revoke checks still apply to it.
+	 */
+	slot = _sig_cache_slot(ctx, cred);
+	if (_sig_cache_match(slot, cred, buffer)) {
+		debug2("Credential signature for %u.%u found in cache",
+		       cred->jobid, cred->stepid);
+		free_buf(buffer);
+		return SLURM_SUCCESS;
+	}
+
 	rc = (*(g_crypto_context->ops.crypto_verify_sign))(ctx->key,
 							get_buf_data(buffer),
 							get_buf_offset(buffer),
@@ -1689,6 +1867,8 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 							cred->signature,
 							cred->siglen);
 	}
+	if (rc == 0)
+		_sig_cache_add(ctx, slot, cred, buffer);
 	free_buf(buffer);
 
 	if (rc) {
@@ -1699,6 +1879,59 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	return SLURM_SUCCESS;
 }
 
+/* Return the signature cache slot for a credential */
+static sig_cache_t *
+_sig_cache_slot(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
+{
+	slurm_digest_t digest;
+
+	slurm_digest(cred->signature, cred->siglen, &digest);
+	return &ctx->sig_cache[digest.h1 % SIG_CACHE_SIZE];
+}
+
+/*
+ * Return true if slot holds an unexpired signature verified for exactly
+ * this credential. buffer holds the credential as packed for signing.
+ */
+static bool
+_sig_cache_match(sig_cache_t *slot, slurm_cred_t *cred, Buf buffer)
+{
+	if ((slot->signature == NULL)		||
+	    (slot->jobid   != cred->jobid)	||
+	    (slot->stepid  != cred->stepid)	||
+	    (slot->siglen  != cred->siglen)	||
+	    (slot->datalen != get_buf_offset(buffer)))
+		return false;
+
+	if (time(NULL) > slot->expiration)
+		return false;
+
+	if (memcmp(slot->signature, cred->signature, cred->siglen) ||
+	    memcmp(slot->data, get_buf_data(buffer), slot->datalen))
+		return false;
+
+	return true;
+}
+
+/* Record a verified credential signature in slot, replacing its contents */
+static void
+_sig_cache_add(slurm_cred_ctx_t ctx, sig_cache_t *slot, slurm_cred_t *cred,
+	       Buf buffer)
+{
+	xfree(slot->data);
+	xfree(slot->signature);
+
+	slot->jobid      = cred->jobid;
+	slot->stepid     = cred->stepid;
+	slot->expiration = cred->ctime + ctx->expiry_window;
+	slot->datalen    = get_buf_offset(buffer);
+	slot->data       = xmalloc(slot->datalen);
+	memcpy(slot->data, get_buf_data(buffer), slot->datalen);
+	slot->siglen     = cred->siglen;
+	slot->signature  = xmalloc(slot->siglen);
+	memcpy(slot->signature, cred->signature, slot->siglen);
+}
+
 
 static void
 _pack_cred(slurm_cred_t *cred, Buf buffer)
@@ -1748,26 +1981,12 @@ _pack_cred(slurm_cred_t *cred, Buf buffer)
 static bool
 _credential_replayed(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
-	ListIterator  i = NULL;
-	cred_state_t *s = NULL;
-
 	_clear_expired_credential_states(ctx);
 
-	i = list_iterator_create(ctx->state_list);
-
-	while ((s = list_next(i))) {
-		if ((s->jobid  == cred->jobid)  &&
-		    (s->stepid == cred->stepid) &&
-		    (s->ctime  == cred->ctime))
-			break;
-	}
-
-	list_iterator_destroy(i);
-
 	/*
 	 * If we found a match, this credential is being replayed.
 	 */
-	if (s)
+	if (_find_cred_state(ctx, cred->jobid, cred->stepid, cred->ctime))
 		return true;
 
 	/*
@@ -1809,11 +2028,7 @@ slurm_cred_handle_reissue(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 		 * credential to any ensuing commands. */
 		info("reissued job credential for job %u", j->jobid);
 
-		/* Setting j->expiration to zero will make
-		 * _clear_expired_job_states() remove this
-		 * job credential from the cred context. */
-		j->expiration = 0;
-		_clear_expired_job_states(ctx);
+		_remove_job_state(ctx, j);
 	}
 }
 
@@ -1854,36 +2069,76 @@ _credential_revoked(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 }
 
 
+static inline int
+_job_hash_inx(uint32_t jobid)
+{
+	return (jobid % CRED_HASH_SIZE);
+}
+
+static inline int
+_cred_hash_inx(uint32_t jobid, uint32_t stepid)
+{
+	return ((jobid + (stepid * 31)) % CRED_HASH_SIZE);
+}
+
 static job_state_t *
 _find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
 {
-	ListIterator  i = NULL;
-	job_state_t  *j = NULL;
+	job_state_t  *j = ctx->job_hash[_job_hash_inx(jobid)];
 
-	i = list_iterator_create(ctx->job_list);
-	while ((j = list_next(i))) {
-		if (j->jobid == jobid)
-			break;
-	}
-	list_iterator_destroy(i);
+	while (j && (j->jobid != jobid))
+		j = j->next;
 	return j;
 }
 
-static int
-_find_cred_state(cred_state_t *c, slurm_cred_t *cred)
+static cred_state_t *
+_find_cred_state(slurm_cred_ctx_t ctx, uint32_t jobid, uint32_t stepid,
+		 time_t ctime)
 {
-	return ((c->jobid == cred->jobid) && (c->stepid == cred->stepid) &&
-		(c->ctime == cred->ctime));
+	cred_state_t *s = ctx->cred_hash[_cred_hash_inx(jobid, stepid)];
+
+	while (s && ((s->jobid  != jobid)  ||
+		     (s->stepid != stepid) ||
+		     (s->ctime  != ctime)))
+		s = s->next;
+	return s;
+}
+
+static void
+_add_job_state(slurm_cred_ctx_t ctx, job_state_t *j)
+{
+	int inx = _job_hash_inx(j->jobid);
+
+	j->next = ctx->job_hash[inx];
+	ctx->job_hash[inx] = j;
+	ctx->job_cnt++;
 }
 
 static job_state_t *
 _insert_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
 {
 	job_state_t *j = _job_state_create(jobid);
-	list_append(ctx->job_list, j);
+	_add_job_state(ctx, j);
+	_record_job_state(ctx, j);
 	return j;
 }
 
+/* Unlink job state j from the context and destroy it */
+static void
+_remove_job_state(slurm_cred_ctx_t ctx, job_state_t *j)
+{
+	job_state_t **jp = &ctx->job_hash[_job_hash_inx(j->jobid)];
+
+	while (*jp && (*jp != j))
+		jp = &(*jp)->next;
+	if (*jp == NULL)
+		return;
+	*jp = j->next;
+	ctx->job_cnt--;
+	_record_removal(ctx, CRED_CHANGE_JOB_DEL, j->jobid, 0, 0);
+	_job_state_destroy(j);
+}
+
 
 static job_state_t *
 _job_state_create(uint32_t jobid)
@@ -1907,37 +2162,54 @@ _job_state_destroy(job_state_t *j)
 
 
 static void
-_clear_expired_job_states(slurm_cred_ctx_t ctx)
+_log_job_state(job_state_t *j)
 {
 	char          t1[64], t2[64], t3[64];
-	time_t        now = time(NULL);
-	ListIterator  i   = NULL;
-	job_state_t  *j   = NULL;
 
-	i = list_iterator_create(ctx->job_list);
+	if (j->revoked) {
+		strcpy(t2, " revoked:");
+		timestr(&j->revoked, (t2+9), (64-9));
+	} else {
+		t2[0] = '\0';
+	}
+	if (j->expiration) {
+		strcpy(t3, " expires:");
+		timestr(&j->revoked, (t3+9), (64-9));
+	} else {
+		t3[0] = '\0';
+	}
+	debug3("state for jobid %u: ctime:%s%s%s",
+	       j->jobid, timestr(&j->ctime, t1, 64), t2, t3);
+}
 
-	while ((j = list_next(i))) {
-		if (j->revoked) {
-			strcpy(t2, " revoked:");
-			timestr(&j->revoked, (t2+9), (64-9));
-		} else {
-			t2[0] = '\0';
-		}
-		if (j->expiration) {
-			strcpy(t3, " expires:");
-			timestr(&j->revoked, (t3+9), (64-9));
-		} else {
-			t3[0] = '\0';
-		}
-		debug3("state for jobid %u: ctime:%s%s%s",
-		       j->jobid, timestr(&j->ctime, t1, 64), t2, t3);
 
-		if (j->revoked && (now > j->expiration)) {
-			list_delete_item(i);
+static void
+_clear_expired_job_states(slurm_cred_ctx_t ctx)
+{
+	time_t        now = time(NULL);
+	job_state_t **jp, *j;
+	int           inx;
+
+	/*
+	 * Expiration times have one second resolution, so one sweep
+	 * per second removes everything a sweep on every call would.
+	 */
+	if (now == ctx->job_sweep)
+		return;
+	ctx->job_sweep = now;
+
+	for (inx = 0; inx < CRED_HASH_SIZE; inx++) {
+		jp = &ctx->job_hash[inx];
+		while ((j = *jp)) {
+			_log_job_state(j);
+			if (j->revoked && (now > j->expiration)) {
+				*jp = j->next;
+				ctx->job_cnt--;
+				_job_state_destroy(j);
+			} else
+				jp = &j->next;
 		}
 	}
-
-	list_iterator_destroy(i);
 }
 
 
@@ -1945,17 +2217,54 @@ static void
 _clear_expired_credential_states(slurm_cred_ctx_t ctx)
 {
 	time_t        now = time(NULL);
-	ListIterator  i   = NULL;
-	cred_state_t *s   = NULL;
+	cred_state_t **sp, *s;
+	int           inx;
 
-	i = list_iterator_create(ctx->state_list);
-
-	while ((s = list_next(i))) {
-		if (now > s->expiration)
-			list_delete_item(i);
+	if (now == ctx->cred_sweep)
+		return;
+	ctx->cred_sweep = now;
+
+	for (inx = 0; inx < CRED_HASH_SIZE; inx++) {
+		sp = &ctx->cred_hash[inx];
+		while ((s = *sp)) {
+			if (now > s->expiration) {
+				*sp = s->next;
+				ctx->cred_cnt--;
+				_cred_state_destroy(s);
+			} else
+				sp = &s->next;
+		}
 	}
+}
+
+
+static void
+_add_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s)
+{
+	int inx = _cred_hash_inx(s->jobid, s->stepid);
+
+	s->next = ctx->cred_hash[inx];
+	ctx->cred_hash[inx] = s;
+	ctx->cred_cnt++;
+}
 
-	list_iterator_destroy(i);
+
+/* Unlink credential state s from the context and destroy it */
+static void
+_remove_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s)
+{
+	cred_state_t **sp;
+
+	sp = &ctx->cred_hash[_cred_hash_inx(s->jobid, s->stepid)];
+	while (*sp && (*sp != s))
+		sp = &(*sp)->next;
+	if (*sp == NULL)
+		return;
+	*sp = s->next;
+	ctx->cred_cnt--;
+	_record_removal(ctx, CRED_CHANGE_CRED_DEL, s->jobid, s->stepid,
+			s->ctime);
+	_cred_state_destroy(s);
 }
 
 
@@ -1963,7 +2272,8 @@ static void
 _insert_cred_state(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
 	cred_state_t *s = _cred_state_create(ctx, cred);
-	list_append(ctx->state_list, s);
+	_add_cred_state(ctx, s);
+	_record_cred_state(ctx, s);
 }
 
 
@@ -2064,18 +2374,133 @@ unpack_error:
 }
 
 
+/*
+ * Stop recording changes once too many have piled up between packs.
+ * slurm_cred_ctx_pack_changes() then fails until the next full pack.
+ */
+static void
+_check_changes_size(slurm_cred_ctx_t ctx)
+{
+	if (get_buf_offset(ctx->changes) > CRED_CHANGES_MAX) {
+		debug("too many credential state changes, dropping them");
+		free_buf(ctx->changes);
+		ctx->changes = NULL;
+	}
+}
+
+
+static void
+_record_job_state(slurm_cred_ctx_t ctx, job_state_t *j)
+{
+	if (ctx->changes == NULL)
+		return;
+	pack16(CRED_CHANGE_JOB, ctx->changes);
+	_job_state_pack_one(j, ctx->changes);
+	_check_changes_size(ctx);
+}
+
+
+static void
+_record_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s)
+{
+	if (ctx->changes == NULL)
+		return;
+	pack16(CRED_CHANGE_CRED, ctx->changes);
+	_cred_state_pack_one(s, ctx->changes);
+	_check_changes_size(ctx);
+}
+
+
+static void
+_record_removal(slurm_cred_ctx_t ctx, uint16_t type, uint32_t jobid,
+		uint32_t stepid, time_t ctime)
+{
+	if (ctx->changes == NULL)
+		return;
+	pack16(type, ctx->changes);
+	pack32(jobid, ctx->changes);
+	if (type == CRED_CHANGE_CRED_DEL) {
+		pack32(stepid, ctx->changes);
+		pack_time(ctime, ctx->changes);
+	}
+	_check_changes_size(ctx);
+}
+
+
+/*
+ * Apply the change records in buffer to ctx, in order. States which
+ * have since expired are dropped just as _job_state_unpack() and
+ * _cred_state_unpack() would.
+ */
+static void
+_apply_changes(slurm_cred_ctx_t ctx, Buf buffer)
+{
+	time_t        now = time(NULL);
+	uint16_t      type;
+	uint32_t      jobid, stepid;
+	time_t        ctime;
+	job_state_t  *j, *old_j;
+	cred_state_t *s;
+
+	while (remaining_buf(buffer) > 0) {
+		safe_unpack16(&type, buffer);
+		switch (type) {
+		case CRED_CHANGE_JOB:
+			if (!(j = _job_state_unpack_one(buffer)))
+				goto unpack_error;
+			if ((old_j = _find_job_state(ctx, j->jobid)))
+				_remove_job_state(ctx, old_j);
+			if (!j->revoked || (now < j->expiration))
+				_add_job_state(ctx, j);
+			else
+				_job_state_destroy(j);
+			break;
+		case CRED_CHANGE_JOB_DEL:
+			safe_unpack32(&jobid, buffer);
+			if ((j = _find_job_state(ctx, jobid)))
+				_remove_job_state(ctx, j);
+			break;
+		case CRED_CHANGE_CRED:
+			if (!(s = _cred_state_unpack_one(buffer)))
+				goto unpack_error;
+			if ((now < s->expiration) &&
+			    !_find_cred_state(ctx, s->jobid, s->stepid,
+					      s->ctime))
+				_add_cred_state(ctx, s);
+			else
+				_cred_state_destroy(s);
+			break;
+		case CRED_CHANGE_CRED_DEL:
+			safe_unpack32(&jobid, buffer);
+			safe_unpack32(&stepid, buffer);
+			safe_unpack_time(&ctime, buffer);
+			if ((s = _find_cred_state(ctx, jobid, stepid, ctime)))
+				_remove_cred_state(ctx, s);
+			break;
+		default:
+			goto unpack_error;
+		}
+	}
+	return;
+
+unpack_error:
+	error("Unable to unpack job credential state changes");
+	return;
+}
+
+
 static void
 _cred_state_pack(slurm_cred_ctx_t ctx, Buf buffer)
 {
-	ListIterator  i = NULL;
 	cred_state_t *s = NULL;
+	int           inx;
 
-	pack32(list_count(ctx->state_list), buffer);
+	pack32(ctx->cred_cnt, buffer);
 
-	i = list_iterator_create(ctx->state_list);
-	while ((s = list_next(i)))
-		_cred_state_pack_one(s, buffer);
-	list_iterator_destroy(i);
+	for (inx = 0; inx < CRED_HASH_SIZE; inx++) {
+		for (s = ctx->cred_hash[inx]; s; s = s->next)
+			_cred_state_pack_one(s, buffer);
+	}
 }
 
 
@@ -2094,7 +2519,9 @@ _cred_state_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 			goto unpack_error;
 
 		if (now < s->expiration)
-			list_append(ctx->state_list, s);
+			_add_cred_state(ctx, s);
+		else
+			_cred_state_destroy(s);
 	}
 
 	return;
@@ -2108,16 +2535,15 @@ unpack_error:
 static void
 _job_state_pack(slurm_cred_ctx_t ctx, Buf buffer)
 {
-	ListIterator  i = NULL;
 	job_state_t  *j = NULL;
+	int           inx;
 
-	pack32((uint32_t) list_count(ctx->job_list), buffer);
-
+	pack32(ctx->job_cnt, buffer);
 
-	i = list_iterator_create(ctx->job_list);
-	while ((j = list_next(i)))
-		_job_state_pack_one(j, buffer);
-	list_iterator_destroy(i);
+	for (inx = 0; inx < CRED_HASH_SIZE; inx++) {
+		for (j = ctx->job_hash[inx]; j; j = j->next)
+			_job_state_pack_one(j, buffer);
+	}
 }
 
 
@@ -2136,10 +2562,11 @@ _job_state_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 			goto unpack_error;
 
 		if (!j->revoked || (j->revoked && (now < j->expiration)))
-			list_append(ctx->job_list, j);
+			_add_job_state(ctx, j);
 		else {
 			debug3 ("not appending expired job %u state",
 				j->jobid);
+			_job_state_destroy(j);
 		}
 	}
 
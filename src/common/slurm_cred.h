@@ -134,6 +134,20 @@ void slurm_cred_ctx_destroy(slurm_cred_ctx_t ctx);
 int  slurm_cred_ctx_pack(slurm_cred_ctx_t ctx, Buf buffer);
 int  slurm_cred_ctx_unpack(slurm_cred_ctx_t ctx, Buf buffer);
 
+/*
+ * Pack and unpack the changes made to a verifier context since it was
+ * last packed.
+ *
+ * On pack() the changes made since the last slurm_cred_ctx_pack() or
+ * slurm_cred_ctx_pack_changes() are packed into the buffer, or nothing
+ * if there were none. SLURM_ERROR is returned if the changes are not
+ * known, because ctx was never packed or too many changes were made;
+ * pack the whole context with slurm_cred_ctx_pack() then. On unpack()
+ * one packed set of changes is applied to the state of ctx.
+ */
+int  slurm_cred_ctx_pack_changes(slurm_cred_ctx_t ctx, Buf buffer);
+int  slurm_cred_ctx_unpack_changes(slurm_cred_ctx_t ctx, Buf buffer);
+
 
 /*
  * Container for SLURM credential create and verify arguments
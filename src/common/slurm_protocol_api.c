@@ -71,6 +71,8 @@
 #include "src/common/xstring.h"
 #include "src/common/log.h"
 #include "src/common/forward.h"
+#include "src/common/lz.h"
+#include "src/common/timers.h"
 #include "src/slurmdbd/read_config.h"
 #include "src/common/slurm_accounting_storage.h"
 
@@ -80,6 +82,7 @@
 #define _DEBUG	0
 #define MAX_SHUTDOWN_RETRY 5
 #define MAX_RETRIES 3
+#define MSG_ARENA_CHUNK (16 * 1024)
 
 /* STATIC VARIABLES */
 /* static pthread_mutex_t config_lock = PTHREAD_MUTEX_INITIALIZER; */
@@ -92,6 +95,11 @@ static int message_timeout = -1;
 static char *_global_auth_key(void);
 static void  _remap_slurmctld_errno(void);
 static int   _unpack_msg_uid(Buf buffer);
+static Buf   _compress_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer,
+			   uint32_t body_offset, char *body,
+			   uint32_t body_len);
+static int   _uncompress_msg(header_t *hdr, Buf *buffer);
+static xarena_t _msg_arena_create(uint16_t msg_type);
 
 #if _DEBUG
 static void _print_data(char *data, int len);
@@ -722,6 +730,24 @@ char *slurm_get_state_save_location(void)
 	return state_save_loc;
 }
 
+/* slurm_get_max_dbd_msgs
+ * get max_dbd_msgs from slurmctld_conf object
+ * RET uint32_t   - max number of messages queued for the slurmdbd
+ */
+uint32_t slurm_get_max_dbd_msgs(void)
+{
+	uint32_t max_dbd_msgs = 0;
+	slurm_ctl_conf_t *conf;
+
+	if (slurmdbd_conf) {
+	} else {
+		conf = slurm_conf_lock();
+		max_dbd_msgs = conf->max_dbd_msgs;
+		slurm_conf_unlock();
+	}
+	return max_dbd_msgs;
+}
+
 /* slurm_get_auth_type
  * returns the authentication type from slurmctld_conf object
  * RET char *    - auth type, MUST be xfreed by caller
@@ -1409,6 +1435,24 @@ char *slurm_get_jobcomp_loc(void)
 	return jobcomp_loc;
 }
 
+/* slurm_get_jobcomp_params
+ * returns the job completion parameters from slurmctld_conf object
+ * RET char *    - value of JobCompParams,  MUST be xfreed by caller
+ */
+char *slurm_get_jobcomp_params(void)
+{
+	char *jobcomp_params = NULL;
+	slurm_ctl_conf_t *conf;
+
+	if (slurmdbd_conf) {
+	} else {
+		conf = slurm_conf_lock();
+		jobcomp_params = xstrdup(conf->job_comp_params);
+		slurm_conf_unlock();
+	}
+	return jobcomp_params;
+}
+
 /* slurm_get_jobcomp_user
  * returns the storage user from slurmctld_conf object
  * RET char *    - storage user,  MUST be xfreed by caller
@@ -1627,6 +1671,57 @@ extern char *slurm_get_sched_params(void)
 	return params;
 }
 
+/* slurm_get_comm_params
+ * RET char * - Value of CommunicationParameters, MUST be xfreed by caller */
+extern char *slurm_get_comm_params(void)
+{
+	char *params = NULL;
+	slurm_ctl_conf_t *conf;
+
+	if (slurmdbd_conf) {
+	} else {
+		conf = slurm_conf_lock();
+		params = xstrdup(conf->comm_params);
+		slurm_conf_unlock();
+	}
+	return params;
+}
+
+/* slurm_get_msg_compress_min
+ * RET uint32_t - smallest message body to compress in bytes as set by
+ *	CommunicationParameters, zero if compression is disabled */
+extern uint32_t slurm_get_msg_compress_min(void)
+{
+	uint32_t min_size = DEFAULT_MSG_COMPRESS_MIN;
+	bool compress = false;
+	char *params = NULL, *tok, *last = NULL;
+	slurm_ctl_conf_t *conf;
+
+	if (slurmdbd_conf) {
+	} else {
+		conf = slurm_conf_lock();
+		params = xstrdup(conf->comm_params);
+		slurm_conf_unlock();
+	}
+
+	tok = params ? strtok_r(params, ",", &last) : NULL;
+	while (tok) {
+		if (!strcasecmp(tok, "compress"))
+			compress = true;
+		else if (!strncasecmp(tok, "compress_min=", 13))
+			min_size = strtoul(tok + 13, NULL, 10);
+		tok = strtok_r(NULL, ",", &last);
+	}
+	xfree(params);
+
+	if (!compress)
+		return 0;
+	/* a body must hold the length and a literal run */
+	if (min_size < 16)
+		min_size = 16;
+	return min_size;
+}
+
 /* slurm_get_sched_port
  * RET uint16_t  - Value of SchedulerPort */
 extern uint16_t slurm_get_sched_port(void)
@@ -2186,18 +2281,29 @@ int slurm_receive_msg(slurm_fd_t fd, slurm_msg_t *msg, int timeout)
 		goto total_return;
 	}
 
+	if ((header.flags & SLURM_MSG_COMPRESSED) &&
+	    (_uncompress_msg(&header, &buffer) != SLURM_SUCCESS)) {
+		(void) g_slurm_auth_destroy(auth_cred);
+		free_buf(buffer);
+		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
+		goto total_return;
+	}
+
 	/*
 	 * Unpack message body
 	 */
 	msg->protocol_version = header.version;
 	msg->msg_type = header.msg_type;
 	msg->flags = header.flags;
+	buffer->arena = msg->arena = _msg_arena_create(msg->msg_type);
 
 	if ((header.body_length > remaining_buf(buffer)) ||
 	    (unpack_msg(msg, buffer) != SLURM_SUCCESS)) {
 		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
 		(void) g_slurm_auth_destroy(auth_cred);
 		free_buf(buffer);
+		xarena_destroy(msg->arena);
+		msg->arena = NULL;
 		goto total_return;
 	}
 
@@ -2353,6 +2459,14 @@ List slurm_receive_msgs(slurm_fd_t fd, int steps, int timeout)
 		goto total_return;
 	}
 
+	if ((header.flags & SLURM_MSG_COMPRESSED) &&
+	    (_uncompress_msg(&header, &buffer) != SLURM_SUCCESS)) {
+		(void) g_slurm_auth_destroy(auth_cred);
+		free_buf(buffer);
+		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
+		goto total_return;
+	}
+
 	/*
 	 * Unpack message body
 	 */
@@ -2583,16 +2697,27 @@ int slurm_receive_msg_and_forward(slurm_fd_t fd, slurm_addr_t *orig_addr,
 		goto total_return;
 	}
 
+	if ((header.flags & SLURM_MSG_COMPRESSED) &&
+	    (_uncompress_msg(&header, &buffer) != SLURM_SUCCESS)) {
+		(void) g_slurm_auth_destroy(auth_cred);
+		free_buf(buffer);
+		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
+		goto total_return;
+	}
+
 	/*
 	 * Unpack message body
 	 */
 	msg->msg_type = header.msg_type;
 	msg->flags = header.flags;
+	buffer->arena = msg->arena = _msg_arena_create(msg->msg_type);
 
 	if ( (header.body_length > remaining_buf(buffer)) ||
 	     (unpack_msg(msg, buffer) != SLURM_SUCCESS) ) {
 		(void) g_slurm_auth_destroy(auth_cred);
 		free_buf(buffer);
+		xarena_destroy(msg->arena);
+		msg->arena = NULL;
 		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
 		goto total_return;
 	}
@@ -2623,18 +2748,135 @@ total_return:
  * send message functions
 \**********************************************************************/
 
+/*
+ *  Compress a packed message body of body_len bytes if compression is
+ *  enabled and the body is large enough to be worth it. On success hdr is
+ *  updated and repacked at the start of buffer, buffer is truncated to
+ *  hold only the header and auth credential (body_offset bytes) and the
+ *  compressed body is returned, which must be freed by the caller.
+ *  RET compressed body or NULL if the message is to be sent as is
+ */
+static Buf
+_compress_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer,
+	      uint32_t body_offset, char *body, uint32_t body_len)
+{
+	uint32_t min_size, zlen;
+	Buf zbuf;
+	DEF_TIMERS;
+
+	min_size = slurm_get_msg_compress_min();
+	if (!min_size || (body_len < min_size))
+		return NULL;
+
+	/* Compressed body is the original length followed by lz data,
+	 * give up unless that comes out smaller than the original */
+	START_TIMER;
+	zbuf = create_buf(xmalloc_nz(body_len), body_len);
+	pack32(body_len, zbuf);
+	zlen = lz_compress(body, body_len, get_buf_data(zbuf) + sizeof(uint32_t),
+			   body_len - sizeof(uint32_t));
+	END_TIMER;
+	if (zlen == 0) {
+		debug3("msg_type=%u body of %u bytes not compressible %s",
+		       msg->msg_type, body_len, TIME_STR);
+		free_buf(zbuf);
+		return NULL;
+	}
+	set_buf_offset(zbuf, sizeof(uint32_t) + zlen);
+	debug2("compressed msg_type=%u body from %u to %u bytes "
+	       "(ratio %.2f) %s", msg->msg_type, body_len,
+	       get_buf_offset(zbuf),
+	       (double) body_len / (double) get_buf_offset(zbuf), TIME_STR);
+
+	hdr->flags |= SLURM_MSG_COMPRESSED;
+	update_header(hdr, get_buf_offset(zbuf));
+	set_buf_offset(buffer, 0);
+	pack_header(hdr, buffer);
+	set_buf_offset(buffer, body_offset);
+
+	return zbuf;
+}
+
+/*
+ *  Replace a buffer positioned at a compressed message body with a new
+ *  one holding the decompressed body and clear the header's compressed
+ *  flag.
+ *  RET SLURM_SUCCESS or SLURM_ERROR if the body is corrupt
+ */
+static int
+_uncompress_msg(header_t *hdr, Buf *buffer)
+{
+	uint32_t raw_len, zlen;
+	char *raw;
+	Buf zbuf = *buffer;
+	DEF_TIMERS;
+
+	if ((hdr->body_length < sizeof(uint32_t)) ||
+	    (hdr->body_length > remaining_buf(zbuf)))
+		return SLURM_ERROR;
+	zlen = hdr->body_length - sizeof(uint32_t);
+	safe_unpack32(&raw_len, zbuf);
+	if (raw_len > MAX_BUF_SIZE)
+		return SLURM_ERROR;
+
+	START_TIMER;
+	raw = xmalloc_nz(raw_len);
+	if (lz_decompress(&zbuf->head[zbuf->processed], zlen, raw, raw_len)
+	    != raw_len) {
+		error("msg_type=%u: corrupt compressed message body",
+		      hdr->msg_type);
+		xfree(raw);
+		return SLURM_ERROR;
+	}
+	END_TIMER;
+	debug3("uncompressed msg_type=%u body from %u to %u bytes %s",
+	       hdr->msg_type, hdr->body_length, raw_len, TIME_STR);
+
+	free_buf(zbuf);
+	*buffer = create_buf(raw, raw_len);
+	hdr->body_length = raw_len;
+	hdr->flags &= (~SLURM_MSG_COMPRESSED);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	return SLURM_ERROR;
+}
+
+/*
+ *  Return an arena to unpack a message of the given type into, or NULL
+ *  to unpack it onto the heap. Only request types whose handlers copy
+ *  (rather than keep) the strings and arrays they need qualify.
+ */
+static xarena_t
+_msg_arena_create(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case REQUEST_RESOURCE_ALLOCATION:
+	case REQUEST_JOB_WILL_RUN:
+	case REQUEST_SUBMIT_BATCH_JOB:
+		return xarena_create(MSG_ARENA_CHUNK);
+	default:
+		return NULL;
+	}
+}
+
 /*
  *  Do the wonderful stuff that needs be done to pack msg
- *  and hdr into buffer
+ *  and hdr into buffer. Pre-packed message bodies are left out of
+ *  buffer, only the header is updated to account for them.
  */
 static void
 _pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
 {
 	unsigned int tmplen, msglen;
 
-	tmplen = get_buf_offset(buffer);
-	pack_msg(msg, buffer);
-	msglen = get_buf_offset(buffer) - tmplen;
+	if (msg_body_prepacked(msg))
+		msglen = msg->data_size;
+	else {
+		tmplen = get_buf_offset(buffer);
+		pack_msg(msg, buffer);
+		msglen = get_buf_offset(buffer) - tmplen;
+	}
 
 	/* update header with correct cred and msg lengths */
 	update_header(hdr, msglen);
@@ -2657,6 +2899,10 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 	int      rc;
 	void *   auth_cred;
 	uint16_t auth_flags = SLURM_PROTOCOL_NO_FLAGS;
+	Buf      zbuf = NULL;
+	struct iovec iov[2];
+	int      iovcnt = 1;
+	uint32_t body_offset;
 
 	/*
 	 * Initialize header with Auth credential and message type.
@@ -2678,7 +2924,14 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 	}
 	forward_wait(msg);
 
-	init_header(&header, msg, msg->flags);
+	/*
+	 * SLURM_MSG_COMPRESSED is only set in the header if the body
+	 * really is compressed below. Let the peer know it may compress
+	 * its response to us.
+	 */
+	init_header(&header, msg,
+		    (msg->flags & (~SLURM_MSG_COMPRESSED)) |
+		    SLURM_MSG_ACCEPT_COMPRESSED);
 
 	/*
 	 * Pack header into buffer for transmission
@@ -2699,9 +2952,36 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 	}
 
 	/*
-	 * Pack message into buffer
+	 * Pack message into buffer. Bodies which were already packed by
+	 * the caller (e.g. state dumps) are sent straight from msg->data
+	 * rather than being copied in behind the header.
 	 */
+	body_offset = get_buf_offset(buffer);
 	_pack_msg(msg, &header, buffer);
+	if (msg_body_prepacked(msg)) {
+		iov[1].iov_base = msg->data;
+		iov[1].iov_len  = msg->data_size;
+		iovcnt = 2;
+	} else {
+		/* body stays in buffer unless compressed below */
+		iov[1].iov_base = get_buf_data(buffer) + body_offset;
+		iov[1].iov_len  = get_buf_offset(buffer) - body_offset;
+	}
+
+	/*
+	 * Compress large bodies if either the caller asked for it or the
+	 * peer told us it can take it (i.e. we are answering its request)
+	 */
+	if ((msg->flags &
+	     (SLURM_MSG_COMPRESSED | SLURM_MSG_ACCEPT_COMPRESSED)) &&
+	    (zbuf = _compress_msg(msg, &header, buffer, body_offset,
+				  iov[1].iov_base, iov[1].iov_len))) {
+		iov[1].iov_base = get_buf_data(zbuf);
+		iov[1].iov_len  = get_buf_offset(zbuf);
+		iovcnt = 2;
+	}
+	iov[0].iov_base = get_buf_data(buffer);
+	iov[0].iov_len  = get_buf_offset(buffer);
 
 #if	_DEBUG
 	_print_data (get_buf_data(buffer),get_buf_offset(buffer));
@@ -2709,9 +2989,8 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 	/*
 	 * Send message
 	 */
-	rc = _slurm_msg_sendto( fd, get_buf_data(buffer),
-				get_buf_offset(buffer),
-				SLURM_PROTOCOL_NO_SEND_RECV_FLAGS );
+	rc = _slurm_msg_sendv(fd, iov, iovcnt,
+			      SLURM_PROTOCOL_NO_SEND_RECV_FLAGS);
 
 	if ((rc < 0) && (errno == ENOTCONN)) {
 		debug3("slurm_msg_sendto: peer has disappeared for msg_type=%u",
@@ -2726,6 +3005,8 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 		      addr_str, msg->msg_type);
 	}
 
+	if (zbuf)
+		free_buf(zbuf);
 	free_buf(buffer);
 	return rc;
 }
@@ -3544,6 +3825,7 @@ extern void slurm_free_msg(slurm_msg_t * msg)
 		msg->ret_list = NULL;
 	}
 
+	xarena_destroy(msg->arena);
 	xfree(msg);
 }
 
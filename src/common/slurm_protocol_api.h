@@ -303,6 +303,12 @@ uint16_t slurm_get_private_data(void);
  */
 char *slurm_get_state_save_location(void);
 
+/* slurm_get_max_dbd_msgs
+ * get max_dbd_msgs from slurmctld_conf object
+ * RET uint32_t   - max number of messages queued for the slurmdbd
+ */
+uint32_t slurm_get_max_dbd_msgs(void);
+
 /* slurm_get_auth_type
  * returns the authentication type from slurmctld_conf object
  * RET char *    - auth type, MUST be xfreed by caller
@@ -472,6 +478,12 @@ char *slurm_get_jobcomp_type(void);
  */
 char *slurm_get_jobcomp_loc(void);
 
+/* slurm_get_jobcomp_params
+ * returns the job completion parameters from slurmctld_conf object
+ * RET char *    - value of JobCompParams,  MUST be xfreed by caller
+ */
+char *slurm_get_jobcomp_params(void);
+
 /* slurm_get_jobcomp_user
  * returns the storage user from slurmctld_conf object
  * RET char *    - storage user,  MUST be xfreed by caller
@@ -527,6 +539,15 @@ extern uint16_t slurm_get_root_filter(void);
  * RET char * - Value of SchedulerParameters, MUST be xfreed by caller */
 extern char *slurm_get_sched_params(void);
 
+/* slurm_get_comm_params
+ * RET char * - Value of CommunicationParameters, MUST be xfreed by caller */
+extern char *slurm_get_comm_params(void);
+
+/* slurm_get_msg_compress_min
+ * RET uint32_t - smallest message body to compress in bytes as set by
+ *	CommunicationParameters, zero if compression is disabled */
+extern uint32_t slurm_get_msg_compress_min(void);
+
 /* slurm_get_sched_port
  * RET uint16_t  - Value of SchedulerPort */
 extern uint16_t slurm_get_sched_port(void);
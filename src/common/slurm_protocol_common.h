@@ -79,6 +79,11 @@
 /* used to set flags to empty */
 #define SLURM_PROTOCOL_NO_FLAGS 0
 #define SLURM_GLOBAL_AUTH_KEY   0x0001
+#define SLURM_MSG_COMPRESSED    0x0002	/* message body is lz compressed,
+					 * set by a sender to request
+					 * compression of large bodies */
+#define SLURM_MSG_ACCEPT_COMPRESSED 0x0004 /* sender can read a compressed
+					    * response */
 
 #if MONGO_IMPLEMENTATION
 #  include "src/common/slurm_protocol_mongo_common.h"
@@ -1784,6 +1784,7 @@ extern void slurm_free_slurmd_status(slurmd_status_t* slurmd_status_ptr)
 {
 	if (slurmd_status_ptr) {
 		xfree(slurmd_status_ptr->hostname);
+		xfree(slurmd_status_ptr->rpc_lanes);
 		xfree(slurmd_status_ptr->slurmd_logfile);
 		xfree(slurmd_status_ptr->step_list);
 		xfree(slurmd_status_ptr->version);
@@ -2057,6 +2058,15 @@ extern void slurm_free_file_bcast_msg(file_bcast_msg_t *msg)
 		xfree(msg->block);
 		xfree(msg->fname);
 		delete_sbcast_cred(msg->cred);
+		xfree(msg->digests);
+		xfree(msg);
+	}
+}
+
+extern void slurm_free_file_bcast_resp_msg(file_bcast_resp_msg_t *msg)
+{
+	if (msg) {
+		xfree(msg->missing);
 		xfree(msg);
 	}
 }
@@ -2401,6 +2411,9 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_FILE_BCAST:
 		slurm_free_file_bcast_msg(data);
 		break;
+	case RESPONSE_FILE_BCAST:
+		slurm_free_file_bcast_resp_msg(data);
+		break;
 	case RESPONSE_SLURM_RC:
 		slurm_free_return_code_msg(data);
 		break;
@@ -2463,6 +2476,9 @@ extern uint32_t slurm_get_return_code(slurm_msg_type_t type, void *data)
 	case RESPONSE_JOB_ID:
 		rc = ((job_id_response_msg_t *)data)->return_code;
 		break;
+	case RESPONSE_FILE_BCAST:
+		rc = ((file_bcast_resp_msg_t *)data)->return_code;
+		break;
 	case RESPONSE_SLURM_RC:
 		rc = ((return_code_msg_t *)data)->return_code;
 		break;
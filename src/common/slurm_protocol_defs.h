@@ -69,6 +69,7 @@
 #include "src/common/xassert.h"
 #include "src/common/slurmdb_defs.h"
 #include "src/common/working_cluster.h"
+#include "src/common/xmalloc.h"
 
 #define MAX_SLURM_NAME 64
 #define FORWARD_INIT 0xfffe
@@ -299,6 +300,7 @@ typedef enum {
 	REQUEST_FILE_BCAST,
 	TASK_USER_MANAGED_IO_STREAM,
 	REQUEST_KILL_PREEMPTED,
+	RESPONSE_FILE_BCAST,
 
 	SRUN_PING = 7001,
 	SRUN_TIMEOUT,
@@ -394,6 +396,8 @@ typedef struct slurm_msg {
 	forward_struct_t *forward_struct;
 	slurm_addr_t orig_addr;
 	List ret_list;
+	xarena_t arena;	/* DON'T PACK! holds data's strings and arrays
+			 * when set, released by slurm_free_msg() */
 } slurm_msg_t;
 
 typedef struct ret_data_info {
@@ -667,6 +671,8 @@ typedef struct launch_tasks_request_msg {
 	char     *ifname; /* stdin filename pattern */
 	uint8_t   buffered_stdio; /* 1 for line-buffered, 0 for unbuffered */
 	uint8_t   labelio;  /* prefix output lines with the task number */
+	uint32_t  io_msg_len; /* max stdout/err message payload, 0 for
+			      * the legacy MAX_MSG_LEN */
 	uint16_t  num_io_port;
 	uint16_t  *io_port;  /* array of available client IO listen ports */
 	/**********  END  "normal" IO only options **********/
@@ -862,10 +868,29 @@ typedef struct file_bcast_msg {
 	time_t atime;		/* last access time for destination file */
 	time_t mtime;		/* last modification time for dest file */
 	sbcast_cred_t *cred;	/* credential for the RPC */
+	uint64_t block_offset;	/* file offset of this data block, or
+				 * SBCAST_APPEND_OFFSET */
 	uint32_t block_len;	/* length of this data block */
 	char *block;		/* data for this block */
+	/* Manifest of a deduplicated transfer, sent with its first message
+	 * only: a digest for each block_size bytes of the file */
+	uint32_t digest_cnt;	/* number of blocks in the file */
+	uint64_t *digests;	/* two words per block (slurm_digest_t) */
+	uint32_t block_size;	/* size of all but the last block */
+	uint64_t file_size;	/* size of the complete file */
 } file_bcast_msg_t;
 
+/* Reply to the manifest of a deduplicated file broadcast */
+typedef struct file_bcast_resp_msg {
+	uint32_t return_code;
+	uint32_t missing_cnt;	/* blocks the node must still be sent */
+	uint32_t *missing;	/* their indexes in the manifest */
+} file_bcast_resp_msg_t;
+
+/* file_bcast_msg_t block_offset of a block to be appended to the file,
+ * blocks must then arrive in order */
+#define SBCAST_APPEND_OFFSET	((uint64_t) 0xffffffffffffffffULL)
+
 typedef struct multi_core_data {
 	uint16_t sockets_per_node;	/* sockets per node required by job */
 	uint16_t cores_per_socket;	/* cores per cpu required by job */
@@ -1080,6 +1105,7 @@ extern void slurm_free_will_run_response_msg(will_run_response_msg_t *msg);
 extern void slurm_free_reserve_info_members(reserve_info_t * resv);
 extern void slurm_free_topo_info_msg(topo_info_response_msg_t *msg);
 extern void slurm_free_file_bcast_msg(file_bcast_msg_t *msg);
+extern void slurm_free_file_bcast_resp_msg(file_bcast_resp_msg_t *msg);
 extern void slurm_free_step_complete_msg(step_complete_msg_t *msg);
 extern void slurm_free_job_step_stat(void *object);
 extern void slurm_free_job_step_pids(void *object);
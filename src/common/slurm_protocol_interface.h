@@ -69,6 +69,7 @@
 
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdarg.h>
@@ -166,6 +167,23 @@ ssize_t _slurm_msg_sendto ( slurm_fd_t open_fd, char *buffer ,
 ssize_t _slurm_msg_sendto_timeout ( slurm_fd_t open_fd, char *buffer,
 				    size_t size, uint32_t flags, int timeout );
 
+/* _slurm_msg_sendv
+ * Send message over the given connection, default timeout value. The
+ *	message is gathered from several separately allocated pieces
+ *	(e.g. header and a pre-packed body) without copying them together
+ * IN open_fd - an open file descriptor
+ * IN iov - pieces of the message, in order (at most 8)
+ * IN iovcnt - number of entries in iov
+ * IN flags - communication specific flags
+ * RET number of bytes written
+ */
+ssize_t _slurm_msg_sendv ( slurm_fd_t open_fd, struct iovec *iov,
+			   int iovcnt, uint32_t flags );
+/* _slurm_msg_sendv_timeout is identical to _slurm_msg_sendv except
+ * IN timeout - maximum time to wait for a message in milliseconds */
+ssize_t _slurm_msg_sendv_timeout ( slurm_fd_t open_fd, struct iovec *iov,
+				   int iovcnt, uint32_t flags, int timeout );
+
 /* _slurm_accept_msg_conn
  * In the bsd implmentation maps directly to a accept call
  * IN open_fd		- file descriptor to accept connection on
@@ -238,6 +256,8 @@ extern inline int _slurm_set_stream_blocking ( slurm_fd_t open_fd ) ;
 
 int _slurm_send_timeout ( slurm_fd_t open_fd, char *buffer ,
 			  size_t size , uint32_t flags, int timeout ) ;
+int _slurm_send_iov_timeout ( slurm_fd_t open_fd, struct iovec *iov,
+			      int iovcnt, uint32_t flags, int timeout ) ;
 int _slurm_recv_timeout ( slurm_fd_t open_fd, char *buffer ,
 			  size_t size , uint32_t flags, int timeout ) ;
 
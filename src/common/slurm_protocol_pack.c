@@ -522,6 +522,10 @@ static void _pack_file_bcast(file_bcast_msg_t * msg , Buf buffer,
 			     uint16_t protocol_version);
 static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , Buf buffer,
 			      uint16_t protocol_version);
+static void _pack_file_bcast_resp(file_bcast_resp_msg_t *msg, Buf buffer,
+				  uint16_t protocol_version);
+static int _unpack_file_bcast_resp(file_bcast_resp_msg_t **msg_ptr,
+				   Buf buffer, uint16_t protocol_version);
 
 static void _pack_trigger_msg(trigger_info_msg_t *msg , Buf buffer,
 			      uint16_t protocol_version);
@@ -1084,6 +1088,10 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 		_pack_file_bcast((file_bcast_msg_t *) msg->data, buffer,
 				 msg->protocol_version);
 		break;
+	case RESPONSE_FILE_BCAST:
+		_pack_file_bcast_resp((file_bcast_resp_msg_t *) msg->data,
+				      buffer, msg->protocol_version);
+		break;
 	case PMI_KVS_PUT_REQ:
 	case PMI_KVS_GET_RESP:
 		_pack_kvs_data((struct kvs_comm_set *) msg->data, buffer,
@@ -1167,6 +1175,29 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 	return SLURM_SUCCESS;
 }
 
+/* msg_body_prepacked
+ * report whether a message body is an opaque buffer which was already
+ * packed by the sender and is transmitted verbatim, see _pack_buffer_msg()
+ * IN msg - the message to test
+ * RET true if the body needs no further packing
+ */
+bool
+msg_body_prepacked(slurm_msg_t const *msg)
+{
+	switch (msg->msg_type) {
+	case RESPONSE_JOB_INFO:
+	case RESPONSE_JOB_STEP_INFO:
+	case RESPONSE_BLOCK_INFO:
+	case RESPONSE_FRONT_END_INFO:
+	case RESPONSE_NODE_INFO:
+	case RESPONSE_PARTITION_INFO:
+	case RESPONSE_RESERVATION_INFO:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /* unpack_msg
  * unpacks a generic slurm protocol message body
  * OUT msg - the body structure to unpack (note: includes message type)
@@ -1621,6 +1652,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 					 & msg->data, buffer,
 					 msg->protocol_version);
 		break;
+	case RESPONSE_FILE_BCAST:
+		rc = _unpack_file_bcast_resp((file_bcast_resp_msg_t **)
+					     &msg->data, buffer,
+					     msg->protocol_version);
+		break;
 	case PMI_KVS_PUT_REQ:
 	case PMI_KVS_GET_RESP:
 		rc = _unpack_kvs_data((struct kvs_comm_set **) &msg->data,
@@ -4293,6 +4329,7 @@ _pack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t * build_ptr, Buf buffer,
 
 		packstr(build_ptr->checkpoint_type, buffer);
 		packstr(build_ptr->cluster_name, buffer);
+		packstr(build_ptr->comm_params, buffer);
 		pack16(build_ptr->complete_wait, buffer);
 		packstr(build_ptr->control_addr, buffer);
 		packstr(build_ptr->control_machine, buffer);
@@ -4328,6 +4365,7 @@ _pack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t * build_ptr, Buf buffer,
 
 		packstr(build_ptr->job_comp_host, buffer);
 		packstr(build_ptr->job_comp_loc, buffer);
+		packstr(build_ptr->job_comp_params, buffer);
 		pack32((uint32_t)build_ptr->job_comp_port, buffer);
 		packstr(build_ptr->job_comp_type, buffer);
 		packstr(build_ptr->job_comp_user, buffer);
@@ -4344,6 +4382,7 @@ _pack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t * build_ptr, Buf buffer,
 		packstr(build_ptr->licenses, buffer);
 
 		packstr(build_ptr->mail_prog, buffer);
+		pack32(build_ptr->max_dbd_msgs, buffer);
 		pack32(build_ptr->max_job_cnt, buffer);
 		pack32(build_ptr->max_job_id, buffer);
 		pack32(build_ptr->max_mem_per_cpu, buffer);
@@ -4438,6 +4477,7 @@ _pack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t * build_ptr, Buf buffer,
 
 		packstr(build_ptr->slurmd_spooldir, buffer);
 		pack16(build_ptr->slurmd_timeout, buffer);
+		pack16(build_ptr->slurmstepd_pool_size, buffer);
 		packstr(build_ptr->srun_epilog, buffer);
 		packstr(build_ptr->srun_prolog, buffer);
 		packstr(build_ptr->state_save_location, buffer);
@@ -4908,6 +4948,8 @@ _unpack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t **build_buffer_ptr,
 				       &uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&build_ptr->cluster_name,
 				       &uint32_tmp, buffer);
+		safe_unpackstr_xmalloc(&build_ptr->comm_params,
+				       &uint32_tmp, buffer);
 		safe_unpack16(&build_ptr->complete_wait, buffer);
 		safe_unpackstr_xmalloc(&build_ptr->control_addr,
 				       &uint32_tmp, buffer);
@@ -4954,6 +4996,8 @@ _unpack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t **build_buffer_ptr,
 				       &uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&build_ptr->job_comp_loc,
 				       &uint32_tmp, buffer);
+		safe_unpackstr_xmalloc(&build_ptr->job_comp_params,
+				       &uint32_tmp, buffer);
 		safe_unpack32(&build_ptr->job_comp_port, buffer);
 		safe_unpackstr_xmalloc(&build_ptr->job_comp_type,
 				       &uint32_tmp, buffer);
@@ -4978,6 +5022,7 @@ _unpack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t **build_buffer_ptr,
 
 		safe_unpackstr_xmalloc(&build_ptr->mail_prog,
 				       &uint32_tmp, buffer);
+		safe_unpack32(&build_ptr->max_dbd_msgs, buffer);
 		safe_unpack32(&build_ptr->max_job_cnt, buffer);
 		safe_unpack32(&build_ptr->max_job_id, buffer);
 		safe_unpack32(&build_ptr->max_mem_per_cpu, buffer);
@@ -5098,6 +5143,7 @@ _unpack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t **build_buffer_ptr,
 		safe_unpackstr_xmalloc(&build_ptr->slurmd_spooldir,
 				       &uint32_tmp, buffer);
 		safe_unpack16(&build_ptr->slurmd_timeout, buffer);
+		safe_unpack16(&build_ptr->slurmstepd_pool_size, buffer);
 
 		safe_unpackstr_xmalloc(&build_ptr->srun_epilog,
 				       &uint32_tmp, buffer);
@@ -6822,7 +6868,67 @@ _pack_launch_tasks_request_msg(launch_tasks_request_msg_t * msg, Buf buffer,
 {
 	int i=0;
 	xassert(msg != NULL);
-	if (protocol_version >= SLURM_2_2_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION) {
+		pack32(msg->job_id, buffer);
+		pack32(msg->job_step_id, buffer);
+		pack32(msg->ntasks, buffer);
+		pack32(msg->uid, buffer);
+		pack32(msg->gid, buffer);
+		pack32(msg->job_mem_lim, buffer);
+		pack32(msg->step_mem_lim, buffer);
+
+		pack32(msg->nnodes, buffer);
+		pack16(msg->cpus_per_task, buffer);
+		pack16(msg->task_dist, buffer);
+
+		slurm_cred_pack(msg->cred, buffer);
+		for(i=0; i<msg->nnodes; i++) {
+			pack16(msg->tasks_to_launch[i], buffer);
+			pack16(msg->cpus_allocated[i], buffer);
+			pack32_array(msg->global_task_ids[i],
+				     (uint32_t) msg->tasks_to_launch[i],
+				     buffer);
+		}
+		pack16(msg->num_resp_port, buffer);
+		for(i = 0; i < msg->num_resp_port; i++)
+			pack16(msg->resp_port[i], buffer);
+		slurm_pack_slurm_addr(&msg->orig_addr, buffer);
+		packstr_array(msg->env, msg->envc, buffer);
+		packstr_array(msg->spank_job_env, msg->spank_job_env_size,
+			      buffer);
+		packstr(msg->cwd, buffer);
+		pack16(msg->cpu_bind_type, buffer);
+		packstr(msg->cpu_bind, buffer);
+		pack16(msg->mem_bind_type, buffer);
+		packstr(msg->mem_bind, buffer);
+		packstr_array(msg->argv, msg->argc, buffer);
+		pack16(msg->task_flags, buffer);
+		pack16(msg->multi_prog, buffer);
+		pack16(msg->user_managed_io, buffer);
+		if (msg->user_managed_io == 0) {
+			packstr(msg->ofname, buffer);
+			packstr(msg->efname, buffer);
+			packstr(msg->ifname, buffer);
+			pack8(msg->buffered_stdio, buffer);
+			pack8(msg->labelio, buffer);
+			pack32(msg->io_msg_len, buffer);
+			pack16(msg->num_io_port, buffer);
+			for(i = 0; i < msg->num_io_port; i++)
+				pack16(msg->io_port[i], buffer);
+		}
+		packstr(msg->task_prolog, buffer);
+		packstr(msg->task_epilog, buffer);
+		pack16(msg->slurmd_debug, buffer);
+		switch_pack_jobinfo(msg->switch_job, buffer);
+		job_options_pack(msg->options, buffer);
+		packstr(msg->complete_nodelist, buffer);
+
+		pack8(msg->open_mode, buffer);
+		pack8(msg->pty, buffer);
+		pack16(msg->acctg_freq, buffer);
+		packstr(msg->ckpt_dir, buffer);
+		packstr(msg->restart_dir, buffer);
+	} else if (protocol_version >= SLURM_2_2_PROTOCOL_VERSION) {
 		pack32(msg->job_id, buffer);
 		pack32(msg->job_step_id, buffer);
 		pack32(msg->ntasks, buffer);
@@ -6955,7 +7061,97 @@ _unpack_launch_tasks_request_msg(launch_tasks_request_msg_t **
 	msg = xmalloc(sizeof(launch_tasks_request_msg_t));
 	*msg_ptr = msg;
 
-	if (protocol_version >= SLURM_2_2_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION) {
+		safe_unpack32(&msg->job_id, buffer);
+		safe_unpack32(&msg->job_step_id, buffer);
+		safe_unpack32(&msg->ntasks, buffer);
+		safe_unpack32(&msg->uid, buffer);
+		safe_unpack32(&msg->gid, buffer);
+		safe_unpack32(&msg->job_mem_lim, buffer);
+		safe_unpack32(&msg->step_mem_lim, buffer);
+
+		safe_unpack32(&msg->nnodes, buffer);
+		safe_unpack16(&msg->cpus_per_task, buffer);
+		safe_unpack16(&msg->task_dist, buffer);
+
+		if (!(msg->cred = slurm_cred_unpack(buffer, protocol_version)))
+			goto unpack_error;
+		msg->tasks_to_launch = xmalloc(sizeof(uint16_t) * msg->nnodes);
+		msg->cpus_allocated = xmalloc(sizeof(uint16_t) * msg->nnodes);
+		msg->global_task_ids = xmalloc(sizeof(uint32_t *) *
+					       msg->nnodes);
+		for(i=0; i<msg->nnodes; i++) {
+			safe_unpack16(&msg->tasks_to_launch[i], buffer);
+			safe_unpack16(&msg->cpus_allocated[i], buffer);
+			safe_unpack32_array(&msg->global_task_ids[i],
+					    &uint32_tmp,
+					    buffer);
+			if (msg->tasks_to_launch[i] != (uint16_t) uint32_tmp)
+				goto unpack_error;
+		}
+		safe_unpack16(&msg->num_resp_port, buffer);
+		if (msg->num_resp_port > 0) {
+			msg->resp_port = xmalloc(sizeof(uint16_t) *
+						 msg->num_resp_port);
+			for (i = 0; i < msg->num_resp_port; i++)
+				safe_unpack16(&msg->resp_port[i], buffer);
+		}
+		slurm_unpack_slurm_addr_no_alloc(&msg->orig_addr, buffer);
+		safe_unpackstr_array(&msg->env, &msg->envc, buffer);
+		safe_unpackstr_array(&msg->spank_job_env,
+				     &msg->spank_job_env_size, buffer);
+		safe_unpackstr_xmalloc(&msg->cwd, &uint32_tmp, buffer);
+		safe_unpack16(&msg->cpu_bind_type, buffer);
+		safe_unpackstr_xmalloc(&msg->cpu_bind, &uint32_tmp, buffer);
+		safe_unpack16(&msg->mem_bind_type, buffer);
+		safe_unpackstr_xmalloc(&msg->mem_bind, &uint32_tmp, buffer);
+		safe_unpackstr_array(&msg->argv, &msg->argc, buffer);
+		safe_unpack16(&msg->task_flags, buffer);
+		safe_unpack16(&msg->multi_prog, buffer);
+		safe_unpack16(&msg->user_managed_io, buffer);
+		if (msg->user_managed_io == 0) {
+			safe_unpackstr_xmalloc(&msg->ofname, &uint32_tmp,
+					       buffer);
+			safe_unpackstr_xmalloc(&msg->efname, &uint32_tmp,
+					       buffer);
+			safe_unpackstr_xmalloc(&msg->ifname, &uint32_tmp,
+					       buffer);
+			safe_unpack8(&msg->buffered_stdio, buffer);
+			safe_unpack8(&msg->labelio, buffer);
+			safe_unpack32(&msg->io_msg_len, buffer);
+			safe_unpack16(&msg->num_io_port, buffer);
+			if (msg->num_io_port > 0) {
+				msg->io_port = xmalloc(sizeof(uint16_t) *
+						       msg->num_io_port);
+				for (i = 0; i < msg->num_io_port; i++)
+					safe_unpack16(&msg->io_port[i],
+						      buffer);
+			}
+		}
+		safe_unpackstr_xmalloc(&msg->task_prolog, &uint32_tmp, buffer);
+		safe_unpackstr_xmalloc(&msg->task_epilog, &uint32_tmp, buffer);
+		safe_unpack16(&msg->slurmd_debug, buffer);
+
+		switch_alloc_jobinfo(&msg->switch_job);
+		if (switch_unpack_jobinfo(msg->switch_job, buffer) < 0) {
+			error("switch_unpack_jobinfo: %m");
+			switch_free_jobinfo(msg->switch_job);
+			goto unpack_error;
+		}
+		msg->options = job_options_create();
+		if (job_options_unpack(msg->options, buffer) < 0) {
+			error("Unable to unpack extra job options: %m");
+			goto unpack_error;
+		}
+		safe_unpackstr_xmalloc(&msg->complete_nodelist, &uint32_tmp,
+				       buffer);
+
+		safe_unpack8(&msg->open_mode, buffer);
+		safe_unpack8(&msg->pty, buffer);
+		safe_unpack16(&msg->acctg_freq, buffer);
+		safe_unpackstr_xmalloc(&msg->ckpt_dir, &uint32_tmp, buffer);
+		safe_unpackstr_xmalloc(&msg->restart_dir, &uint32_tmp, buffer);
+	} else if (protocol_version >= SLURM_2_2_PROTOCOL_VERSION) {
 		safe_unpack32(&msg->job_id, buffer);
 		safe_unpack32(&msg->job_step_id, buffer);
 		safe_unpack32(&msg->ntasks, buffer);
@@ -8975,31 +9171,58 @@ unpack_error:
 static void _pack_file_bcast(file_bcast_msg_t * msg , Buf buffer,
 			     uint16_t protocol_version)
 {
+	uint32_t i;
+
 	xassert ( msg != NULL );
 
 	grow_buf(buffer,  msg->block_len);
 
-	pack16 ( msg->block_no, buffer );
-	pack16 ( msg->last_block, buffer );
-	pack16 ( msg->force, buffer );
-	pack16 ( msg->modes, buffer );
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION) {
+		pack16 ( msg->block_no, buffer );
+		pack16 ( msg->last_block, buffer );
+		pack16 ( msg->force, buffer );
+		pack16 ( msg->modes, buffer );
+
+		pack32 ( msg->uid, buffer );
+		pack32 ( msg->gid, buffer );
+
+		pack_time ( msg->atime, buffer );
+		pack_time ( msg->mtime, buffer );
+
+		packstr ( msg->fname, buffer );
+		pack64 ( msg->block_offset, buffer );
+		pack32 ( msg->block_len, buffer );
+		packmem ( msg->block, msg->block_len, buffer );
+		pack_sbcast_cred( msg->cred, buffer );
+
+		pack32 ( msg->digest_cnt, buffer );
+		for (i = 0; i < (msg->digest_cnt * 2); i++)
+			pack64 ( msg->digests[i], buffer );
+		pack32 ( msg->block_size, buffer );
+		pack64 ( msg->file_size, buffer );
+	} else {
+		pack16 ( msg->block_no, buffer );
+		pack16 ( msg->last_block, buffer );
+		pack16 ( msg->force, buffer );
+		pack16 ( msg->modes, buffer );
 
-	pack32 ( msg->uid, buffer );
-	pack32 ( msg->gid, buffer );
+		pack32 ( msg->uid, buffer );
+		pack32 ( msg->gid, buffer );
 
-	pack_time ( msg->atime, buffer );
-	pack_time ( msg->mtime, buffer );
+		pack_time ( msg->atime, buffer );
+		pack_time ( msg->mtime, buffer );
 
-	packstr ( msg->fname, buffer );
-	pack32 ( msg->block_len, buffer );
-	packmem ( msg->block, msg->block_len, buffer );
-	pack_sbcast_cred( msg->cred, buffer );
+		packstr ( msg->fname, buffer );
+		pack32 ( msg->block_len, buffer );
+		packmem ( msg->block, msg->block_len, buffer );
+		pack_sbcast_cred( msg->cred, buffer );
+	}
 }
 
 static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , Buf buffer,
 			      uint16_t protocol_version)
 {
-	uint32_t uint32_tmp;
+	uint32_t uint32_tmp, i;
 	file_bcast_msg_t *msg ;
 
 	xassert ( msg_ptr != NULL );
@@ -9007,26 +9230,64 @@ static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , Buf buffer,
 	msg = xmalloc ( sizeof (file_bcast_msg_t) ) ;
 	*msg_ptr = msg;
 
-	safe_unpack16 ( & msg->block_no, buffer );
-	safe_unpack16 ( & msg->last_block, buffer );
-	safe_unpack16 ( & msg->force, buffer );
-	safe_unpack16 ( & msg->modes, buffer );
-
-	safe_unpack32 ( & msg->uid, buffer );
-	safe_unpack32 ( & msg->gid, buffer );
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION) {
+		safe_unpack16 ( & msg->block_no, buffer );
+		safe_unpack16 ( & msg->last_block, buffer );
+		safe_unpack16 ( & msg->force, buffer );
+		safe_unpack16 ( & msg->modes, buffer );
+
+		safe_unpack32 ( & msg->uid, buffer );
+		safe_unpack32 ( & msg->gid, buffer );
+
+		safe_unpack_time ( & msg->atime, buffer );
+		safe_unpack_time ( & msg->mtime, buffer );
+
+		safe_unpackstr_xmalloc ( & msg->fname, &uint32_tmp, buffer );
+		safe_unpack64 ( & msg->block_offset, buffer );
+		safe_unpack32 ( & msg->block_len, buffer );
+		safe_unpackmem_xmalloc ( & msg->block, &uint32_tmp , buffer ) ;
+		if ( uint32_tmp != msg->block_len )
+			goto unpack_error;
 
-	safe_unpack_time ( & msg->atime, buffer );
-	safe_unpack_time ( & msg->mtime, buffer );
+		msg->cred = unpack_sbcast_cred( buffer );
+		if (msg->cred == NULL)
+			goto unpack_error;
 
-	safe_unpackstr_xmalloc ( & msg->fname, &uint32_tmp, buffer );
-	safe_unpack32 ( & msg->block_len, buffer );
-	safe_unpackmem_xmalloc ( & msg->block, &uint32_tmp , buffer ) ;
-	if ( uint32_tmp != msg->block_len )
-		goto unpack_error;
+		safe_unpack32 ( & msg->digest_cnt, buffer );
+		if (msg->digest_cnt > (remaining_buf(buffer) / 16))
+			goto unpack_error;
+		if (msg->digest_cnt) {
+			msg->digests = xmalloc(sizeof(uint64_t) * 2 *
+					       msg->digest_cnt);
+		}
+		for (i = 0; i < (msg->digest_cnt * 2); i++)
+			safe_unpack64 ( & msg->digests[i], buffer );
+		safe_unpack32 ( & msg->block_size, buffer );
+		safe_unpack64 ( & msg->file_size, buffer );
+	} else {
+		safe_unpack16 ( & msg->block_no, buffer );
+		safe_unpack16 ( & msg->last_block, buffer );
+		safe_unpack16 ( & msg->force, buffer );
+		safe_unpack16 ( & msg->modes, buffer );
+
+		safe_unpack32 ( & msg->uid, buffer );
+		safe_unpack32 ( & msg->gid, buffer );
+
+		safe_unpack_time ( & msg->atime, buffer );
+		safe_unpack_time ( & msg->mtime, buffer );
+
+		safe_unpackstr_xmalloc ( & msg->fname, &uint32_tmp, buffer );
+		/* older sbcast sends blocks in order, one at a time */
+		msg->block_offset = SBCAST_APPEND_OFFSET;
+		safe_unpack32 ( & msg->block_len, buffer );
+		safe_unpackmem_xmalloc ( & msg->block, &uint32_tmp , buffer ) ;
+		if ( uint32_tmp != msg->block_len )
+			goto unpack_error;
 
-	msg->cred = unpack_sbcast_cred( buffer );
-	if (msg->cred == NULL)
-		goto unpack_error;
+		msg->cred = unpack_sbcast_cred( buffer );
+		if (msg->cred == NULL)
+			goto unpack_error;
+	}
 
 	return SLURM_SUCCESS;
 
@@ -9036,6 +9297,35 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void _pack_file_bcast_resp(file_bcast_resp_msg_t *msg, Buf buffer,
+				  uint16_t protocol_version)
+{
+	xassert(msg != NULL);
+
+	pack32(msg->return_code, buffer);
+	pack32_array(msg->missing, msg->missing_cnt, buffer);
+}
+
+static int _unpack_file_bcast_resp(file_bcast_resp_msg_t **msg_ptr,
+				   Buf buffer, uint16_t protocol_version)
+{
+	file_bcast_resp_msg_t *msg;
+
+	xassert(msg_ptr != NULL);
+
+	msg = xmalloc(sizeof(file_bcast_resp_msg_t));
+	*msg_ptr = msg;
+
+	safe_unpack32(&msg->return_code, buffer);
+	safe_unpack32_array(&msg->missing, &msg->missing_cnt, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_file_bcast_resp_msg(msg);
+	*msg_ptr = NULL;
+	return SLURM_ERROR;
+}
+
 static void _pack_trigger_msg(trigger_info_msg_t *msg , Buf buffer,
 			      uint16_t protocol_version)
 {
@@ -9367,6 +9657,8 @@ static void _pack_slurmd_status(slurmd_status_t *msg, Buf buffer,
 	packstr(msg->slurmd_logfile, buffer);
 	packstr(msg->step_list, buffer);
 	packstr(msg->version, buffer);
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+		packstr(msg->rpc_lanes, buffer);
 }
 
 static int _unpack_slurmd_status(slurmd_status_t **msg_ptr, Buf buffer,
@@ -9396,6 +9688,9 @@ static int _unpack_slurmd_status(slurmd_status_t **msg_ptr, Buf buffer,
 	safe_unpackstr_xmalloc(&msg->slurmd_logfile, &uint32_tmp, buffer);
 	safe_unpackstr_xmalloc(&msg->step_list,      &uint32_tmp, buffer);
 	safe_unpackstr_xmalloc(&msg->version,        &uint32_tmp, buffer);
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION) {
+		safe_unpackstr_xmalloc(&msg->rpc_lanes, &uint32_tmp, buffer);
+	}
 
 	*msg_ptr = msg;
 	return SLURM_SUCCESS;
@@ -91,6 +91,15 @@ extern int unpack_header ( header_t * header , Buf buffer );
  */
 extern int pack_msg ( slurm_msg_t const * msg , Buf buffer );
 
+/* msg_body_prepacked
+ * report whether a message body is an opaque buffer which was already
+ * packed by the sender (e.g. the slurmctld job, node and partition state
+ * dumps) and is transmitted verbatim from msg->data/msg->data_size
+ * IN msg - the message to test
+ * RET true if the body needs no further packing
+ */
+extern bool msg_body_prepacked ( slurm_msg_t const * msg );
+
 /* unpack_msg
  * unpacks a generic slurm protocol message body
  * OUT msg - the body structure to unpack (note: includes message type)
@@ -58,6 +58,7 @@
 #include <stdlib.h>
 #include <arpa/inet.h>
 #include <sys/param.h>
+#include <sys/uio.h>
 #include <stdlib.h>
 
 #if HAVE_SYS_SOCKET_H
@@ -90,6 +91,12 @@
  */
 #define MAX_MSG_SIZE     (128*1024*1024)
 
+/*
+ *  Maximum number of iovecs a caller may hand to _slurm_msg_sendv(),
+ *  one more is used internally for the message length.
+ */
+#define MAX_MSG_IOV      8
+
 /****************************************************************
  * MIDDLE LAYER MSG FUNCTIONS
  ****************************************************************/
@@ -187,9 +194,10 @@ ssize_t _slurm_msg_recvfrom_timeout(slurm_fd_t fd, char **pbuf, size_t *lenp,
 		slurm_seterrno_ret(SLURM_PROTOCOL_INSANE_MSG_LENGTH);
 
 	/*
-	 *  Allocate memory on heap for message
+	 *  Allocate memory on heap for message. It is read directly into
+	 *  and fully overwritten, so skip zeroing it.
 	 */
-	*pbuf = xmalloc(msglen);
+	*pbuf = xmalloc_nz(msglen);
 
 	if (_slurm_recv_timeout(fd, *pbuf, msglen, 0, tmout) != msglen) {
 		xfree(*pbuf);
@@ -212,28 +220,56 @@ ssize_t _slurm_msg_sendto(slurm_fd_t fd, char *buffer, size_t size,
 ssize_t _slurm_msg_sendto_timeout(slurm_fd_t fd, char *buffer, size_t size,
 				  uint32_t flags, int timeout)
 {
-	int   len;
-	uint32_t usize;
+	struct iovec iov;
+
+	iov.iov_base = buffer;
+	iov.iov_len  = size;
+	return _slurm_msg_sendv_timeout(fd, &iov, 1, flags, timeout);
+}
+
+ssize_t _slurm_msg_sendv(slurm_fd_t fd, struct iovec *iov, int iovcnt,
+			 uint32_t flags)
+{
+	return _slurm_msg_sendv_timeout(fd, iov, iovcnt, flags,
+				(slurm_get_msg_timeout() * 1000));
+}
+
+ssize_t _slurm_msg_sendv_timeout(slurm_fd_t fd, struct iovec *iov, int iovcnt,
+				 uint32_t flags, int timeout)
+{
+	struct iovec msg_iov[MAX_MSG_IOV + 1];
+	int   i, len;
+	uint32_t usize, size = 0;
 	SigFunc *ohandler;
 
+	if ((iovcnt < 1) || (iovcnt > MAX_MSG_IOV)) {
+		slurm_seterrno(EINVAL);
+		return SLURM_ERROR;
+	}
+
+	/*
+	 *  The length prefix and every piece of the message go out in
+	 *    a single gathered write, the pieces are never copied into
+	 *    one contiguous buffer.
+	 */
+	for (i = 0; i < iovcnt; i++) {
+		msg_iov[i + 1] = iov[i];
+		size += iov[i].iov_len;
+	}
+	usize = htonl(size);
+	msg_iov[0].iov_base = &usize;
+	msg_iov[0].iov_len  = sizeof(usize);
+
 	/*
 	 *  Ignore SIGPIPE so that send can return a error code if the
 	 *    other side closes the socket
 	 */
 	ohandler = xsignal(SIGPIPE, SIG_IGN);
 
-	usize = htonl(size);
-
-	if ((len = _slurm_send_timeout(
-				fd, (char *)&usize, sizeof(usize), 0,
-				timeout)) < 0)
-		goto done;
-
-	if ((len = _slurm_send_timeout(fd, buffer, size, 0, timeout)) < 0)
-		goto done;
+	len = _slurm_send_iov_timeout(fd, msg_iov, iovcnt + 1, 0, timeout);
+	if (len >= 0)
+		len -= sizeof(usize);
 
-
-     done:
 	xsignal(SIGPIPE, ohandler);
 	return len;
 }
@@ -242,15 +278,37 @@ ssize_t _slurm_msg_sendto_timeout(slurm_fd_t fd, char *buffer, size_t size,
  * RET message size (as specified in argument) or SLURM_ERROR on error */
 int _slurm_send_timeout(slurm_fd_t fd, char *buf, size_t size,
 			uint32_t flags, int timeout)
+{
+	struct iovec iov;
+
+	iov.iov_base = buf;
+	iov.iov_len  = size;
+	return _slurm_send_iov_timeout(fd, &iov, 1, flags, timeout);
+}
+
+/* Send the data described by an array of iovecs with timeout,
+ * iov is advanced in place as data is written
+ * RET total size of all iovecs or SLURM_ERROR on error */
+int _slurm_send_iov_timeout(slurm_fd_t fd, struct iovec *iov, int iovcnt,
+			    uint32_t flags, int timeout)
 {
 	int rc;
 	int sent = 0;
+	size_t size = 0;
 	int fd_flags;
 	struct pollfd ufds;
 	struct timeval tstart;
+	struct msghdr msg;
 	int timeleft = timeout;
 	char temp[2];
 
+	for (rc = 0; rc < iovcnt; rc++)
+		size += iov[rc].iov_len;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov    = iov;
+	msg.msg_iovlen = iovcnt;
+
 	ufds.fd     = fd;
 	ufds.events = POLLOUT;
 
@@ -307,7 +365,7 @@ int _slurm_send_timeout(slurm_fd_t fd, char *buf, size_t size,
 			      ufds.revents);
 		}
 
-		rc = _slurm_send(fd, &buf[sent], (size - sent), flags);
+		rc = _slurm_sendmsg(fd, &msg, flags);
 		if (rc < 0) {
  			if (errno == EINTR)
 				continue;
@@ -331,6 +389,19 @@ int _slurm_send_timeout(slurm_fd_t fd, char *buf, size_t size,
 		}
 
 		sent += rc;
+
+		/* Skip over whatever was written, possibly partially */
+		while ((msg.msg_iovlen > 0) &&
+		       (rc >= msg.msg_iov->iov_len)) {
+			rc -= msg.msg_iov->iov_len;
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+		if (rc > 0) {
+			msg.msg_iov->iov_base = (char *) msg.msg_iov->iov_base
+						+ rc;
+			msg.msg_iov->iov_len -= rc;
+		}
 	}
 
     done:
@@ -724,6 +724,7 @@ extern void slurmdb_destroy_job_cond(void *object)
 			list_destroy(job_cond->cluster_list);
 		if(job_cond->groupid_list)
 			list_destroy(job_cond->groupid_list);
+		xfree(job_cond->page_cluster);
 		if(job_cond->partition_list)
 			list_destroy(job_cond->partition_list);
 		if(job_cond->qos_list)
@@ -1976,11 +1976,19 @@ extern void slurmdb_pack_archive_rec(void *in, uint16_t rpc_version, Buf buffer)
 	if(!object) {
 		packnull(buffer);
 		packnull(buffer);
+		if (rpc_version >= 9) {
+			pack_time(0, buffer);
+			pack_time(0, buffer);
+		}
 		return;
 	}
 
 	packstr(object->archive_file, buffer);
 	packstr(object->insert, buffer);
+	if (rpc_version >= 9) {
+		pack_time(object->period_end, buffer);
+		pack_time(object->period_start, buffer);
+	}
 }
 
 extern int slurmdb_unpack_archive_rec(void **object, uint16_t rpc_version,
@@ -1994,6 +2002,10 @@ extern int slurmdb_unpack_archive_rec(void **object, uint16_t rpc_version,
 
 	safe_unpackstr_xmalloc(&object_ptr->archive_file, &uint32_tmp, buffer);
 	safe_unpackstr_xmalloc(&object_ptr->insert, &uint32_tmp, buffer);
+	if (rpc_version >= 9) {
+		safe_unpack_time(&object_ptr->period_end, buffer);
+		safe_unpack_time(&object_ptr->period_start, buffer);
+	}
 
 	return SLURM_SUCCESS;
 
@@ -3843,6 +3855,11 @@ extern void slurmdb_pack_job_cond(void *in, uint16_t rpc_version, Buf buffer)
 			pack32(NO_VAL, buffer);
 			pack16(0, buffer);
 			pack16(0, buffer);
+			if (rpc_version >= 9) {
+				packnull(buffer);
+				pack32(0, buffer);
+				pack32(0, buffer);
+			}
 			return;
 		}
 
@@ -4014,6 +4031,11 @@ extern void slurmdb_pack_job_cond(void *in, uint16_t rpc_version, Buf buffer)
 
 		pack16(object->without_steps, buffer);
 		pack16(object->without_usage_truncation, buffer);
+		if (rpc_version >= 9) {
+			packstr(object->page_cluster, buffer);
+			pack32(object->page_jobid, buffer);
+			pack32(object->page_size, buffer);
+		}
 	} else if(rpc_version >= 6) {
 		if(!object) {
 			pack32(NO_VAL, buffer);
@@ -4361,6 +4383,12 @@ extern int slurmdb_unpack_job_cond(void **object, uint16_t rpc_version,
 
 		safe_unpack16(&object_ptr->without_steps, buffer);
 		safe_unpack16(&object_ptr->without_usage_truncation, buffer);
+		if (rpc_version >= 9) {
+			safe_unpackstr_xmalloc(&object_ptr->page_cluster,
+					       &uint32_tmp, buffer);
+			safe_unpack32(&object_ptr->page_jobid, buffer);
+			safe_unpack32(&object_ptr->page_size, buffer);
+		}
 	} else if(rpc_version >= 6) {
 		safe_unpack32(&count, buffer);
 		if(count != NO_VAL) {
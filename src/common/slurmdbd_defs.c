@@ -50,9 +50,11 @@
 #endif				/*  HAVE_CONFIG_H */
 
 #include <arpa/inet.h>
+#include <dirent.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <syslog.h>
 #include <sys/poll.h>
 #include <sys/stat.h>
@@ -84,9 +86,23 @@ strong_alias(slurmdbd_free_id_rc_msg,	slurmdb_slurmdbd_free_id_rc_msg);
 
 
 #define DBD_MAGIC		0xDEAD3219
-#define MAX_AGENT_QUEUE		10000
+#define MAX_AGENT_BATCH		1000	/* Records sent in one message */
+#define MAX_AGENT_QUEUE		10000	/* Records held in memory */
 #define MAX_DBD_MSG_LEN		16384
+#define MAX_DBD_REC_LEN		(16 * 1024 * 1024)
 #define SLURMDBD_TIMEOUT	900	/* Seconds SlurmDBD for response */
+#define SPOOL_SEG_SIZE		(16 * 1024 * 1024)
+
+/* A segment file of the on-disk agent queue.  Records are appended to
+ * the newest segment and a segment is removed once the SlurmDBD has
+ * acknowledged all of its records. */
+typedef struct {
+	uint32_t acked;		/* records acknowledged */
+	uint32_t id;		/* file is <spool_dir>/seg.<id> */
+	uint32_t recs;		/* records in the file */
+	uint32_t size;		/* bytes in the file */
+	uint16_t rpc_version;	/* version the records were packed with */
+} spool_seg_t;
 
 uint16_t running_cache = 0;
 pthread_mutex_t assoc_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -108,11 +124,28 @@ static bool      halt_agent          = 0;
 static slurm_trigger_callbacks_t callback;
 static bool      callbacks_requested = 0;
 
+/* On-disk agent queue, protected by agent_lock.  agent_list holds the
+ * oldest unacknowledged records, read from the spool as it drains. */
+static char *    spool_dir      = NULL;
+static List      spool_list     = NULL;	/* spool_seg_t, oldest first */
+static spool_seg_t *spool_tail  = NULL;	/* segment appended to */
+static int       spool_fd       = -1;	/* open on spool_tail */
+static int       spool_head_fd  = -1;	/* first unacknowledged record */
+static spool_seg_t *spool_rd_seg = NULL;	/* segment read into agent_list */
+static int       spool_rd_fd    = -1;
+static uint32_t  spool_rd_off   = 0;	/* offset of next record to read */
+static uint32_t  spool_rd_recs  = 0;	/* records of spool_rd_seg read */
+static uint32_t  spool_cnt      = 0;	/* records not acknowledged */
+static uint32_t  spool_max      = 0;	/* MaxDBDMsgs */
+static bool      spool_dirty    = false;	/* written since last sync */
+
 static void * _agent(void *x);
+static List   _agent_batch(void);
 static void   _close_slurmdbd_fd(void);
 static void   _create_agent(void);
 static bool   _fd_readable(slurm_fd_t fd, int read_timeout);
 static int    _fd_writeable(slurm_fd_t fd);
+static Buf    _convert_dbd_rec(Buf buffer, uint16_t rpc_version);
 static int    _get_return_code(uint16_t rpc_version, int read_timeout);
 static Buf    _load_dbd_rec(int fd);
 static void   _load_dbd_state(void);
@@ -126,6 +159,17 @@ static int    _send_init_msg(void);
 static int    _send_fini_msg(void);
 static int    _send_msg(Buf buffer);
 static void   _sig_handler(int signal);
+static int    _skip_dbd_rec(int fd);
+static int    _spool_ack(int cnt);
+static int    _spool_append(Buf buffer);
+static void   _spool_close(void);
+static void   _spool_fill(void);
+static int    _spool_new_seg(uint32_t id);
+static void   _spool_open(void);
+static int    _spool_open_seg(spool_seg_t *seg, uint32_t *offset);
+static int    _spool_rd_next(void);
+static int    _spool_scan_seg(spool_seg_t *seg);
+static void   _spool_write_head(void);
 static void   _shutdown_agent(void);
 static void   _slurmdbd_packstr(void *str, uint16_t rpc_version, Buf buffer);
 static int    _slurmdbd_unpackstr(void **str, uint16_t rpc_version, Buf buffer);
@@ -345,7 +389,8 @@ end_it:
 extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 {
 	Buf buffer;
-	int cnt, rc = SLURM_SUCCESS;
+	uint32_t cnt, max_cnt;
+	int rc = SLURM_SUCCESS;
 	static time_t syslog_time = 0;
 
 	buffer = pack_slurmdbd_msg(req, rpc_version);
@@ -359,8 +404,14 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 			return SLURM_ERROR;
 		}
 	}
-	cnt = list_count(agent_list);
-	if ((cnt >= (MAX_AGENT_QUEUE / 2)) &&
+	if (spool_list) {
+		cnt = spool_cnt;
+		max_cnt = spool_max;
+	} else {
+		cnt = list_count(agent_list);
+		max_cnt = MAX_AGENT_QUEUE;
+	}
+	if ((cnt >= (max_cnt / 2)) &&
 	    (difftime(time(NULL), syslog_time) > 120)) {
 		/* Record critical error every 120 seconds */
 		syslog_time = time(NULL);
@@ -369,16 +420,30 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 		if (callbacks_requested)
 			(callback.dbd_fail)();
 	}
-	if (cnt == (MAX_AGENT_QUEUE - 1))
-		cnt -= _purge_job_start_req();
-	if (cnt < MAX_AGENT_QUEUE) {
-		if (list_enqueue(agent_list, buffer) == NULL)
-			fatal("list_enqueue: memory allocation failure");
+	if (spool_list) {
+		if (cnt >= max_cnt) {
+			error("slurmdbd: agent queue is full, "
+			      "discarding request");
+			if (callbacks_requested)
+				(callback.acct_full)();
+			free_buf(buffer);
+			rc = SLURM_ERROR;
+		} else
+			rc = _spool_append(buffer);
 	} else {
-		error("slurmdbd: agent queue is full, discarding request");
-		if (callbacks_requested)
-			(callback.acct_full)();
-		rc = SLURM_ERROR;
+		/* No spool, keep what we can in memory */
+		if (cnt == (MAX_AGENT_QUEUE - 1))
+			cnt -= _purge_job_start_req();
+		if (cnt < MAX_AGENT_QUEUE) {
+			if (list_enqueue(agent_list, buffer) == NULL)
+				fatal("list_enqueue: memory allocation failure");
+		} else {
+			error("slurmdbd: agent queue is full, "
+			      "discarding request");
+			if (callbacks_requested)
+				(callback.acct_full)();
+			rc = SLURM_ERROR;
+		}
 	}
 
 	pthread_cond_broadcast(&agent_cond);
@@ -1659,6 +1724,7 @@ static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout)
 
 		slurm_mutex_lock(&agent_lock);
 		if (agent_list) {
+			int acked = 0;
 			ListIterator itr =
 				list_iterator_create(list_msg->my_list);
 			while((out_buf = list_next(itr))) {
@@ -1668,8 +1734,11 @@ static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout)
 					break;
 
 				free_buf(list_dequeue(agent_list));
+				acked++;
 			}
 			list_iterator_destroy(itr);
+			if (spool_list && acked)
+				_spool_ack(acked);
 		}
 		slurm_mutex_unlock(&agent_lock);
 		slurmdbd_free_list_msg(list_msg);
@@ -1895,6 +1964,7 @@ static void _create_agent(void)
 		agent_list = list_create(slurmdbd_free_buffer);
 		if (agent_list == NULL)
 			fatal("list_create: malloc failure");
+		_spool_open();
 		_load_dbd_state();
 	}
 
@@ -1985,6 +2055,15 @@ static void *_agent(void *x)
 		}
 
 		slurm_mutex_lock(&agent_lock);
+		if (spool_list) {
+			if (spool_dirty) {
+				/* Bound what a crash of the node can lose */
+				if (fdatasync(spool_fd) < 0)
+					error("slurmdbd: spool sync: %m");
+				spool_dirty = false;
+			}
+			_spool_fill();
+		}
 		if (agent_list && slurmdbd_fd)
 			cnt = list_count(agent_list);
 		else
@@ -1999,11 +2078,12 @@ static void *_agent(void *x)
 			slurm_mutex_unlock(&agent_lock);
 			continue;
 		} else if ((cnt > 0) && ((cnt % 50) == 0))
-			info("slurmdbd: agent queue size %u", cnt);
+			info("slurmdbd: agent queue size %u",
+			     spool_list ? spool_cnt : cnt);
 		/* Leave item on the queue until processing complete */
 		if (agent_list) {
 			if(list_count(agent_list) > 1) {
-				list_msg.my_list = agent_list;
+				list_msg.my_list = _agent_batch();
 				buffer = pack_slurmdbd_msg(&list_req,
 							   SLURMDBD_VERSION);
 			} else
@@ -2055,14 +2135,18 @@ static void *_agent(void *x)
 		slurm_mutex_lock(&agent_lock);
 		if (agent_list && (rc == SLURM_SUCCESS)) {
 			/* If we sent a mult_msg we just need to free
-			   buffer, we don't need to requeue, just mark
-			   list_msg.my_list as NULL as that is the
+			   buffer, we don't need to requeue, just free
+			   list_msg.my_list as that is the
 			   sign we sent a mult_msg.
 			*/
-			if(list_msg.my_list)
+			if(list_msg.my_list) {
+				list_destroy(list_msg.my_list);
 				list_msg.my_list = NULL;
-			else
+			} else {
 				buffer = (Buf) list_dequeue(agent_list);
+				if (spool_list)
+					_spool_ack(1);
+			}
 
 			free_buf(buffer);
 			fail_time = 0;
@@ -2071,6 +2155,7 @@ static void *_agent(void *x)
 			   got a failure.
 			*/
 			if(list_msg.my_list) {
+				list_destroy(list_msg.my_list);
 				list_msg.my_list = NULL;
 				free_buf(buffer);
 			}
@@ -2083,7 +2168,11 @@ static void *_agent(void *x)
 	}
 
 	slurm_mutex_lock(&agent_lock);
-	_save_dbd_state();
+	/* Anything spooled is already on disk */
+	if (spool_list)
+		_spool_close();
+	else
+		_save_dbd_state();
 	if (agent_list) {
 		list_destroy(agent_list);
 		agent_list = NULL;
@@ -2205,46 +2294,19 @@ static void _load_dbd_state(void)
 				buffer = _load_dbd_rec(fd);
 			if (buffer == NULL)
 				break;
-			if (rpc_version != SLURMDBD_VERSION) {
-				slurmdbd_msg_t msg;
-				int rc;
-				set_buf_offset(buffer, 0);
-				if (rpc_version == 0) {
-					/* This should only happen for
-					   pre 2.2.0.rc4 and 2.1
-					   machines so no real need to
-					   keep it add more to it.
-					*/
-					rc = unpack_slurmdbd_msg(
-						&msg, SLURMDBD_VERSION, buffer);
-					if ((rc == SLURM_SUCCESS)
-					    && !remaining_buf(buffer))
-						goto got_it;
-
-					/* If the current version
-					   failed lets try the last
-					   version.
-					*/
-					set_buf_offset(buffer, 0);
-					rc = unpack_slurmdbd_msg(
-						&msg, SLURMDBD_VERSION_MIN,
-						buffer);
-				} else
-					rc = unpack_slurmdbd_msg(
-						&msg, rpc_version, buffer);
-			got_it:
-				free_buf(buffer);
-				if (rc == SLURM_SUCCESS)
-					buffer = pack_slurmdbd_msg(
-						&msg, SLURMDBD_VERSION);
-				else
-					buffer = NULL;
-			}
+			if (rpc_version != SLURMDBD_VERSION)
+				buffer = _convert_dbd_rec(buffer, rpc_version);
 			if (!buffer) {
 				error("no buffer given");
 				continue;
 			}
-			if (!list_enqueue(agent_list, buffer))
+			if (spool_list) {
+				/* Move the old state file into the spool */
+				if (_spool_append(buffer) != SLURM_SUCCESS) {
+					buffer = NULL;
+					continue;
+				}
+			} else if (!list_enqueue(agent_list, buffer))
 				fatal("slurmdbd: list_enqueue, no memory");
 			recovered++;
 			buffer = NULL;
@@ -2253,10 +2315,46 @@ static void _load_dbd_state(void)
 	end_it:
 		verbose("slurmdbd: recovered %d pending RPCs", recovered);
 		(void) close(fd);
+		if (spool_list)
+			(void) unlink(dbd_fname);
 	}
 	xfree(dbd_fname);
 }
 
+/* Repack a record saved with an older rpc_version using the current one,
+ * rpc_version of zero means the version is unknown.  The buffer given is
+ * freed.  RET the new buffer or NULL if it can not be unpacked */
+static Buf _convert_dbd_rec(Buf buffer, uint16_t rpc_version)
+{
+	slurmdbd_msg_t msg;
+	int rc;
+
+	set_buf_offset(buffer, 0);
+	if (rpc_version == 0) {
+		/* This should only happen for
+		   pre 2.2.0.rc4 and 2.1
+		   machines so no real need to
+		   keep it add more to it.
+		*/
+		rc = unpack_slurmdbd_msg(&msg, SLURMDBD_VERSION, buffer);
+		if ((rc == SLURM_SUCCESS) && !remaining_buf(buffer))
+			goto got_it;
+
+		/* If the current version
+		   failed lets try the last
+		   version.
+		*/
+		set_buf_offset(buffer, 0);
+		rc = unpack_slurmdbd_msg(&msg, SLURMDBD_VERSION_MIN, buffer);
+	} else
+		rc = unpack_slurmdbd_msg(&msg, rpc_version, buffer);
+got_it:
+	free_buf(buffer);
+	if (rc == SLURM_SUCCESS)
+		return pack_slurmdbd_msg(&msg, SLURMDBD_VERSION);
+	return NULL;
+}
+
 static int _save_dbd_rec(int fd, Buf buffer)
 {
 	ssize_t size, wrote;
@@ -2310,7 +2408,7 @@ static Buf _load_dbd_rec(int fd)
 		error("slurmdbd: state recover error: %m");
 		return (Buf) NULL;
 	}
-	if (msg_size > MAX_DBD_MSG_LEN) {
+	if (msg_size > MAX_DBD_REC_LEN) {
 		error("slurmdbd: state recover error, msg_size=%u", msg_size);
 		return (Buf) NULL;
 	}
@@ -2346,6 +2444,495 @@ static Buf _load_dbd_rec(int fd)
 	return buffer;
 }
 
+/* Skip over a record saved by _save_dbd_rec() without reading its data */
+static int _skip_dbd_rec(int fd)
+{
+	ssize_t size, rd_size;
+	uint32_t msg_size, magic;
+
+	size = sizeof(msg_size);
+	rd_size = read(fd, &msg_size, size);
+	if ((rd_size != size) || (msg_size > MAX_DBD_REC_LEN))
+		return SLURM_ERROR;
+	if (lseek(fd, msg_size, SEEK_CUR) < 0)
+		return SLURM_ERROR;
+	size = sizeof(magic);
+	rd_size = read(fd, &magic, size);
+	if ((rd_size != size) || (magic != DBD_MAGIC))
+		return SLURM_ERROR;
+
+	return SLURM_SUCCESS;
+}
+
+/* Build the list of records to send in one DBD_SEND_MULT_MSG from the
+ * head of agent_list.  The records stay on agent_list until they are
+ * acknowledged, so the list returned does not own them. */
+static List _agent_batch(void)
+{
+	ListIterator itr;
+	List batch_list = list_create(NULL);
+	Buf buffer;
+	uint32_t size = 0;
+
+	itr = list_iterator_create(agent_list);
+	while ((list_count(batch_list) < MAX_AGENT_BATCH) &&
+	       (buffer = list_next(itr))) {
+		size += get_buf_offset(buffer);
+		if ((size > (MAX_DBD_REC_LEN / 2)) &&
+		    list_count(batch_list))
+			break;
+		list_append(batch_list, buffer);
+	}
+	list_iterator_destroy(itr);
+
+	return batch_list;
+}
+
+static void _spool_seg_del(void *x)
+{
+	xfree(x);
+}
+
+static int _spool_cmp_id(const void *x, const void *y)
+{
+	uint32_t id_x = *(uint32_t *) x;
+	uint32_t id_y = *(uint32_t *) y;
+
+	if (id_x < id_y)
+		return -1;
+	if (id_x > id_y)
+		return 1;
+	return 0;
+}
+
+/* Open a spool segment for reading and set its rpc_version from the
+ * header record.  RET file descriptor positioned at the first record
+ * (its offset stored in *offset) or -1 on error */
+static int _spool_open_seg(spool_seg_t *seg, uint32_t *offset)
+{
+	char *fname, *ver_str = NULL;
+	uint32_t ver_str_len;
+	Buf buffer = NULL;
+	int fd;
+
+	fname = xstrdup_printf("%s/seg.%u", spool_dir, seg->id);
+	fd = open(fname, O_RDONLY);
+	if (fd < 0) {
+		error("slurmdbd: Opening spool file %s: %m", fname);
+		xfree(fname);
+		return -1;
+	}
+
+	buffer = _load_dbd_rec(fd);
+	if (buffer == NULL)
+		goto unpack_error;
+	set_buf_offset(buffer, 0);
+	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
+	if (!ver_str || strncmp(ver_str, "VER", 3))
+		goto unpack_error;
+	seg->rpc_version = atoi(ver_str + 3);
+	xfree(ver_str);
+	free_buf(buffer);
+	*offset = lseek(fd, 0, SEEK_CUR);
+	xfree(fname);
+	return fd;
+
+unpack_error:
+	error("slurmdbd: Invalid header in spool file %s", fname);
+	xfree(ver_str);
+	if (buffer)
+		free_buf(buffer);
+	(void) close(fd);
+	xfree(fname);
+	return -1;
+}
+
+/* Count the records of a spool segment found at startup, dropping a
+ * partial record a crash left at its end */
+static int _spool_scan_seg(spool_seg_t *seg)
+{
+	struct stat stat_buf;
+	uint32_t offset;
+	int fd;
+
+	fd = _spool_open_seg(seg, &offset);
+	if (fd < 0)
+		return SLURM_ERROR;
+	seg->recs = 0;
+	while (_skip_dbd_rec(fd) == SLURM_SUCCESS) {
+		offset = lseek(fd, 0, SEEK_CUR);
+		seg->recs++;
+	}
+	seg->size = offset;
+	if ((fstat(fd, &stat_buf) == 0) && (stat_buf.st_size > offset)) {
+		char *fname = xstrdup_printf("%s/seg.%u", spool_dir, seg->id);
+		error("slurmdbd: discarding partial record in spool file %s",
+		      fname);
+		if (truncate(fname, offset) < 0)
+			error("slurmdbd: truncate(%s): %m", fname);
+		xfree(fname);
+	}
+	(void) close(fd);
+
+	return SLURM_SUCCESS;
+}
+
+/* Start a new spool segment and make it the one appended to */
+static int _spool_new_seg(uint32_t id)
+{
+	char *fname, curr_ver_str[10];
+	spool_seg_t *seg;
+	Buf buffer;
+	int fd, rc;
+
+	fname = xstrdup_printf("%s/seg.%u", spool_dir, id);
+	fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+	if (fd < 0) {
+		error("slurmdbd: Creating spool file %s: %m", fname);
+		xfree(fname);
+		return SLURM_ERROR;
+	}
+
+	snprintf(curr_ver_str, sizeof(curr_ver_str),
+		 "VER%d", SLURMDBD_VERSION);
+	buffer = init_buf(strlen(curr_ver_str));
+	packstr(curr_ver_str, buffer);
+	rc = _save_dbd_rec(fd, buffer);
+	if (rc != SLURM_SUCCESS) {
+		free_buf(buffer);
+		(void) close(fd);
+		(void) unlink(fname);
+		xfree(fname);
+		return rc;
+	}
+	xfree(fname);
+
+	seg = xmalloc(sizeof(spool_seg_t));
+	seg->id = id;
+	seg->rpc_version = SLURMDBD_VERSION;
+	seg->size = get_buf_offset(buffer) + (2 * sizeof(uint32_t));
+	free_buf(buffer);
+	list_append(spool_list, seg);
+
+	/* The segment we leave is complete, make sure it is on disk */
+	if (spool_fd >= 0) {
+		if (spool_dirty && (fdatasync(spool_fd) < 0))
+			error("slurmdbd: spool sync: %m");
+		(void) close(spool_fd);
+	}
+	spool_fd = fd;
+	spool_tail = seg;
+	spool_dirty = true;
+
+	return SLURM_SUCCESS;
+}
+
+/* Move the read cursor to the segment after spool_rd_seg */
+static int _spool_rd_next(void)
+{
+	ListIterator itr;
+	spool_seg_t *seg;
+
+	if (spool_rd_fd >= 0)
+		(void) close(spool_rd_fd);
+	spool_rd_fd = -1;
+
+	itr = list_iterator_create(spool_list);
+	while ((seg = list_next(itr))) {
+		if (seg == spool_rd_seg)
+			break;
+	}
+	seg = list_next(itr);
+	list_iterator_destroy(itr);
+
+	spool_rd_seg = seg;
+	spool_rd_recs = 0;
+	if (!seg)
+		return SLURM_ERROR;
+	spool_rd_fd = _spool_open_seg(seg, &spool_rd_off);
+	if (spool_rd_fd < 0) {
+		spool_rd_seg = NULL;
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+/* Record the first unacknowledged record in the head file */
+static void _spool_write_head(void)
+{
+	spool_seg_t *seg = list_peek(spool_list);
+	uint32_t head[2];
+
+	if (!seg || (spool_head_fd < 0))
+		return;
+	head[0] = seg->id;
+	head[1] = seg->acked;
+	if (pwrite(spool_head_fd, head, sizeof(head), 0) != sizeof(head))
+		error("slurmdbd: spool head write error: %m");
+}
+
+/* Open the on-disk agent queue in StateSaveLocation/dbd.spool, recover
+ * any records not yet acknowledged and position the read cursor at the
+ * first of them.  Without a spool the agent queue is kept in memory. */
+static void _spool_open(void)
+{
+	DIR *dir;
+	struct dirent *ent;
+	char *fname;
+	spool_seg_t *seg, *last = NULL;
+	uint32_t head[2] = {0, 0}, id, *ids = NULL, first_new_id;
+	int i, id_cnt = 0;
+	bool convert = false;
+
+	if (spool_list)
+		return;
+	spool_dir = slurm_get_state_save_location();
+	if (!spool_dir)
+		return;
+	spool_max = slurm_get_max_dbd_msgs();
+	xstrcat(spool_dir, "/dbd.spool");
+	if ((mkdir(spool_dir, 0700) < 0) && (errno != EEXIST)) {
+		error("slurmdbd: Creating spool directory %s: %m", spool_dir);
+		xfree(spool_dir);
+		return;
+	}
+	spool_list = list_create(_spool_seg_del);
+
+	fname = xstrdup_printf("%s/head", spool_dir);
+	spool_head_fd = open(fname, O_RDWR | O_CREAT, 0600);
+	if (spool_head_fd < 0) {
+		error("slurmdbd: Opening spool file %s: %m", fname);
+		xfree(fname);
+		goto fail;
+	}
+	xfree(fname);
+	if (read(spool_head_fd, head, sizeof(head)) != sizeof(head))
+		head[0] = head[1] = 0;
+
+	if (!(dir = opendir(spool_dir))) {
+		error("slurmdbd: opendir(%s): %m", spool_dir);
+		goto fail;
+	}
+	while ((ent = readdir(dir))) {
+		if (sscanf(ent->d_name, "seg.%u", &id) != 1)
+			continue;
+		xrealloc(ids, sizeof(uint32_t) * (id_cnt + 1));
+		ids[id_cnt++] = id;
+	}
+	closedir(dir);
+	qsort(ids, id_cnt, sizeof(uint32_t), _spool_cmp_id);
+
+	for (i = 0; i < id_cnt; i++) {
+		if (ids[i] < head[0]) {
+			/* acknowledged before the last shutdown */
+			fname = xstrdup_printf("%s/seg.%u", spool_dir, ids[i]);
+			(void) unlink(fname);
+			xfree(fname);
+			continue;
+		}
+		seg = xmalloc(sizeof(spool_seg_t));
+		seg->id = ids[i];
+		if (_spool_scan_seg(seg) != SLURM_SUCCESS) {
+			xfree(seg);
+			continue;
+		}
+		if (seg->id == head[0])
+			seg->acked = MIN(head[1], seg->recs);
+		if (seg->rpc_version != SLURMDBD_VERSION)
+			convert = true;
+		spool_cnt += seg->recs - seg->acked;
+		list_append(spool_list, seg);
+		last = seg;
+	}
+	xfree(ids);
+
+	if (!convert && last && (last->size < SPOOL_SEG_SIZE)) {
+		fname = xstrdup_printf("%s/seg.%u", spool_dir, last->id);
+		spool_fd = open(fname, O_WRONLY | O_APPEND);
+		if (spool_fd < 0)
+			error("slurmdbd: Opening spool file %s: %m", fname);
+		xfree(fname);
+		if (spool_fd < 0)
+			goto fail;
+		spool_tail = last;
+	} else if (_spool_new_seg(last ? last->id + 1 : 1) != SLURM_SUCCESS)
+		goto fail;
+	first_new_id = spool_tail->id;
+
+	/* Records saved by an older version are all repacked into new
+	 * segments after the old ones so they are sent in the order
+	 * received.  The repacked records may fill more than one segment,
+	 * so stop at the first segment created here, not at the tail. */
+	while (convert && (seg = list_peek(spool_list)) &&
+	       (seg->id < first_new_id)) {
+		uint32_t offset;
+		int fd = _spool_open_seg(seg, &offset);
+		Buf buffer;
+
+		for (i = 0; (fd >= 0) && (buffer = _load_dbd_rec(fd)); i++) {
+			if (i < seg->acked) {
+				free_buf(buffer);
+				continue;
+			}
+			if (seg->rpc_version != SLURMDBD_VERSION)
+				buffer = _convert_dbd_rec(buffer,
+							  seg->rpc_version);
+			if (buffer)
+				(void) _spool_append(buffer);
+		}
+		if (fd >= 0)
+			(void) close(fd);
+		spool_cnt -= seg->recs - seg->acked;
+		fname = xstrdup_printf("%s/seg.%u", spool_dir, seg->id);
+		(void) unlink(fname);
+		xfree(fname);
+		seg = list_dequeue(spool_list);
+		xfree(seg);
+	}
+
+	spool_rd_seg = list_peek(spool_list);
+	spool_rd_recs = 0;
+	spool_rd_fd = _spool_open_seg(spool_rd_seg, &spool_rd_off);
+	if (spool_rd_fd < 0)
+		goto fail;
+	_spool_write_head();
+	if (spool_cnt)
+		verbose("slurmdbd: recovered %u pending RPCs", spool_cnt);
+	return;
+
+fail:
+	error("slurmdbd: agent queue will not survive a restart");
+	_spool_close();
+}
+
+/* Append a record to the spool.  The buffer is consumed, it is queued
+ * on agent_list if everything spooled before it is already there,
+ * otherwise _spool_fill() reads it back when there is room. */
+static int _spool_append(Buf buffer)
+{
+	uint32_t size = get_buf_offset(buffer);
+
+	if ((spool_tail->size >= SPOOL_SEG_SIZE) &&
+	    (_spool_new_seg(spool_tail->id + 1) != SLURM_SUCCESS)) {
+		error("slurmdbd: unable to spool request, discarding it");
+		free_buf(buffer);
+		return SLURM_ERROR;
+	}
+	if (_save_dbd_rec(spool_fd, buffer) != SLURM_SUCCESS) {
+		/* Drop whatever part of the record was written */
+		if (ftruncate(spool_fd, spool_tail->size) < 0)
+			error("slurmdbd: spool truncate: %m");
+		error("slurmdbd: unable to spool request, discarding it");
+		free_buf(buffer);
+		return SLURM_ERROR;
+	}
+	spool_tail->size += size + (2 * sizeof(uint32_t));
+	spool_tail->recs++;
+	spool_cnt++;
+	spool_dirty = true;
+
+	if ((spool_rd_seg == spool_tail) &&
+	    (spool_rd_recs == (spool_tail->recs - 1)) &&
+	    (list_count(agent_list) < MAX_AGENT_QUEUE)) {
+		if (list_enqueue(agent_list, buffer) == NULL)
+			fatal("list_enqueue: memory allocation failure");
+		spool_rd_off = spool_tail->size;
+		spool_rd_recs++;
+	} else
+		free_buf(buffer);
+
+	return SLURM_SUCCESS;
+}
+
+/* Read records from the spool into agent_list until it holds
+ * MAX_AGENT_QUEUE records or all of them */
+static void _spool_fill(void)
+{
+	Buf buffer;
+
+	while (spool_rd_seg && (list_count(agent_list) < MAX_AGENT_QUEUE)) {
+		if (spool_rd_recs >= spool_rd_seg->recs) {
+			if ((spool_rd_seg == spool_tail) ||
+			    (_spool_rd_next() != SLURM_SUCCESS))
+				break;
+			continue;
+		}
+
+		buffer = NULL;
+		if ((lseek(spool_rd_fd, spool_rd_off, SEEK_SET) < 0) ||
+		    ((spool_rd_recs < spool_rd_seg->acked) ?
+		     (_skip_dbd_rec(spool_rd_fd) != SLURM_SUCCESS) :
+		     !(buffer = _load_dbd_rec(spool_rd_fd)))) {
+			uint32_t recs = MAX(spool_rd_recs,
+					    spool_rd_seg->acked);
+			uint32_t lost = spool_rd_seg->recs - recs;
+
+			error("slurmdbd: spool file %u unreadable, "
+			      "discarding %u records", spool_rd_seg->id, lost);
+			if (spool_rd_seg == spool_tail)
+				break;
+			spool_rd_seg->recs = spool_rd_recs = recs;
+			spool_cnt -= MIN(lost, spool_cnt);
+			continue;
+		}
+		spool_rd_off = lseek(spool_rd_fd, 0, SEEK_CUR);
+		spool_rd_recs++;
+		if (buffer && (list_enqueue(agent_list, buffer) == NULL))
+			fatal("list_enqueue: memory allocation failure");
+	}
+}
+
+/* Note that the cnt oldest records were accepted by the SlurmDBD and
+ * remove segments no longer needed */
+static int _spool_ack(int cnt)
+{
+	spool_seg_t *seg;
+	uint32_t take;
+	char *fname;
+
+	spool_cnt -= MIN(cnt, spool_cnt);
+	while ((seg = list_peek(spool_list))) {
+		take = MIN(cnt, seg->recs - seg->acked);
+		seg->acked += take;
+		cnt -= take;
+		if ((seg->acked < seg->recs) || (seg == spool_tail))
+			break;
+		if (seg == spool_rd_seg)
+			(void) _spool_rd_next();
+		fname = xstrdup_printf("%s/seg.%u", spool_dir, seg->id);
+		(void) unlink(fname);
+		xfree(fname);
+		seg = list_dequeue(spool_list);
+		xfree(seg);
+	}
+	_spool_write_head();
+
+	return SLURM_SUCCESS;
+}
+
+static void _spool_close(void)
+{
+	if (spool_fd >= 0) {
+		if (spool_dirty && (fdatasync(spool_fd) < 0))
+			error("slurmdbd: spool sync: %m");
+		(void) close(spool_fd);
+	}
+	if (spool_rd_fd >= 0)
+		(void) close(spool_rd_fd);
+	if (spool_head_fd >= 0)
+		(void) close(spool_head_fd);
+	spool_fd = spool_rd_fd = spool_head_fd = -1;
+	if (spool_list) {
+		list_destroy(spool_list);
+		spool_list = NULL;
+	}
+	spool_tail = spool_rd_seg = NULL;
+	spool_rd_off = spool_rd_recs = spool_cnt = 0;
+	spool_dirty = false;
+	xfree(spool_dir);
+}
+
 static void _sig_handler(int signal)
 {
 }
@@ -306,7 +306,8 @@ typedef struct {
 				 * is handled correctly on both ends */
 	uint32_t return_code;   /* If there was an error and a list of
 				 * them this is the type of error it
-				 * was */
+				 * was.  For DBD_GOT_JOBS of a paged
+				 * request, set if more jobs remain */
 } dbd_list_msg_t;
 
 typedef struct {
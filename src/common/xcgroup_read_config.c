@@ -84,6 +84,7 @@ static void _clear_slurm_cgroup_conf(slurm_cgroup_conf_t *slurm_cgroup_conf)
 		slurm_cgroup_conf->memlimit_enforcement = 0 ;
 		slurm_cgroup_conf->memlimit_threshold = 100 ;
 		slurm_cgroup_conf->constrain_devices = false ;
+		slurm_cgroup_conf->jobacct_gather_cgroup = false ;
 	}
 }
 
@@ -108,6 +109,7 @@ extern int read_slurm_cgroup_conf(slurm_cgroup_conf_t *slurm_cgroup_conf)
 		{"MemoryLimitEnforcement", S_P_BOOLEAN},
 		{"MemoryLimitThreshold", S_P_UINT32},
 		{"ConstrainDevices", S_P_BOOLEAN},
+		{"JobAcctGatherCgroup", S_P_BOOLEAN},
 		{NULL} };
 	s_p_hashtbl_t *tbl = NULL;
 	char *conf_path = NULL;
@@ -180,6 +182,11 @@ extern int read_slurm_cgroup_conf(slurm_cgroup_conf_t *slurm_cgroup_conf)
 				     "ConstrainDevices", tbl))
 			slurm_cgroup_conf->constrain_devices = false;
 
+		/* Accounting related conf items */
+		if (!s_p_get_boolean(&slurm_cgroup_conf->jobacct_gather_cgroup,
+				     "JobAcctGatherCgroup", tbl))
+			slurm_cgroup_conf->jobacct_gather_cgroup = false;
+
 		s_p_hashtbl_destroy(tbl);
 	}
 
@@ -72,6 +72,8 @@ typedef struct slurm_cgroup_conf {
 
 	bool      constrain_devices;
 
+	bool      jobacct_gather_cgroup;
+
 } slurm_cgroup_conf_t;
 
 /*
@@ -77,6 +77,31 @@ static void malloc_assert_failed(char *, const char *, int,
           } _STMT_END
 #endif /* NDEBUG */
 
+/*
+ * Arena allocations are prefixed by the same two ints as xmalloc'd memory,
+ * with a different magic cookie, and are rounded up to keep the next one
+ * aligned. Each chunk is a single malloc().
+ */
+#define XARENA_ALIGN		(2 * sizeof(int))
+#define XARENA_ROUND(__sz)	(((__sz) + XARENA_ALIGN - 1) & \
+				 ~(XARENA_ALIGN - 1))
+
+struct xarena_chunk {
+	struct xarena_chunk *next;
+	size_t size;		/* usable bytes in data */
+	size_t used;		/* bytes of data handed out */
+	double data[];		/* double for alignment */
+};
+
+struct xarena {
+	struct xarena_chunk *chunks;	/* current chunk first */
+	size_t chunk_size;
+};
+
+static struct xarena_chunk *_xarena_chunk_add(xarena_t arena, size_t size,
+					      bool dedicated, const char *file,
+					      int line, const char *func);
+
 
 /*
  * "Safe" version of malloc().
@@ -108,6 +133,33 @@ void *slurm_xmalloc(size_t size, const char *file, int line, const char *func)
 	return new;
 }
 
+/*
+ * Same as above, except the new memory is not zeroed. For use with large
+ * buffers which the caller is about to overwrite in full (e.g. message
+ * bodies read off the wire).
+ */
+void *slurm_xmalloc_nz(size_t size, const char *file, int line,
+		       const char *func)
+{
+	int *p;
+
+	xmalloc_assert(size >= 0 && size <= INT_MAX);
+	MALLOC_LOCK();
+	p = (int *)malloc(size + 2*sizeof(int));
+	MALLOC_UNLOCK();
+	if (!p) {
+		/* don't call log functions here, we're probably OOM
+		 */
+		fprintf(log_fp(), "%s:%d: %s: xmalloc_nz(%d) failed\n",
+				file, line, func, (int)size);
+		exit(1);
+	}
+	p[0] = XMALLOC_MAGIC;	/* add "secret" magic cookie */
+	p[1] = (int)size;	/* store size in buffer */
+
+	return &p[2];
+}
+
 /*
  * same as above, except return NULL on malloc failure instead of exiting
  */
@@ -151,15 +203,25 @@ void * slurm_xrealloc(void **item, size_t newsize,
 		p = (int *)*item - 2;
 
 		/* magic cookie still there? */
-		xmalloc_assert(p[0] == XMALLOC_MAGIC);
+		xmalloc_assert((p[0] == XMALLOC_MAGIC) ||
+			       (p[0] == XARENA_MAGIC));
 		old_size = p[1];
 
 		MALLOC_LOCK();
-		p = (int *)realloc(p, newsize + 2*sizeof(int));
+		if (p[0] == XARENA_MAGIC) {
+			/* move out of the arena, which keeps the original */
+			int *arena_p = p;
+			p = (int *)malloc(newsize + 2*sizeof(int));
+			if (p)
+				memcpy(&p[2], &arena_p[2],
+				       MIN((size_t)old_size, newsize));
+		} else
+			p = (int *)realloc(p, newsize + 2*sizeof(int));
 		MALLOC_UNLOCK();
 
 		if (p == NULL)
 			goto error;
+		p[0] = XMALLOC_MAGIC;
 
 		if (old_size < newsize) {
 			char *p_new = (char *)(&p[2]) + old_size;
@@ -207,15 +269,25 @@ int slurm_try_xrealloc(void **item, size_t newsize,
 		p = (int *)*item - 2;
 
 		/* magic cookie still there? */
-		xmalloc_assert(p[0] == XMALLOC_MAGIC);
+		xmalloc_assert((p[0] == XMALLOC_MAGIC) ||
+			       (p[0] == XARENA_MAGIC));
 		old_size = p[1];
 
 		MALLOC_LOCK();
-		p = (int *)realloc(p, newsize + 2*sizeof(int));
+		if (p[0] == XARENA_MAGIC) {
+			/* move out of the arena, which keeps the original */
+			int *arena_p = p;
+			p = (int *)malloc(newsize + 2*sizeof(int));
+			if (p)
+				memcpy(&p[2], &arena_p[2],
+				       MIN((size_t)old_size, newsize));
+		} else
+			p = (int *)realloc(p, newsize + 2*sizeof(int));
 		MALLOC_UNLOCK();
 
 		if (p == NULL)
 			return 0;
+		p[0] = XMALLOC_MAGIC;
 
 		if (old_size < newsize) {
 			char *p_new = (char *)(&p[2]) + old_size;
@@ -250,7 +322,7 @@ int slurm_xsize(void *item, const char *file, int line, const char *func)
 {
 	int *p = (int *)item - 2;
 	xmalloc_assert(item != NULL);
-	xmalloc_assert(p[0] == XMALLOC_MAGIC);
+	xmalloc_assert((p[0] == XMALLOC_MAGIC) || (p[0] == XARENA_MAGIC));
 	return p[1];
 }
 
@@ -263,6 +335,11 @@ void slurm_xfree(void **item, const char *file, int line, const char *func)
 {
 	if (*item != NULL) {
 		int *p = (int *)*item - 2;
+		if (p[0] == XARENA_MAGIC) {
+			/* released with the rest of its arena */
+			*item = NULL;
+			return;
+		}
 		/* magic cookie still there? */
 		xmalloc_assert(p[0] == XMALLOC_MAGIC);
 		p[0] = 0;	/* make sure xfree isn't called twice */
@@ -273,6 +350,117 @@ void slurm_xfree(void **item, const char *file, int line, const char *func)
 	}
 }
 
+/*
+ * Create an arena which allocates from chunks of chunk_size bytes.
+ *   chunk_size (IN)	size of each chunk, larger requests get their own
+ *   RETURN		the new arena, release with xarena_destroy()
+ */
+xarena_t xarena_create(size_t chunk_size)
+{
+	xarena_t arena = xmalloc(sizeof(struct xarena));
+
+	arena->chunk_size = XARENA_ROUND(chunk_size);
+	return arena;
+}
+
+/*
+ * Release an arena and every allocation ever made from it.
+ *   arena (IN)	arena to destroy, may be NULL
+ */
+void xarena_destroy(xarena_t arena)
+{
+	struct xarena_chunk *chunk;
+
+	if (arena == NULL)
+		return;
+	MALLOC_LOCK();
+	while ((chunk = arena->chunks)) {
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+	MALLOC_UNLOCK();
+	xfree(arena);
+}
+
+static struct xarena_chunk *_xarena_chunk_add(xarena_t arena, size_t size,
+					      bool dedicated, const char *file,
+					      int line, const char *func)
+{
+	struct xarena_chunk *chunk;
+
+	MALLOC_LOCK();
+	chunk = malloc(sizeof(struct xarena_chunk) + size);
+	MALLOC_UNLOCK();
+	if (!chunk) {
+		fprintf(log_fp(), "%s:%d: %s: xarena_alloc(%d) failed\n",
+				file, line, func, (int)size);
+		exit(1);
+	}
+	chunk->size = size;
+	chunk->used = 0;
+
+	/* a dedicated chunk is full from the start, keep carving from
+	 * the current one */
+	if (dedicated && arena->chunks) {
+		chunk->next = arena->chunks->next;
+		arena->chunks->next = chunk;
+	} else {
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+	return chunk;
+}
+
+/*
+ * Allocate zeroed memory from an arena.
+ *   arena (IN)	arena to allocate from
+ *   size (IN)	number of bytes to allocate
+ *   RETURN	pointer to allocated space, valid until the arena is destroyed
+ */
+void *slurm_xarena_alloc(xarena_t arena, size_t size, const char *file,
+			 int line, const char *func)
+{
+	struct xarena_chunk *chunk;
+	size_t need = XARENA_ROUND(size) + 2*sizeof(int);
+	int *p;
+
+	xmalloc_assert(arena != NULL);
+	xmalloc_assert(size >= 0 && size <= INT_MAX);
+
+	chunk = arena->chunks;
+	if ((chunk == NULL) || ((chunk->size - chunk->used) < need)) {
+		/* large requests get a chunk of their own rather than
+		 * abandoning the free space in the current one */
+		if (need > (arena->chunk_size / 4))
+			chunk = _xarena_chunk_add(arena, need, true,
+						  file, line, func);
+		else
+			chunk = _xarena_chunk_add(arena, arena->chunk_size,
+						  false, file, line, func);
+	}
+
+	p = (int *)((char *)chunk->data + chunk->used);
+	chunk->used += need;
+	p[0] = XARENA_MAGIC;	/* add "secret" magic cookie */
+	p[1] = (int)size;	/* store size in buffer */
+
+	memset(&p[2], 0, size);
+	return &p[2];
+}
+
+/*
+ * Test if memory was allocated from an arena rather than the heap.
+ *   item (IN)		pointer to allocated space
+ */
+bool slurm_xmalloc_in_arena(void *item)
+{
+	int *p = (int *)item - 2;
+
+	if (item == NULL)
+		return false;
+	return (p[0] == XARENA_MAGIC);
+}
+
 #ifndef NDEBUG
 static void malloc_assert_failed(char *expr, const char *file,
 		                 int line, const char *caller, const char *func)
@@ -43,6 +43,7 @@
  * Description:
  *
  * void *xmalloc(size_t size);
+ * void *xmalloc_nz(size_t size);
  * void *try_xmalloc(size_t size);
  * void xrealloc(void *p, size_t newsize);
  * int  try_xrealloc(void *p, size_t newsize);
@@ -53,6 +54,8 @@
  * memory. The memory is set to zero. xmalloc() will not return unless
  * there are no errors. The memory must be freed using xfree().
  *
+ * xmalloc_nz(size) is the same as above, but the memory is not zeroed.
+ *
  * try_xmalloc(size) is the same as above, but a NULL pointer is returned
  * when there is an error allocating the memory.
  *
@@ -72,6 +75,18 @@
  * p. The memory must have been allocated with [try_]xmalloc() or
  * [try_]xrealloc().
  *
+ * xarena_t arena = xarena_create(size);
+ * void *xarena_alloc(xarena_t arena, size_t size);
+ * void xarena_destroy(xarena_t arena);
+ *
+ * An arena hands out zeroed memory from large chunks, carved off one after
+ * the other, and releases all of it at once in xarena_destroy(). It is
+ * meant for many small allocations with a common, short lifetime (e.g. the
+ * contents of an RPC being unpacked). Arena memory may be passed to xfree()
+ * (which does nothing), xrealloc() (which moves it to the heap) and xsize()
+ * like any other xmalloc'd memory, but no pointer into the arena may be
+ * kept after it is destroyed. xmalloc_in_arena(p) tells if p is such memory.
+ *
 \*****************************************************************************/
 
 #ifndef _XMALLOC_H
@@ -86,6 +101,9 @@
 #define xmalloc(__sz) \
 	slurm_xmalloc (__sz, __FILE__, __LINE__, __CURRENT_FUNC__)
 
+#define xmalloc_nz(__sz) \
+	slurm_xmalloc_nz (__sz, __FILE__, __LINE__, __CURRENT_FUNC__)
+
 #define try_xmalloc(__sz) \
 	slurm_try_xmalloc(__sz, __FILE__, __LINE__, __CURRENT_FUNC__)
 
@@ -103,13 +121,28 @@
 #define xsize(__p) \
 	slurm_xsize((void *)__p, __FILE__, __LINE__, __CURRENT_FUNC__)
 
+#define xarena_alloc(__a, __sz) \
+	slurm_xarena_alloc(__a, __sz, __FILE__, __LINE__, __CURRENT_FUNC__)
+
+#define xmalloc_in_arena(__p) \
+	slurm_xmalloc_in_arena((void *)__p)
+
+typedef struct xarena * xarena_t;
+
 void *slurm_xmalloc(size_t, const char *, int, const char *);
+void *slurm_xmalloc_nz(size_t, const char *, int, const char *);
 void *slurm_try_xmalloc(size_t , const char *, int , const char *);
 void slurm_xfree(void **, const char *, int, const char *);
 void *slurm_xrealloc(void **, size_t, const char *, int, const char *);
 int  slurm_try_xrealloc(void **, size_t, const char *, int, const char *);
 int  slurm_xsize(void *, const char *, int, const char *);
 
+xarena_t xarena_create(size_t chunk_size);
+void xarena_destroy(xarena_t arena);
+void *slurm_xarena_alloc(xarena_t, size_t, const char *, int, const char *);
+bool slurm_xmalloc_in_arena(void *);
+
 #define XMALLOC_MAGIC 0x42
+#define XARENA_MAGIC  0x43
 
 #endif /* !_XMALLOC_H */
@@ -78,6 +78,7 @@ typedef struct {
 	bool rollback;
 	List update_list;
 	int conn;
+	void *job_batch; /* deferred job records, see as_mysql_job.c */
 } mysql_conn_t;
 
 typedef struct {
@@ -43,10 +43,12 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <arpa/inet.h>
 #include "src/common/slurmdbd_defs.h"
 #include "src/common/slurm_auth.h"
 #include "src/common/xstring.h"
 #include "src/common/env.h"
+#include "src/common/lz.h"
 #include "src/slurmdbd/read_config.h"
 #include "common_as.h"
 
@@ -841,3 +843,317 @@ extern int archive_write_file(Buf buffer, char *cluster_name,
 
 	return rc;
 }
+
+/* Compress the columns gathered for the current block and append them to
+ * the data section.  Each column is stored as its raw size, its
+ * compressed size (0 if it did not compress) and then the bytes. */
+static void _archive_col_flush(archive_col_t *arch)
+{
+	archive_block_t *block = arch->cur_block;
+	uint32_t raw_len, comp_len, alloc_len = 0;
+	char *comp = NULL;
+	int i;
+
+	if (!block)
+		return;
+
+	block->offset = get_buf_offset(arch->data_buf);
+	for (i = 0; i < arch->col_cnt; i++) {
+		raw_len = get_buf_offset(arch->col_bufs[i]);
+		if (raw_len > alloc_len) {
+			alloc_len = raw_len;
+			xrealloc(comp, alloc_len);
+		}
+		/* only keep the compressed form if it is smaller */
+		comp_len = lz_compress(get_buf_data(arch->col_bufs[i]),
+				       raw_len, comp, raw_len);
+		pack32(raw_len, arch->data_buf);
+		pack32(comp_len, arch->data_buf);
+		if (comp_len)
+			packmem_array(comp, comp_len, arch->data_buf);
+		else
+			packmem_array(get_buf_data(arch->col_bufs[i]),
+				      raw_len, arch->data_buf);
+		set_buf_offset(arch->col_bufs[i], 0);
+	}
+	xfree(comp);
+	block->size = get_buf_offset(arch->data_buf) - block->offset;
+	arch->cur_block = NULL;
+}
+
+extern archive_col_t *archive_col_create(uint16_t type, char *cluster_name,
+					 uint16_t col_cnt, uint16_t time_col)
+{
+	archive_col_t *arch = xmalloc(sizeof(archive_col_t));
+	int i;
+
+	xassert(time_col < col_cnt);
+
+	arch->rpc_version = SLURMDBD_VERSION;
+	arch->create_time = time(NULL);
+	arch->type = type;
+	arch->cluster_name = xstrdup(cluster_name);
+	arch->col_cnt = col_cnt;
+	arch->time_col = time_col;
+	arch->col_bufs = xmalloc(sizeof(Buf) * col_cnt);
+	for (i = 0; i < col_cnt; i++)
+		arch->col_bufs[i] = init_buf(BUF_SIZE);
+	arch->data_buf = init_buf(BUF_SIZE);
+
+	return arch;
+}
+
+extern void archive_col_add_row(archive_col_t *arch, char **row)
+{
+	archive_block_t *block;
+	time_t row_time;
+	int i;
+
+	xassert(arch && arch->col_bufs);
+
+	if (!(block = arch->cur_block)) {
+		if (arch->block_cnt >= arch->blocks_alloc) {
+			arch->blocks_alloc += 64;
+			xrealloc(arch->blocks, sizeof(archive_block_t)
+				 * arch->blocks_alloc);
+		}
+		block = arch->cur_block = &arch->blocks[arch->block_cnt++];
+	}
+
+	for (i = 0; i < arch->col_cnt; i++)
+		packstr(row[i], arch->col_bufs[i]);
+
+	row_time = row[arch->time_col] ? slurm_atoul(row[arch->time_col]) : 0;
+	if (!block->rows || (row_time < block->min_time))
+		block->min_time = row_time;
+	if (!block->rows || (row_time > block->max_time))
+		block->max_time = row_time;
+	block->rows++;
+	arch->rec_cnt++;
+
+	if (block->rows >= ARCHIVE_BLOCK_ROWS)
+		_archive_col_flush(arch);
+}
+
+extern Buf archive_col_pack(archive_col_t *arch)
+{
+	Buf buffer;
+	int i;
+
+	xassert(arch && arch->data_buf);
+
+	_archive_col_flush(arch);
+
+	buffer = init_buf(get_buf_offset(arch->data_buf) + BUF_SIZE);
+	pack32(ARCHIVE_COL_MAGIC, buffer);
+	pack16(ARCHIVE_COL_VERSION, buffer);
+	pack16(arch->rpc_version, buffer);
+	pack_time(arch->create_time, buffer);
+	pack16(arch->type, buffer);
+	packstr(arch->cluster_name, buffer);
+	pack32(arch->rec_cnt, buffer);
+	pack16(arch->col_cnt, buffer);
+	pack16(arch->time_col, buffer);
+	pack32(arch->block_cnt, buffer);
+	for (i = 0; i < arch->block_cnt; i++) {
+		pack32(arch->blocks[i].rows, buffer);
+		pack_time(arch->blocks[i].min_time, buffer);
+		pack_time(arch->blocks[i].max_time, buffer);
+		pack32(arch->blocks[i].offset, buffer);
+		pack32(arch->blocks[i].size, buffer);
+	}
+	pack32(get_buf_offset(arch->data_buf), buffer);
+	packmem_array(get_buf_data(arch->data_buf),
+		      get_buf_offset(arch->data_buf), buffer);
+
+	return buffer;
+}
+
+extern bool archive_col_is_columnar(char *data, uint32_t data_size)
+{
+	uint32_t magic;
+
+	if (!data || (data_size < sizeof(magic)))
+		return false;
+	memcpy(&magic, data, sizeof(magic));
+	return (ntohl(magic) == ARCHIVE_COL_MAGIC);
+}
+
+extern int archive_col_unpack(archive_col_t **arch_out,
+			      char *data, uint32_t data_size)
+{
+	archive_col_t *arch = xmalloc(sizeof(archive_col_t));
+	Buf buffer = create_buf(data, data_size);
+	uint32_t magic, uint32_tmp;
+	uint16_t format_ver;
+	char *cluster_name = NULL;
+	int i;
+
+	*arch_out = NULL;
+
+	safe_unpack32(&magic, buffer);
+	safe_unpack16(&format_ver, buffer);
+	if ((magic != ARCHIVE_COL_MAGIC)
+	    || (format_ver != ARCHIVE_COL_VERSION)) {
+		error("Unknown archive file format %u", format_ver);
+		goto unpack_error;
+	}
+	safe_unpack16(&arch->rpc_version, buffer);
+	if ((arch->rpc_version > SLURMDBD_VERSION)
+	    || (arch->rpc_version < SLURMDBD_VERSION_MIN)) {
+		error("Can not recover archive file, incompatible version, "
+		      "got %u need >= %u <= %u", arch->rpc_version,
+		      SLURMDBD_VERSION_MIN, SLURMDBD_VERSION);
+		goto unpack_error;
+	}
+	safe_unpack_time(&arch->create_time, buffer);
+	safe_unpack16(&arch->type, buffer);
+	safe_unpackstr_xmalloc(&cluster_name, &uint32_tmp, buffer);
+	arch->cluster_name = cluster_name;
+	safe_unpack32(&arch->rec_cnt, buffer);
+	safe_unpack16(&arch->col_cnt, buffer);
+	safe_unpack16(&arch->time_col, buffer);
+	safe_unpack32(&arch->block_cnt, buffer);
+	if (!arch->col_cnt || (arch->time_col >= arch->col_cnt)
+	    || (arch->block_cnt > remaining_buf(buffer)))
+		goto unpack_error;
+	arch->blocks = xmalloc(sizeof(archive_block_t) * (arch->block_cnt + 1));
+	for (i = 0; i < arch->block_cnt; i++) {
+		safe_unpack32(&arch->blocks[i].rows, buffer);
+		safe_unpack_time(&arch->blocks[i].min_time, buffer);
+		safe_unpack_time(&arch->blocks[i].max_time, buffer);
+		safe_unpack32(&arch->blocks[i].offset, buffer);
+		safe_unpack32(&arch->blocks[i].size, buffer);
+		/* blocks are written with at most ARCHIVE_BLOCK_ROWS rows */
+		if (arch->blocks[i].rows > ARCHIVE_BLOCK_ROWS) {
+			error("Archive block %d has too many rows (%u)",
+			      i, arch->blocks[i].rows);
+			goto unpack_error;
+		}
+	}
+	safe_unpack32(&arch->data_size, buffer);
+	if (arch->data_size > remaining_buf(buffer))
+		goto unpack_error;
+	arch->data = data + get_buf_offset(buffer);
+	for (i = 0; i < arch->block_cnt; i++) {
+		if ((arch->blocks[i].offset > arch->data_size)
+		    || (arch->blocks[i].size
+			> (arch->data_size - arch->blocks[i].offset))) {
+			error("Archive block %d is out of range", i);
+			goto unpack_error;
+		}
+	}
+
+	xfer_buf_data(buffer);
+	*arch_out = arch;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	xfer_buf_data(buffer);
+	archive_col_destroy(arch);
+	return SLURM_ERROR;
+}
+
+extern int archive_col_read_block(archive_col_t *arch, uint32_t inx,
+				  char ***vals_out, char ***col_data_out)
+{
+	archive_block_t *block;
+	char **vals, **col_data;
+	char *ptr, *end;
+	uint32_t raw_len, comp_len, uint32_tmp;
+	Buf buffer;
+	int c, r;
+
+	xassert(arch && (inx < arch->block_cnt));
+
+	block = &arch->blocks[inx];
+	ptr = arch->data + block->offset;
+	end = ptr + block->size;
+	/* each column needs its length header in the block */
+	if ((block->rows > ((UINT32_MAX / sizeof(char *)) - 1) / arch->col_cnt)
+	    || ((block->size / (2 * sizeof(uint32_t))) < arch->col_cnt)) {
+		*vals_out = NULL;
+		*col_data_out = NULL;
+		error("Archive block %u of %s is corrupt",
+		      inx, arch->cluster_name);
+		return SLURM_ERROR;
+	}
+	vals = xmalloc(sizeof(char *) * ((block->rows * arch->col_cnt) + 1));
+	col_data = xmalloc(sizeof(char *) * arch->col_cnt);
+
+	for (c = 0; c < arch->col_cnt; c++) {
+		if ((end - ptr) < (2 * sizeof(uint32_t)))
+			goto corrupt;
+		memcpy(&raw_len, ptr, sizeof(uint32_t));
+		raw_len = ntohl(raw_len);
+		ptr += sizeof(uint32_t);
+		memcpy(&comp_len, ptr, sizeof(uint32_t));
+		comp_len = ntohl(comp_len);
+		ptr += sizeof(uint32_t);
+		/* every value takes at least a 32-bit length in the column */
+		if (((comp_len ? comp_len : raw_len) > (end - ptr))
+		    || ((raw_len / sizeof(uint32_t)) < block->rows))
+			goto corrupt;
+
+		col_data[c] = xmalloc(raw_len + 1);
+		if (!comp_len)
+			memcpy(col_data[c], ptr, raw_len);
+		else if (lz_decompress(ptr, comp_len, col_data[c], raw_len)
+			 != raw_len)
+			goto corrupt;
+		ptr += comp_len ? comp_len : raw_len;
+
+		buffer = create_buf(col_data[c], raw_len);
+		for (r = 0; r < block->rows; r++) {
+			if (unpackstr_ptr(&vals[(r * arch->col_cnt) + c],
+					  &uint32_tmp, buffer)) {
+				xfer_buf_data(buffer);
+				goto corrupt;
+			}
+		}
+		xfer_buf_data(buffer);
+	}
+
+	*vals_out = vals;
+	*col_data_out = col_data;
+	return SLURM_SUCCESS;
+
+corrupt:
+	error("Archive block %u of %s is corrupt", inx, arch->cluster_name);
+	archive_col_free_block(arch, vals, col_data);
+	*vals_out = NULL;
+	*col_data_out = NULL;
+	return SLURM_ERROR;
+}
+
+extern void archive_col_free_block(archive_col_t *arch,
+				   char **vals, char **col_data)
+{
+	int i;
+
+	if (col_data) {
+		for (i = 0; i < arch->col_cnt; i++)
+			xfree(col_data[i]);
+		xfree(col_data);
+	}
+	xfree(vals);
+}
+
+extern void archive_col_destroy(archive_col_t *arch)
+{
+	int i;
+
+	if (!arch)
+		return;
+
+	if (arch->col_bufs) {
+		for (i = 0; i < arch->col_cnt; i++)
+			free_buf(arch->col_bufs[i]);
+		xfree(arch->col_bufs);
+	}
+	if (arch->data_buf)
+		free_buf(arch->data_buf);
+	xfree(arch->blocks);
+	xfree(arch->cluster_name);
+	xfree(arch);
+}
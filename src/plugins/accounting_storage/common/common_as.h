@@ -88,4 +88,94 @@ extern int archive_write_file(Buf buffer, char *cluster_name,
 			      char *arch_dir, char *arch_type,
 			      uint32_t archive_period);
 
+/*
+ * Columnar archive files.
+ *
+ * Rows are gathered into blocks of ARCHIVE_BLOCK_ROWS.  Inside a block
+ * every column is stored on its own and compressed, so the repeated
+ * values of a column (accounts, partitions, states...) compress well.
+ * An index at the front of the file records the row count, byte range
+ * and time range of every block, so a load limited to a time window
+ * only has to decompress the blocks overlapping it.  Archive files
+ * are written per cluster, the cluster name is in the file header.
+ */
+#define ARCHIVE_COL_MAGIC	0x534c4341	/* "SLCA" */
+#define ARCHIVE_COL_VERSION	1
+#define ARCHIVE_BLOCK_ROWS	1000
+
+typedef struct {
+	uint32_t rows;		/* rows in this block */
+	time_t min_time;	/* smallest value of the time column */
+	time_t max_time;	/* largest value of the time column */
+	uint32_t offset;	/* start of the block in the data section */
+	uint32_t size;		/* bytes of the block in the data section */
+} archive_block_t;
+
+typedef struct {
+	uint16_t rpc_version;	/* SLURMDBD_VERSION file was written with */
+	time_t create_time;
+	uint16_t type;		/* DBD_GOT_JOBS, DBD_STEP_START... */
+	char *cluster_name;
+	uint32_t rec_cnt;
+	uint16_t col_cnt;
+	uint16_t time_col;	/* column the block time ranges are of */
+	uint32_t block_cnt;
+	archive_block_t *blocks;
+	char *data;		/* data section, points into the file */
+	uint32_t data_size;
+
+	/* only used while writing */
+	Buf *col_bufs;
+	Buf data_buf;
+	archive_block_t *cur_block;
+	uint32_t blocks_alloc;
+} archive_col_t;
+
+/*
+ * archive_col_create - start a columnar archive of col_cnt columns whose
+ *	time ranges are taken from column time_col
+ */
+extern archive_col_t *archive_col_create(uint16_t type, char *cluster_name,
+					 uint16_t col_cnt, uint16_t time_col);
+
+/*
+ * archive_col_add_row - append a row of col_cnt strings (NULL allowed)
+ */
+extern void archive_col_add_row(archive_col_t *arch, char **row);
+
+/*
+ * archive_col_pack - flush the last block and pack the whole archive
+ * RET buffer holding the file contents, free with free_buf()
+ */
+extern Buf archive_col_pack(archive_col_t *arch);
+
+/*
+ * archive_col_is_columnar - whether the file contents are a columnar archive
+ */
+extern bool archive_col_is_columnar(char *data, uint32_t data_size);
+
+/*
+ * archive_col_unpack - read the header and block index of a columnar
+ *	archive.  The returned structure points into data, which must
+ *	stay around until archive_col_destroy() is called.
+ */
+extern int archive_col_unpack(archive_col_t **arch,
+			      char *data, uint32_t data_size);
+
+/*
+ * archive_col_read_block - decompress block inx of an archive
+ * OUT vals - xmalloc'd array of rows * col_cnt pointers, value of
+ *	row r column c is vals[(r * col_cnt) + c] (NULL if the value
+ *	was NULL), the strings point into *col_data
+ * OUT col_data - xmalloc'd array of col_cnt decompressed columns,
+ *	free with archive_col_free_block()
+ * RET SLURM_SUCCESS or SLURM_ERROR if the block is corrupt
+ */
+extern int archive_col_read_block(archive_col_t *arch, uint32_t inx,
+				  char ***vals, char ***col_data);
+extern void archive_col_free_block(archive_col_t *arch,
+				   char **vals, char **col_data);
+
+extern void archive_col_destroy(archive_col_t *arch);
+
 #endif
@@ -38,9 +38,21 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#include <stdlib.h>
 #include <strings.h>
 #include "src/common/slurm_accounting_storage.h"
 #include "filetxt_jobacct_process.h"
+#include "filetxt_index.h"
+
+/* These are defined here so when we link with something other than
+ * the slurmctld we will have these symbols defined.  They will get
+ * overwritten when linking with the slurmctld.
+ */
+#if defined(__APPLE__)
+slurm_ctl_conf_t slurmctld_conf __attribute__((weak_import));
+#else
+slurm_ctl_conf_t slurmctld_conf;
+#endif
 
 /*
  * These variables are required by the generic plugin interface.  If they
@@ -137,6 +149,7 @@ static int _print_record(struct job_record *job_ptr,
 {
 	static int   rc=SLURM_SUCCESS;
 	char *block_id = NULL;
+	off_t offset;
 	if(!job_ptr->details) {
 		error("job_acct: job=%u doesn't exist", job_ptr->job_id);
 		return SLURM_ERROR;
@@ -154,6 +167,8 @@ static int _print_record(struct job_record *job_ptr,
 
 	slurm_mutex_lock( &logfile_lock );
 
+	/* the log is line buffered, so nothing is pending in LOGFILE */
+	offset = lseek(LOGFILE_FD, 0, SEEK_END);
 	if (fprintf(LOGFILE,
 		    "%u %s %d %d %u %u %s - %s\n",
 		    job_ptr->job_id, job_ptr->partition,
@@ -161,6 +176,8 @@ static int _print_record(struct job_record *job_ptr,
 		    job_ptr->user_id, job_ptr->group_id, block_id, data)
 	    < 0)
 		rc=SLURM_ERROR;
+	else if (offset != (off_t) -1)
+		filetxt_index_add(offset, atoi(data), job_ptr->job_id, time);
 #ifdef HAVE_FDATASYNC
 	fdatasync(LOGFILE_FD);
 #endif
@@ -237,11 +254,15 @@ extern int init ( void )
 		} else
 			chmod(log_file, prot);
 
-		xfree(log_file);
-
 		if (setvbuf(LOGFILE, NULL, _IOLBF, 0))
 			error("setvbuf() failed");
 		LOGFILE_FD = fileno(LOGFILE);
+		/* Only the slurmctld maintains the index, sacct run as
+		 * SlurmUser must not take the index lock from it.
+		 * slurmctld_conf is only filled in there. */
+		if (slurmctld_conf.control_machine)
+			filetxt_index_open(log_file, LOGFILE_FD);
+		xfree(log_file);
 		slurm_mutex_unlock( &logfile_lock );
 		storage_init = 1;
 		/* since this can be loaded from many different places
@@ -257,6 +278,7 @@ extern int init ( void )
 
 extern int fini ( void )
 {
+	filetxt_index_close();
 	if (LOGFILE)
 		fclose(LOGFILE);
 	return SLURM_SUCCESS;
@@ -990,3 +1012,8 @@ extern int acct_storage_p_flush_jobs_on_cluster(
 	/* put end times for a clean start */
 	return SLURM_SUCCESS;
 }
+
+extern int jobacct_storage_p_batch(void *db_conn, bool start, bool commit)
+{
+	return SLURM_SUCCESS;
+}
@@ -0,0 +1,632 @@
+/*****************************************************************************\
+ *  filetxt_index.c - index of the text file accounting log
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/common/fd.h"
+#include "src/common/jobacct_common.h"
+#include "src/common/log.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "filetxt_index.h"
+
+#define FILETXT_INDEX_MAGIC	0x46544958	/* "FTIX" */
+#define FILETXT_INDEX_VERSION	1
+#define FILETXT_INDEX_TIME	0xffff	/* rec_type of a time entry */
+#define FILETXT_INDEX_HDR_SIZE	18
+#define FILETXT_INDEX_REC_SIZE	18
+#define INDEX_JOB_HASH_SIZE	1024
+
+/* fields of a log line the index needs, see _print_record() */
+#define LOG_F_JOB		0
+#define LOG_F_TIMESTAMP		3
+#define LOG_F_RECTYPE		8
+
+typedef struct {
+	uint16_t rec_type;
+	uint32_t jobid;
+	uint32_t time;
+	uint64_t offset;
+} index_rec_t;
+
+/* records of a job that is still running at some point of the log */
+typedef struct index_job {
+	uint32_t jobid;
+	struct index_job *next;
+	uint64_t *offsets;
+	uint32_t offset_alloc;
+	uint32_t offset_cnt;
+} index_job_t;
+
+static int      index_fd = -1;
+static uint32_t index_bucket = 0; /* bucket of the last time entry */
+
+static void _pack_u64(char *p, uint64_t val)
+{
+	uint32_t part = htonl((uint32_t)(val >> 32));
+
+	memcpy(p, &part, 4);
+	part = htonl((uint32_t)val);
+	memcpy(p + 4, &part, 4);
+}
+
+static uint64_t _unpack_u64(char *p)
+{
+	uint32_t hi, lo;
+
+	memcpy(&hi, p, 4);
+	memcpy(&lo, p + 4, 4);
+	return ((uint64_t)ntohl(hi) << 32) | ntohl(lo);
+}
+
+static void _pack_rec(char *p, index_rec_t *rec)
+{
+	uint16_t u16 = htons(rec->rec_type);
+	uint32_t u32;
+
+	memcpy(p, &u16, 2);
+	u32 = htonl(rec->jobid);
+	memcpy(p + 2, &u32, 4);
+	u32 = htonl(rec->time);
+	memcpy(p + 6, &u32, 4);
+	_pack_u64(p + 10, rec->offset);
+}
+
+static void _unpack_rec(char *p, index_rec_t *rec)
+{
+	uint16_t u16;
+	uint32_t u32;
+
+	memcpy(&u16, p, 2);
+	rec->rec_type = ntohs(u16);
+	memcpy(&u32, p + 2, 4);
+	rec->jobid = ntohl(u32);
+	memcpy(&u32, p + 6, 4);
+	rec->time = ntohl(u32);
+	rec->offset = _unpack_u64(p + 10);
+}
+
+static void _pack_hdr(char *p, ino_t log_inode)
+{
+	uint32_t u32 = htonl(FILETXT_INDEX_MAGIC);
+	uint16_t u16 = htons(FILETXT_INDEX_VERSION);
+
+	memcpy(p, &u32, 4);
+	memcpy(p + 4, &u16, 2);
+	_pack_u64(p + 6, (uint64_t)log_inode);
+	u32 = htonl(FILETXT_INDEX_BUCKET);
+	memcpy(p + 14, &u32, 4);
+}
+
+/* RET true if the header is of an index of the log file with log_inode */
+static bool _valid_hdr(char *p, ino_t log_inode)
+{
+	char hdr[FILETXT_INDEX_HDR_SIZE];
+
+	_pack_hdr(hdr, log_inode);
+	return !memcmp(p, hdr, FILETXT_INDEX_HDR_SIZE);
+}
+
+static int _write_all(int fd, char *buf, int len)
+{
+	int rc;
+
+	while (len > 0) {
+		rc = write(fd, buf, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return SLURM_ERROR;
+		}
+		buf += rc;
+		len -= rc;
+	}
+	return SLURM_SUCCESS;
+}
+
+/* Index the lines of the log from offset on.  If skip_first the line at
+ * offset is already indexed. */
+static void _index_log(char *log_file, uint64_t offset, bool skip_first)
+{
+	char line[BUFFER_SIZE], *f[LOG_F_RECTYPE + 1], *ptr;
+	bool line_start = true;
+	uint64_t line_offset;
+	FILE *fp;
+	int i, cnt = 0;
+
+	if (!(fp = fopen(log_file, "r"))) {
+		error("filetxt: can't index %s: %m", log_file);
+		return;
+	}
+	if (fseeko(fp, offset, SEEK_SET)) {
+		error("filetxt: can't index %s: %m", log_file);
+		fclose(fp);
+		return;
+	}
+	if (skip_first)
+		line_start = false;
+
+	while (1) {
+		line_offset = ftello(fp);
+		if (!fgets(line, sizeof(line), fp))
+			break;
+		i = strlen(line);
+		if (!line_start) {
+			/* rest of a line already dealt with */
+			line_start = (i && (line[i - 1] == '\n'));
+			continue;
+		}
+		line_start = (i && (line[i - 1] == '\n'));
+
+		ptr = line;
+		for (i = 0; i <= LOG_F_RECTYPE; i++) {
+			f[i] = ptr;
+			if (!(ptr = strchr(ptr, ' ')))
+				break;
+			*ptr++ = '\0';
+		}
+		if (i < LOG_F_RECTYPE)
+			continue;	/* not a record */
+
+		filetxt_index_add(line_offset, atoi(f[LOG_F_RECTYPE]),
+				  strtoul(f[LOG_F_JOB], NULL, 10),
+				  strtoul(f[LOG_F_TIMESTAMP], NULL, 10));
+		if (index_fd < 0)
+			break;
+		cnt++;
+	}
+	fclose(fp);
+
+	if (cnt)
+		verbose("filetxt: indexed %d records of %s", cnt, log_file);
+}
+
+extern int filetxt_index_open(char *log_file, int log_fd)
+{
+	char *index_file = NULL, hdr[FILETXT_INDEX_HDR_SIZE];
+	char rec_buf[FILETXT_INDEX_REC_SIZE];
+	struct stat log_st, index_st;
+	uint64_t last_offset = FILETXT_NO_OFFSET, rec_cnt = 0, i;
+	index_rec_t rec;
+
+	filetxt_index_close();
+
+	if (fstat(log_fd, &log_st)) {
+		error("filetxt: can't stat %s: %m", log_file);
+		return SLURM_ERROR;
+	}
+
+	index_file = xstrdup_printf("%s%s", log_file, FILETXT_INDEX_SUFFIX);
+	index_fd = open(index_file, O_RDWR | O_CREAT | O_APPEND,
+			log_st.st_mode & 0666);
+	if (index_fd < 0) {
+		error("filetxt: can't open index %s: %m", index_file);
+		xfree(index_file);
+		return SLURM_ERROR;
+	}
+	fd_set_close_on_exec(index_fd);
+	/* only one process (normally slurmctld) maintains the index */
+	if (flock(index_fd, LOCK_EX | LOCK_NB)) {
+		debug("filetxt: index %s is maintained elsewhere", index_file);
+		close(index_fd);
+		index_fd = -1;
+		xfree(index_file);
+		return SLURM_SUCCESS;
+	}
+
+	index_bucket = 0;
+	if (!fstat(index_fd, &index_st)
+	    && (index_st.st_size >= FILETXT_INDEX_HDR_SIZE)
+	    && (pread(index_fd, hdr, sizeof(hdr), 0) == sizeof(hdr))
+	    && _valid_hdr(hdr, log_st.st_ino)) {
+		rec_cnt = (index_st.st_size - FILETXT_INDEX_HDR_SIZE)
+			/ FILETXT_INDEX_REC_SIZE;
+		for (i = 0; i < rec_cnt; i++) {
+			if (pread(index_fd, rec_buf, sizeof(rec_buf),
+				  FILETXT_INDEX_HDR_SIZE
+				  + (i * FILETXT_INDEX_REC_SIZE))
+			    != sizeof(rec_buf))
+				break;
+			_unpack_rec(rec_buf, &rec);
+			if (rec.offset >= log_st.st_size)
+				break;	/* log was cut back */
+			if (rec.rec_type == FILETXT_INDEX_TIME)
+				index_bucket = rec.time / FILETXT_INDEX_BUCKET;
+			else
+				last_offset = rec.offset;
+		}
+		if (i < rec_cnt) {
+			info("filetxt: index %s does not match the log, "
+			     "rebuilding it", index_file);
+			rec_cnt = 0;
+		}
+	}
+
+	if (!rec_cnt) {
+		/* new or unusable index, start over */
+		index_bucket = 0;
+		last_offset = FILETXT_NO_OFFSET;
+		_pack_hdr(hdr, log_st.st_ino);
+		if (ftruncate(index_fd, 0)
+		    || _write_all(index_fd, hdr, sizeof(hdr))) {
+			error("filetxt: can't write index %s: %m",
+			      index_file);
+			filetxt_index_close();
+			xfree(index_file);
+			return SLURM_ERROR;
+		}
+	} else if (ftruncate(index_fd, FILETXT_INDEX_HDR_SIZE
+			     + (rec_cnt * FILETXT_INDEX_REC_SIZE))) {
+		/* drop a partly written entry */
+		error("filetxt: can't truncate index %s: %m", index_file);
+	}
+	xfree(index_file);
+
+	/* catch up with whatever was logged while we were not running */
+	if (last_offset == FILETXT_NO_OFFSET)
+		_index_log(log_file, 0, false);
+	else
+		_index_log(log_file, last_offset, true);
+
+	return SLURM_SUCCESS;
+}
+
+extern void filetxt_index_add(uint64_t offset, uint16_t rec_type,
+			      uint32_t jobid, time_t rec_time)
+{
+	char buf[2 * FILETXT_INDEX_REC_SIZE];
+	index_rec_t rec;
+	uint32_t bucket = rec_time / FILETXT_INDEX_BUCKET;
+	int len = 0;
+
+	if (index_fd < 0)
+		return;
+
+	rec.offset = offset;
+	if (bucket > index_bucket) {
+		rec.rec_type = FILETXT_INDEX_TIME;
+		rec.jobid = 0;
+		rec.time = bucket * FILETXT_INDEX_BUCKET;
+		_pack_rec(buf, &rec);
+		len += FILETXT_INDEX_REC_SIZE;
+		index_bucket = bucket;
+	}
+	rec.rec_type = rec_type;
+	rec.jobid = jobid;
+	rec.time = rec_time;
+	_pack_rec(buf + len, &rec);
+	len += FILETXT_INDEX_REC_SIZE;
+
+	if (_write_all(index_fd, buf, len)) {
+		/* readers go through the log past the last entry, so the
+		 * index stays usable, just less useful, until rebuilt */
+		error("filetxt: can't write index, %m");
+		filetxt_index_close();
+	}
+}
+
+extern void filetxt_index_close(void)
+{
+	if (index_fd >= 0) {
+		close(index_fd);
+		index_fd = -1;
+	}
+}
+
+/* Open the index of log_file for reading, checking it belongs to it */
+static FILE *_open_index(char *log_file, uint64_t *log_size)
+{
+	char *index_file, hdr[FILETXT_INDEX_HDR_SIZE];
+	struct stat log_st;
+	FILE *fp;
+
+	if (stat(log_file, &log_st))
+		return NULL;
+	*log_size = log_st.st_size;
+
+	index_file = xstrdup_printf("%s%s", log_file, FILETXT_INDEX_SUFFIX);
+	fp = fopen(index_file, "r");
+	if (!fp) {
+		debug2("filetxt: no index %s: %m", index_file);
+	} else if ((fread(hdr, sizeof(hdr), 1, fp) != 1)
+		   || !_valid_hdr(hdr, log_st.st_ino)) {
+		debug("filetxt: index %s is not of %s, not using it",
+		      index_file, log_file);
+		fclose(fp);
+		fp = NULL;
+	}
+	xfree(index_file);
+
+	return fp;
+}
+
+/* Read the next entry of the index.  RET false at the end of it or if
+ * the entry points past the end of the log. */
+static bool _next_rec(FILE *fp, uint64_t log_size, index_rec_t *rec,
+		      bool *bad)
+{
+	char rec_buf[FILETXT_INDEX_REC_SIZE];
+
+	if (fread(rec_buf, sizeof(rec_buf), 1, fp) != 1)
+		return false;
+	_unpack_rec(rec_buf, rec);
+	if (rec->offset >= log_size) {
+		*bad = true;
+		return false;
+	}
+	return true;
+}
+
+static void _plan_add(filetxt_index_plan_t *plan, uint32_t *alloc,
+		      uint32_t jobid, uint64_t offset)
+{
+	if (plan->cnt >= *alloc) {
+		*alloc = *alloc ? (*alloc * 2) : 256;
+		xrealloc(plan->jobids, sizeof(uint32_t) * *alloc);
+		xrealloc(plan->offsets, sizeof(uint64_t) * *alloc);
+	}
+	plan->jobids[plan->cnt] = jobid;
+	plan->offsets[plan->cnt++] = offset;
+}
+
+static int _cmp_offset(const void *a, const void *b)
+{
+	uint64_t a_off = (*(uint64_t **)a)[0];
+	uint64_t b_off = (*(uint64_t **)b)[0];
+
+	if (a_off < b_off)
+		return -1;
+	return (a_off > b_off);
+}
+
+/* put the planned lines in file order */
+static void _plan_sort(filetxt_index_plan_t *plan)
+{
+	uint64_t **order, *offsets;
+	uint32_t *jobids, i;
+
+	if (plan->cnt < 2)
+		return;
+
+	order = xmalloc(sizeof(uint64_t *) * plan->cnt);
+	for (i = 0; i < plan->cnt; i++)
+		order[i] = &plan->offsets[i];
+	qsort(order, plan->cnt, sizeof(uint64_t *), _cmp_offset);
+
+	offsets = xmalloc(sizeof(uint64_t) * plan->cnt);
+	jobids = xmalloc(sizeof(uint32_t) * plan->cnt);
+	for (i = 0; i < plan->cnt; i++) {
+		offsets[i] = *order[i];
+		jobids[i] = plan->jobids[order[i] - plan->offsets];
+	}
+	xfree(order);
+	xfree(plan->offsets);
+	xfree(plan->jobids);
+	plan->offsets = offsets;
+	plan->jobids = jobids;
+}
+
+static index_job_t *_find_index_job(index_job_t **hash, uint32_t jobid,
+				    bool create)
+{
+	index_job_t *job, **head = &hash[jobid % INDEX_JOB_HASH_SIZE];
+
+	for (job = *head; job; job = job->next) {
+		if (job->jobid == jobid)
+			return job;
+	}
+	if (!create)
+		return NULL;
+
+	job = xmalloc(sizeof(index_job_t));
+	job->jobid = jobid;
+	job->next = *head;
+	*head = job;
+	return job;
+}
+
+static void _remove_index_job(index_job_t **hash, uint32_t jobid)
+{
+	index_job_t *job, **prev = &hash[jobid % INDEX_JOB_HASH_SIZE];
+
+	for (job = *prev; job; prev = &job->next, job = job->next) {
+		if (job->jobid == jobid) {
+			*prev = job->next;
+			xfree(job->offsets);
+			xfree(job);
+			return;
+		}
+	}
+}
+
+/* add the records between two time entries to the running jobs */
+static void _replay_recs(index_job_t **hash, index_rec_t *recs, uint32_t cnt)
+{
+	index_job_t *job;
+	uint32_t i;
+
+	for (i = 0; i < cnt; i++) {
+		if (recs[i].rec_type == JOB_TERMINATED) {
+			_remove_index_job(hash, recs[i].jobid);
+			continue;
+		}
+		job = _find_index_job(hash, recs[i].jobid, true);
+		if (job->offset_cnt >= job->offset_alloc) {
+			job->offset_alloc += 8;
+			xrealloc(job->offsets,
+				 sizeof(uint64_t) * job->offset_alloc);
+		}
+		job->offsets[job->offset_cnt++] = recs[i].offset;
+	}
+}
+
+extern int filetxt_index_plan_window(char *log_file, time_t start,
+				     time_t end, filetxt_index_plan_t *plan)
+{
+	index_job_t **hash, *job, *next_job;
+	index_rec_t rec, *pending = NULL;
+	uint64_t log_size;
+	uint32_t alloc = 0, pending_alloc = 0, pending_cnt = 0, j;
+	bool replay = true, bad = false;
+	FILE *fp;
+	int i;
+
+	memset(plan, 0, sizeof(filetxt_index_plan_t));
+	if (!(fp = _open_index(log_file, &log_size)))
+		return SLURM_ERROR;
+
+	plan->seq_offset = 0;
+	plan->known_offset = FILETXT_NO_OFFSET;
+	hash = xmalloc(sizeof(index_job_t *) * INDEX_JOB_HASH_SIZE);
+
+	/* Replay the index up to the time entry of the bucket holding
+	 * start, remembering the records of the jobs still going there.
+	 * The log is read sequentially from that entry on.  Records are
+	 * only replayed once the next time entry shows they are before
+	 * the sequential start. */
+	while (_next_rec(fp, log_size, &rec, &bad)) {
+		if (rec.rec_type == FILETXT_INDEX_TIME) {
+			if (replay && (rec.time <= start)) {
+				_replay_recs(hash, pending, pending_cnt);
+				plan->seq_offset = rec.offset;
+			} else
+				replay = false;
+			pending_cnt = 0;
+			if (end && (rec.time > end)) {
+				plan->known_offset = rec.offset;
+				break;
+			}
+			continue;
+		}
+		if (!replay)
+			continue;
+		if (pending_cnt >= pending_alloc) {
+			pending_alloc = pending_alloc ?
+				(pending_alloc * 2) : 256;
+			xrealloc(pending, sizeof(index_rec_t) * pending_alloc);
+		}
+		pending[pending_cnt++] = rec;
+	}
+	fclose(fp);
+	xfree(pending);
+
+	for (i = 0; i < INDEX_JOB_HASH_SIZE; i++) {
+		for (job = hash[i]; job; job = next_job) {
+			next_job = job->next;
+			for (j = 0; j < job->offset_cnt; j++)
+				_plan_add(plan, &alloc, job->jobid,
+					  job->offsets[j]);
+			xfree(job->offsets);
+			xfree(job);
+		}
+	}
+	xfree(hash);
+
+	if (bad) {
+		filetxt_index_free_plan(plan);
+		return SLURM_ERROR;
+	}
+	_plan_sort(plan);
+	debug("filetxt: reading %u records of running jobs, then from offset "
+	      "%"PRIu64" of %s", plan->cnt, plan->seq_offset, log_file);
+
+	return SLURM_SUCCESS;
+}
+
+extern int filetxt_index_plan_jobs(char *log_file, List step_list,
+				   filetxt_index_plan_t *plan)
+{
+	slurmdb_selected_step_t *selected_step = NULL;
+	ListIterator itr;
+	uint32_t *jobids, jobid_cnt = 0, alloc = 0, i;
+	uint64_t log_size;
+	index_rec_t rec;
+	bool bad = false;
+	FILE *fp;
+
+	memset(plan, 0, sizeof(filetxt_index_plan_t));
+	if (!(fp = _open_index(log_file, &log_size)))
+		return SLURM_ERROR;
+
+	plan->known_offset = FILETXT_NO_OFFSET;
+	plan->seq_offset = 0;
+
+	jobids = xmalloc(sizeof(uint32_t) * list_count(step_list));
+	itr = list_iterator_create(step_list);
+	while ((selected_step = list_next(itr)))
+		jobids[jobid_cnt++] = selected_step->jobid;
+	list_iterator_destroy(itr);
+
+	while (_next_rec(fp, log_size, &rec, &bad)) {
+		if (rec.rec_type == FILETXT_INDEX_TIME)
+			continue;
+		/* lines past the last entry are read sequentially */
+		plan->seq_offset = rec.offset;
+		plan->skip_first = true;
+		for (i = 0; i < jobid_cnt; i++) {
+			if (jobids[i] == rec.jobid) {
+				_plan_add(plan, &alloc, rec.jobid, rec.offset);
+				break;
+			}
+		}
+	}
+	fclose(fp);
+	xfree(jobids);
+
+	if (bad) {
+		filetxt_index_free_plan(plan);
+		return SLURM_ERROR;
+	}
+	/* the index is written in log order, no need to sort */
+	debug("filetxt: reading %u indexed records of %s", plan->cnt,
+	      log_file);
+
+	return SLURM_SUCCESS;
+}
+
+extern void filetxt_index_free_plan(filetxt_index_plan_t *plan)
+{
+	xfree(plan->jobids);
+	xfree(plan->offsets);
+	plan->cnt = 0;
+}
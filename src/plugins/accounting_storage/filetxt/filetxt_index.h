@@ -0,0 +1,110 @@
+/*****************************************************************************\
+ *  filetxt_index.h - index of the text file accounting log
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_FILETXT_INDEX_H
+#define _HAVE_FILETXT_INDEX_H
+
+#include "src/common/list.h"
+#include "src/common/slurm_accounting_storage.h"
+
+/*
+ * The index of the accounting log lives next to it in "<log>.idx".  It
+ * holds a fixed size entry for every record appended to the log (record
+ * type, jobid, timestamp and offset of the line) and, whenever the
+ * record time moves into a new FILETXT_INDEX_BUCKET, a time entry with
+ * the offset of the first record of that bucket.  slurmctld appends to
+ * it as it writes the log; sacct uses it to read only the lines it
+ * needs.  An index that does not match the log is ignored by readers
+ * and rebuilt by slurmctld the next time it opens the log.
+ */
+#define FILETXT_INDEX_SUFFIX	".idx"
+#define FILETXT_INDEX_BUCKET	3600	/* seconds of log per time entry */
+#define FILETXT_NO_OFFSET	((uint64_t) -1)
+
+/*
+ * A plan of which log lines to read.  The lines at offsets[] (in file
+ * order) are read first, then unless seq_offset is FILETXT_NO_OFFSET
+ * the log is read sequentially from there to the end.  Lines at or
+ * after known_offset only matter for jobs that were already seen.
+ */
+typedef struct {
+	uint32_t cnt;
+	uint64_t known_offset;	/* FILETXT_NO_OFFSET if every line matters */
+	uint32_t *jobids;	/* jobid expected on each line */
+	uint64_t *offsets;
+	uint64_t seq_offset;	/* FILETXT_NO_OFFSET for no sequential read */
+	bool skip_first;	/* first sequential line was read already */
+} filetxt_index_plan_t;
+
+/* Writer side, all called with the log file lock held */
+
+/*
+ * filetxt_index_open - open the index of log_file for appending,
+ *	indexing any lines of the log it does not cover yet
+ */
+extern int filetxt_index_open(char *log_file, int log_fd);
+
+/*
+ * filetxt_index_add - index a record appended to the log at offset
+ */
+extern void filetxt_index_add(uint64_t offset, uint16_t rec_type,
+			      uint32_t jobid, time_t rec_time);
+
+extern void filetxt_index_close(void);
+
+/* Reader side */
+
+/*
+ * filetxt_index_plan_window - plan reading the jobs active from start on.
+ *	Records of jobs that were done before start are skipped, records
+ *	of jobs submitted after end (if set) are ignored.
+ * RET SLURM_SUCCESS or SLURM_ERROR if there is no usable index
+ */
+extern int filetxt_index_plan_window(char *log_file, time_t start,
+				     time_t end, filetxt_index_plan_t *plan);
+
+/*
+ * filetxt_index_plan_jobs - plan reading only the records of the jobs
+ *	in step_list (a list of slurmdb_selected_step_t *)
+ * RET SLURM_SUCCESS or SLURM_ERROR if there is no usable index
+ */
+extern int filetxt_index_plan_jobs(char *log_file, List step_list,
+				   filetxt_index_plan_t *plan);
+
+extern void filetxt_index_free_plan(filetxt_index_plan_t *plan);
+
+#endif
@@ -48,6 +48,7 @@
 #include "src/common/xmalloc.h"
 #include "src/common/list.h"
 #include "filetxt_jobacct_process.h"
+#include "filetxt_index.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmdbd/read_config.h"
 /* Map field names to positions */
@@ -57,6 +58,7 @@
 #define BATCH_JOB_TIMESTAMP 0
 #define EXPIRE_READ_LENGTH 10
 #define MAX_RECORD_FIELDS 100
+#define JOB_HASH_SIZE 1024
 
 typedef struct expired_rec {  /* table of expired jobs */
 	uint32_t job;
@@ -75,7 +77,7 @@ typedef struct header {
 	uint16_t rec_type;
 } filetxt_header_t;
 
-typedef struct {
+typedef struct filetxt_job_rec {
 	uint32_t job_start_seen,		/* useful flags */
 		job_step_seen,
 		job_terminated_seen,
@@ -99,8 +101,23 @@ typedef struct {
 	List    steps;
 	char    *account;
 	uint32_t requid;
+	struct filetxt_job_rec *hash_next; /* next job in filetxt_jobs_t hash */
 } filetxt_job_rec_t;
 
+typedef struct {
+	filetxt_job_rec_t *hash[JOB_HASH_SIZE]; /* by jobnum, oldest first */
+	List job_list;			/* in the order they were seen */
+} filetxt_jobs_t;
+
+/* where the lines of the log come from */
+typedef struct {
+	bool bad_index;			/* index did not match the log */
+	uint32_t inx;			/* next line of plan->offsets */
+	uint64_t offset;		/* offset of the current line */
+	filetxt_index_plan_t *plan;	/* NULL to read the whole log */
+	bool seq;			/* past plan->offsets */
+} filetxt_reader_t;
+
 typedef struct {
 	filetxt_header_t   header;
 	uint32_t	stepnum;	/* job's step number */
@@ -620,18 +637,55 @@ static void _do_fdump(char* f[], int lc)
        		printf("%12s: %s\n", type[i-HEADER_LENGTH], f[i]);
 }
 
-static filetxt_job_rec_t *_find_job_record(List job_list,
+static int _find_job_ptr(void *x, void *key)
+{
+	return (x == key);
+}
+
+static void _add_job_record(filetxt_jobs_t *jobs, filetxt_job_rec_t *job)
+{
+	filetxt_job_rec_t **tail = &jobs->hash[job->header.jobnum
+					       % JOB_HASH_SIZE];
+
+	while (*tail)
+		tail = &(*tail)->hash_next;
+	job->hash_next = NULL;
+	*tail = job;
+	list_append(jobs->job_list, job);
+}
+
+static bool _have_job_record(filetxt_jobs_t *jobs, uint32_t jobnum)
+{
+	filetxt_job_rec_t *job = jobs->hash[jobnum % JOB_HASH_SIZE];
+
+	for (; job; job = job->hash_next) {
+		if (job->header.jobnum == jobnum)
+			return true;
+	}
+	return false;
+}
+
+static void _reset_job_records(filetxt_jobs_t *jobs)
+{
+	if (jobs->job_list)
+		list_destroy(jobs->job_list);
+	memset(jobs->hash, 0, sizeof(jobs->hash));
+	jobs->job_list = list_create(_destroy_filetxt_job_rec);
+}
+
+static filetxt_job_rec_t *_find_job_record(filetxt_jobs_t *jobs,
 					   filetxt_header_t header,
 					   int type)
 {
 	filetxt_job_rec_t *job = NULL;
-	ListIterator itr = list_iterator_create(job_list);
+	filetxt_job_rec_t **prev = &jobs->hash[header.jobnum % JOB_HASH_SIZE];
 
-	while((job = (filetxt_job_rec_t *)list_next(itr)) != NULL) {
+	for (job = *prev; job; prev = &job->hash_next, job = job->hash_next) {
 		if (job->header.jobnum == header.jobnum) {
 			if(job->header.job_submit == 0 && type == JOB_START) {
-				list_remove(itr);
-				_destroy_filetxt_job_rec(job);
+				*prev = job->hash_next;
+				list_delete_all(jobs->job_list,
+						_find_job_ptr, job);
 				job = NULL;
 				break;
 			}
@@ -655,7 +709,6 @@ static filetxt_job_rec_t *_find_job_record(List job_list,
 			}
 		}
 	}
-	list_iterator_destroy(itr);
 	return job;
 }
 
@@ -823,14 +876,14 @@ static int _parse_line(char *f[], void **data, int len)
 	return SLURM_SUCCESS;
 }
 
-static void _process_start(List job_list, char *f[], int lc,
+static void _process_start(filetxt_jobs_t *jobs, char *f[], int lc,
 			   int show_full, int len)
 {
 	filetxt_job_rec_t *job = NULL;
 	filetxt_job_rec_t *temp = NULL;
 
 	_parse_line(f, (void **)&temp, len);
-	job = _find_job_record(job_list, temp->header, JOB_START);
+	job = _find_job_record(jobs, temp->header, JOB_START);
 	if (job) {
 		/* in slurm we can get 2 start records one for submit
 		 * and one for start, so look at the last one */
@@ -850,12 +903,12 @@ static void _process_start(List job_list, char *f[], int lc,
 
 	job = temp;
 	job->show_full = show_full;
-	list_append(job_list, job);
+	_add_job_record(jobs, job);
 	job->job_start_seen = 1;
 
 }
 
-static void _process_step(List job_list, char *f[], int lc,
+static void _process_step(filetxt_jobs_t *jobs, char *f[], int lc,
 			  int show_full, int len)
 {
 	filetxt_job_rec_t *job = NULL;
@@ -865,7 +918,7 @@ static void _process_step(List job_list, char *f[], int lc,
 
 	_parse_line(f, (void **)&temp, len);
 
-	job = _find_job_record(job_list, temp->header, JOB_STEP);
+	job = _find_job_record(jobs, temp->header, JOB_STEP);
 
 	if (temp->stepnum == -2) {
 		_destroy_filetxt_step_rec(temp);
@@ -953,14 +1006,14 @@ got_step:
 	}
 }
 
-static void _process_suspend(List job_list, char *f[], int lc,
+static void _process_suspend(filetxt_jobs_t *jobs, char *f[], int lc,
 			     int show_full, int len)
 {
 	filetxt_job_rec_t *job = NULL;
 	filetxt_job_rec_t *temp = NULL;
 
 	_parse_line(f, (void **)&temp, len);
-	job = _find_job_record(job_list, temp->header, JOB_SUSPEND);
+	job = _find_job_record(jobs, temp->header, JOB_SUSPEND);
 	if (!job)  {	/* fake it for now */
 		job = _create_filetxt_job_rec(temp->header);
 		job->jobname = xstrdup("(unknown)");
@@ -975,14 +1028,14 @@ static void _process_suspend(List job_list, char *f[], int lc,
 	_destroy_filetxt_job_rec(temp);
 }
 
-static void _process_terminated(List job_list, char *f[], int lc,
+static void _process_terminated(filetxt_jobs_t *jobs, char *f[], int lc,
 				int show_full, int len)
 {
 	filetxt_job_rec_t *job = NULL;
 	filetxt_job_rec_t *temp = NULL;
 
 	_parse_line(f, (void **)&temp, len);
-	job = _find_job_record(job_list, temp->header, JOB_TERMINATED);
+	job = _find_job_record(jobs, temp->header, JOB_TERMINATED);
 	if (!job) {	/* fake it for now */
 		job = _create_filetxt_job_rec(temp->header);
 		job->jobname = xstrdup("(unknown)");
@@ -1026,6 +1079,41 @@ finished:
 	_destroy_filetxt_job_rec(temp);
 }
 
+/* Read the next line the reader needs from the log.
+ * RET false at the end, or if the index turns out not to match the log */
+static bool _next_line(filetxt_reader_t *reader, FILE *fd, char *line)
+{
+	filetxt_index_plan_t *plan = reader->plan;
+
+	while (plan && !reader->seq) {
+		if (reader->inx < plan->cnt) {
+			reader->offset = plan->offsets[reader->inx];
+			if (fseeko(fd, reader->offset, SEEK_SET)
+			    || !fgets(line, BUFFER_SIZE, fd)
+			    || (strtoul(line, NULL, 10)
+				!= plan->jobids[reader->inx])) {
+				reader->bad_index = true;
+				return false;
+			}
+			reader->inx++;
+			return true;
+		}
+
+		reader->seq = true;
+		if (plan->seq_offset == FILETXT_NO_OFFSET)
+			return false;
+		if (fseeko(fd, plan->seq_offset, SEEK_SET)) {
+			reader->bad_index = true;
+			return false;
+		}
+		if (plan->skip_first && !fgets(line, BUFFER_SIZE, fd))
+			return false;
+	}
+
+	reader->offset = ftello(fd);
+	return (fgets(line, BUFFER_SIZE, fd) != NULL);
+}
+
 extern List filetxt_jobacct_process_get_jobs(slurmdb_job_cond_t *job_cond)
 {
 	char line[BUFFER_SIZE];
@@ -1045,7 +1133,9 @@ extern List filetxt_jobacct_process_get_jobs(slurmdb_job_cond_t *job_cond)
 	int show_full = 0;
 	int fdump_flag = 0;
 	List ret_job_list = list_create(slurmdb_destroy_job_rec);
-	List job_list = list_create(_destroy_filetxt_job_rec);
+	filetxt_jobs_t jobs;
+	filetxt_reader_t reader;
+	filetxt_index_plan_t plan;
 
 	filein = slurm_get_accounting_storage_loc();
 
@@ -1063,7 +1153,28 @@ extern List filetxt_jobacct_process_get_jobs(slurmdb_job_cond_t *job_cond)
 
 	fd = _open_log_file(filein);
 
-	while (fgets(line, BUFFER_SIZE, fd)) {
+	memset(&jobs, 0, sizeof(filetxt_jobs_t));
+	memset(&reader, 0, sizeof(filetxt_reader_t));
+	memset(&plan, 0, sizeof(filetxt_index_plan_t));
+	/* Use the index to only read the lines of the jobs asked for or of
+	   those around from the start time on. */
+	if (job_cond && !fdump_flag) {
+		if (job_cond->step_list && list_count(job_cond->step_list)) {
+			if (filetxt_index_plan_jobs(filein, job_cond->step_list,
+						    &plan) == SLURM_SUCCESS)
+				reader.plan = &plan;
+		} else if (job_cond->usage_start) {
+			if (filetxt_index_plan_window(
+				    filein, job_cond->usage_start,
+				    job_cond->usage_end, &plan)
+			    == SLURM_SUCCESS)
+				reader.plan = &plan;
+		}
+	}
+
+read_log:
+	_reset_job_records(&jobs);
+	while (_next_line(&reader, fd, line)) {
 		lc++;
 		fptr = line;	/* break the record into NULL-
 				   terminated strings */
@@ -1089,6 +1200,12 @@ extern List filetxt_jobacct_process_get_jobs(slurmdb_job_cond_t *job_cond)
 		uid = atoi(f[F_UID]);
 		gid = atoi(f[F_GID]);
 
+		/* past the end time only jobs already seen matter */
+		if (reader.plan
+		    && (reader.offset >= reader.plan->known_offset)
+		    && !_have_job_record(&jobs, job_id))
+			continue;
+
 		if(rec_type == JOB_STEP)
 			step_id = atoi(f[F_JOBSTEP]);
 		else
@@ -1178,21 +1295,21 @@ extern List filetxt_jobacct_process_get_jobs(slurmdb_job_cond_t *job_cond)
 				error("Bad data on a Job Start");
 				_show_rec(f);
 			} else
-				_process_start(job_list, f, lc, show_full, i);
+				_process_start(&jobs, f, lc, show_full, i);
 			break;
 		case JOB_STEP:
 			if(i < F_MAX_VSIZE) {
 				error("Bad data on a Step entry");
 				_show_rec(f);
 			} else
-				_process_step(job_list, f, lc, show_full, i);
+				_process_step(&jobs, f, lc, show_full, i);
 			break;
 		case JOB_SUSPEND:
 			if(i < F_JOB_REQUID) {
 				error("Bad data on a Suspend entry");
 				_show_rec(f);
 			} else
-				_process_suspend(job_list, f, lc,
+				_process_suspend(&jobs, f, lc,
 						 show_full, i);
 			break;
 		case JOB_TERMINATED:
@@ -1200,7 +1317,7 @@ extern List filetxt_jobacct_process_get_jobs(slurmdb_job_cond_t *job_cond)
 				error("Bad data on a Job Term");
 				_show_rec(f);
 			} else
-				_process_terminated(job_list, f, lc,
+				_process_terminated(&jobs, f, lc,
 						    show_full, i);
 			break;
 		default:
@@ -1210,13 +1327,23 @@ extern List filetxt_jobacct_process_get_jobs(slurmdb_job_cond_t *job_cond)
 		}
 	}
 
+	if (reader.bad_index) {
+		info("Index of %s does not match it, reading all of it",
+		     filein);
+		memset(&reader, 0, sizeof(filetxt_reader_t));
+		rewind(fd);
+		lc = 0;
+		goto read_log;
+	}
+	filetxt_index_free_plan(&plan);
+
 	if (ferror(fd)) {
 		perror(filein);
 		exit(1);
 	}
 	fclose(fd);
 
-	itr = list_iterator_create(job_list);
+	itr = list_iterator_create(jobs.job_list);
 
 	while((filetxt_job = list_next(itr))) {
 		slurmdb_job_rec_t *slurmdb_job =
@@ -1243,7 +1370,7 @@ extern List filetxt_jobacct_process_get_jobs(slurmdb_job_cond_t *job_cond)
 		list_iterator_destroy(itr2);
 
 	list_iterator_destroy(itr);
-	list_destroy(job_list);
+	list_destroy(jobs.job_list);
 
 	xfree(filein);
 
@@ -1520,6 +1647,10 @@ extern int filetxt_jobacct_process_archive(slurmdb_archive_cond_t *arch_cond)
 				old_logfile_name, filein);
 		goto finished2;
 	}
+	/* the offsets in the index are of the old log */
+	xfree(logfile_name);
+	logfile_name = xstrdup_printf("%s%s", filein, FILETXT_INDEX_SUFFIX);
+	(void) unlink(logfile_name);
 	fflush(new_logfile);	/* Flush the buffers before forking */
 	fflush(fd);
 
@@ -59,6 +59,7 @@
 #include "as_mysql_rollup.h"
 #include "as_mysql_txn.h"
 #include "as_mysql_usage.h"
+#include "as_mysql_usage_cache.h"
 #include "as_mysql_user.h"
 #include "as_mysql_wckey.h"
 
@@ -772,6 +773,9 @@ extern int check_connection(mysql_conn_t *mysql_conn)
 		error("We need a connection to run this");
 		errno = SLURM_ERROR;
 		return SLURM_ERROR;
+	} else if (mysql_conn->job_batch) {
+		/* The connection was checked when the job batch began,
+		 * reconnecting now would lose the batch's transaction. */
 	} else if (mysql_db_ping(mysql_conn) != 0) {
 		if (mysql_db_get_db_connection(
 			    mysql_conn, mysql_db_name, mysql_db_info)
@@ -2113,6 +2117,7 @@ extern int fini ( void )
 	destroy_mysql_db_info(mysql_db_info);
 	xfree(mysql_db_name);
 	xfree(default_qos_str);
+	as_mysql_usage_cache_fini();
 	mysql_db_cleanup();
 	return SLURM_SUCCESS;
 }
@@ -2159,6 +2164,8 @@ extern int acct_storage_p_close_connection(mysql_conn_t **mysql_conn)
 	if (!mysql_conn || !(*mysql_conn))
 		return SLURM_SUCCESS;
 
+	if ((*mysql_conn)->job_batch)
+		as_mysql_job_batch((*mysql_conn), false, false);
 	acct_storage_p_commit((*mysql_conn), 0);
 	rc = destroy_mysql_conn(*mysql_conn);
 	*mysql_conn = NULL;
@@ -2212,7 +2219,7 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 		char *query = NULL;
 		MYSQL_RES *result = NULL;
 		MYSQL_ROW row;
-		bool get_qos_count = 0;
+		bool get_qos_count = 0, flush_usage = 0;
 		ListIterator itr = NULL, itr2 = NULL, itr3 = NULL;
 		char *rem_cluster = NULL, *cluster_name = NULL;
 		slurmdb_update_object_t *object = NULL;
@@ -2244,9 +2251,18 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 		while ((object = list_next(itr))) {
 			if (!object->objects || !list_count(object->objects))
 				continue;
-			/* We only care about clusters removed here. */
+			/* We only care about clusters removed and
+			   associations changing here. */
 			switch(object->type) {
+			case SLURMDB_ADD_ASSOC:
+			case SLURMDB_MODIFY_ASSOC:
+			case SLURMDB_REMOVE_ASSOC:
+				/* the subtrees usage is summed over may
+				   have changed */
+				flush_usage = 1;
+				break;
 			case SLURMDB_REMOVE_CLUSTER:
+				flush_usage = 1;
 				itr3 = list_iterator_create(object->objects);
 				while ((rem_cluster = list_next(itr3))) {
 					while ((cluster_name =
@@ -2269,6 +2285,8 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 		list_iterator_destroy(itr2);
 		slurm_mutex_unlock(&as_mysql_cluster_list_lock);
 
+		if (flush_usage)
+			as_mysql_usage_cache_flush();
 		if (get_qos_count)
 			_set_qos_cnt(mysql_conn);
 	}
@@ -2646,6 +2664,15 @@ extern int jobacct_storage_p_step_complete(mysql_conn_t *mysql_conn,
 	return as_mysql_step_complete(mysql_conn, step_ptr);
 }
 
+/*
+ * begin or end a batch of job and step records
+ */
+extern int jobacct_storage_p_batch(mysql_conn_t *mysql_conn, bool start,
+				   bool commit)
+{
+	return as_mysql_job_batch(mysql_conn, start, commit);
+}
+
 /*
  * load into the storage a suspention of a job
  */
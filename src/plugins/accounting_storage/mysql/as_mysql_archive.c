@@ -43,6 +43,7 @@
 #include <unistd.h>
 
 #include "as_mysql_archive.h"
+#include "as_mysql_usage_cache.h"
 #include "src/common/env.h"
 
 typedef struct {
@@ -215,11 +216,11 @@ enum {
 	JOB_REQ_NAME,
 	JOB_REQ_NODELIST,
 	JOB_REQ_NODE_INX,
-	JOB_REQ_RESVID,
 	JOB_REQ_PARTITION,
 	JOB_REQ_PRIORITY,
 	JOB_REQ_QOS,
 	JOB_REQ_REQ_CPUS,
+	JOB_REQ_RESVID,
 	JOB_REQ_START,
 	JOB_REQ_STATE,
 	JOB_REQ_SUBMIT,
@@ -328,21 +329,6 @@ enum {
 	SUSPEND_REQ_COUNT
 };
 
-static int high_buffer_size = (1024 * 1024);
-
-static void _pack_local_event(local_event_t *object,
-			      uint16_t rpc_version, Buf buffer)
-{
-	packstr(object->cluster_nodes, buffer);
-	packstr(object->cpu_count, buffer);
-	packstr(object->node_name, buffer);
-	packstr(object->period_end, buffer);
-	packstr(object->period_start, buffer);
-	packstr(object->reason, buffer);
-	packstr(object->reason_uid, buffer);
-	packstr(object->state, buffer);
-}
-
 /* this needs to be allocated before calling, and since we aren't
  * doing any copying it needs to be used before destroying buffer */
 static int _unpack_local_event(local_event_t *object,
@@ -362,42 +348,6 @@ static int _unpack_local_event(local_event_t *object,
 	return SLURM_SUCCESS;
 }
 
-static void _pack_local_job(local_job_t *object,
-			    uint16_t rpc_version, Buf buffer)
-{
-	packstr(object->account, buffer);
-	packstr(object->alloc_cpus, buffer);
-	packstr(object->alloc_nodes, buffer);
-	packstr(object->associd, buffer);
-	packstr(object->blockid, buffer);
-	packstr(object->derived_ec, buffer);
-	packstr(object->derived_es, buffer);
-	packstr(object->exit_code, buffer);
-	packstr(object->timelimit, buffer);
-	packstr(object->eligible, buffer);
-	packstr(object->end, buffer);
-	packstr(object->gid, buffer);
-	packstr(object->id, buffer);
-	packstr(object->jobid, buffer);
-	packstr(object->kill_requid, buffer);
-	packstr(object->name, buffer);
-	packstr(object->nodelist, buffer);
-	packstr(object->node_inx, buffer);
-	packstr(object->partition, buffer);
-	packstr(object->priority, buffer);
-	packstr(object->qos, buffer);
-	packstr(object->req_cpus, buffer);
-	packstr(object->resvid, buffer);
-	packstr(object->start, buffer);
-	packstr(object->state, buffer);
-	packstr(object->submit, buffer);
-	packstr(object->suspended, buffer);
-	packstr(object->track_steps, buffer);
-	packstr(object->uid, buffer);
-	packstr(object->wckey, buffer);
-	packstr(object->wckey_id, buffer);
-}
-
 /* this needs to be allocated before calling, and since we aren't
  * doing any copying it needs to be used before destroying buffer */
 static int _unpack_local_job(local_job_t *object,
@@ -440,46 +390,6 @@ static int _unpack_local_job(local_job_t *object,
 	return SLURM_SUCCESS;
 }
 
-static void _pack_local_step(local_step_t *object,
-			     uint16_t rpc_version, Buf buffer)
-{
-	packstr(object->ave_cpu, buffer);
-	packstr(object->ave_pages, buffer);
-	packstr(object->ave_rss, buffer);
-	packstr(object->ave_vsize, buffer);
-	packstr(object->exit_code, buffer);
-	packstr(object->cpus, buffer);
-	packstr(object->id, buffer);
-	packstr(object->kill_requid, buffer);
-	packstr(object->max_pages, buffer);
-	packstr(object->max_pages_node, buffer);
-	packstr(object->max_pages_task, buffer);
-	packstr(object->max_rss, buffer);
-	packstr(object->max_rss_node, buffer);
-	packstr(object->max_rss_task, buffer);
-	packstr(object->max_vsize, buffer);
-	packstr(object->max_vsize_node, buffer);
-	packstr(object->max_vsize_task, buffer);
-	packstr(object->min_cpu, buffer);
-	packstr(object->min_cpu_node, buffer);
-	packstr(object->min_cpu_task, buffer);
-	packstr(object->name, buffer);
-	packstr(object->nodelist, buffer);
-	packstr(object->nodes, buffer);
-	packstr(object->node_inx, buffer);
-	packstr(object->period_end, buffer);
-	packstr(object->period_start, buffer);
-	packstr(object->period_suspended, buffer);
-	packstr(object->state, buffer);
-	packstr(object->stepid, buffer);
-	packstr(object->sys_sec, buffer);
-	packstr(object->sys_usec, buffer);
-	packstr(object->tasks, buffer);
-	packstr(object->task_dist, buffer);
-	packstr(object->user_sec, buffer);
-	packstr(object->user_usec, buffer);
-}
-
 /* this needs to be allocated before calling, and since we aren't
  * doing any copying it needs to be used before destroying buffer */
 static int _unpack_local_step(local_step_t *object,
@@ -526,15 +436,6 @@ static int _unpack_local_step(local_step_t *object,
 	return SLURM_SUCCESS;
 }
 
-static void _pack_local_suspend(local_suspend_t *object,
-				uint16_t rpc_version, Buf buffer)
-{
-	packstr(object->associd, buffer);
-	packstr(object->id, buffer);
-	packstr(object->period_end, buffer);
-	packstr(object->period_start, buffer);
-}
-
 /* this needs to be allocated before calling, and since we aren't
  * doing any copying it needs to be used before destroying buffer */
 static int _unpack_local_suspend(local_suspend_t *object,
@@ -1071,7 +972,7 @@ static uint32_t _archive_events(mysql_conn_t *mysql_conn, char *cluster_name,
 	char *tmp = NULL, *query = NULL;
 	time_t period_start = 0;
 	uint32_t cnt = 0;
-	local_event_t event;
+	archive_col_t *arch;
 	Buf buffer;
 	int error_code = 0, i = 0;
 
@@ -1102,31 +1003,19 @@ static uint32_t _archive_events(mysql_conn_t *mysql_conn, char *cluster_name,
 		return 0;
 	}
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURMDBD_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_GOT_EVENTS, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
+	arch = archive_col_create(DBD_GOT_EVENTS, cluster_name,
+				  EVENT_REQ_COUNT, EVENT_REQ_START);
 	while ((row = mysql_fetch_row(result))) {
 		if (!period_start)
 			period_start = slurm_atoul(row[EVENT_REQ_START]);
 
-		memset(&event, 0, sizeof(local_event_t));
-
-		event.cluster_nodes = row[EVENT_REQ_CNODES];
-		event.cpu_count = row[EVENT_REQ_CPU];
-		event.node_name = row[EVENT_REQ_NODE];
-		event.period_end = row[EVENT_REQ_END];
-		event.period_start = row[EVENT_REQ_START];
-		event.reason = row[EVENT_REQ_REASON];
-		event.reason_uid = row[EVENT_REQ_REASON_UID];
-		event.state = row[EVENT_REQ_STATE];
-
-		_pack_local_event(&event, SLURMDBD_VERSION, buffer);
+		/* the select returns the columns in event_req_inx
+		 * order, which is the column order of the archive */
+		archive_col_add_row(arch, row);
 	}
 	mysql_free_result(result);
+	buffer = archive_col_pack(arch);
+	archive_col_destroy(arch);
 
 //	END_TIMER2("step query");
 //	info("event query took %s", TIME_STR);
@@ -1200,7 +1089,7 @@ static uint32_t _archive_jobs(mysql_conn_t *mysql_conn, char *cluster_name,
 	char *tmp = NULL, *query = NULL;
 	time_t period_start = 0;
 	uint32_t cnt = 0;
-	local_job_t job;
+	archive_col_t *arch;
 	Buf buffer;
 	int error_code = 0, i = 0;
 
@@ -1231,54 +1120,19 @@ static uint32_t _archive_jobs(mysql_conn_t *mysql_conn, char *cluster_name,
 		return 0;
 	}
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURMDBD_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_GOT_JOBS, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
+	arch = archive_col_create(DBD_GOT_JOBS, cluster_name,
+				  JOB_REQ_COUNT, JOB_REQ_SUBMIT);
 	while ((row = mysql_fetch_row(result))) {
 		if (!period_start)
 			period_start = slurm_atoul(row[JOB_REQ_SUBMIT]);
 
-		memset(&job, 0, sizeof(local_job_t));
-
-		job.account = row[JOB_REQ_ACCOUNT];
-		job.alloc_cpus = row[JOB_REQ_ALLOC_CPUS];
-		job.alloc_nodes = row[JOB_REQ_ALLOC_NODES];
-		job.associd = row[JOB_REQ_ASSOCID];
-		job.blockid = row[JOB_REQ_BLOCKID];
-		job.derived_ec = row[JOB_REQ_DERIVED_EC];
-		job.derived_es = row[JOB_REQ_DERIVED_ES];
-		job.exit_code = row[JOB_REQ_EXIT_CODE];
-		job.timelimit = row[JOB_REQ_TIMELIMIT];
-		job.eligible = row[JOB_REQ_ELIGIBLE];
-		job.end = row[JOB_REQ_END];
-		job.gid = row[JOB_REQ_GID];
-		job.id = row[JOB_REQ_ID];
-		job.jobid = row[JOB_REQ_JOBID];
-		job.kill_requid = row[JOB_REQ_KILL_REQUID];
-		job.name = row[JOB_REQ_NAME];
-		job.nodelist = row[JOB_REQ_NODELIST];
-		job.node_inx = row[JOB_REQ_NODE_INX];
-		job.partition = row[JOB_REQ_PARTITION];
-		job.priority = row[JOB_REQ_PRIORITY];
-		job.qos = row[JOB_REQ_QOS];
-		job.req_cpus = row[JOB_REQ_REQ_CPUS];
-		job.resvid = row[JOB_REQ_RESVID];
-		job.start = row[JOB_REQ_START];
-		job.state = row[JOB_REQ_STATE];
-		job.submit = row[JOB_REQ_SUBMIT];
-		job.suspended = row[JOB_REQ_SUSPENDED];
-		job.track_steps = row[JOB_REQ_TRACKSTEPS];
-		job.uid = row[JOB_REQ_UID];
-		job.wckey = row[JOB_REQ_WCKEY];
-		job.wckey_id = row[JOB_REQ_WCKEYID];
-
-		_pack_local_job(&job, SLURMDBD_VERSION, buffer);
+		/* the select returns the columns in job_req_inx
+		 * order, which is the column order of the archive */
+		archive_col_add_row(arch, row);
 	}
 	mysql_free_result(result);
+	buffer = archive_col_pack(arch);
+	archive_col_destroy(arch);
 
 //	END_TIMER2("step query");
 //	info("event query took %s", TIME_STR);
@@ -1374,7 +1228,7 @@ static uint32_t _archive_steps(mysql_conn_t *mysql_conn, char *cluster_name,
 	char *tmp = NULL, *query = NULL;
 	time_t period_start = 0;
 	uint32_t cnt = 0;
-	local_step_t step;
+	archive_col_t *arch;
 	Buf buffer;
 	int error_code = 0, i = 0;
 
@@ -1405,58 +1259,19 @@ static uint32_t _archive_steps(mysql_conn_t *mysql_conn, char *cluster_name,
 		return 0;
 	}
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURMDBD_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_STEP_START, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
+	arch = archive_col_create(DBD_STEP_START, cluster_name,
+				  STEP_REQ_COUNT, STEP_REQ_START);
 	while ((row = mysql_fetch_row(result))) {
 		if (!period_start)
 			period_start = slurm_atoul(row[STEP_REQ_START]);
 
-		memset(&step, 0, sizeof(local_step_t));
-
-		step.ave_cpu = row[STEP_REQ_AVE_CPU];
-		step.ave_pages = row[STEP_REQ_AVE_PAGES];
-		step.ave_rss = row[STEP_REQ_AVE_RSS];
-		step.ave_vsize = row[STEP_REQ_AVE_VSIZE];
-		step.exit_code = row[STEP_REQ_EXIT_CODE];
-		step.cpus = row[STEP_REQ_CPUS];
-		step.id = row[STEP_REQ_ID];
-		step.kill_requid = row[STEP_REQ_KILL_REQUID];
-		step.max_pages = row[STEP_REQ_MAX_PAGES];
-		step.max_pages_node = row[STEP_REQ_MAX_PAGES_NODE];
-		step.max_pages_task = row[STEP_REQ_MAX_PAGES_TASK];
-		step.max_rss = row[STEP_REQ_MAX_RSS];
-		step.max_rss_node = row[STEP_REQ_MAX_RSS_NODE];
-		step.max_rss_task = row[STEP_REQ_MAX_RSS_TASK];
-		step.max_vsize = row[STEP_REQ_MAX_VSIZE];
-		step.max_vsize_node = row[STEP_REQ_MAX_VSIZE_NODE];
-		step.max_vsize_task = row[STEP_REQ_MAX_VSIZE_TASK];
-		step.min_cpu = row[STEP_REQ_MIN_CPU];
-		step.min_cpu_node = row[STEP_REQ_MIN_CPU_NODE];
-		step.min_cpu_task = row[STEP_REQ_MIN_CPU_TASK];
-		step.name = row[STEP_REQ_NAME];
-		step.nodelist = row[STEP_REQ_NODELIST];
-		step.nodes = row[STEP_REQ_NODES];
-		step.node_inx = row[STEP_REQ_NODE_INX];
-		step.period_end = row[STEP_REQ_END];
-		step.period_start = row[STEP_REQ_START];
-		step.period_suspended = row[STEP_REQ_SUSPENDED];
-		step.state = row[STEP_REQ_STATE];
-		step.stepid = row[STEP_REQ_STEPID];
-		step.sys_sec = row[STEP_REQ_SYS_SEC];
-		step.sys_usec = row[STEP_REQ_SYS_USEC];
-		step.tasks = row[STEP_REQ_TASKS];
-		step.task_dist = row[STEP_REQ_TASKDIST];
-		step.user_sec = row[STEP_REQ_USER_SEC];
-		step.user_usec = row[STEP_REQ_USER_USEC];
-
-		_pack_local_step(&step, SLURMDBD_VERSION, buffer);
+		/* the select returns the columns in step_req_inx
+		 * order, which is the column order of the archive */
+		archive_col_add_row(arch, row);
 	}
 	mysql_free_result(result);
+	buffer = archive_col_pack(arch);
+	archive_col_destroy(arch);
 
 //	END_TIMER2("step query");
 //	info("event query took %s", TIME_STR);
@@ -1556,7 +1371,7 @@ static uint32_t _archive_suspend(mysql_conn_t *mysql_conn, char *cluster_name,
 	char *tmp = NULL, *query = NULL;
 	time_t period_start = 0;
 	uint32_t cnt = 0;
-	local_suspend_t suspend;
+	archive_col_t *arch;
 	Buf buffer;
 	int error_code = 0, i = 0;
 
@@ -1587,27 +1402,19 @@ static uint32_t _archive_suspend(mysql_conn_t *mysql_conn, char *cluster_name,
 		return 0;
 	}
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURMDBD_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_JOB_SUSPEND, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
+	arch = archive_col_create(DBD_JOB_SUSPEND, cluster_name,
+				  SUSPEND_REQ_COUNT, SUSPEND_REQ_START);
 	while ((row = mysql_fetch_row(result))) {
 		if (!period_start)
 			period_start = slurm_atoul(row[SUSPEND_REQ_START]);
 
-		memset(&suspend, 0, sizeof(local_suspend_t));
-
-		suspend.id = row[SUSPEND_REQ_ID];
-		suspend.associd = row[SUSPEND_REQ_ASSOCID];
-		suspend.period_start = row[SUSPEND_REQ_START];
-		suspend.period_end = row[SUSPEND_REQ_END];
-
-		_pack_local_suspend(&suspend, SLURMDBD_VERSION, buffer);
+		/* the select returns the columns in suspend_req_inx
+		 * order, which is the column order of the archive */
+		archive_col_add_row(arch, row);
 	}
 	mysql_free_result(result);
+	buffer = archive_col_pack(arch);
+	archive_col_destroy(arch);
 
 //	END_TIMER2("step query");
 //	info("event query took %s", TIME_STR);
@@ -1666,6 +1473,252 @@ static char *_load_suspend(uint16_t rpc_version, Buf buffer,
 	return insert;
 }
 
+/* number of threads decoding blocks of a columnar archive on load */
+#define ARCHIVE_LOAD_THREADS	4
+/* how many blocks the decoding threads may get ahead of the inserts */
+#define ARCHIVE_LOAD_AHEAD	16
+
+typedef struct {
+	archive_col_t *arch;
+	bool abort;		/* stop decoding, something failed */
+	pthread_cond_t cond;
+	bool *done;		/* set once sql[inx] has been built */
+	char *insert_head;	/* "insert into ... values " */
+	uint32_t loaded;	/* blocks handed to the database so far */
+	pthread_mutex_t lock;
+	uint32_t next_block;	/* next block to decode */
+	time_t period_end;
+	time_t period_start;
+	char **sql;		/* insert statement of each block */
+} archive_load_t;
+
+/* Build the insert statement for the rows of block inx inside the time
+ * window being loaded.  Sets *sql to NULL if no rows are needed. */
+static int _load_block_sql(archive_load_t *load, uint32_t inx, char **sql)
+{
+	archive_col_t *arch = load->arch;
+	archive_block_t *block = &arch->blocks[inx];
+	char **vals = NULL, **col_data = NULL, **row, *insert = NULL, *tmp;
+	uint32_t r, rows = 0;
+	time_t row_time;
+	int c;
+
+	*sql = NULL;
+	/* the index lets us skip whole blocks outside of the window */
+	if ((block->max_time < load->period_start)
+	    || (load->period_end && (block->min_time >= load->period_end)))
+		return SLURM_SUCCESS;
+
+	if (archive_col_read_block(arch, inx, &vals, &col_data)
+	    != SLURM_SUCCESS)
+		return SLURM_ERROR;
+
+	insert = xstrdup(load->insert_head);
+	for (r = 0; r < block->rows; r++) {
+		row = &vals[r * arch->col_cnt];
+		row_time = row[arch->time_col] ?
+			slurm_atoul(row[arch->time_col]) : 0;
+		if ((row_time < load->period_start)
+		    || (load->period_end && (row_time >= load->period_end)))
+			continue;
+
+		xstrcat(insert, rows++ ? ", (" : "(");
+		for (c = 0; c < arch->col_cnt; c++) {
+			if (c)
+				xstrcat(insert, ", ");
+			if (!row[c])
+				xstrcat(insert, "NULL");
+			else if (strpbrk(row[c], "'\"")) {
+				tmp = slurm_add_slash_to_quotes(row[c]);
+				xstrfmtcat(insert, "'%s'", tmp);
+				xfree(tmp);
+			} else
+				xstrfmtcat(insert, "'%s'", row[c]);
+		}
+		xstrcat(insert, ")");
+	}
+	archive_col_free_block(arch, vals, col_data);
+
+	if (rows)
+		*sql = insert;
+	else
+		xfree(insert);
+
+	return SLURM_SUCCESS;
+}
+
+static void *_load_block_thread(void *arg)
+{
+	archive_load_t *load = (archive_load_t *)arg;
+	uint32_t inx;
+	char *sql = NULL;
+	int rc;
+
+	while (1) {
+		slurm_mutex_lock(&load->lock);
+		while (!load->abort
+		       && (load->next_block < load->arch->block_cnt)
+		       && (load->next_block
+			   >= (load->loaded + ARCHIVE_LOAD_AHEAD)))
+			pthread_cond_wait(&load->cond, &load->lock);
+		if (load->abort
+		    || (load->next_block >= load->arch->block_cnt)) {
+			slurm_mutex_unlock(&load->lock);
+			break;
+		}
+		inx = load->next_block++;
+		slurm_mutex_unlock(&load->lock);
+
+		rc = _load_block_sql(load, inx, &sql);
+
+		slurm_mutex_lock(&load->lock);
+		load->sql[inx] = sql;
+		load->done[inx] = true;
+		if (rc != SLURM_SUCCESS)
+			load->abort = true;
+		pthread_cond_broadcast(&load->cond);
+		slurm_mutex_unlock(&load->lock);
+	}
+
+	return NULL;
+}
+
+/* Load a columnar archive file.  Blocks are decompressed and turned
+ * into insert statements by a few threads while this one feeds the
+ * statements, a block at a time, to the database in file order.  All
+ * inserts go through mysql_conn so they are committed (or rolled back)
+ * together like any other load. */
+static int _load_columnar(mysql_conn_t *mysql_conn,
+			  slurmdb_archive_rec_t *arch_rec,
+			  char *data, uint32_t data_size)
+{
+	archive_col_t *arch = NULL;
+	archive_load_t load;
+	pthread_t tids[ARCHIVE_LOAD_THREADS];
+	pthread_attr_t attr;
+	char *table = NULL, **req_inx = NULL, *sql = NULL;
+	uint16_t col_cnt = 0;
+	int i, thread_cnt = 0, rc = SLURM_SUCCESS;
+	uint32_t inx;
+
+	if (archive_col_unpack(&arch, data, data_size) != SLURM_SUCCESS)
+		return EFAULT;
+
+	switch (arch->type) {
+	case DBD_GOT_EVENTS:
+		table = event_table;
+		req_inx = event_req_inx;
+		col_cnt = EVENT_REQ_COUNT;
+		break;
+	case DBD_GOT_JOBS:
+		table = job_table;
+		req_inx = job_req_inx;
+		col_cnt = JOB_REQ_COUNT;
+		break;
+	case DBD_STEP_START:
+		table = step_table;
+		req_inx = step_req_inx;
+		col_cnt = STEP_REQ_COUNT;
+		break;
+	case DBD_JOB_SUSPEND:
+		table = suspend_table;
+		req_inx = suspend_req_inx;
+		col_cnt = SUSPEND_REQ_COUNT;
+		break;
+	default:
+		error("Unknown type '%u' to load from archive", arch->type);
+		archive_col_destroy(arch);
+		return SLURM_ERROR;
+	}
+	if (arch->col_cnt != col_cnt) {
+		error("Archive of type '%s' has %u columns, expected %u",
+		      slurmdbd_msg_type_2_str(arch->type, 0),
+		      arch->col_cnt, col_cnt);
+		archive_col_destroy(arch);
+		return SLURM_ERROR;
+	}
+	if (!arch->block_cnt) {
+		error("we didn't get any records from this file of type '%s'",
+		      slurmdbd_msg_type_2_str(arch->type, 0));
+		archive_col_destroy(arch);
+		return SLURM_ERROR;
+	}
+
+	memset(&load, 0, sizeof(archive_load_t));
+	load.arch = arch;
+	load.period_start = arch_rec->period_start;
+	load.period_end = arch_rec->period_end;
+	load.sql = xmalloc(sizeof(char *) * arch->block_cnt);
+	load.done = xmalloc(sizeof(bool) * arch->block_cnt);
+	slurm_mutex_init(&load.lock);
+	pthread_cond_init(&load.cond, NULL);
+
+	xstrfmtcat(load.insert_head, "insert into \"%s_%s\" (%s",
+		   arch->cluster_name, table, req_inx[0]);
+	for (i = 1; i < col_cnt; i++)
+		xstrfmtcat(load.insert_head, ", %s", req_inx[i]);
+	xstrcat(load.insert_head, ") values ");
+
+	for (i = 0; (i < ARCHIVE_LOAD_THREADS) && (i < arch->block_cnt); i++) {
+		slurm_attr_init(&attr);
+		if (pthread_create(&tids[i], &attr, _load_block_thread, &load))
+			fatal("pthread_create: %m");
+		slurm_attr_destroy(&attr);
+		thread_cnt++;
+	}
+
+	for (inx = 0; inx < arch->block_cnt; inx++) {
+		slurm_mutex_lock(&load.lock);
+		while (!load.done[inx] && !load.abort)
+			pthread_cond_wait(&load.cond, &load.lock);
+		if (!load.done[inx] || load.abort) {
+			slurm_mutex_unlock(&load.lock);
+			rc = SLURM_ERROR;
+			break;
+		}
+		sql = load.sql[inx];
+		load.sql[inx] = NULL;
+		load.loaded = inx + 1;
+		pthread_cond_broadcast(&load.cond);
+		slurm_mutex_unlock(&load.lock);
+
+		if (!sql)
+			continue;
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, sql);
+		rc = mysql_db_query_check_after(mysql_conn, sql);
+		xfree(sql);
+		if (rc != SLURM_SUCCESS) {
+			slurm_mutex_lock(&load.lock);
+			load.abort = true;
+			pthread_cond_broadcast(&load.cond);
+			slurm_mutex_unlock(&load.lock);
+			break;
+		}
+	}
+
+	for (i = 0; i < thread_cnt; i++)
+		pthread_join(tids[i], NULL);
+
+	if (rc == SLURM_SUCCESS)
+		debug("Loaded %s archive of %s (%u records in %u blocks)",
+		      table, arch->cluster_name, arch->rec_cnt,
+		      arch->block_cnt);
+	else
+		error("Couldn't load old data");
+
+	for (inx = 0; inx < arch->block_cnt; inx++)
+		xfree(load.sql[inx]);
+	xfree(load.sql);
+	xfree(load.done);
+	xfree(load.insert_head);
+	pthread_cond_destroy(&load.cond);
+	slurm_mutex_destroy(&load.lock);
+	archive_col_destroy(arch);
+
+	return rc;
+}
+
 static int _execute_archive(mysql_conn_t *mysql_conn,
 			    char *cluster_name,
 			    slurmdb_archive_cond_t *arch_cond)
@@ -1939,14 +1992,26 @@ extern int as_mysql_jobacct_process_archive_load(
 		goto got_sql;
 	}
 
+	if (archive_col_is_columnar(data, data_size)) {
+		error_code = _load_columnar(mysql_conn, arch_rec,
+					    data, data_size);
+		xfree(data);
+		return error_code;
+	}
+
+	/* this is the row at a time packed format written before the
+	   columnar one, it has no index so it is loaded whole. */
+	if (arch_rec->period_start || arch_rec->period_end)
+		info("Archive file %s has no block index, loading all of it",
+		     arch_rec->archive_file);
 	buffer = create_buf(data, data_size);
 
 	safe_unpack16(&ver, buffer);
 	debug3("Version in assoc_mgr_state header is %u", ver);
-	if (ver <= SLURMDBD_VERSION || ver < SLURMDBD_VERSION_MIN) {
+	if (ver > SLURMDBD_VERSION || ver < SLURMDBD_VERSION_MIN) {
 		error("***********************************************");
 		error("Can not recover archive file, incompatible version, "
-		      "got %u need > %u <= %u", ver,
+		      "got %u need >= %u <= %u", ver,
 		      SLURMDBD_VERSION_MIN, SLURMDBD_VERSION);
 		error("***********************************************");
 		free_buf(buffer);
@@ -1961,6 +2026,7 @@ extern int as_mysql_jobacct_process_archive_load(
 		error("we didn't get any records from this file of type '%s'",
 		      slurmdbd_msg_type_2_str(type, 0));
 		free_buf(buffer);
+		data = NULL;
 		goto got_sql;
 	}
 
@@ -1997,6 +2063,8 @@ got_sql:
 		error("Couldn't load old data");
 		return SLURM_ERROR;
 	}
+	/* old sql archives can fill in the usage tables */
+	as_mysql_usage_cache_flush();
 
 	return SLURM_SUCCESS;
 }
@@ -44,6 +44,180 @@
 #include "src/common/parse_time.h"
 #include "src/common/jobacct_common.h"
 
+#define BATCH_HASH_SIZE		1024
+#define BATCH_QUERY_MAX		(512 * 1024)
+
+/* db_index of a job learned while processing a batch, so later records
+ * for the job in the same batch need not look it up again */
+typedef struct batch_index {
+	uint32_t assoc_id;
+	uint32_t db_index;
+	uint32_t job_id;
+	struct batch_index *next;
+	time_t submit;
+} batch_index_t;
+
+/* Job and step records deferred while processing a batch from the
+ * slurmctld.  Updates are queued in order and sent as one
+ * multi-statement query, consecutive step starts are merged into one
+ * multi-row insert. */
+typedef struct {
+	batch_index_t *index_hash[BATCH_HASH_SIZE];
+	char *query;		/* deferred statements */
+	int query_len;
+	int rc;			/* first error seen in the batch */
+	char *step_rows;	/* values of the pending step insert */
+	int step_len;
+} job_batch_t;
+
+static void _batch_free(job_batch_t *batch)
+{
+	batch_index_t *index_ptr, *next_ptr;
+	int i;
+
+	for (i = 0; i < BATCH_HASH_SIZE; i++) {
+		for (index_ptr = batch->index_hash[i]; index_ptr;
+		     index_ptr = next_ptr) {
+			next_ptr = index_ptr->next;
+			xfree(index_ptr);
+		}
+	}
+	xfree(batch->query);
+	xfree(batch->step_rows);
+	xfree(batch);
+}
+
+static uint32_t _batch_find_index(mysql_conn_t *mysql_conn, time_t submit,
+				  uint32_t jobid, uint32_t associd)
+{
+	job_batch_t *batch = mysql_conn->job_batch;
+	batch_index_t *index_ptr;
+
+	if (!batch)
+		return 0;
+	for (index_ptr = batch->index_hash[jobid % BATCH_HASH_SIZE];
+	     index_ptr; index_ptr = index_ptr->next) {
+		if ((index_ptr->job_id == jobid)
+		    && (index_ptr->assoc_id == associd)
+		    && (index_ptr->submit == submit))
+			return index_ptr->db_index;
+	}
+	return 0;
+}
+
+static void _batch_add_index(mysql_conn_t *mysql_conn, time_t submit,
+			     uint32_t jobid, uint32_t associd,
+			     uint32_t db_index)
+{
+	job_batch_t *batch = mysql_conn->job_batch;
+	batch_index_t *index_ptr;
+	int inx = jobid % BATCH_HASH_SIZE;
+
+	if (!batch || !db_index)
+		return;
+	for (index_ptr = batch->index_hash[inx]; index_ptr;
+	     index_ptr = index_ptr->next) {
+		if ((index_ptr->job_id == jobid)
+		    && (index_ptr->assoc_id == associd)
+		    && (index_ptr->submit == submit)) {
+			index_ptr->db_index = db_index;
+			return;
+		}
+	}
+	index_ptr = xmalloc(sizeof(batch_index_t));
+	index_ptr->assoc_id = associd;
+	index_ptr->db_index = db_index;
+	index_ptr->job_id = jobid;
+	index_ptr->submit = submit;
+	index_ptr->next = batch->index_hash[inx];
+	batch->index_hash[inx] = index_ptr;
+}
+
+/* Move the pending multi-row step insert onto the deferred query */
+static void _batch_close_steps(mysql_conn_t *mysql_conn, job_batch_t *batch)
+{
+	char *query;
+
+	if (!batch->step_rows)
+		return;
+
+	query = xstrdup_printf(
+		"insert into \"%s_%s\" (job_db_inx, id_step, time_start, "
+		"step_name, state, "
+		"cpus_alloc, nodes_alloc, task_cnt, nodelist, "
+		"node_inx, task_dist) values %s "
+		"on duplicate key update cpus_alloc=VALUES(cpus_alloc), "
+		"nodes_alloc=VALUES(nodes_alloc), task_cnt=VALUES(task_cnt), "
+		"time_end=0, state=VALUES(state), "
+		"nodelist=VALUES(nodelist), node_inx=VALUES(node_inx), "
+		"task_dist=VALUES(task_dist);",
+		mysql_conn->cluster_name, step_table, batch->step_rows);
+	xfree(batch->step_rows);
+	batch->step_len = 0;
+	batch->query_len += strlen(query);
+	xstrcat(batch->query, query);
+	xfree(query);
+}
+
+/* Send all the statements deferred so far */
+static int _batch_flush(mysql_conn_t *mysql_conn)
+{
+	job_batch_t *batch = mysql_conn->job_batch;
+
+	if (!batch)
+		return SLURM_SUCCESS;
+
+	_batch_close_steps(mysql_conn, batch);
+	if (batch->query) {
+		if ((batch->rc == SLURM_SUCCESS)
+		    && (mysql_db_query_check_after(mysql_conn, batch->query)
+			!= SLURM_SUCCESS))
+			batch->rc = SLURM_ERROR;
+		xfree(batch->query);
+		batch->query_len = 0;
+	}
+	return batch->rc;
+}
+
+/* Run a statement that returns nothing now, or defer it to the end of
+ * the batch if one is being processed */
+static int _batch_query(mysql_conn_t *mysql_conn, char *query)
+{
+	job_batch_t *batch = mysql_conn->job_batch;
+	int len;
+
+	if (!batch)
+		return mysql_db_query(mysql_conn, query);
+
+	_batch_close_steps(mysql_conn, batch);
+	len = strlen(query);
+	xstrcat(batch->query, query);
+	if (len && (query[len - 1] != ';')) {
+		xstrcat(batch->query, ";");
+		len++;
+	}
+	batch->query_len += len;
+	if (batch->query_len >= BATCH_QUERY_MAX)
+		return _batch_flush(mysql_conn);
+	return batch->rc;
+}
+
+/* Add a row to the pending multi-row step insert */
+static int _batch_step_row(mysql_conn_t *mysql_conn, char *row)
+{
+	job_batch_t *batch = mysql_conn->job_batch;
+
+	if (batch->step_rows) {
+		xstrcat(batch->step_rows, ", ");
+		batch->step_len += 2;
+	}
+	xstrcat(batch->step_rows, row);
+	batch->step_len += strlen(row);
+	if ((batch->query_len + batch->step_len) >= BATCH_QUERY_MAX)
+		return _batch_flush(mysql_conn);
+	return batch->rc;
+}
+
 /* Used in job functions for getting the database index based off the
  * submit time, job and assoc id.  0 is returned if none is found
  */
@@ -53,11 +227,16 @@ static int _get_db_index(mysql_conn_t *mysql_conn,
 	MYSQL_RES *result = NULL;
 	MYSQL_ROW row;
 	int db_index = 0;
-	char *query = xstrdup_printf("select job_db_inx from \"%s_%s\" where "
-				     "time_submit=%d and id_job=%u "
-				     "and id_assoc=%u",
-				     mysql_conn->cluster_name, job_table,
-				     (int)submit, jobid, associd);
+	char *query;
+
+	if ((db_index = _batch_find_index(mysql_conn, submit, jobid, associd)))
+		return db_index;
+
+	query = xstrdup_printf("select job_db_inx from \"%s_%s\" where "
+			       "time_submit=%d and id_job=%u "
+			       "and id_assoc=%u",
+			       mysql_conn->cluster_name, job_table,
+			       (int)submit, jobid, associd);
 
 	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
 		xfree(query);
@@ -77,6 +256,7 @@ static int _get_db_index(mysql_conn_t *mysql_conn,
 	}
 	db_index = slurm_atoul(row[0]);
 	mysql_free_result(result);
+	_batch_add_index(mysql_conn, submit, jobid, associd, db_index);
 
 	return db_index;
 }
@@ -189,8 +369,17 @@ static uint32_t _get_wckeyid(mysql_conn_t *mysql_conn, char **name,
 			if (as_mysql_add_wckeys(mysql_conn,
 						slurm_get_slurm_user_id(),
 						wckey_list)
-			    == SLURM_SUCCESS)
+			    == SLURM_SUCCESS) {
+				/* The new wckey is handed out as soon
+				   as it is added, so it can't wait for
+				   the end of a batch to be committed. */
+				if (mysql_conn->job_batch
+				    && !mysql_conn->rollback
+				    && (_batch_flush(mysql_conn)
+					== SLURM_SUCCESS))
+					mysql_db_commit(mysql_conn);
 				acct_storage_p_commit(mysql_conn, 1);
+			}
 			/* If that worked lets get it */
 			assoc_mgr_fill_in_wckey(mysql_conn, &wckey_rec,
 						ACCOUNTING_ENFORCE_WCKEYS,
@@ -234,6 +423,11 @@ extern int as_mysql_job_start(mysql_conn_t *mysql_conn,
 
 	debug2("as_mysql_slurmdb_job_start() called");
 
+	/* Anything deferred earlier in the batch has to be in the
+	 * database before we look at or insert this job. */
+	if (_batch_flush(mysql_conn) != SLURM_SUCCESS)
+		return SLURM_ERROR;
+
 	job_state = job_ptr->job_state;
 
 	/* Since we need a new db_inx make sure the old db_inx
@@ -475,7 +669,7 @@ no_rollup_change:
 	try_again:
 		if (!(job_ptr->db_index = mysql_db_insert_ret_id(
 			      mysql_conn, query))) {
-			if (!reinit) {
+			if (!reinit && !mysql_conn->job_batch) {
 				error("It looks like the storage has gone "
 				      "away trying to reconnect");
 				mysql_db_close_db_connection(
@@ -486,7 +680,10 @@ no_rollup_change:
 				goto try_again;
 			} else
 				rc = SLURM_ERROR;
-		}
+		} else
+			_batch_add_index(mysql_conn, submit_time,
+					 job_ptr->job_id, job_ptr->assoc_id,
+					 job_ptr->db_index);
 	} else {
 		query = xstrdup_printf("update \"%s_%s\" set nodelist='%s', ",
 				       mysql_conn->cluster_name,
@@ -515,7 +712,7 @@ no_rollup_change:
 			   job_ptr->db_index);
 		debug3("%d(%s:%d) query\n%s",
 		       mysql_conn->conn, THIS_FILE, __LINE__, query);
-		rc = mysql_db_query(mysql_conn, query);
+		rc = _batch_query(mysql_conn, query);
 	}
 
 	xfree(block_id);
@@ -540,7 +737,7 @@ no_rollup_change:
 
 		debug3("%d(%s:%d) query\n%s",
 		       mysql_conn->conn, THIS_FILE, __LINE__, query);
-		rc = mysql_db_query(mysql_conn, query);
+		rc = _batch_query(mysql_conn, query);
 		xfree(query);
 	}
 
@@ -730,7 +927,7 @@ extern int as_mysql_job_complete(mysql_conn_t *mysql_conn,
 
 	debug3("%d(%s:%d) query\n%s",
 	       mysql_conn->conn, THIS_FILE, __LINE__, query);
-	rc = mysql_db_query(mysql_conn, query);
+	rc = _batch_query(mysql_conn, query);
 	xfree(query);
 
 	return rc;
@@ -855,6 +1052,21 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 
 	step_name = slurm_add_slash_to_quotes(step_ptr->name);
 
+	if (mysql_conn->job_batch) {
+		/* The stepid could be -2 so use %d not %u */
+		query = xstrdup_printf(
+			"(%d, %d, %d, '%s', %d, %d, %d, %d, '%s', '%s', %d)",
+			step_ptr->job_ptr->db_index,
+			step_ptr->step_id,
+			(int)start_time, step_name,
+			JOB_RUNNING, cpus, nodes, tasks, node_list, node_inx,
+			task_dist);
+		rc = _batch_step_row(mysql_conn, query);
+		xfree(query);
+		xfree(step_name);
+		return rc;
+	}
+
 	/* we want to print a -1 for the requid so leave it a
 	   %d */
 	/* The stepid could be -2 so use %d not %u */
@@ -1043,7 +1255,7 @@ extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 		step_ptr->job_ptr->db_index, step_ptr->step_id);
 	debug3("%d(%s:%d) query\n%s",
 	       mysql_conn->conn, THIS_FILE, __LINE__, query);
-	rc = mysql_db_query(mysql_conn, query);
+	rc = _batch_query(mysql_conn, query);
 	xfree(query);
 
 	return rc;
@@ -1060,6 +1272,8 @@ extern int as_mysql_suspend(mysql_conn_t *mysql_conn,
 
 	if (check_connection(mysql_conn) != SLURM_SUCCESS)
 		return ESLURM_DB_CONNECTION;
+	if (_batch_flush(mysql_conn) != SLURM_SUCCESS)
+		return SLURM_ERROR;
 
 	if (job_ptr->resize_time)
 		submit_time = job_ptr->resize_time;
@@ -1158,6 +1372,8 @@ extern int as_mysql_flush_jobs_on_cluster(
 
 	if (check_connection(mysql_conn) != SLURM_SUCCESS)
 		return ESLURM_DB_CONNECTION;
+	if (_batch_flush(mysql_conn) != SLURM_SUCCESS)
+		return SLURM_ERROR;
 
 	/* First we need to get the job_db_inx's and states so we can clean up
 	 * the suspend table and the step table
@@ -1237,3 +1453,49 @@ extern int as_mysql_flush_jobs_on_cluster(
 
 	return rc;
 }
+
+/* Begin or end a batch of job and step records.  While the batch is
+ * open updates are deferred and sent together, and if the connection
+ * is not already in rollback mode everything is written in one
+ * transaction that is committed (or with commit false rolled back)
+ * when the batch ends.
+ */
+extern int as_mysql_job_batch(mysql_conn_t *mysql_conn, bool start,
+			      bool commit)
+{
+	job_batch_t *batch = mysql_conn->job_batch;
+	int rc;
+
+	if (start) {
+		if (batch) {
+			error("as_mysql_job_batch: batch already started");
+			return SLURM_ERROR;
+		}
+		if ((rc = check_connection(mysql_conn)) != SLURM_SUCCESS)
+			return rc;
+		if (!mysql_conn->rollback)
+			mysql_autocommit(mysql_conn->db_conn, 0);
+		mysql_conn->job_batch = xmalloc(sizeof(job_batch_t));
+		return SLURM_SUCCESS;
+	}
+
+	if (!batch)
+		return SLURM_SUCCESS;
+
+	if (commit)
+		rc = _batch_flush(mysql_conn);
+	else
+		rc = SLURM_ERROR;
+	mysql_conn->job_batch = NULL;
+	_batch_free(batch);
+
+	if (!mysql_conn->rollback && mysql_conn->db_conn) {
+		if (rc == SLURM_SUCCESS)
+			rc = mysql_db_commit(mysql_conn);
+		if ((rc != SLURM_SUCCESS) && mysql_db_rollback(mysql_conn))
+			error("as_mysql_job_batch: rollback failed");
+		mysql_autocommit(mysql_conn->db_conn, 1);
+	}
+
+	return rc;
+}
@@ -63,4 +63,7 @@ extern int as_mysql_suspend(mysql_conn_t *mysql_conn, uint32_t old_db_inx,
 
 extern int as_mysql_flush_jobs_on_cluster(
 	mysql_conn_t *mysql_conn, time_t event_time);
+
+extern int as_mysql_job_batch(mysql_conn_t *mysql_conn, bool start,
+			      bool commit);
 #endif
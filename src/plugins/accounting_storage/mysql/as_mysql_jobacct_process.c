@@ -311,7 +311,8 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 			     char *cluster_name,
 			     char *job_fields, char *step_fields,
 			     char *sent_extra,
-			     bool is_admin, int only_pending, List sent_list)
+			     bool is_admin, int only_pending, List sent_list,
+			     uint32_t page_rows, uint32_t *page_jobid)
 {
 	char *query = NULL;
 	char *extra = xstrdup(sent_extra);
@@ -329,8 +330,11 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	char *prefix="t2";
 	int rc = SLURM_SUCCESS;
 	int last_id = -1, curr_id = -1, last_state = -1;
+	int page_last_id = -1;
 	local_cluster_t *curr_cluster = NULL;
 
+	*page_jobid = 0;
+
 	/* This is here to make sure we are looking at only this user
 	 * if this flag is set.  We also include any accounts they may be
 	 * coordinator of.
@@ -388,31 +392,73 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	setup_job_cluster_cond_limits(mysql_conn, job_cond,
 				      cluster_name, &extra);
 
+	/* Start after the last job of the previous page */
+	if (page_rows && job_cond->page_cluster
+	    && !strcmp(cluster_name, job_cond->page_cluster)) {
+		if (extra)
+			xstrfmtcat(extra, " && (t1.id_job>%u)",
+				   job_cond->page_jobid);
+		else
+			xstrfmtcat(extra, " where (t1.id_job>%u)",
+				   job_cond->page_jobid);
+	}
+
+get_page:
 	query = xstrdup_printf("select %s from \"%s_%s\" as t1 "
 			       "left join \"%s_%s\" as t2 "
 			       "on t1.id_assoc=t2.id_assoc",
 			       job_fields, cluster_name, job_table,
 			       cluster_name, assoc_table);
-	if (extra) {
+	if (extra)
 		xstrcat(query, extra);
-		xfree(extra);
-	}
 
 	/* Here we want to order them this way in such a way so it is
 	   easy to look for duplicates, it is also easy to sort the
 	   resized jobs.
 	*/
-	xstrcat(query, " group by id_job, time_submit desc");
+	xstrcat(query, " group by id_job, time_submit "
+		"order by id_job, time_submit desc");
+	if (page_rows)
+		xstrfmtcat(query, " limit %u", page_rows);
 
 	debug3("%d(%s:%d) query\n%s",
 	       mysql_conn->conn, THIS_FILE, __LINE__, query);
 	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
 		xfree(query);
+		xfree(extra);
 		rc = SLURM_ERROR;
 		goto end_it;
 	}
 	xfree(query);
 
+	/* If the page is full the records of the last job id may go
+	   on, leave that job for the next page.  If the page holds
+	   nothing but that job get the rest of its records instead so
+	   the next page can start after it. */
+	if (page_rows && (mysql_num_rows(result) >= page_rows)) {
+		int first_id;
+
+		row = mysql_fetch_row(result);
+		first_id = slurm_atoul(row[JOB_REQ_JOBID]);
+		mysql_data_seek(result, mysql_num_rows(result) - 1);
+		row = mysql_fetch_row(result);
+		page_last_id = slurm_atoul(row[JOB_REQ_JOBID]);
+		mysql_data_seek(result, 0);
+		if (first_id == page_last_id) {
+			mysql_free_result(result);
+			if (extra)
+				xstrfmtcat(extra, " && (t1.id_job=%d)",
+					   page_last_id);
+			else
+				xstrfmtcat(extra, " where (t1.id_job=%d)",
+					   page_last_id);
+			*page_jobid = page_last_id;
+			page_last_id = -1;
+			page_rows = 0;
+			goto get_page;
+		}
+	}
+	xfree(extra);
 
 	/* Here we set up environment to check used nodes of jobs.
 	   Since we store the bitmap of the entire cluster we can use
@@ -435,6 +481,12 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 		int submit = slurm_atoul(row[JOB_REQ_SUBMIT]);
 
 		curr_id = slurm_atoul(row[JOB_REQ_JOBID]);
+		if (curr_id == page_last_id) {
+			/* Rows come ordered by job id so this is the
+			   end of the page, it starts after last_id. */
+			*page_jobid = last_id;
+			break;
+		}
 
 		if (job_cond && !job_cond->duplicates
 		    && (curr_id == last_id)
@@ -807,6 +859,7 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 		/* need to reset here to make the above test valid */
 		step = NULL;
 	}
+
 	mysql_free_result(result);
 
 end_it:
@@ -1292,7 +1345,9 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 	slurmdb_user_rec_t user;
 	int only_pending = 0;
 	List use_cluster_list = as_mysql_cluster_list;
-	char *cluster_name;
+	char *cluster_name, *page_cluster = NULL;
+	uint32_t page_jobid = 0;
+	bool skip_clusters;
 
 	memset(&user, 0, sizeof(slurmdb_user_rec_t));
 	user.uid = uid;
@@ -1335,18 +1390,60 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 		slurm_mutex_lock(&as_mysql_cluster_list_lock);
 
 	job_list = list_create(slurmdb_destroy_job_rec);
+next_page:
+	/* A page goes through the clusters in order starting with
+	   the one the last page ended in */
+	skip_clusters = job_cond && job_cond->page_size
+		&& job_cond->page_cluster;
+	page_jobid = 0;
 	itr = list_iterator_create(use_cluster_list);
 	while ((cluster_name = list_next(itr))) {
 		int rc;
+		uint32_t page_rows = 0;
+
+		if (skip_clusters) {
+			if (strcmp(cluster_name, job_cond->page_cluster))
+				continue;
+			skip_clusters = 0;
+		}
+		if (job_cond && job_cond->page_size)
+			page_rows = job_cond->page_size - list_count(job_list);
+
 		if ((rc = _cluster_get_jobs(mysql_conn, &user, job_cond,
 					    cluster_name, tmp, tmp2, extra,
-					    is_admin, only_pending, job_list))
+					    is_admin, only_pending, job_list,
+					    page_rows, &page_jobid))
 		    != SLURM_SUCCESS)
 			error("Problem getting jobs for cluster %s",
 			      cluster_name);
+		if (page_jobid) {
+			page_cluster = cluster_name;
+			break;
+		}
 	}
 	list_iterator_destroy(itr);
 
+	if (job_cond && job_cond->page_size) {
+		xfree(job_cond->page_cluster);
+		job_cond->page_jobid = 0;
+		if (page_jobid && !list_count(job_list)) {
+			/* Nothing in this page made it through the
+			   filters, don't let the caller think we are
+			   done. */
+			job_cond->page_cluster = xstrdup(page_cluster);
+			job_cond->page_jobid = page_jobid;
+			goto next_page;
+		} else if (page_jobid) {
+			slurmdb_job_rec_t *job = NULL, *last_job = NULL;
+			itr = list_iterator_create(job_list);
+			while ((job = list_next(itr)))
+				last_job = job;
+			list_iterator_destroy(itr);
+			job_cond->page_cluster = xstrdup(last_job->cluster);
+			job_cond->page_jobid = last_job->jobid;
+		}
+	}
+
 	if (use_cluster_list == as_mysql_cluster_list)
 		slurm_mutex_unlock(&as_mysql_cluster_list_lock);
 
@@ -42,11 +42,24 @@
 #include "as_mysql_archive.h"
 #include "src/common/parse_time.h"
 
-typedef struct {
+/* Hours rolled up from one set of queries */
+#define ROLLUP_WINDOW_HOURS	24
+#define ID_HASH_SIZE		256
+#define SUSPEND_HASH_SIZE	1024
+
+typedef struct local_id_usage {
 	int id;
 	uint64_t a_cpu;
+	struct local_id_usage *next; /* next in local_id_table_t hash */
 } local_id_usage_t;
 
+/* Usage by association or wckey for an hour, listed for the inserts
+ * and hashed by id for the lookups */
+typedef struct {
+	local_id_usage_t *hash[ID_HASH_SIZE];
+	List list;
+} local_id_table_t;
+
 typedef struct {
 	int id; /*only needed for reservations */
 	uint64_t total_time;
@@ -71,6 +84,40 @@ typedef struct {
 	time_t end;
 } local_resv_usage_t;
 
+typedef struct {
+	local_id_table_t assoc_usage;
+	local_cluster_usage_t *c_usage;
+	ListIterator c_itr;
+	List cluster_down_list;
+	time_t end;
+	ListIterator r_itr;
+	List resv_usage_list;
+	time_t start;
+	local_id_table_t wckey_usage;
+} local_hour_usage_t;
+
+typedef struct local_suspend {
+	uint32_t job_db_inx;
+	time_t start;
+	time_t end;
+	struct local_suspend *next;
+} local_suspend_t;
+
+/* A job as read from the job table */
+typedef struct {
+	uint32_t assoc_id;
+	uint32_t db_inx;
+	uint32_t job_id;
+	uint32_t resv_id;
+	uint32_t row_acpu;
+	time_t row_eligible;
+	time_t row_end;
+	uint32_t row_rcpu;
+	time_t row_start;
+	local_suspend_t *suspend; /* suspend_hash bucket of the job */
+	uint32_t wckey_id;
+} local_job_usage_t;
+
 static void _destroy_local_id_usage(void *object)
 {
 	local_id_usage_t *a_usage = (local_id_usage_t *)object;
@@ -97,6 +144,50 @@ static void _destroy_local_resv_usage(void *object)
 	}
 }
 
+static local_id_usage_t *_get_id_usage(local_id_table_t *table, int id)
+{
+	int inx = (uint32_t)id % ID_HASH_SIZE;
+	local_id_usage_t *usage;
+
+	for (usage = table->hash[inx]; usage; usage = usage->next) {
+		if (usage->id == id)
+			return usage;
+	}
+
+	usage = xmalloc(sizeof(local_id_usage_t));
+	usage->id = id;
+	usage->next = table->hash[inx];
+	table->hash[inx] = usage;
+	list_append(table->list, usage);
+
+	return usage;
+}
+
+static void _init_hour_usage(local_hour_usage_t *hour,
+			     time_t curr_start, time_t curr_end)
+{
+	memset(hour, 0, sizeof(local_hour_usage_t));
+	hour->start = curr_start;
+	hour->end = curr_end;
+	hour->assoc_usage.list = list_create(_destroy_local_id_usage);
+	hour->wckey_usage.list = list_create(_destroy_local_id_usage);
+	hour->cluster_down_list = list_create(_destroy_local_cluster_usage);
+	hour->resv_usage_list = list_create(_destroy_local_resv_usage);
+	hour->c_itr = list_iterator_create(hour->cluster_down_list);
+	hour->r_itr = list_iterator_create(hour->resv_usage_list);
+}
+
+static void _fini_hour_usage(local_hour_usage_t *hour)
+{
+	list_iterator_destroy(hour->c_itr);
+	list_iterator_destroy(hour->r_itr);
+	list_destroy(hour->assoc_usage.list);
+	list_destroy(hour->wckey_usage.list);
+	list_destroy(hour->cluster_down_list);
+	list_destroy(hour->resv_usage_list);
+	_destroy_local_cluster_usage(hour->c_usage);
+}
+
 static int _process_purge(mysql_conn_t *mysql_conn,
 			  char *cluster_name,
 			  uint16_t archive_data,
@@ -301,34 +392,31 @@ static int _process_cluster_usage(mysql_conn_t *mysql_conn,
 	return rc;
 }
 
-static local_cluster_usage_t *_setup_cluster_usage(mysql_conn_t *mysql_conn,
-						   char *cluster_name,
-						   time_t curr_start,
-						   time_t curr_end,
-						   List cluster_down_list)
+static char *event_req_inx[] = {
+	"node_name",
+	"cpu_count",
+	"time_start",
+	"time_end",
+	"state",
+};
+enum {
+	EVENT_REQ_NAME,
+	EVENT_REQ_CPU,
+	EVENT_REQ_START,
+	EVENT_REQ_END,
+	EVENT_REQ_STATE,
+	EVENT_REQ_COUNT
+};
+
+/* Get the events from curr_start to curr_end for _setup_cluster_usage() */
+static MYSQL_RES *_get_cluster_events(mysql_conn_t *mysql_conn,
+				      char *cluster_name,
+				      time_t curr_start, time_t curr_end)
 {
-	local_cluster_usage_t *c_usage = NULL;
-	char *query = NULL;
 	MYSQL_RES *result = NULL;
-	MYSQL_ROW row;
-	int i = 0;
-
-	char *event_req_inx[] = {
-		"node_name",
-		"cpu_count",
-		"time_start",
-		"time_end",
-		"state",
-	};
+	char *query = NULL;
 	char *event_str = NULL;
-	enum {
-		EVENT_REQ_NAME,
-		EVENT_REQ_CPU,
-		EVENT_REQ_START,
-		EVENT_REQ_END,
-		EVENT_REQ_STATE,
-		EVENT_REQ_COUNT
-	};
+	int i = 0;
 
 	xstrfmtcat(event_str, "%s", event_req_inx[i]);
 	for(i=1; i<EVENT_REQ_COUNT; i++) {
@@ -351,17 +439,33 @@ static local_cluster_usage_t *_setup_cluster_usage(mysql_conn_t *mysql_conn,
 
 	debug3("%d(%s:%d) query\n%s",
 	       mysql_conn->conn, THIS_FILE, __LINE__, query);
-	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
-		xfree(query);
-		return NULL;
-	}
+	result = mysql_db_query_ret(mysql_conn, query, 0);
 	xfree(query);
 
+	return result;
+}
+
+/* Set up the cluster usage for one hour from the events read by
+ * _get_cluster_events() for a span including it */
+static local_cluster_usage_t *_setup_cluster_usage(MYSQL_RES *result,
+						   time_t curr_start,
+						   time_t curr_end,
+						   List cluster_down_list)
+{
+	local_cluster_usage_t *c_usage = NULL;
+	MYSQL_ROW row;
+
+	mysql_data_seek(result, 0);
 	while ((row = mysql_fetch_row(result))) {
 		time_t row_start = slurm_atoul(row[EVENT_REQ_START]);
 		time_t row_end = slurm_atoul(row[EVENT_REQ_END]);
 		uint32_t row_cpu = slurm_atoul(row[EVENT_REQ_CPU]);
 		uint16_t state = slurm_atoul(row[EVENT_REQ_STATE]);
+
+		if ((row_start >= curr_end)
+		    || (row_end && (row_end < curr_start)))
+			continue;
+
 		if (row_start < curr_start)
 			row_start = curr_start;
 
@@ -442,10 +546,296 @@ static local_cluster_usage_t *_setup_cluster_usage(mysql_conn_t *mysql_conn,
 			}
 		}
 	}
-	mysql_free_result(result);
 	return c_usage;
 }
 
+/* Add the usage of a job to one of the hours it was eligible or ran */
+static void _add_job_hour_usage(local_hour_usage_t *hour,
+				local_job_usage_t *job, uint16_t track_wckey)
+{
+	time_t curr_start = hour->start;
+	time_t curr_end = hour->end;
+	time_t row_start = job->row_start;
+	time_t row_end = job->row_end;
+	int seconds = 0;
+	int tot_time = 0;
+	local_cluster_usage_t *loc_c_usage = NULL;
+	local_cluster_usage_t *c_usage = hour->c_usage;
+	local_resv_usage_t *r_usage = NULL;
+	local_id_usage_t *a_usage = NULL;
+	local_id_usage_t *w_usage = NULL;
+	local_suspend_t *suspend = NULL;
+
+	if (row_start && (row_start < curr_start))
+		row_start = curr_start;
+
+	if (!row_start && row_end)
+		row_start = row_end;
+
+	if (!row_end || row_end > curr_end)
+		row_end = curr_end;
+
+	if (!row_start || ((row_end - row_start) < 1))
+		goto calc_cluster;
+
+	seconds = (row_end - row_start);
+
+	/* take off the time the job was suspended this hour, the
+	   chain also holds suspends of other jobs */
+	for (suspend = job->suspend; suspend; suspend = suspend->next) {
+		time_t local_start = suspend->start;
+		time_t local_end = suspend->end;
+
+		if (!local_start || (suspend->job_db_inx != job->db_inx))
+			continue;
+
+		if (row_start > local_start)
+			local_start = row_start;
+		if (row_end < local_end)
+			local_end = row_end;
+		tot_time = (local_end - local_start);
+		if (tot_time < 1)
+			continue;
+
+		seconds -= tot_time;
+	}
+	if (seconds < 1) {
+		debug4("This job (%u) was suspended "
+		       "the entire hour", job->job_id);
+		return;
+	}
+
+	a_usage = _get_id_usage(&hour->assoc_usage, job->assoc_id);
+	a_usage->a_cpu += seconds * job->row_acpu;
+
+	if (!track_wckey)
+		goto calc_cluster;
+
+	/* do the wckey calculation */
+	w_usage = _get_id_usage(&hour->wckey_usage, job->wckey_id);
+	w_usage->a_cpu += seconds * job->row_acpu;
+	/* do the cluster allocated calculation */
+calc_cluster:
+
+	/* Now figure out there was a disconnected
+	   slurmctld durning this job.
+	*/
+	list_iterator_reset(hour->c_itr);
+	while ((loc_c_usage = list_next(hour->c_itr))) {
+		int temp_end = row_end;
+		int temp_start = row_start;
+		if (loc_c_usage->start > temp_start)
+			temp_start = loc_c_usage->start;
+		if (loc_c_usage->end < temp_end)
+			temp_end = loc_c_usage->end;
+		seconds = (temp_end - temp_start);
+		if (seconds > 0)
+			loc_c_usage->total_time -= seconds * job->row_acpu;
+	}
+
+	/* first figure out the reservation */
+	if (job->resv_id) {
+		if (seconds <= 0)
+			return;
+		/* Since we have already added the
+		   entire reservation as used time on
+		   the cluster we only need to
+		   calculate the used time for the
+		   reservation and then divy up the
+		   unused time over the associations
+		   able to run in the reservation.
+		   Since the job was to run, or ran a
+		   reservation we don't care about
+		   eligible time since that could
+		   totally skew the clusters reserved time
+		   since the job may be able to run
+		   outside of the reservation. */
+		list_iterator_reset(hour->r_itr);
+		while ((r_usage = list_next(hour->r_itr))) {
+			/* since the reservation could
+			   have changed in some way,
+			   thus making a new
+			   reservation record in the
+			   database, we have to make
+			   sure all the reservations
+			   are checked to see if such
+			   a thing has happened */
+			if (r_usage->id == job->resv_id) {
+				int temp_end = row_end;
+				int temp_start = row_start;
+				if (r_usage->start > temp_start)
+					temp_start = r_usage->start;
+				if (r_usage->end < temp_end)
+					temp_end = r_usage->end;
+
+				if ((temp_end - temp_start) > 0) {
+					r_usage->a_cpu +=
+						(temp_end - temp_start)
+						* job->row_acpu;
+				}
+			}
+		}
+		return;
+	}
+
+	/* only record time for the clusters that have
+	   registered.  This continue should rarely if
+	   ever happen.
+	*/
+	if (!c_usage)
+		return;
+
+	if (row_start && (seconds > 0))
+		c_usage->a_cpu += seconds * job->row_acpu;
+
+	/* now reserved time */
+	if (!row_start || (row_start >= c_usage->start)) {
+		int temp_end = row_start;
+		int temp_start = job->row_eligible;
+		if (c_usage->start > temp_start)
+			temp_start = c_usage->start;
+		if (c_usage->end < temp_end)
+			temp_end = c_usage->end;
+		seconds = (temp_end - temp_start);
+		if (seconds > 0)
+			c_usage->r_cpu += seconds * job->row_rcpu;
+	}
+}
+
+/* Finish the usage of an hour and put it into the hour tables */
+static int _process_hour_usage(mysql_conn_t *mysql_conn, char *cluster_name,
+			       local_hour_usage_t *hour, time_t now,
+			       uint16_t track_wckey)
+{
+	int rc = SLURM_SUCCESS;
+	int seconds = 0;
+	char *query = NULL;
+	ListIterator itr = NULL;
+	local_cluster_usage_t *loc_c_usage = NULL;
+	local_resv_usage_t *r_usage = NULL;
+	local_id_usage_t *a_usage = NULL;
+	local_id_usage_t *w_usage = NULL;
+
+	/* now figure out how much more to add to the
+	   associations that could had run in the reservation
+	*/
+	list_iterator_reset(hour->r_itr);
+	while ((r_usage = list_next(hour->r_itr))) {
+		int64_t idle = r_usage->total_time - r_usage->a_cpu;
+		char *assoc = NULL;
+
+		if (idle <= 0)
+			continue;
+
+		/* now divide that time by the number of
+		   associations in the reservation and add
+		   them to each association */
+		seconds = idle / list_count(r_usage->local_assocs);
+		itr = list_iterator_create(r_usage->local_assocs);
+		while ((assoc = list_next(itr))) {
+			a_usage = _get_id_usage(&hour->assoc_usage,
+						slurm_atoul(assoc));
+			a_usage->a_cpu += seconds;
+		}
+		list_iterator_destroy(itr);
+	}
+
+	/* now apply the down time from the slurmctld disconnects */
+	list_iterator_reset(hour->c_itr);
+	while ((loc_c_usage = list_next(hour->c_itr)))
+		hour->c_usage->d_cpu += loc_c_usage->total_time;
+
+	if ((rc = _process_cluster_usage(
+		     mysql_conn, cluster_name, hour->start,
+		     hour->end, now, hour->c_usage)) != SLURM_SUCCESS)
+		return rc;
+
+	itr = list_iterator_create(hour->assoc_usage.list);
+	while ((a_usage = list_next(itr))) {
+		if (query) {
+			xstrfmtcat(query,
+				   ", (%ld, %ld, %d, %ld, %"PRIu64")",
+				   now, now,
+				   a_usage->id, hour->start,
+				   a_usage->a_cpu);
+		} else {
+			xstrfmtcat(query,
+				   "insert into \"%s_%s\" "
+				   "(creation_time, "
+				   "mod_time, id_assoc, time_start, "
+				   "alloc_cpu_secs) values "
+				   "(%ld, %ld, %d, %ld, %"PRIu64")",
+				   cluster_name, assoc_hour_table,
+				   now, now,
+				   a_usage->id, hour->start,
+				   a_usage->a_cpu);
+		}
+	}
+	list_iterator_destroy(itr);
+	if (query) {
+		xstrfmtcat(query,
+			   " on duplicate key update "
+			   "mod_time=%ld, "
+			   "alloc_cpu_secs=VALUES(alloc_cpu_secs);",
+			   now);
+
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, query);
+		rc = mysql_db_query(mysql_conn, query);
+		xfree(query);
+		if (rc != SLURM_SUCCESS) {
+			error("Couldn't add assoc hour rollup");
+			return rc;
+		}
+	}
+
+	if (!track_wckey)
+		return rc;
+
+	itr = list_iterator_create(hour->wckey_usage.list);
+	while ((w_usage = list_next(itr))) {
+		if (query) {
+			xstrfmtcat(query,
+				   ", (%ld, %ld, %d, %ld, %"PRIu64")",
+				   now, now,
+				   w_usage->id, hour->start,
+				   w_usage->a_cpu);
+		} else {
+			xstrfmtcat(query,
+				   "insert into \"%s_%s\" "
+				   "(creation_time, "
+				   "mod_time, id_wckey, time_start, "
+				   "alloc_cpu_secs) values "
+				   "(%ld, %ld, %d, %ld, %"PRIu64")",
+				   cluster_name, wckey_hour_table,
+				   now, now,
+				   w_usage->id, hour->start,
+				   w_usage->a_cpu);
+		}
+	}
+	list_iterator_destroy(itr);
+	if (query) {
+		xstrfmtcat(query,
+			   " on duplicate key update "
+			   "mod_time=%ld, "
+			   "alloc_cpu_secs=VALUES(alloc_cpu_secs);",
+			   now);
+
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, query);
+		rc = mysql_db_query(mysql_conn, query);
+		xfree(query);
+		if (rc != SLURM_SUCCESS)
+			error("Couldn't add wckey hour rollup");
+	}
+
+	return rc;
+}
+
+/* Each window of up to ROLLUP_WINDOW_HOURS hours is rolled up from one
+ * read of the event, reservation, suspend and job tables.  Every job is
+ * read once per window and added to each hour it spans.
+ */
 extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 				  char *cluster_name,
 				  time_t start, time_t end,
@@ -453,23 +843,19 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 {
 	int rc = SLURM_SUCCESS;
 	int add_sec = 3600;
-	int i=0;
+	int i=0, h, hour_cnt = 0;
 	time_t now = time(NULL);
 	time_t curr_start = start;
 	time_t curr_end = curr_start + add_sec;
+	time_t win_start, win_end;
 	char *query = NULL;
 	MYSQL_RES *result = NULL;
 	MYSQL_ROW row;
-	ListIterator a_itr = NULL;
-	ListIterator c_itr = NULL;
-	ListIterator w_itr = NULL;
-	ListIterator r_itr = NULL;
-	List assoc_usage_list = list_create(_destroy_local_id_usage);
-	List cluster_down_list = list_create(_destroy_local_cluster_usage);
-	List wckey_usage_list = list_create(_destroy_local_id_usage);
-	List resv_usage_list = list_create(_destroy_local_resv_usage);
+	local_hour_usage_t *hours = NULL, *hour = NULL;
+	local_suspend_t **suspend_hash = NULL;
+	local_suspend_t *suspend = NULL;
+	local_job_usage_t job;
 	uint16_t track_wckey = slurm_get_track_wckey();
-	/* char start_char[20], end_char[20]; */
 
 	char *job_req_inx[] = {
 		"job_db_inx",
@@ -502,11 +888,13 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 	};
 
 	char *suspend_req_inx[] = {
+		"job_db_inx",
 		"time_start",
 		"time_end"
 	};
 	char *suspend_str = NULL;
 	enum {
+		SUSPEND_REQ_DB_INX,
 		SUSPEND_REQ_START,
 		SUSPEND_REQ_END,
 		SUSPEND_REQ_COUNT
@@ -549,45 +937,50 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		xstrfmtcat(resv_str, ", %s", resv_req_inx[i]);
 	}
 
-/* 	info("begin start %s", ctime(&curr_start)); */
-/* 	info("begin end %s", ctime(&curr_end)); */
-	a_itr = list_iterator_create(assoc_usage_list);
-	c_itr = list_iterator_create(cluster_down_list);
-	w_itr = list_iterator_create(wckey_usage_list);
-	r_itr = list_iterator_create(resv_usage_list);
+	hours = xmalloc(sizeof(local_hour_usage_t) * ROLLUP_WINDOW_HOURS);
+	suspend_hash = xmalloc(sizeof(local_suspend_t *) * SUSPEND_HASH_SIZE);
 	while (curr_start < end) {
-		int last_id = -1;
-		int last_wckeyid = -1;
-		int seconds = 0;
-		int tot_time = 0;
-		local_cluster_usage_t *loc_c_usage = NULL;
-		local_cluster_usage_t *c_usage = NULL;
-		local_resv_usage_t *r_usage = NULL;
-		local_id_usage_t *a_usage = NULL;
-		local_id_usage_t *w_usage = NULL;
-
-		debug3("%s curr hour is now %ld-%ld",
-		       cluster_name, curr_start, curr_end);
-/* 		info("start %s", ctime(&curr_start)); */
-/* 		info("end %s", ctime(&curr_end)); */
+		win_start = curr_start;
+		for (hour_cnt = 0;
+		     (hour_cnt < ROLLUP_WINDOW_HOURS) && (curr_start < end);
+		     hour_cnt++) {
+			_init_hour_usage(&hours[hour_cnt],
+					 curr_start, curr_end);
+			curr_start = curr_end;
+			curr_end = curr_start + add_sec;
+		}
+		win_end = curr_start;
 
-		c_usage = _setup_cluster_usage(mysql_conn, cluster_name,
-					       curr_start, curr_end,
-					       cluster_down_list);
+		debug3("%s curr hours are now %ld-%ld",
+		       cluster_name, win_start, win_end);
+
+		if (!(result = _get_cluster_events(mysql_conn, cluster_name,
+						   win_start, win_end))) {
+			rc = SLURM_ERROR;
+			goto end_it;
+		}
+		for (h = 0; h < hour_cnt; h++) {
+			hour = &hours[h];
+			hour->c_usage = _setup_cluster_usage(
+				result, hour->start, hour->end,
+				hour->cluster_down_list);
+		}
+		mysql_free_result(result);
 
 		// now get the reservations during this time
 		query = xstrdup_printf("select %s from \"%s_%s\" where "
 				       "(time_start < %ld && time_end >= %ld) "
 				       "order by time_start",
 				       resv_str, cluster_name, resv_table,
-				       curr_end, curr_start);
+				       win_end, win_start);
 
 		debug3("%d(%s:%d) query\n%s",
 		       mysql_conn->conn, THIS_FILE, __LINE__, query);
 		if (!(result = mysql_db_query_ret(
 			     mysql_conn, query, 0))) {
 			xfree(query);
-			return SLURM_ERROR;
+			rc = SLURM_ERROR;
+			goto end_it;
 		}
 		xfree(query);
 
@@ -610,64 +1003,100 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		   option which will allow jobs to continue to run in the
 		   reservation that aren't suppose to.
 		*/
-		while ((row = mysql_fetch_row(result))) {
-			time_t row_start = slurm_atoul(row[RESV_REQ_START]);
-			time_t row_end = slurm_atoul(row[RESV_REQ_END]);
-			uint32_t row_cpu = slurm_atoul(row[RESV_REQ_CPU]);
-			uint32_t row_flags = slurm_atoul(row[RESV_REQ_FLAGS]);
+		for (h = 0; h < hour_cnt; h++) {
+			local_resv_usage_t *r_usage = NULL;
+
+			hour = &hours[h];
+			mysql_data_seek(result, 0);
+			while ((row = mysql_fetch_row(result))) {
+				time_t row_start =
+					slurm_atoul(row[RESV_REQ_START]);
+				time_t row_end =
+					slurm_atoul(row[RESV_REQ_END]);
+				uint32_t row_cpu =
+					slurm_atoul(row[RESV_REQ_CPU]);
+				uint32_t row_flags =
+					slurm_atoul(row[RESV_REQ_FLAGS]);
+
+				if ((row_start >= hour->end)
+				    || (row_end < hour->start))
+					continue;
 
-			if (row_start < curr_start)
-				row_start = curr_start;
+				if (row_start < hour->start)
+					row_start = hour->start;
 
-			if (!row_end || row_end > curr_end)
-				row_end = curr_end;
+				if (!row_end || row_end > hour->end)
+					row_end = hour->end;
 
-			/* Don't worry about it if the time is less
-			 * than 1 second.
-			 */
-			if ((row_end - row_start) < 1)
-				continue;
-
-			r_usage = xmalloc(sizeof(local_resv_usage_t));
-			r_usage->id = slurm_atoul(row[RESV_REQ_ID]);
-
-			r_usage->local_assocs = list_create(slurm_destroy_char);
-			slurm_addto_char_list(r_usage->local_assocs,
-					      row[RESV_REQ_ASSOCS]);
-
-			r_usage->total_time = (row_end - row_start) * row_cpu;
-			r_usage->start = row_start;
-			r_usage->end = row_end;
-			list_append(resv_usage_list, r_usage);
-
-			/* Since this reservation was added to the
-			   cluster and only certain people could run
-			   there we will use this as allocated time on
-			   the system.  If the reservation was a
-			   maintenance then we add the time to planned
-			   down time.
-			*/
-
-
-			/* only record time for the clusters that have
-			   registered.  This continue should rarely if
-			   ever happen.
-			*/
-			if (!c_usage)
-				continue;
-			else if (row_flags & RESERVE_FLAG_MAINT)
-				c_usage->pd_cpu += r_usage->total_time;
-			else
-				c_usage->a_cpu += r_usage->total_time;
-			/* slurm_make_time_str(&r_usage->start, start_char, */
-			/* 		    sizeof(start_char)); */
-			/* slurm_make_time_str(&r_usage->end, end_char, */
-			/* 		    sizeof(end_char)); */
-			/* info("adding this much %lld to cluster %s " */
-			/*      "%d %d %s - %s", */
-			/*      r_usage->total_time, c_usage->name, */
-			/*      (row_flags & RESERVE_FLAG_MAINT),  */
-			/*      r_usage->id, start_char, end_char); */
+				/* Don't worry about it if the time is less
+				 * than 1 second.
+				 */
+				if ((row_end - row_start) < 1)
+					continue;
+
+				r_usage = xmalloc(sizeof(local_resv_usage_t));
+				r_usage->id = slurm_atoul(row[RESV_REQ_ID]);
+
+				r_usage->local_assocs =
+					list_create(slurm_destroy_char);
+				slurm_addto_char_list(r_usage->local_assocs,
+						      row[RESV_REQ_ASSOCS]);
+
+				r_usage->total_time =
+					(row_end - row_start) * row_cpu;
+				r_usage->start = row_start;
+				r_usage->end = row_end;
+				list_append(hour->resv_usage_list, r_usage);
+
+				/* Since this reservation was added to the
+				   cluster and only certain people could run
+				   there we will use this as allocated time on
+				   the system.  If the reservation was a
+				   maintenance then we add the time to planned
+				   down time.
+				*/
+
+				/* only record time for the clusters that have
+				   registered.  This continue should rarely if
+				   ever happen.
+				*/
+				if (!hour->c_usage)
+					continue;
+				else if (row_flags & RESERVE_FLAG_MAINT)
+					hour->c_usage->pd_cpu +=
+						r_usage->total_time;
+				else
+					hour->c_usage->a_cpu +=
+						r_usage->total_time;
+			}
+		}
+		mysql_free_result(result);
+
+		/* get the suspended time of the jobs, indexed by job */
+		query = xstrdup_printf("select %s from \"%s_%s\" where "
+				       "(time_start < %ld && (time_end >= %ld "
+				       "|| time_end = 0))",
+				       suspend_str, cluster_name,
+				       suspend_table, win_end, win_start);
+
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, query);
+		if (!(result = mysql_db_query_ret(
+			     mysql_conn, query, 0))) {
+			xfree(query);
+			rc = SLURM_ERROR;
+			goto end_it;
+		}
+		xfree(query);
+		while ((row = mysql_fetch_row(result))) {
+			suspend = xmalloc(sizeof(local_suspend_t));
+			suspend->job_db_inx =
+				slurm_atoul(row[SUSPEND_REQ_DB_INX]);
+			suspend->start = slurm_atoul(row[SUSPEND_REQ_START]);
+			suspend->end = slurm_atoul(row[SUSPEND_REQ_END]);
+			i = suspend->job_db_inx % SUSPEND_HASH_SIZE;
+			suspend->next = suspend_hash[i];
+			suspend_hash[i] = suspend;
 		}
 		mysql_free_result(result);
 
@@ -677,413 +1106,80 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 				       "(time_end >= %ld || time_end = 0)) "
 				       "order by id_assoc, time_eligible",
 				       job_str, cluster_name, job_table,
-				       curr_end, curr_start);
+				       win_end, win_start);
 
 		debug3("%d(%s:%d) query\n%s",
 		       mysql_conn->conn, THIS_FILE, __LINE__, query);
 		if (!(result = mysql_db_query_ret(
 			     mysql_conn, query, 0))) {
 			xfree(query);
-			return SLURM_ERROR;
+			rc = SLURM_ERROR;
+			goto end_it;
 		}
 		xfree(query);
 
 		while ((row = mysql_fetch_row(result))) {
-			uint32_t job_id = slurm_atoul(row[JOB_REQ_JOBID]);
-			uint32_t assoc_id = slurm_atoul(row[JOB_REQ_ASSOCID]);
-			uint32_t wckey_id = slurm_atoul(row[JOB_REQ_WCKEYID]);
-			uint32_t resv_id = slurm_atoul(row[JOB_REQ_RESVID]);
-			time_t row_eligible = slurm_atoul(row[JOB_REQ_ELG]);
-			time_t row_start = slurm_atoul(row[JOB_REQ_START]);
-			time_t row_end = slurm_atoul(row[JOB_REQ_END]);
-			uint32_t row_acpu = slurm_atoul(row[JOB_REQ_ACPU]);
-			uint32_t row_rcpu = slurm_atoul(row[JOB_REQ_RCPU]);
-			seconds = 0;
-
-			if (row_start && (row_start < curr_start))
-				row_start = curr_start;
-
-			if (!row_start && row_end)
-				row_start = row_end;
-
-			if (!row_end || row_end > curr_end)
-				row_end = curr_end;
-
-			if (!row_start || ((row_end - row_start) < 1))
-				goto calc_cluster;
-
-			seconds = (row_end - row_start);
-
-			if (row[JOB_REQ_SUSPENDED]) {
-				MYSQL_RES *result2 = NULL;
-				MYSQL_ROW row2;
-				/* get the suspended time for this job */
-				query = xstrdup_printf(
-					"select %s from \"%s_%s\" where "
-					"(time_start < %ld && (time_end >= %ld "
-					"|| time_end = 0)) && job_db_inx=%s "
-					"order by time_start",
-					suspend_str, cluster_name,
-					suspend_table,
-					curr_end, curr_start,
-					row[JOB_REQ_DB_INX]);
-
-				debug4("%d(%s:%d) query\n%s",
-				       mysql_conn->conn, THIS_FILE,
-				       __LINE__, query);
-				if (!(result2 = mysql_db_query_ret(
-					     mysql_conn,
-					     query, 0))) {
-					xfree(query);
-					return SLURM_ERROR;
-				}
-				xfree(query);
-				while ((row2 = mysql_fetch_row(result2))) {
-					time_t local_start = slurm_atoul(
-						row2[SUSPEND_REQ_START]);
-					time_t local_end = slurm_atoul(
-						row2[SUSPEND_REQ_END]);
-
-					if (!local_start)
-						continue;
-
-					if (row_start > local_start)
-						local_start = row_start;
-					if (row_end < local_end)
-						local_end = row_end;
-					tot_time = (local_end - local_start);
-					if (tot_time < 1)
-						continue;
-
-					seconds -= tot_time;
-				}
-				mysql_free_result(result2);
-			}
-			if (seconds < 1) {
-				debug4("This job (%u) was suspended "
-				       "the entire hour", job_id);
-				continue;
-			}
-
-			if (last_id != assoc_id) {
-				a_usage = xmalloc(sizeof(local_id_usage_t));
-				a_usage->id = assoc_id;
-				list_append(assoc_usage_list, a_usage);
-				last_id = assoc_id;
-			}
-
-			a_usage->a_cpu += seconds * row_acpu;
-
-			if (!track_wckey)
-				goto calc_cluster;
-
-			/* do the wckey calculation */
-			if (last_wckeyid != wckey_id) {
-				list_iterator_reset(w_itr);
-				while ((w_usage = list_next(w_itr)))
-					if (w_usage->id == wckey_id)
-						break;
-
-				if (!w_usage) {
-					w_usage = xmalloc(
-						sizeof(local_id_usage_t));
-					w_usage->id = wckey_id;
-					list_append(wckey_usage_list,
-						    w_usage);
-				}
-
-				last_wckeyid = wckey_id;
-			}
-			w_usage->a_cpu += seconds * row_acpu;
-			/* do the cluster allocated calculation */
-		calc_cluster:
-
-			/* Now figure out there was a disconnected
-			   slurmctld durning this job.
-			*/
-			list_iterator_reset(c_itr);
-			while ((loc_c_usage = list_next(c_itr))) {
-				int temp_end = row_end;
-				int temp_start = row_start;
-				if (loc_c_usage->start > temp_start)
-					temp_start = loc_c_usage->start;
-				if (loc_c_usage->end < temp_end)
-					temp_end = loc_c_usage->end;
-				seconds = (temp_end - temp_start);
-				if (seconds > 0) {
-					/* info(" Job %u was running for " */
-					/*      "%"PRIu64" seconds while " */
-					/*      "cluster %s's slurmctld " */
-					/*      "wasn't responding", */
-					/*      job_id, */
-					/*      (uint64_t) */
-					/*      (seconds * row_acpu), */
-					/*      cluster_name); */
-					loc_c_usage->total_time -=
-						seconds * row_acpu;
-				}
-			}
-
-			/* first figure out the reservation */
-			if (resv_id) {
-				if (seconds <= 0)
+			memset(&job, 0, sizeof(local_job_usage_t));
+			job.job_id = slurm_atoul(row[JOB_REQ_JOBID]);
+			job.assoc_id = slurm_atoul(row[JOB_REQ_ASSOCID]);
+			job.wckey_id = slurm_atoul(row[JOB_REQ_WCKEYID]);
+			job.resv_id = slurm_atoul(row[JOB_REQ_RESVID]);
+			job.row_eligible = slurm_atoul(row[JOB_REQ_ELG]);
+			job.row_start = slurm_atoul(row[JOB_REQ_START]);
+			job.row_end = slurm_atoul(row[JOB_REQ_END]);
+			job.row_acpu = slurm_atoul(row[JOB_REQ_ACPU]);
+			job.row_rcpu = slurm_atoul(row[JOB_REQ_RCPU]);
+
+			job.db_inx = slurm_atoul(row[JOB_REQ_DB_INX]);
+			if (row[JOB_REQ_SUSPENDED])
+				job.suspend = suspend_hash[job.db_inx %
+							   SUSPEND_HASH_SIZE];
+
+			for (h = 0; h < hour_cnt; h++) {
+				hour = &hours[h];
+				if ((job.row_eligible >= hour->end)
+				    || (job.row_end
+					&& (job.row_end < hour->start)))
 					continue;
-				/* Since we have already added the
-				   entire reservation as used time on
-				   the cluster we only need to
-				   calculate the used time for the
-				   reservation and then divy up the
-				   unused time over the associations
-				   able to run in the reservation.
-				   Since the job was to run, or ran a
-				   reservation we don't care about
-				   eligible time since that could
-				   totally skew the clusters reserved time
-				   since the job may be able to run
-				   outside of the reservation. */
-				list_iterator_reset(r_itr);
-				while ((r_usage = list_next(r_itr))) {
-					/* since the reservation could
-					   have changed in some way,
-					   thus making a new
-					   reservation record in the
-					   database, we have to make
-					   sure all the reservations
-					   are checked to see if such
-					   a thing has happened */
-					if (r_usage->id == resv_id) {
-						int temp_end = row_end;
-						int temp_start = row_start;
-						if (r_usage->start > temp_start)
-							temp_start =
-								r_usage->start;
-						if (r_usage->end < temp_end)
-							temp_end = r_usage->end;
-
-						if ((temp_end - temp_start)
-						   > 0) {
-							r_usage->a_cpu +=
-								(temp_end
-								 - temp_start)
-								* row_acpu;
-						}
-					}
-				}
-				continue;
-			}
-
-			/* only record time for the clusters that have
-			   registered.  This continue should rarely if
-			   ever happen.
-			*/
-			if (!c_usage)
-				continue;
-
-			if (row_start && (seconds > 0)) {
-				/* info("%d assoc %d adds " */
-				/*      "(%d)(%d-%d) * %d = %d " */
-				/*      "to %d", */
-				/*      job_id, */
-				/*      a_usage->id, */
-				/*      seconds, */
-				/*      row_end, row_start, */
-				/*      row_acpu, */
-				/*      seconds * row_acpu, */
-				/*      row_acpu); */
-
-				c_usage->a_cpu += seconds * row_acpu;
-			}
-
-			/* now reserved time */
-			if (!row_start || (row_start >= c_usage->start)) {
-				int temp_end = row_start;
-				int temp_start = row_eligible;
-				if (c_usage->start > temp_start)
-					temp_start = c_usage->start;
-				if (c_usage->end < temp_end)
-					temp_end = c_usage->end;
-				seconds = (temp_end - temp_start);
-				if (seconds > 0) {
-					/* info("%d assoc %d reserved " */
-					/*      "(%d)(%d-%d) * %d = %d " */
-					/*      "to %d", */
-					/*      job_id, */
-					/*      assoc_id, */
-					/*      seconds, */
-					/*      temp_end, temp_start, */
-					/*      row_rcpu, */
-					/*      seconds * row_rcpu, */
-					/*      row_rcpu); */
-					c_usage->r_cpu += seconds * row_rcpu;
-				}
+				_add_job_hour_usage(hour, &job, track_wckey);
 			}
 		}
 		mysql_free_result(result);
 
-		/* now figure out how much more to add to the
-		   associations that could had run in the reservation
-		*/
-		list_iterator_reset(r_itr);
-		while ((r_usage = list_next(r_itr))) {
-			int64_t idle = r_usage->total_time - r_usage->a_cpu;
-			char *assoc = NULL;
-			ListIterator tmp_itr = NULL;
-
-			if (idle <= 0)
-				continue;
-
-			/* now divide that time by the number of
-			   associations in the reservation and add
-			   them to each association */
-			seconds = idle / list_count(r_usage->local_assocs);
-/* 			info("resv %d got %d for seconds for %d assocs", */
-/* 			     r_usage->id, seconds, */
-/* 			     list_count(r_usage->local_assocs)); */
-			tmp_itr = list_iterator_create(r_usage->local_assocs);
-			while ((assoc = list_next(tmp_itr))) {
-				uint32_t associd = slurm_atoul(assoc);
-				if (last_id != associd) {
-					list_iterator_reset(a_itr);
-					while ((a_usage = list_next(a_itr))) {
-						if (!a_usage->id == associd) {
-							last_id = a_usage->id;
-							break;
-						}
-					}
-				}
-
-				if (!a_usage) {
-					a_usage = xmalloc(
-						sizeof(local_id_usage_t));
-					a_usage->id = associd;
-					list_append(assoc_usage_list, a_usage);
-					last_id = associd;
-				}
-
-				a_usage->a_cpu += seconds;
-			}
-			list_iterator_destroy(tmp_itr);
-		}
-
-		/* now apply the down time from the slurmctld disconnects */
-		list_iterator_reset(c_itr);
-		while ((loc_c_usage = list_next(c_itr)))
-			c_usage->d_cpu += loc_c_usage->total_time;
-
-		if ((rc = _process_cluster_usage(
-			     mysql_conn, cluster_name, curr_start,
-			     curr_end, now, c_usage)) != SLURM_SUCCESS)
-			goto end_it;
-
-		list_iterator_reset(a_itr);
-		while ((a_usage = list_next(a_itr))) {
-/* 			info("association (%d) %d alloc %d", */
-/* 			     a_usage->id, last_id, */
-/* 			     a_usage->a_cpu); */
-			if (query) {
-				xstrfmtcat(query,
-					   ", (%ld, %ld, %d, %ld, %"PRIu64")",
-					   now, now,
-					   a_usage->id, curr_start,
-					   a_usage->a_cpu);
-			} else {
-				xstrfmtcat(query,
-					   "insert into \"%s_%s\" "
-					   "(creation_time, "
-					   "mod_time, id_assoc, time_start, "
-					   "alloc_cpu_secs) values "
-					   "(%ld, %ld, %d, %ld, %"PRIu64")",
-					   cluster_name, assoc_hour_table,
-					   now, now,
-					   a_usage->id, curr_start,
-					   a_usage->a_cpu);
-			}
-		}
-		if (query) {
-			xstrfmtcat(query,
-				   " on duplicate key update "
-				   "mod_time=%ld, "
-				   "alloc_cpu_secs=VALUES(alloc_cpu_secs);",
-				   now);
-
-			debug3("%d(%s:%d) query\n%s",
-			       mysql_conn->conn, THIS_FILE, __LINE__, query);
-			rc = mysql_db_query(mysql_conn, query);
-			xfree(query);
-			if (rc != SLURM_SUCCESS) {
-				error("Couldn't add assoc hour rollup");
+		for (h = 0; h < hour_cnt; h++) {
+			debug3("%s curr hour is now %ld-%ld", cluster_name,
+			       hours[h].start, hours[h].end);
+			if ((rc = _process_hour_usage(
+				     mysql_conn, cluster_name, &hours[h],
+				     now, track_wckey)) != SLURM_SUCCESS)
 				goto end_it;
-			}
 		}
 
-		if (!track_wckey)
-			goto end_loop;
-
-		list_iterator_reset(w_itr);
-		while ((w_usage = list_next(w_itr))) {
-/* 			info("association (%d) %d alloc %d", */
-/* 			     w_usage->id, last_id, */
-/* 			     w_usage->a_cpu); */
-			if (query) {
-				xstrfmtcat(query,
-					   ", (%ld, %ld, %d, %ld, %"PRIu64")",
-					   now, now,
-					   w_usage->id, curr_start,
-					   w_usage->a_cpu);
-			} else {
-				xstrfmtcat(query,
-					   "insert into \"%s_%s\" "
-					   "(creation_time, "
-					   "mod_time, id_wckey, time_start, "
-					   "alloc_cpu_secs) values "
-					   "(%ld, %ld, %d, %ld, %"PRIu64")",
-					   cluster_name, wckey_hour_table,
-					   now, now,
-					   w_usage->id, curr_start,
-					   w_usage->a_cpu);
-			}
-		}
-		if (query) {
-			xstrfmtcat(query,
-				   " on duplicate key update "
-				   "mod_time=%ld, "
-				   "alloc_cpu_secs=VALUES(alloc_cpu_secs);",
-				   now);
-
-			debug3("%d(%s:%d) query\n%s",
-			       mysql_conn->conn, THIS_FILE, __LINE__, query);
-			rc = mysql_db_query(mysql_conn, query);
-			xfree(query);
-			if (rc != SLURM_SUCCESS) {
-				error("Couldn't add wckey hour rollup");
-				goto end_it;
+		for (h = 0; h < hour_cnt; h++)
+			_fini_hour_usage(&hours[h]);
+		hour_cnt = 0;
+		for (i = 0; i < SUSPEND_HASH_SIZE; i++) {
+			while ((suspend = suspend_hash[i])) {
+				suspend_hash[i] = suspend->next;
+				xfree(suspend);
 			}
 		}
-
-	end_loop:
-		list_flush(assoc_usage_list);
-		list_flush(cluster_down_list);
-		list_flush(wckey_usage_list);
-		list_flush(resv_usage_list);
-		curr_start = curr_end;
-		curr_end = curr_start + add_sec;
 	}
 end_it:
 	xfree(suspend_str);
 	xfree(job_str);
 	xfree(resv_str);
-	list_iterator_destroy(a_itr);
-	list_iterator_destroy(c_itr);
-	list_iterator_destroy(w_itr);
-	list_iterator_destroy(r_itr);
-
-	list_destroy(assoc_usage_list);
-	list_destroy(cluster_down_list);
-	list_destroy(wckey_usage_list);
-	list_destroy(resv_usage_list);
 
-/* 	info("stop start %s", ctime(&curr_start)); */
-/* 	info("stop end %s", ctime(&curr_end)); */
+	for (h = 0; h < hour_cnt; h++)
+		_fini_hour_usage(&hours[h]);
+	xfree(hours);
+	for (i = 0; i < SUSPEND_HASH_SIZE; i++) {
+		while ((suspend = suspend_hash[i])) {
+			suspend_hash[i] = suspend->next;
+			xfree(suspend);
+		}
+	}
+	xfree(suspend_hash);
 
 	/* go check to see if we archive and purge */
 
@@ -1093,6 +1189,7 @@ end_it:
 
 	return rc;
 }
+
 extern int as_mysql_daily_rollup(mysql_conn_t *mysql_conn,
 				 char *cluster_name,
 				 time_t start, time_t end,
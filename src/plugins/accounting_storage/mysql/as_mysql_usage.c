@@ -39,12 +39,16 @@
 
 #include "as_mysql_usage.h"
 #include "as_mysql_rollup.h"
+#include "as_mysql_usage_cache.h"
 
 time_t global_last_rollup = 0;
 pthread_mutex_t rollup_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static pthread_mutex_t usage_rollup_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* Clusters rolled up at the same time, each using its own connection */
+#define MAX_ROLLUP_THREADS 4
+
 typedef struct {
 	uint16_t archive_data;
 	char *cluster_name;
@@ -57,6 +61,32 @@ typedef struct {
 	time_t sent_start;
 } local_rollup_t;
 
+/* Usage cached from the periods just rolled is stale now */
+static void _invalidate_usage_cache(char *cluster_name,
+				    time_t hour_start, time_t hour_end,
+				    time_t day_start, time_t day_end,
+				    time_t month_start, time_t month_end)
+{
+	if ((hour_end - hour_start) > 0) {
+		as_mysql_usage_cache_invalidate(cluster_name,
+						assoc_hour_table, hour_start);
+		as_mysql_usage_cache_invalidate(cluster_name,
+						wckey_hour_table, hour_start);
+	}
+	if ((day_end - day_start) > 0) {
+		as_mysql_usage_cache_invalidate(cluster_name,
+						assoc_day_table, day_start);
+		as_mysql_usage_cache_invalidate(cluster_name,
+						wckey_day_table, day_start);
+	}
+	if ((month_end - month_start) > 0) {
+		as_mysql_usage_cache_invalidate(cluster_name,
+						assoc_month_table, month_start);
+		as_mysql_usage_cache_invalidate(cluster_name,
+						wckey_month_table, month_start);
+	}
+}
+
 static void *_cluster_rollup_usage(void *arg)
 {
 	local_rollup_t *local_rollup = (local_rollup_t *)arg;
@@ -72,12 +102,12 @@ static void *_cluster_rollup_usage(void *arg)
 	time_t last_hour = local_rollup->sent_start;
 	time_t last_day = local_rollup->sent_start;
 	time_t last_month = local_rollup->sent_start;
-	time_t hour_start;
-	time_t hour_end;
-	time_t day_start;
-	time_t day_end;
-	time_t month_start;
-	time_t month_end;
+	time_t hour_start = 0;
+	time_t hour_end = 0;
+	time_t day_start = 0;
+	time_t day_end = 0;
+	time_t month_start = 0;
+	time_t month_end = 0;
 	DEF_TIMERS;
 
 	char *update_req_inx[] = {
@@ -383,7 +413,11 @@ end_it:
 			error("Couldn't commit rollup of cluster %s",
 			      local_rollup->cluster_name);
 			rc = SLURM_ERROR;
-		}
+		} else
+			_invalidate_usage_cache(local_rollup->cluster_name,
+						hour_start, hour_end,
+						day_start, day_end,
+						month_start, month_end);
 	} else {
 		error("Cluster %s rollup failed", local_rollup->cluster_name);
 		if (mysql_db_rollback(&mysql_conn))
@@ -399,6 +433,7 @@ end_it:
 		(*local_rollup->rc) = rc;
 	pthread_cond_signal(local_rollup->rolledup_cond);
 	slurm_mutex_unlock(local_rollup->rolledup_lock);
+	xfree(local_rollup->cluster_name);
 	xfree(local_rollup);
 
 	return NULL;
@@ -496,32 +531,71 @@ static int _get_cluster_usage(mysql_conn_t *mysql_conn, uid_t uid,
 
 
 
-/* checks should already be done before this to see if this is a valid
-   user or not.
-*/
-extern int get_usage_for_list(mysql_conn_t *mysql_conn,
-			      slurmdbd_msg_type_t type, List object_list,
-			      char *cluster_name, time_t start, time_t end)
+typedef struct {
+	List acct_list;
+	time_t end;	/* window missing from the usage cache */
+	uint32_t id;
+	bool raw;	/* cache changed, read it uncached */
+	time_t start;
+} usage_miss_t;
+
+static int _sort_usage_miss(const void *a, const void *b)
+{
+	const usage_miss_t *miss_a = a;
+	const usage_miss_t *miss_b = b;
+
+	if (miss_a->start != miss_b->start)
+		return (miss_a->start < miss_b->start) ? -1 : 1;
+	if (miss_a->end != miss_b->end)
+		return (miss_a->end < miss_b->end) ? -1 : 1;
+	if (miss_a->id != miss_b->id)
+		return (miss_a->id < miss_b->id) ? -1 : 1;
+	return 0;
+}
+
+/* raw misses first, in id order */
+static int _sort_usage_raw(const void *a, const void *b)
+{
+	const usage_miss_t *miss_a = a;
+	const usage_miss_t *miss_b = b;
+
+	if (miss_a->raw != miss_b->raw)
+		return miss_a->raw ? -1 : 1;
+	if (miss_a->id != miss_b->id)
+		return (miss_a->id < miss_b->id) ? -1 : 1;
+	return 0;
+}
+
+/* Read the usage of the ids given in [start, end) from my_usage_table,
+ * returns a list of slurmdb_accounting_rec_t's in id and time order,
+ * one per id and period. */
+static List _read_usage(mysql_conn_t *mysql_conn, slurmdbd_msg_type_t type,
+			char *cluster_name, char *my_usage_table,
+			uint32_t *ids, int id_cnt, time_t start, time_t end)
 {
-	int rc = SLURM_SUCCESS;
 	int i=0;
 	MYSQL_RES *result = NULL;
 	MYSQL_ROW row;
 	char *tmp = NULL;
-	char *my_usage_table = NULL;
 	char *query = NULL;
-	List usage_list = NULL;
 	char *id_str = NULL;
-	ListIterator itr = NULL, u_itr = NULL;
-	void *object = NULL;
-	slurmdb_association_rec_t *assoc = NULL;
-	slurmdb_wckey_rec_t *wckey = NULL;
-	slurmdb_accounting_rec_t *accounting_rec = NULL;
+	List usage_list = NULL;
 
 	/* Since for id in association table we
 	   use t3 and in wckey table we use t1 we can't define it here */
 	char **usage_req_inx = NULL;
 
+	char *assoc_usage[] = {
+		"t3.id_assoc",
+		"t1.time_start",
+		"sum(t1.alloc_cpu_secs)"
+	};
+	char *wckey_usage[] = {
+		"id_wckey",
+		"time_start",
+		"alloc_cpu_secs"
+	};
+
 	enum {
 		USAGE_ID,
 		USAGE_START,
@@ -529,105 +603,57 @@ extern int get_usage_for_list(mysql_conn_t *mysql_conn,
 		USAGE_COUNT
 	};
 
-
-	if (!object_list) {
-		error("We need an object to set data for getting usage");
-		return SLURM_ERROR;
-	}
-
-	if (check_connection(mysql_conn) != SLURM_SUCCESS)
-		return ESLURM_DB_CONNECTION;
-
 	switch (type) {
 	case DBD_GET_ASSOC_USAGE:
-	{
-		char *temp_usage[] = {
-			"t3.id_assoc",
-			"t1.time_start",
-			"t1.alloc_cpu_secs"
-		};
-		usage_req_inx = temp_usage;
-
-		itr = list_iterator_create(object_list);
-		while ((assoc = list_next(itr))) {
+		usage_req_inx = assoc_usage;
+		for (i=0; i<id_cnt; i++) {
 			if (id_str)
-				xstrfmtcat(id_str, " || t3.id_assoc=%d",
-					   assoc->id);
+				xstrfmtcat(id_str, " || t3.id_assoc=%u",
+					   ids[i]);
 			else
-				xstrfmtcat(id_str, "t3.id_assoc=%d", assoc->id);
+				xstrfmtcat(id_str, "t3.id_assoc=%u", ids[i]);
 		}
-		list_iterator_destroy(itr);
-
-		my_usage_table = assoc_day_table;
 		break;
-	}
 	case DBD_GET_WCKEY_USAGE:
-	{
-		char *temp_usage[] = {
-			"id_wckey",
-			"time_start",
-			"alloc_cpu_secs"
-		};
-		usage_req_inx = temp_usage;
-
-		itr = list_iterator_create(object_list);
-		while ((wckey = list_next(itr))) {
+		usage_req_inx = wckey_usage;
+		for (i=0; i<id_cnt; i++) {
 			if (id_str)
-				xstrfmtcat(id_str, " || id_wckey=%d",
-					   wckey->id);
+				xstrfmtcat(id_str, " || id_wckey=%u", ids[i]);
 			else
-				xstrfmtcat(id_str, "id_wckey=%d", wckey->id);
+				xstrfmtcat(id_str, "id_wckey=%u", ids[i]);
 		}
-		list_iterator_destroy(itr);
-
-		my_usage_table = wckey_day_table;
 		break;
-	}
 	default:
 		error("Unknown usage type %d", type);
-		return SLURM_ERROR;
+		return NULL;
 		break;
 	}
 
-	if (set_usage_information(&my_usage_table, type, &start, &end)
-	    != SLURM_SUCCESS) {
-		xfree(id_str);
-		return SLURM_ERROR;
-	}
-
-	xfree(tmp);
 	i=0;
 	xstrfmtcat(tmp, "%s", usage_req_inx[i]);
 	for(i=1; i<USAGE_COUNT; i++) {
 		xstrfmtcat(tmp, ", %s", usage_req_inx[i]);
 	}
-	switch (type) {
-	case DBD_GET_ASSOC_USAGE:
+	/* A parent association gets one row per period summed over
+	   its children instead of a row for every child. */
+	if (type == DBD_GET_ASSOC_USAGE)
 		query = xstrdup_printf(
 			"select %s from \"%s_%s\" as t1, "
 			"\"%s_%s\" as t2, \"%s_%s\" as t3 "
 			"where (t1.time_start < %ld && t1.time_start >= %ld) "
 			"&& t1.id_assoc=t2.id_assoc && (%s) && "
 			"t2.lft between t3.lft and t3.rgt "
-			"order by t3.id_assoc, time_start;",
+			"group by t3.id_assoc, t1.time_start "
+			"order by t3.id_assoc, t1.time_start;",
 			tmp, cluster_name, my_usage_table,
 			cluster_name, assoc_table, cluster_name, assoc_table,
 			end, start, id_str);
-		break;
-	case DBD_GET_WCKEY_USAGE:
+	else
 		query = xstrdup_printf(
 			"select %s from \"%s_%s\" "
 			"where (time_start < %ld && time_start >= %ld) "
 			"&& (%s) order by id_wckey, time_start;",
 			tmp, cluster_name, my_usage_table, end, start, id_str);
-		break;
-	default:
-		error("Unknown usage type %d", type);
-		xfree(id_str);
-		xfree(tmp);
-		return SLURM_ERROR;
-		break;
-	}
 	xfree(id_str);
 	xfree(tmp);
 
@@ -636,7 +662,7 @@ extern int get_usage_for_list(mysql_conn_t *mysql_conn,
 	if (!(result = mysql_db_query_ret(
 		      mysql_conn, query, 0))) {
 		xfree(query);
-		return SLURM_ERROR;
+		return NULL;
 	}
 	xfree(query);
 
@@ -652,12 +678,79 @@ extern int get_usage_for_list(mysql_conn_t *mysql_conn,
 	}
 	mysql_free_result(result);
 
-	u_itr = list_iterator_create(usage_list);
+	return usage_list;
+}
+
+/* Move the records of id off the front of usage_list (sorted by id)
+ * onto to_list.  Records of lower ids are not wanted and dropped. */
+static void _move_usage(List usage_list, uint32_t id, List to_list)
+{
+	slurmdb_accounting_rec_t *accounting_rec;
+
+	while ((accounting_rec = list_peek(usage_list))) {
+		if (accounting_rec->id > id)
+			break;
+		accounting_rec = list_pop(usage_list);
+		if (accounting_rec->id == id)
+			list_append(to_list, accounting_rec);
+		else
+			slurmdb_destroy_accounting_rec(accounting_rec);
+	}
+}
+
+/* checks should already be done before this to see if this is a valid
+   user or not.
+*/
+extern int get_usage_for_list(mysql_conn_t *mysql_conn,
+			      slurmdbd_msg_type_t type, List object_list,
+			      char *cluster_name, time_t start, time_t end)
+{
+	int rc = SLURM_SUCCESS;
+	int i, j, k, miss_cnt = 0, raw_cnt = 0;
+	char *my_usage_table = NULL;
+	List usage_list = NULL, id_list = NULL;
+	ListIterator itr = NULL;
+	void *object = NULL;
+	slurmdb_association_rec_t *assoc = NULL;
+	slurmdb_wckey_rec_t *wckey = NULL;
+	usage_miss_t *misses = NULL;
+	uint32_t *ids = NULL;
+	uint32_t gen;
+
+	if (!object_list) {
+		error("We need an object to set data for getting usage");
+		return SLURM_ERROR;
+	}
+
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	switch (type) {
+	case DBD_GET_ASSOC_USAGE:
+		my_usage_table = assoc_day_table;
+		break;
+	case DBD_GET_WCKEY_USAGE:
+		my_usage_table = wckey_day_table;
+		break;
+	default:
+		error("Unknown usage type %d", type);
+		return SLURM_ERROR;
+		break;
+	}
+
+	if (set_usage_information(&my_usage_table, type, &start, &end)
+	    != SLURM_SUCCESS) {
+		return SLURM_ERROR;
+	}
+
+	/* Serve what we can from the usage cache and remember what
+	   is missing for the rest. */
+	gen = as_mysql_usage_cache_gen();
+	misses = xmalloc(sizeof(usage_miss_t) * (list_count(object_list) + 1));
 	itr = list_iterator_create(object_list);
 	while ((object = list_next(itr))) {
-		int found = 0;
-		int id = 0;
 		List acct_list = NULL;
+		uint32_t id = 0;
 
 		switch (type) {
 		case DBD_GET_ASSOC_USAGE:
@@ -681,36 +774,76 @@ extern int get_usage_for_list(mysql_conn_t *mysql_conn,
 			break;
 		}
 
-		while ((accounting_rec = list_next(u_itr))) {
-			if (id == accounting_rec->id) {
-				list_append(acct_list, accounting_rec);
-				list_remove(u_itr);
-				found = 1;
-			} else if (found) {
-				/* here we know the
-				   list is in id order so
-				   if the next record
-				   isn't the correct id
-				   just continue since
-				   there is no reason to
-				   go through the rest of
-				   the list when we know
-				   it isn't going to be
-				   the correct id */
+		if (as_mysql_usage_cache_get(cluster_name, my_usage_table, id,
+					     start, end, acct_list,
+					     &misses[miss_cnt].start,
+					     &misses[miss_cnt].end))
+			continue;
+		misses[miss_cnt].acct_list = acct_list;
+		misses[miss_cnt].id = id;
+		miss_cnt++;
+	}
+	list_iterator_destroy(itr);
+
+	debug3("usage of %d of %d from %s for %s from cache",
+	       list_count(object_list) - miss_cnt, list_count(object_list),
+	       my_usage_table, cluster_name);
+	if (!miss_cnt)
+		goto end_it;
+
+	/* Ids missing the same window are read with one query. */
+	qsort(misses, miss_cnt, sizeof(usage_miss_t), _sort_usage_miss);
+	ids = xmalloc(sizeof(uint32_t) * miss_cnt);
+	for (i = 0; i < miss_cnt; i = j) {
+		for (j = i; j < miss_cnt; j++) {
+			if ((misses[j].start != misses[i].start)
+			    || (misses[j].end != misses[i].end))
 				break;
+			ids[j - i] = misses[j].id;
+		}
+		if (!(usage_list = _read_usage(mysql_conn, type, cluster_name,
+					       my_usage_table, ids, j - i,
+					       misses[i].start,
+					       misses[i].end))) {
+			rc = SLURM_ERROR;
+			goto end_it;
+		}
+		for (k = i; k < j; k++) {
+			id_list = list_create(slurmdb_destroy_accounting_rec);
+			_move_usage(usage_list, misses[k].id, id_list);
+			if (!as_mysql_usage_cache_put(
+				    cluster_name, my_usage_table, misses[k].id,
+				    misses[k].start, misses[k].end, id_list,
+				    gen, start, end, misses[k].acct_list)) {
+				misses[k].raw = 1;
+				raw_cnt++;
 			}
+			list_destroy(id_list);
 		}
-		list_iterator_reset(u_itr);
+		list_destroy(usage_list);
 	}
-	list_iterator_destroy(itr);
-	list_iterator_destroy(u_itr);
-
-	if (list_count(usage_list))
-		error("we have %d records not added "
-		      "to the association list",
-		      list_count(usage_list));
-	list_destroy(usage_list);
 
+	/* Whatever the cache could not take is read whole. */
+	if (raw_cnt) {
+		debug3("reading usage of %d ids from %s for %s uncached",
+		       raw_cnt, my_usage_table, cluster_name);
+		qsort(misses, miss_cnt, sizeof(usage_miss_t), _sort_usage_raw);
+		for (i = 0; i < raw_cnt; i++)
+			ids[i] = misses[i].id;
+		if (!(usage_list = _read_usage(mysql_conn, type, cluster_name,
+					       my_usage_table, ids, raw_cnt,
+					       start, end))) {
+			rc = SLURM_ERROR;
+			goto end_it;
+		}
+		for (i = 0; i < raw_cnt; i++)
+			_move_usage(usage_list, misses[i].id,
+				    misses[i].acct_list);
+		list_destroy(usage_list);
+	}
+end_it:
+	xfree(ids);
+	xfree(misses);
 
 	return rc;
 }
@@ -720,62 +853,27 @@ extern int as_mysql_get_usage(mysql_conn_t *mysql_conn, uid_t uid,
 			      time_t start, time_t end)
 {
 	int rc = SLURM_SUCCESS;
-	int i=0, is_admin=1;
-	MYSQL_RES *result = NULL;
-	MYSQL_ROW row;
-	char *tmp = NULL;
-	char *my_usage_table = NULL;
+	int is_admin=1;
 	slurmdb_association_rec_t *slurmdb_assoc = in;
 	slurmdb_wckey_rec_t *slurmdb_wckey = in;
-	char *query = NULL;
 	char *username = NULL;
 	uint16_t private_data = 0;
 	slurmdb_user_rec_t user;
-	List *my_list;
+	List object_list = NULL;
 	uint32_t id = NO_VAL;
 	char *cluster_name = NULL;
-	char **usage_req_inx = NULL;
-
-	enum {
-		USAGE_ID,
-		USAGE_START,
-		USAGE_ACPU,
-		USAGE_COUNT
-	};
 
 	switch (type) {
 	case DBD_GET_ASSOC_USAGE:
-	{
-		char *temp_usage[] = {
-			"t3.id_assoc",
-			"t1.time_start",
-			"t1.alloc_cpu_secs"
-		};
-		usage_req_inx = temp_usage;
-
 		id = slurmdb_assoc->id;
 		cluster_name = slurmdb_assoc->cluster;
 		username = slurmdb_assoc->user;
-		my_list = &slurmdb_assoc->accounting_list;
-		my_usage_table = assoc_day_table;
 		break;
-	}
 	case DBD_GET_WCKEY_USAGE:
-	{
-		char *temp_usage[] = {
-			"id_wckey",
-			"time_start",
-			"alloc_cpu_secs"
-		};
-		usage_req_inx = temp_usage;
-
 		id = slurmdb_wckey->id;
 		cluster_name = slurmdb_wckey->cluster;
 		username = slurmdb_wckey->user;
-		my_list = &slurmdb_wckey->accounting_list;
-		my_usage_table = wckey_day_table;
 		break;
-	}
 	case DBD_GET_CLUSTER_USAGE:
 	{
 		return _get_cluster_usage(mysql_conn, uid, in,
@@ -845,66 +943,11 @@ extern int as_mysql_get_usage(mysql_conn_t *mysql_conn, uid_t uid,
 		}
 	}
 is_user:
-
-	if (set_usage_information(&my_usage_table, type, &start, &end)
-	    != SLURM_SUCCESS) {
-		return SLURM_ERROR;
-	}
-
-	xfree(tmp);
-	i=0;
-	xstrfmtcat(tmp, "%s", usage_req_inx[i]);
-	for(i=1; i<USAGE_COUNT; i++) {
-		xstrfmtcat(tmp, ", %s", usage_req_inx[i]);
-	}
-	switch (type) {
-	case DBD_GET_ASSOC_USAGE:
-		query = xstrdup_printf(
-			"select %s from \"%s_%s\" as t1, "
-			"\"%s_%s\" as t2, \"%s_%s\" as t3 "
-			"where (t1.time_start < %ld && t1.time_start >= %ld) "
-			"&& t1.id_assoc=t2.id_assoc && t3.id_assoc=%d && "
-			"t2.lft between t3.lft and t3.rgt "
-			"order by t3.id_assoc, time_start;",
-			tmp, cluster_name, my_usage_table,
-			cluster_name, cluster_name, assoc_table, assoc_table,
-			end, start, id);
-		break;
-	case DBD_GET_WCKEY_USAGE:
-		query = xstrdup_printf(
-			"select %s from \"%s_%s\" "
-			"where (time_start < %ld && time_start >= %ld) "
-			"&& id_wckey=%d order by id_wckey, time_start;",
-			tmp, cluster_name, my_usage_table, end, start, id);
-		break;
-	default:
-		error("Unknown usage type %d", type);
-		return SLURM_ERROR;
-		break;
-	}
-
-	xfree(tmp);
-	debug4("%d(%s:%d) query\n%s",
-	       mysql_conn->conn, THIS_FILE, __LINE__, query);
-	if (!(result = mysql_db_query_ret(
-		      mysql_conn, query, 0))) {
-		xfree(query);
-		return SLURM_ERROR;
-	}
-	xfree(query);
-
-	if (!(*my_list))
-		(*my_list) = list_create(slurmdb_destroy_accounting_rec);
-
-	while ((row = mysql_fetch_row(result))) {
-		slurmdb_accounting_rec_t *accounting_rec =
-			xmalloc(sizeof(slurmdb_accounting_rec_t));
-		accounting_rec->id = slurm_atoul(row[USAGE_ID]);
-		accounting_rec->period_start = slurm_atoul(row[USAGE_START]);
-		accounting_rec->alloc_secs = slurm_atoull(row[USAGE_ACPU]);
-		list_append((*my_list), accounting_rec);
-	}
-	mysql_free_result(result);
+	object_list = list_create(NULL);
+	list_append(object_list, in);
+	rc = get_usage_for_list(mysql_conn, type, object_list,
+				cluster_name, start, end);
+	list_destroy(object_list);
 
 	return rc;
 }
@@ -914,7 +957,7 @@ extern int as_mysql_roll_usage(mysql_conn_t *mysql_conn,
 			       uint16_t archive_data)
 {
 	int rc = SLURM_SUCCESS;
-	int rolledup = 0;
+	int rolledup = 0, started = 0;
 	char *cluster_name = NULL;
 	ListIterator itr;
 	pthread_mutex_t rolledup_lock = PTHREAD_MUTEX_INITIALIZER;
@@ -933,12 +976,13 @@ extern int as_mysql_roll_usage(mysql_conn_t *mysql_conn,
 	slurm_mutex_lock(&as_mysql_cluster_list_lock);
 	itr = list_iterator_create(as_mysql_cluster_list);
 	while ((cluster_name = list_next(itr))) {
-		/* pthread_t rollup_tid; */
-		/* pthread_attr_t rollup_attr; */
+		pthread_t rollup_tid;
+		pthread_attr_t rollup_attr;
 		local_rollup_t *local_rollup = xmalloc(sizeof(local_rollup_t));
 
 		local_rollup->archive_data = archive_data;
-		local_rollup->cluster_name = cluster_name;
+		/* The cluster could be removed while we roll it up */
+		local_rollup->cluster_name = xstrdup(cluster_name);
 
 		local_rollup->mysql_conn = mysql_conn;
 		local_rollup->rc = &rc;
@@ -949,27 +993,33 @@ extern int as_mysql_roll_usage(mysql_conn_t *mysql_conn,
 		local_rollup->sent_end = sent_end;
 		local_rollup->sent_start = sent_start;
 
+		/* Each cluster is independent, so after a long outage
+		   catching up several of them at once is worth it.
+		   Limit how many at a time to spare the database.
+		*/
+		slurm_mutex_lock(&rolledup_lock);
+		while ((started - rolledup) >= MAX_ROLLUP_THREADS)
+			pthread_cond_wait(&rolledup_cond, &rolledup_lock);
+		slurm_mutex_unlock(&rolledup_lock);
+
 		/* _cluster_rollup_usage is responsible for freeing
 		   this local_rollup */
-		_cluster_rollup_usage(local_rollup);
-		/* It turns out doing this with threads only buys a
-		   very small victory, and can skew the timings.  So
-		   just doing them one after the other isn't too bad.
-		   If you really want to do this in threads you can
-		   just uncomment this, and comment the call above.
-		*/
-		/* slurm_attr_init(&rollup_attr); */
-		/* if (pthread_create(&rollup_tid, &rollup_attr, */
-		/* 		   _cluster_rollup_usage, */
-		/* 		   (void *)local_rollup)) */
-		/* 	fatal("pthread_create: %m"); */
-		/* slurm_attr_destroy(&rollup_attr); */
+		slurm_attr_init(&rollup_attr);
+		if (pthread_attr_setdetachstate(&rollup_attr,
+						PTHREAD_CREATE_DETACHED))
+			error("pthread_attr_setdetachstate error %m");
+		if (pthread_create(&rollup_tid, &rollup_attr,
+				   _cluster_rollup_usage,
+				   (void *)local_rollup))
+			fatal("pthread_create: %m");
+		slurm_attr_destroy(&rollup_attr);
+		started++;
 	}
-	slurm_mutex_lock(&rolledup_lock);
 	list_iterator_destroy(itr);
 	slurm_mutex_unlock(&as_mysql_cluster_list_lock);
 
-	while (rolledup < list_count(as_mysql_cluster_list)) {
+	slurm_mutex_lock(&rolledup_lock);
+	while (rolledup < started) {
 		pthread_cond_wait(&rolledup_cond, &rolledup_lock);
 		debug2("Got %d rolled up", rolledup);
 	}
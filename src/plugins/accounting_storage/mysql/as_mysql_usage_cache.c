@@ -0,0 +1,331 @@
+/*****************************************************************************\
+ *  as_mysql_usage_cache.c - cache of association and wckey usage.
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "as_mysql_usage_cache.h"
+
+#define USAGE_CACHE_HASH_SIZE	4096
+/* Past this many buckets the whole cache is thrown away, a bucket is
+ * an hour, day or month of one id so this is plenty for the reports
+ * run between rollups. */
+#define USAGE_CACHE_MAX_BUCKETS	1000000
+
+typedef struct {
+	uint64_t alloc_secs;
+	time_t period_start;
+} usage_bucket_t;
+
+typedef struct usage_cache_ent {
+	usage_bucket_t *buckets;	/* in period_start order */
+	int bucket_cnt;
+	char *cluster;
+	time_t end;			/* window the buckets cover */
+	uint32_t id;
+	struct usage_cache_ent *next;
+	time_t start;
+	char *table;			/* one of the usage tables,
+					 * compared by address */
+} usage_cache_ent_t;
+
+static pthread_mutex_t usage_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static usage_cache_ent_t *usage_cache_hash[USAGE_CACHE_HASH_SIZE];
+static int usage_cache_buckets = 0;
+static uint32_t usage_cache_generation = 0;
+static uint32_t usage_cache_hits = 0;
+static uint32_t usage_cache_misses = 0;
+
+static int _hash_inx(char *cluster, char *table, uint32_t id)
+{
+	uint32_t hash = id;
+
+	while (*cluster)
+		hash = (hash * 31) + *cluster++;
+	hash += (uint32_t)((unsigned long)table >> 3);
+
+	return hash % USAGE_CACHE_HASH_SIZE;
+}
+
+static usage_cache_ent_t *_find_ent(char *cluster, char *table, uint32_t id)
+{
+	usage_cache_ent_t *ent;
+
+	ent = usage_cache_hash[_hash_inx(cluster, table, id)];
+	for ( ; ent; ent = ent->next) {
+		if ((ent->id == id) && (ent->table == table)
+		    && !strcmp(ent->cluster, cluster))
+			return ent;
+	}
+	return NULL;
+}
+
+static void _free_ent(usage_cache_ent_t *ent)
+{
+	usage_cache_buckets -= ent->bucket_cnt;
+	xfree(ent->buckets);
+	xfree(ent->cluster);
+	xfree(ent);
+}
+
+static void _flush_locked(void)
+{
+	usage_cache_ent_t *ent, *next;
+	int i;
+
+	for (i = 0; i < USAGE_CACHE_HASH_SIZE; i++) {
+		for (ent = usage_cache_hash[i]; ent; ent = next) {
+			next = ent->next;
+			_free_ent(ent);
+		}
+		usage_cache_hash[i] = NULL;
+	}
+	usage_cache_generation++;
+}
+
+/* Append the buckets of ent in [start, end) to acct_list */
+static void _serve(usage_cache_ent_t *ent, time_t start, time_t end,
+		   List acct_list)
+{
+	slurmdb_accounting_rec_t *accounting_rec;
+	int i;
+
+	for (i = 0; i < ent->bucket_cnt; i++) {
+		if (ent->buckets[i].period_start < start)
+			continue;
+		if (ent->buckets[i].period_start >= end)
+			break;
+		accounting_rec = xmalloc(sizeof(slurmdb_accounting_rec_t));
+		accounting_rec->id = ent->id;
+		accounting_rec->period_start = ent->buckets[i].period_start;
+		accounting_rec->alloc_secs = ent->buckets[i].alloc_secs;
+		list_append(acct_list, accounting_rec);
+	}
+}
+
+static int _sort_buckets(const void *a, const void *b)
+{
+	const usage_bucket_t *bucket_a = a;
+	const usage_bucket_t *bucket_b = b;
+
+	if (bucket_a->period_start < bucket_b->period_start)
+		return -1;
+	if (bucket_a->period_start > bucket_b->period_start)
+		return 1;
+	return 0;
+}
+
+extern uint32_t as_mysql_usage_cache_gen(void)
+{
+	uint32_t gen;
+
+	slurm_mutex_lock(&usage_cache_lock);
+	gen = usage_cache_generation;
+	slurm_mutex_unlock(&usage_cache_lock);
+
+	return gen;
+}
+
+extern bool as_mysql_usage_cache_get(char *cluster, char *table, uint32_t id,
+				     time_t start, time_t end, List acct_list,
+				     time_t *miss_start, time_t *miss_end)
+{
+	usage_cache_ent_t *ent;
+
+	*miss_start = start;
+	*miss_end = end;
+
+	slurm_mutex_lock(&usage_cache_lock);
+	ent = _find_ent(cluster, table, id);
+	if (ent && (ent->start <= start) && (ent->end >= end)) {
+		_serve(ent, start, end, acct_list);
+		usage_cache_hits++;
+		slurm_mutex_unlock(&usage_cache_lock);
+		return true;
+	}
+
+	/* Only read what is missing when it joins up with what we
+	 * have, otherwise the whole window replaces the entry. */
+	if (ent && (start < ent->start) && (end >= ent->start)
+	    && (end <= ent->end))
+		*miss_end = ent->start;
+	else if (ent && (end > ent->end) && (start <= ent->end)
+		 && (start >= ent->start))
+		*miss_start = ent->end;
+	usage_cache_misses++;
+	slurm_mutex_unlock(&usage_cache_lock);
+
+	return false;
+}
+
+extern bool as_mysql_usage_cache_put(char *cluster, char *table, uint32_t id,
+				     time_t miss_start, time_t miss_end,
+				     List usage_list, uint32_t gen,
+				     time_t start, time_t end, List acct_list)
+{
+	usage_cache_ent_t *ent;
+	slurmdb_accounting_rec_t *accounting_rec;
+	ListIterator itr;
+	usage_bucket_t *buckets;
+	int i, cnt = 0, kept = 0;
+	bool join;
+	bool rc = false;
+
+	slurm_mutex_lock(&usage_cache_lock);
+	if (gen != usage_cache_generation)
+		goto end_it;
+
+	ent = _find_ent(cluster, table, id);
+	join = ent && (miss_end >= ent->start) && (miss_start <= ent->end);
+	if (ent && join) {
+		for (i = 0; i < ent->bucket_cnt; i++) {
+			if ((ent->buckets[i].period_start < miss_start)
+			    || (ent->buckets[i].period_start >= miss_end))
+				kept++;
+		}
+	}
+
+	if ((usage_cache_buckets - (ent ? ent->bucket_cnt : 0) + kept
+	     + list_count(usage_list)) > USAGE_CACHE_MAX_BUCKETS) {
+		debug("usage cache is full (%d buckets), flushing it",
+		      usage_cache_buckets);
+		_flush_locked();
+		ent = NULL;
+		join = false;
+		kept = 0;
+		if (list_count(usage_list) > USAGE_CACHE_MAX_BUCKETS)
+			goto end_it;
+	}
+
+	if (!ent) {
+		int inx = _hash_inx(cluster, table, id);
+		ent = xmalloc(sizeof(usage_cache_ent_t));
+		ent->cluster = xstrdup(cluster);
+		ent->table = table;
+		ent->id = id;
+		ent->next = usage_cache_hash[inx];
+		usage_cache_hash[inx] = ent;
+	}
+
+	buckets = xmalloc(sizeof(usage_bucket_t)
+			  * (kept + list_count(usage_list) + 1));
+	if (join) {
+		for (i = 0; i < ent->bucket_cnt; i++) {
+			if ((ent->buckets[i].period_start >= miss_start)
+			    && (ent->buckets[i].period_start < miss_end))
+				continue;
+			buckets[cnt++] = ent->buckets[i];
+		}
+		ent->start = MIN(ent->start, miss_start);
+		ent->end = MAX(ent->end, miss_end);
+	} else {
+		ent->start = miss_start;
+		ent->end = miss_end;
+	}
+
+	itr = list_iterator_create(usage_list);
+	while ((accounting_rec = list_next(itr))) {
+		buckets[cnt].period_start = accounting_rec->period_start;
+		buckets[cnt].alloc_secs = accounting_rec->alloc_secs;
+		cnt++;
+	}
+	list_iterator_destroy(itr);
+	qsort(buckets, cnt, sizeof(usage_bucket_t), _sort_buckets);
+
+	usage_cache_buckets += cnt - ent->bucket_cnt;
+	xfree(ent->buckets);
+	ent->buckets = buckets;
+	ent->bucket_cnt = cnt;
+
+	if ((ent->start <= start) && (ent->end >= end)) {
+		_serve(ent, start, end, acct_list);
+		rc = true;
+	}
+end_it:
+	slurm_mutex_unlock(&usage_cache_lock);
+
+	return rc;
+}
+
+extern void as_mysql_usage_cache_invalidate(char *cluster, char *table,
+					    time_t start)
+{
+	usage_cache_ent_t *ent, **prev;
+	int i, cnt;
+
+	slurm_mutex_lock(&usage_cache_lock);
+	for (i = 0; i < USAGE_CACHE_HASH_SIZE; i++) {
+		prev = &usage_cache_hash[i];
+		while ((ent = *prev)) {
+			if ((ent->table != table) || (ent->end <= start)
+			    || strcmp(ent->cluster, cluster)) {
+				prev = &ent->next;
+				continue;
+			}
+			if (ent->start >= start) {
+				*prev = ent->next;
+				_free_ent(ent);
+				continue;
+			}
+			for (cnt = 0; cnt < ent->bucket_cnt; cnt++) {
+				if (ent->buckets[cnt].period_start >= start)
+					break;
+			}
+			usage_cache_buckets -= ent->bucket_cnt - cnt;
+			ent->bucket_cnt = cnt;
+			ent->end = start;
+			prev = &ent->next;
+		}
+	}
+	usage_cache_generation++;
+	slurm_mutex_unlock(&usage_cache_lock);
+}
+
+extern void as_mysql_usage_cache_flush(void)
+{
+	slurm_mutex_lock(&usage_cache_lock);
+	_flush_locked();
+	slurm_mutex_unlock(&usage_cache_lock);
+}
+
+extern void as_mysql_usage_cache_fini(void)
+{
+	slurm_mutex_lock(&usage_cache_lock);
+	if (usage_cache_hits || usage_cache_misses)
+		debug("usage cache: %u hits %u misses",
+		      usage_cache_hits, usage_cache_misses);
+	usage_cache_hits = usage_cache_misses = 0;
+	_flush_locked();
+	slurm_mutex_unlock(&usage_cache_lock);
+}
@@ -0,0 +1,95 @@
+/*****************************************************************************\
+ *  as_mysql_usage_cache.h - cache of association and wckey usage.
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_MYSQL_USAGE_CACHE_H
+#define _HAVE_MYSQL_USAGE_CACHE_H
+
+#include "accounting_storage_mysql.h"
+
+/*
+ * The usage of an association (summed over its subtree) or a wckey is
+ * kept per cluster, usage table and id for the window of time it was
+ * last read for.  Rollup only ever changes the tables from the hour,
+ * day or month it started at, so entries are cut back to that point
+ * when it commits and the rest stays good for the next report.
+ */
+
+/* Returns the current generation of the cache, read this before
+ * querying a usage table and hand it to as_mysql_usage_cache_put so
+ * records read before an invalidation are not cached.
+ */
+extern uint32_t as_mysql_usage_cache_gen(void);
+
+/*
+ * as_mysql_usage_cache_get - append the cached usage of an id to a list
+ * IN cluster, table, id: what usage to get
+ * IN start, end: window wanted
+ * IN/OUT acct_list: list of slurmdb_accounting_rec_t to append to
+ * OUT miss_start, miss_end: window to read from the table on a miss
+ * RET true if the whole window was appended, false otherwise
+ */
+extern bool as_mysql_usage_cache_get(char *cluster, char *table, uint32_t id,
+				     time_t start, time_t end, List acct_list,
+				     time_t *miss_start, time_t *miss_end);
+
+/*
+ * as_mysql_usage_cache_put - add usage read from a table to the cache
+ *	and append the window wanted from it
+ * IN cluster, table, id: what usage was read
+ * IN miss_start, miss_end: window read, from as_mysql_usage_cache_get
+ * IN usage_list: slurmdb_accounting_rec_t's read in time order
+ * IN gen: cache generation from before the read
+ * IN start, end: window wanted
+ * IN/OUT acct_list: list of slurmdb_accounting_rec_t to append to
+ * RET true if the whole window was appended, false if the cache changed
+ *     underneath us and the window has to be read uncached
+ */
+extern bool as_mysql_usage_cache_put(char *cluster, char *table, uint32_t id,
+				     time_t miss_start, time_t miss_end,
+				     List usage_list, uint32_t gen,
+				     time_t start, time_t end, List acct_list);
+
+/* Forget all usage of a cluster in table from start on. */
+extern void as_mysql_usage_cache_invalidate(char *cluster, char *table,
+					    time_t start);
+
+/* Forget everything, used when associations or clusters change. */
+extern void as_mysql_usage_cache_flush(void);
+
+extern void as_mysql_usage_cache_fini(void);
+
+#endif
@@ -459,3 +459,8 @@ extern int acct_storage_p_flush_jobs_on_cluster(
 {
 	return SLURM_SUCCESS;
 }
+
+extern int jobacct_storage_p_batch(void *db_conn, bool start, bool commit)
+{
+	return SLURM_SUCCESS;
+}
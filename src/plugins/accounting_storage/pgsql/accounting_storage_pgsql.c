@@ -729,3 +729,8 @@ extern int acct_storage_p_flush_jobs_on_cluster(pgsql_conn_t *pg_conn,
 {
 	return as_pg_flush_jobs_on_cluster(pg_conn, event_time);
 }
+
+extern int jobacct_storage_p_batch(void *db_conn, bool start, bool commit)
+{
+	return SLURM_SUCCESS;
+}
@@ -2292,6 +2292,7 @@ extern List jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 	dbd_cond_msg_t get_msg;
 	dbd_list_msg_t *got_msg;
 	int rc;
+	uint32_t more = 0;
 	List my_job_list = NULL;
 
 	memset(&get_msg, 0, sizeof(dbd_cond_msg_t));
@@ -2321,9 +2322,28 @@ extern List jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 		got_msg = (dbd_list_msg_t *) resp.data;
 		my_job_list = got_msg->my_list;
 		got_msg->my_list = NULL;
+		more = got_msg->return_code;
 		slurmdbd_free_list_msg(got_msg);
 	}
 
+	if (!job_cond || !job_cond->page_size)
+		return my_job_list;
+
+	/* Set up the next page to start after the last job we got.
+	   A SlurmDBD not paging sends more jobs than asked for. */
+	xfree(job_cond->page_cluster);
+	job_cond->page_jobid = 0;
+	if (more && my_job_list && list_count(my_job_list)
+	    && (list_count(my_job_list) <= job_cond->page_size)) {
+		slurmdb_job_rec_t *job = NULL, *last_job = NULL;
+		ListIterator itr = list_iterator_create(my_job_list);
+		while ((job = list_next(itr)))
+			last_job = job;
+		list_iterator_destroy(itr);
+		job_cond->page_cluster = xstrdup(last_job->cluster);
+		job_cond->page_jobid = last_job->jobid;
+	}
+
 	return my_job_list;
 }
 
@@ -2431,3 +2451,10 @@ extern int acct_storage_p_flush_jobs_on_cluster(void *db_conn,
 
 	return SLURM_SUCCESS;
 }
+
+extern int jobacct_storage_p_batch(void *db_conn, bool start, bool commit)
+{
+	/* The agent already sends queued records as one message and
+	 * the slurmdbd batches them on its side. */
+	return SLURM_SUCCESS;
+}
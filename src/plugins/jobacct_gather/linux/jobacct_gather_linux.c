@@ -41,10 +41,14 @@
 
 #include <fcntl.h>
 #include <signal.h>
+#include <stdlib.h>
 #include "src/common/slurm_xlator.h"
 #include "src/common/jobacct_common.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_defs.h"
+#include "src/common/timers.h"
+#include "src/common/xcgroup.h"
+#include "src/common/xcgroup_read_config.h"
 #include "src/slurmd/common/proctrack.h"
 
 #define _DEBUG 0
@@ -112,6 +116,27 @@ typedef struct prec {	/* process record */
 	int	vsize;	/* virtual size */
 } prec_t;
 
+typedef struct cgroup_task {	/* accounting cgroups of one task */
+	pid_t		pid;
+	xcgroup_t	cpuacct_cg;
+	xcgroup_t	memory_cg;
+	prec_t		prec;	/* last sample */
+} cgroup_task_t;
+
+typedef struct proc_entry {	/* persistent /proc/<pid>/stat reader */
+	pid_t		pid;
+	int		fd;	/* -1 if not kept open */
+	bool		lwp;	/* thread, not accounted for */
+	uint32_t	tick;	/* last tick the pid was listed at */
+	prec_t		prec;	/* last sample */
+	struct proc_entry *next;
+} proc_entry_t;
+
+/* Keep at most this many /proc/<pid>/stat files open between ticks,
+ * any other pid is opened and closed each time it is read */
+#define PROC_MAX_FDS	256
+#define PROC_HASH_SIZE	1024
+
 static int freq = 0;
 static DIR  *slash_proc = NULL;
 static pthread_mutex_t reading_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -121,14 +146,48 @@ static List task_list = NULL;
 static uint64_t cont_id = (uint64_t)NO_VAL;
 static bool pgid_plugin = false;
 
+/* records sampled at the current tick, see _get_process_data() */
+static prec_t **prec_tab = NULL;
+static int prec_cnt = 0;
+static int prec_size = 0;
+
+/* /proc reader, protected by reading_mutex */
+static proc_entry_t *proc_hash[PROC_HASH_SIZE];
+static char proc_buf[512];
+static int proc_fd_cnt = 0;
+static uint32_t proc_tick = 0;
+static int proc_opened = 0;
+static int proc_closed = 0;
+
+/* sampling cost, logged at the end of the step */
+static uint32_t tick_cnt = 0;
+static uint64_t tick_usec_tot = 0;
+static uint32_t tick_usec_max = 0;
+
+/* cgroup sampler, see JobAcctGatherCgroup in cgroup.conf */
+static bool use_cgroup = false;
+static xcgroup_ns_t cpuacct_ns;
+static xcgroup_ns_t memory_ns;
+static char *step_cgroup_path = NULL;
+static List cgroup_task_list = NULL;
+static pthread_mutex_t cgroup_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /* Finally, pre-define all local routines. */
 
 static void _acct_kill_step(void);
-static void _destroy_prec(void *object);
+static void _cgroup_add_task(pid_t pid, jobacct_id_t *jobacct_id);
+static void _cgroup_fini(void);
+static void _cgroup_init(void);
+static void _destroy_cgroup_task(void *object);
+static bool _get_cgroup_data(void);
 static int  _is_a_lwp(uint32_t pid);
-static void _get_offspring_data(List prec_list, prec_t *ancestor, pid_t pid);
+static void _get_offspring_data(prec_t *ancestor, pid_t pid);
 static void _get_process_data(void);
-static int  _get_process_data_line(int in, prec_t *prec);
+static int  _get_process_data_line(char *sbuf, prec_t *prec);
+static void _prec_tab_add(prec_t *prec);
+static void _proc_fini(void);
+static void _proc_purge(void);
+static void _proc_sample(pid_t pid);
 static void *_watch_tasks(void *arg);
 
 /*
@@ -138,8 +197,7 @@ static void *_watch_tasks(void *arg);
  * usage data to the ancestor's <prec> record. Recurse to gather data
  * for *all* subsequent generations.
  *
- * IN:	prec_list       list of prec's
- *      ancestor	The entry in precTable[] to which the data
+ * IN:	ancestor	The copy of the entry in prec_tab[] to which the data
  * 			should be added. Even as we recurse, this will
  * 			always be the prec for the base of the family
  * 			tree.
@@ -153,19 +211,19 @@ static void *_watch_tasks(void *arg);
  * THREADSAFE! Only one thread ever gets here.
  */
 static void
-_get_offspring_data(List prec_list, prec_t *ancestor, pid_t pid) {
+_get_offspring_data(prec_t *ancestor, pid_t pid) {
 
-	ListIterator itr;
 	prec_t *prec = NULL;
+	int i;
 
-	itr = list_iterator_create(prec_list);
-	while((prec = list_next(itr))) {
+	for (i = 0; i < prec_cnt; i++) {
+		prec = prec_tab[i];
 		if (prec->ppid == pid) {
 #if _DEBUG
 			info("pid:%u ppid:%u rss:%d KB",
 			     prec->pid, prec->ppid, prec->rss);
 #endif
-			_get_offspring_data(prec_list, ancestor, prec->pid);
+			_get_offspring_data(ancestor, prec->pid);
 			ancestor->usec += prec->usec;
 			ancestor->ssec += prec->ssec;
 			ancestor->pages += prec->pages;
@@ -173,10 +231,307 @@ _get_offspring_data(List prec_list, prec_t *ancestor, pid_t pid) {
 			ancestor->vsize += prec->vsize;
 		}
 	}
-	list_iterator_destroy(itr);
 	return;
 }
 
+/*
+ * _cgroup_ns_init() -- set up the namespace of one cgroup subsystem,
+ *	mounting it if CgroupAutomount is set.
+ * RET true if the subsystem can be used
+ */
+static bool _cgroup_ns_init(xcgroup_ns_t *ns, char *subsys,
+			    slurm_cgroup_conf_t *cg_conf)
+{
+	char mnt_point[256], release_agent[256];
+
+	snprintf(mnt_point, sizeof(mnt_point), "%s/%s",
+		 CGROUP_BASEDIR, subsys);
+	snprintf(release_agent, sizeof(release_agent), "%s/release_%s",
+		 cg_conf->cgroup_release_agent, subsys);
+	if (xcgroup_ns_create(ns, mnt_point, "", subsys, release_agent)
+	    != XCGROUP_SUCCESS) {
+		error("jobacct-gather: unable to create %s namespace", subsys);
+		return false;
+	}
+
+	if (xcgroup_ns_is_available(ns))
+		return true;
+	if (!cg_conf->cgroup_automount) {
+		info("jobacct-gather: %s namespace not mounted", subsys);
+	} else if (xcgroup_ns_mount(ns)) {
+		error("jobacct-gather: unable to mount %s namespace", subsys);
+	} else {
+		info("jobacct-gather: %s namespace is now mounted", subsys);
+		return true;
+	}
+	xcgroup_ns_destroy(ns);
+	return false;
+}
+
+/*
+ * _cgroup_init() -- enable the cgroup sampler if JobAcctGatherCgroup is
+ *	set and the cpuacct and memory subsystems are available.
+ *
+ * The step cgroup itself is created by proctrack/cgroup or task/cgroup,
+ * without one of those there is nothing to sample from.
+ */
+static void _cgroup_init(void)
+{
+	slurm_cgroup_conf_t cg_conf;
+	char *proctrack_type, *task_plugin;
+	bool cgroup_plugin;
+
+	proctrack_type = slurm_get_proctrack_type();
+	task_plugin = slurm_get_task_plugin();
+	cgroup_plugin = (!strcasecmp(proctrack_type, "proctrack/cgroup") ||
+			 (task_plugin && strstr(task_plugin, "cgroup")));
+	xfree(proctrack_type);
+	xfree(task_plugin);
+	if (!cgroup_plugin)
+		return;
+
+	if (read_slurm_cgroup_conf(&cg_conf) != SLURM_SUCCESS)
+		return;
+	if (cg_conf.jobacct_gather_cgroup) {
+		if (!_cgroup_ns_init(&cpuacct_ns, "cpuacct", &cg_conf)) {
+			info("jobacct-gather: using /proc instead of cgroups");
+		} else if (!_cgroup_ns_init(&memory_ns, "memory", &cg_conf)) {
+			xcgroup_ns_destroy(&cpuacct_ns);
+			info("jobacct-gather: using /proc instead of cgroups");
+		} else {
+			cgroup_task_list = list_create(_destroy_cgroup_task);
+			use_cgroup = true;
+		}
+	}
+	free_slurm_cgroup_conf(&cg_conf);
+}
+
+static void _cgroup_fini(void)
+{
+	slurm_mutex_lock(&cgroup_mutex);
+	use_cgroup = false;
+	if (cgroup_task_list) {
+		list_destroy(cgroup_task_list);
+		cgroup_task_list = NULL;
+		xfree(step_cgroup_path);
+		xcgroup_ns_destroy(&cpuacct_ns);
+		xcgroup_ns_destroy(&memory_ns);
+	}
+	slurm_mutex_unlock(&cgroup_mutex);
+}
+
+/*
+ * _cgroup_step_path() -- find the step cgroup the task was placed in by
+ *	task/cgroup (memory) or proctrack/cgroup (freezer).
+ * RET path relative to the namespace mount point, xfree() it
+ */
+static char *_cgroup_step_path(pid_t pid)
+{
+	xcgroup_ns_t freezer_ns;
+	xcgroup_t cg;
+	char *path = NULL;
+
+	if (xcgroup_ns_find_by_pid(&memory_ns, &cg, pid) == XCGROUP_SUCCESS) {
+		if (strcmp(cg.name, "/"))
+			path = xstrdup(cg.name);
+		xcgroup_destroy(&cg);
+	}
+	if (path)
+		return path;
+
+	if (xcgroup_ns_create(&freezer_ns, CGROUP_BASEDIR "/freezer", "",
+			      "freezer", "") != XCGROUP_SUCCESS)
+		return NULL;
+	if (xcgroup_ns_find_by_pid(&freezer_ns, &cg, pid) == XCGROUP_SUCCESS) {
+		if (strcmp(cg.name, "/"))
+			path = xstrdup(cg.name);
+		xcgroup_destroy(&cg);
+	}
+	xcgroup_ns_destroy(&freezer_ns);
+	return path;
+}
+
+/*
+ * _cgroup_attach() -- create the cgroup <path> and all its missing
+ *	ancestors in namespace <ns>, then move <pid> into it.
+ *
+ * The root cgroup is locked while building the hierarchy so that a
+ * release agent can not remove a parent before the pid is attached,
+ * as done by task/cgroup.
+ */
+static bool _cgroup_attach(xcgroup_ns_t *ns, xcgroup_t *cg,
+			   char *path, pid_t pid)
+{
+	xcgroup_t root_cg, parent_cg;
+	char *sub_path, *sep;
+	bool rc = false;
+
+	if (xcgroup_create(ns, &root_cg, "", 0, 0) != XCGROUP_SUCCESS)
+		return false;
+	if (xcgroup_lock(&root_cg) != XCGROUP_SUCCESS) {
+		xcgroup_destroy(&root_cg);
+		return false;
+	}
+
+	sub_path = xstrdup(path);
+	sep = sub_path;
+	while ((sep = strchr(sep + 1, '/'))) {
+		*sep = '\0';
+		if (xcgroup_create(ns, &parent_cg, sub_path, 0, 0)
+		    != XCGROUP_SUCCESS)
+			goto fini;
+		xcgroup_instanciate(&parent_cg);
+		xcgroup_destroy(&parent_cg);
+		*sep = '/';
+	}
+
+	if (xcgroup_create(ns, cg, path, 0, 0) != XCGROUP_SUCCESS)
+		goto fini;
+	if ((xcgroup_instanciate(cg) != XCGROUP_SUCCESS) ||
+	    (xcgroup_add_pids(cg, &pid, 1) != XCGROUP_SUCCESS)) {
+		xcgroup_destroy(cg);
+		goto fini;
+	}
+	rc = true;
+
+fini:
+	xfree(sub_path);
+	xcgroup_unlock(&root_cg);
+	xcgroup_destroy(&root_cg);
+	return rc;
+}
+
+/*
+ * _cgroup_add_task() -- give a new task its own cpuacct and memory
+ *	cgroups under the step cgroup.
+ *
+ * The task has not called exec() yet, so everything it spawns will be
+ * accounted for in these cgroups. If this fails for any task the
+ * sampler is disabled for the step and /proc is scanned instead.
+ */
+static void _cgroup_add_task(pid_t pid, jobacct_id_t *jobacct_id)
+{
+	cgroup_task_t *cgt;
+	char *task_path;
+
+	slurm_mutex_lock(&cgroup_mutex);
+	if (!use_cgroup)
+		goto fini;
+
+	if (!step_cgroup_path &&
+	    !(step_cgroup_path = _cgroup_step_path(pid))) {
+		info("jobacct-gather: no step cgroup found for pid %d, "
+		     "using /proc instead", pid);
+		goto fail;
+	}
+
+	task_path = xstrdup_printf("%s/task_%u", step_cgroup_path,
+				   jobacct_id->taskid);
+	cgt = xmalloc(sizeof(cgroup_task_t));
+	cgt->pid = pid;
+	if (!_cgroup_attach(&cpuacct_ns, &cgt->cpuacct_cg, task_path, pid)) {
+		error("jobacct-gather: unable to attach pid %d to cpuacct "
+		      "cgroup %s", pid, task_path);
+		xfree(cgt);
+		xfree(task_path);
+		goto fail;
+	}
+	if (!_cgroup_attach(&memory_ns, &cgt->memory_cg, task_path, pid)) {
+		error("jobacct-gather: unable to attach pid %d to memory "
+		      "cgroup %s", pid, task_path);
+		list_append(cgroup_task_list, cgt);	/* for cleanup */
+		xfree(task_path);
+		goto fail;
+	}
+	debug2("jobacct-gather: pid %d accounted in cgroup %s",
+	       pid, task_path);
+	list_append(cgroup_task_list, cgt);
+	xfree(task_path);
+	goto fini;
+
+fail:
+	/* the cgroups already created are removed at the end of the step */
+	use_cgroup = false;
+fini:
+	slurm_mutex_unlock(&cgroup_mutex);
+}
+
+/* Return the value of <key> in a "key value" per line cgroup file */
+static uint64_t _cgroup_stat_value(char *buf, char *key)
+{
+	int len = strlen(key);
+	char *p = buf;
+
+	while (p && *p) {
+		if (!strncmp(p, key, len) && (p[len] == ' '))
+			return strtoull(p + len + 1, NULL, 10);
+		if ((p = strchr(p, '\n')))
+			p++;
+	}
+	return 0;
+}
+
+/*
+ * _get_cgroup_data() -- add to prec_tab[] one record per task, read
+ *	from the task's cgroups. The cost does not depend on the number of
+ *	processes the tasks have spawned.
+ *
+ * The kernel does not account for virtual memory per cgroup, so vsize is
+ * reported as resident plus swapped out memory.
+ *
+ * RET true if every task could be sampled this way
+ */
+static bool _get_cgroup_data(void)
+{
+	ListIterator itr;
+	cgroup_task_t *cgt;
+	prec_t *prec;
+	char *buf;
+	size_t size;
+	uint64_t rss, swap;
+	bool rc = true;
+
+	slurm_mutex_lock(&cgroup_mutex);
+	if (!use_cgroup) {
+		slurm_mutex_unlock(&cgroup_mutex);
+		return false;
+	}
+	itr = list_iterator_create(cgroup_task_list);
+	while ((cgt = list_next(itr))) {
+		prec = &cgt->prec;
+		prec->pid = cgt->pid;
+		if (xcgroup_get_param(&cgt->cpuacct_cg, "cpuacct.stat",
+				      &buf, &size) != XCGROUP_SUCCESS) {
+			rc = false;
+			break;
+		}
+		/* in USER_HZ ticks, like /proc/<pid>/stat */
+		prec->usec = _cgroup_stat_value(buf, "user");
+		prec->ssec = _cgroup_stat_value(buf, "system");
+		xfree(buf);
+
+		if (xcgroup_get_param(&cgt->memory_cg, "memory.stat",
+				      &buf, &size) != XCGROUP_SUCCESS) {
+			rc = false;
+			break;
+		}
+		rss  = _cgroup_stat_value(buf, "rss") +
+		       _cgroup_stat_value(buf, "mapped_file");
+		swap = _cgroup_stat_value(buf, "swap");
+		prec->pages = _cgroup_stat_value(buf, "pgmajfault");
+		xfree(buf);
+		prec->rss   = rss / 1024;
+		prec->vsize = (rss + swap) / 1024;
+		_prec_tab_add(prec);
+	}
+	list_iterator_destroy(itr);
+	slurm_mutex_unlock(&cgroup_mutex);
+
+	if (!rc)
+		prec_cnt = 0;
+	return rc;
+}
+
 /*
  * _get_process_data() - Build a table of all current processes
  *
@@ -186,6 +541,9 @@ _get_offspring_data(List prec_list, prec_t *ancestor, pid_t pid) {
  *
  * THREADSAFE! Only one thread ever gets here.
  *
+ * With the cgroup sampler each task is read from its own cgroups and
+ * /proc is only scanned if that fails.
+ *
  * Assumption:
  *    Any file with a name of the form "/proc/[0-9]+/stat"
  *    is a Linux-style stat entry. We disregard the data if they look
@@ -196,20 +554,18 @@ static void _get_process_data(void)
 	static	int	slash_proc_open = 0;
 
 	struct	dirent *slash_proc_entry;
-	char		*iptr = NULL, *optr = NULL;
-	FILE		*stat_fp = NULL;
-	char		proc_stat_file[256];	/* Allow ~20x extra length */
-	List prec_list = NULL;
+	char		*iptr = NULL;
 	pid_t *pids = NULL;
 	int npids = 0;
 	uint32_t total_job_mem = 0, total_job_vsize = 0;
-	int		i, fd;
+	int		i;
+	pid_t		pid;
 	ListIterator itr;
-	ListIterator itr2;
-	prec_t *prec = NULL;
+	prec_t prec;
 	struct jobacctinfo *jobacct = NULL;
 	static int processing = 0;
 	long		hertz;
+	DEF_TIMERS;
 
 	if (!pgid_plugin && (cont_id == (uint64_t)NO_VAL)) {
 		debug("cont_id hasn't been set yet not running poll");
@@ -221,7 +577,8 @@ static void _get_process_data(void)
 		return;
 	}
 	processing = 1;
-	prec_list = list_create(_destroy_prec);
+	START_TIMER;
+	prec_cnt = 0;
 
 	hertz = sysconf(_SC_CLK_TCK);
 	if (hertz < 1) {
@@ -229,41 +586,22 @@ static void _get_process_data(void)
 		hertz = 100;	/* default on many systems */
 	}
 
-	if(!pgid_plugin) {
+	slurm_mutex_lock(&reading_mutex);
+	proc_tick++;
+	proc_opened = proc_closed = 0;
+	if (use_cgroup && _get_cgroup_data()) {
+		/* one record per task read from its cgroups, the
+		 * processes themselves are never looked at */
+	} else if(!pgid_plugin) {
 		/* get only the processes in the proctrack container */
 		slurm_container_get_pids(cont_id, &pids, &npids);
 		if(!npids) {
 			debug4("no pids in this container %"PRIu64"", cont_id);
-			goto finished;
-		}
-		for (i = 0; i < npids; i++) {
-			snprintf(proc_stat_file, 256,
-				 "/proc/%d/stat", pids[i]);
-			if ((stat_fp = fopen(proc_stat_file, "r"))==NULL)
-				continue;  /* Assume the process went away */
-			/*
-			 * Close the file on exec() of user tasks.
-			 *
-			 * NOTE: If we fork() slurmstepd after the
-			 * fopen() above and before the fcntl() below,
-			 * then the user task may have this extra file
-			 * open, which can cause problems for
-			 * checkpoint/restart, but this should be a very rare
-			 * problem in practice.
-			 */
-			fd = fileno(stat_fp);
-			fcntl(fd, F_SETFD, FD_CLOEXEC);
-
-			prec = xmalloc(sizeof(prec_t));
-			if (_get_process_data_line(fd, prec))
-				list_append(prec_list, prec);
-			else
-				xfree(prec);
-			fclose(stat_fp);
 		}
+		for (i = 0; i < npids; i++)
+			_proc_sample(pids[i]);
+		xfree(pids);
 	} else {
-		slurm_mutex_lock(&reading_mutex);
-
 		if (slash_proc_open) {
 			rewinddir(slash_proc);
 		} else {
@@ -275,63 +613,29 @@ static void _get_process_data(void)
 			}
 			slash_proc_open=1;
 		}
-		strcpy(proc_stat_file, "/proc/");
 
 		while ((slash_proc_entry = readdir(slash_proc))) {
-
-			/* Save a few cyles by simulating
-			   strcat(statFileName, slash_proc_entry->d_name);
-			   strcat(statFileName, "/stat");
-			   while checking for a numeric filename (which really
-			   should be a pid).
-			*/
-			optr = proc_stat_file + sizeof("/proc");
+			/* only numeric filenames (which really should
+			 * be pids) */
 			iptr = slash_proc_entry->d_name;
-			i = 0;
+			pid = 0;
 			do {
-				if((*iptr < '0')
-				   || ((*optr++ = *iptr++) > '9')) {
-					i = -1;
+				if ((*iptr < '0') || (*iptr > '9')) {
+					pid = 0;
 					break;
 				}
+				pid = pid * 10 + (*iptr++ - '0');
 			} while (*iptr);
 
-			if(i == -1)
-				continue;
-			iptr = (char*)"/stat";
-
-			do {
-				*optr++ = *iptr++;
-			} while (*iptr);
-			*optr = 0;
-
-			if ((stat_fp = fopen(proc_stat_file,"r"))==NULL)
-				continue;  /* Assume the process went away */
-			/*
-			 * Close the file on exec() of user tasks.
-			 *
-			 * NOTE: If we fork() slurmstepd after the
-			 * fopen() above and before the fcntl() below,
-			 * then the user task may have this extra file
-			 * open, which can cause problems for
-			 * checkpoint/restart, but this should be a very rare
-			 * problem in practice.
-			 */
-			fd = fileno(stat_fp);
-			fcntl(fd, F_SETFD, FD_CLOEXEC);
-
-			prec = xmalloc(sizeof(prec_t));
-			if (_get_process_data_line(fd, prec))
-				list_append(prec_list, prec);
-			else
-				xfree(prec);
-			fclose(stat_fp);
+			if (pid > 0)
+				_proc_sample(pid);
 		}
-		slurm_mutex_unlock(&reading_mutex);
-
 	}
+	/* forget the pids which were not listed this time */
+	_proc_purge();
+	slurm_mutex_unlock(&reading_mutex);
 
-	if (!list_count(prec_list)) {
+	if (!prec_cnt) {
 		goto finished;	/* We have no business being here! */
 	}
 
@@ -343,37 +647,37 @@ static void _get_process_data(void)
 
 	itr = list_iterator_create(task_list);
 	while((jobacct = list_next(itr))) {
-		itr2 = list_iterator_create(prec_list);
-		while((prec = list_next(itr2))) {
-			if (prec->pid == jobacct->pid) {
+		for (i = 0; i < prec_cnt; i++) {
+			if (prec_tab[i]->pid != jobacct->pid)
+				continue;
+			/* records are kept from one tick to the next,
+			 * sum the descendents into a copy */
+			prec = *prec_tab[i];
 #if _DEBUG
-				info("pid:%u ppid:%u rss:%d KB",
-				     prec->pid, prec->ppid, prec->rss);
+			info("pid:%u ppid:%u rss:%d KB",
+			     prec.pid, prec.ppid, prec.rss);
 #endif
-				/* find all my descendents */
-				_get_offspring_data(prec_list,
-						    prec, prec->pid);
-				/* tally their usage */
-				jobacct->max_rss = jobacct->tot_rss =
-					MAX(jobacct->max_rss, prec->rss);
-				total_job_mem += prec->rss;
-				jobacct->max_vsize = jobacct->tot_vsize =
-					MAX(jobacct->max_vsize, prec->vsize);
-				total_job_vsize += prec->vsize;
-				jobacct->max_pages = jobacct->tot_pages =
-					MAX(jobacct->max_pages, prec->pages);
-				jobacct->min_cpu = jobacct->tot_cpu =
-					MAX(jobacct->min_cpu,
-					    (prec->ssec / hertz +
-					     prec->usec / hertz));
-				debug2("%d mem size %u %u time %u(%u+%u)",
-				       jobacct->pid, jobacct->max_rss,
-				       jobacct->max_vsize, jobacct->tot_cpu,
-				       prec->usec, prec->ssec);
-				break;
-			}
+			/* find all my descendents */
+			_get_offspring_data(&prec, prec.pid);
+			/* tally their usage */
+			jobacct->max_rss = jobacct->tot_rss =
+				MAX(jobacct->max_rss, prec.rss);
+			total_job_mem += prec.rss;
+			jobacct->max_vsize = jobacct->tot_vsize =
+				MAX(jobacct->max_vsize, prec.vsize);
+			total_job_vsize += prec.vsize;
+			jobacct->max_pages = jobacct->tot_pages =
+				MAX(jobacct->max_pages, prec.pages);
+			jobacct->min_cpu = jobacct->tot_cpu =
+				MAX(jobacct->min_cpu,
+				    (prec.ssec / hertz +
+				     prec.usec / hertz));
+			debug2("%d mem size %u %u time %u(%u+%u)",
+			       jobacct->pid, jobacct->max_rss,
+			       jobacct->max_vsize, jobacct->tot_cpu,
+			       prec.usec, prec.ssec);
+			break;
 		}
-		list_iterator_destroy(itr2);
 	}
 	list_iterator_destroy(itr);
 	slurm_mutex_unlock(&jobacct_lock);
@@ -414,7 +718,13 @@ static void _get_process_data(void)
 	}
 
 finished:
-	list_destroy(prec_list);
+	END_TIMER;
+	tick_cnt++;
+	tick_usec_tot += DELTA_TIMER;
+	tick_usec_max = MAX(tick_usec_max, DELTA_TIMER);
+	debug2("jobacct-gather: sampled %d records (%d pids opened, "
+	       "%d closed) in %s", prec_cnt, proc_opened, proc_closed,
+	       TIME_STR);
 	processing = 0;
 	return;
 }
@@ -491,66 +801,213 @@ static int _is_a_lwp(uint32_t pid) {
 
 }
 
-/* _get_process_data_line() - get line of data from /proc/<pid>/stat
+/* _get_process_data_line() - parse the content of /proc/<pid>/stat
  *
- * IN:	in - input file descriptor
- * OUT:	prec - the destination for the data
+ * IN:	sbuf - NUL terminated file content
+ * OUT:	prec - the destination for the data, except its pid
  *
  * RETVAL:	==0 - no valid data
  * 		!=0 - data are valid
  *
- * Based upon stat2proc() from the ps command. It can handle arbitrary executable
- * file basenames for `cmd', i.e. those with embedded whitespace or embedded ')'s.
- * Such names confuse %s (see scanf(3)), so the string is split and %39c is used
- * instead. (except for embedded ')' "(%[^)]c)" would work.
+ * The executable name may contain whitespace or ')', so the fields are
+ * counted from the last ')' in the line as stat2proc() from the ps command
+ * does. Only the first 22 fields after it are looked at, converting just
+ * the ones SLURM records, which is much cheaper than sscanf().
  */
-static int _get_process_data_line(int in, prec_t *prec) {
-	char sbuf[256], *tmp;
-	int num_read, nvals;
-	char cmd[40], state[1];
-	int ppid, pgrp, session, tty_nr, tpgid;
-	long unsigned flags, minflt, cminflt, majflt, cmajflt;
-	long unsigned utime, stime, starttime, vsize;
-	long int cutime, cstime, priority, nice, timeout, itrealvalue, rss;
-
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
-		return 0;
-	sbuf[num_read] = '\0';
+static int _get_process_data_line(char *sbuf, prec_t *prec) {
+	char *p;
+	long val;
+	int field, neg;
 
-	tmp = strrchr(sbuf, ')');	/* split into "PID (cmd" and "<rest>" */
-	*tmp = '\0';			/* replace trailing ')' with NUL */
-	/* parse these two strings separately, skipping the leading "(". */
-	nvals = sscanf(sbuf, "%d (%39c", &prec->pid, cmd);
-	if (nvals < 2)
+	p = strrchr(sbuf, ')');
+	if (!p || (p[1] != ' ') || !p[2])
 		return 0;
+	p += 3;				/* skip ") " and the state */
+
+	for (field = 1; field < 22; field++) {
+		if (*p != ' ')
+			return 0;
+		p++;
+		neg = (*p == '-');
+		if (neg)
+			p++;
+		if ((*p < '0') || (*p > '9'))
+			return 0;
+		for (val = 0; (*p >= '0') && (*p <= '9'); p++)
+			val = val * 10 + (*p - '0');
+		if (neg)
+			val = -val;
+
+		switch (field) {
+		case 1:
+			prec->ppid  = val;
+			break;
+		case 9:
+			prec->pages = val;		/* majflt */
+			break;
+		case 11:
+			prec->usec  = val;		/* utime */
+			break;
+		case 12:
+			prec->ssec  = val;		/* stime */
+			break;
+		case 20:
+			prec->vsize = (unsigned long) val / 1024;
+			break;				/* bytes to KB */
+		case 21:
+			if (val < 0)
+				return 0;
+			prec->rss   = val * getpagesize() / 1024;
+			break;				/* pages to KB */
+		}
+	}
+	return 1;
+}
 
-	nvals = sscanf(tmp + 2,		/* skip space after ')' too */
-		"%c %d %d %d %d %d "
-		"%lu %lu %lu %lu %lu "
-		"%lu %lu %ld %ld %ld %ld "
-		"%ld %ld %lu %lu %ld",
-		state, &ppid, &pgrp, &session, &tty_nr, &tpgid,
-		&flags, &minflt, &cminflt, &majflt, &cmajflt,
-		&utime, &stime, &cutime, &cstime, &priority, &nice,
-		&timeout, &itrealvalue, &starttime, &vsize, &rss);
-	/* There are some additional fields, which we do not scan or use */
-	if ((nvals < 22) || (rss < 0))
-		return 0;
+static void _prec_tab_add(prec_t *prec)
+{
+	if (prec_cnt == prec_size) {
+		prec_size = prec_size ? (prec_size * 2) : 64;
+		xrealloc(prec_tab, prec_size * sizeof(prec_t *));
+	}
+	prec_tab[prec_cnt++] = prec;
+}
 
-	/* If current pid corresponds to a Light Weight Process (Thread POSIX) */
-	/* skip it, we will only account the original process (pid==tgid) */
-	if (_is_a_lwp(prec->pid) > 0)
-  		return 0;
-
-	/* Copy the values that slurm records into our data structure */
-	prec->ppid  = ppid;
-	prec->pages = majflt;
-	prec->usec  = utime;
-	prec->ssec  = stime;
-	prec->vsize = vsize / 1024;		 /* convert from bytes to KB */
-	prec->rss   = rss * getpagesize() / 1024;/* convert from pages to KB */
-	return 1;
+/*
+ * The /proc reader keeps an entry per pid listed at the last tick, with
+ * /proc/<pid>/stat left open so each tick only costs a pread() for the
+ * pids already known. Files are opened and closed only for the pids which
+ * appeared or disappeared since the last tick.
+ */
+static proc_entry_t *_proc_find(pid_t pid)
+{
+	proc_entry_t *entry = proc_hash[pid % PROC_HASH_SIZE];
+
+	while (entry && (entry->pid != pid))
+		entry = entry->next;
+	return entry;
+}
+
+static proc_entry_t *_proc_open(pid_t pid)
+{
+	proc_entry_t *entry = xmalloc(sizeof(proc_entry_t));
+	char proc_stat_file[64];
+
+	entry->pid = pid;
+	entry->fd = -1;
+	entry->prec.pid = pid;
+	/* If the pid corresponds to a Light Weight Process (Thread POSIX)
+	 * skip it, we only account the original process (pid==tgid) */
+	entry->lwp = (_is_a_lwp(pid) > 0);
+	if (!entry->lwp && (proc_fd_cnt < PROC_MAX_FDS)) {
+		snprintf(proc_stat_file, sizeof(proc_stat_file),
+			 "/proc/%d/stat", pid);
+		entry->fd = open(proc_stat_file, O_RDONLY);
+		if (entry->fd >= 0) {
+			/* Close the file on exec() of user tasks */
+			fcntl(entry->fd, F_SETFD, FD_CLOEXEC);
+			proc_fd_cnt++;
+		}
+	}
+	entry->next = proc_hash[pid % PROC_HASH_SIZE];
+	proc_hash[pid % PROC_HASH_SIZE] = entry;
+	proc_opened++;
+	return entry;
+}
+
+static void _proc_close(proc_entry_t **entry_ptr)
+{
+	proc_entry_t *entry = *entry_ptr;
+
+	*entry_ptr = entry->next;
+	if (entry->fd >= 0) {
+		close(entry->fd);
+		proc_fd_cnt--;
+	}
+	xfree(entry);
+	proc_closed++;
+}
+
+/* Read the current values of a process in its entry's prec */
+static bool _proc_read(proc_entry_t *entry)
+{
+	char proc_stat_file[64];
+	int fd, len;
+
+	if (entry->fd >= 0) {
+		len = pread(entry->fd, proc_buf, sizeof(proc_buf) - 1, 0);
+	} else {
+		snprintf(proc_stat_file, sizeof(proc_stat_file),
+			 "/proc/%d/stat", entry->pid);
+		if ((fd = open(proc_stat_file, O_RDONLY)) < 0)
+			return false;	/* Assume the process went away */
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+		len = read(fd, proc_buf, sizeof(proc_buf) - 1);
+		close(fd);
+	}
+	if (len <= 0)
+		return false;
+	proc_buf[len] = '\0';
+	return _get_process_data_line(proc_buf, &entry->prec);
+}
+
+/* Sample a pid listed at this tick and add it to prec_tab[] */
+static void _proc_sample(pid_t pid)
+{
+	proc_entry_t **entry_ptr;
+	proc_entry_t *entry = _proc_find(pid);
+	bool reused = false;
+
+	if (entry && (entry->tick == proc_tick))
+		return;				/* listed twice */
+	if (!entry)
+		entry = _proc_open(pid);
+	else
+		reused = true;
+	entry->tick = proc_tick;
+	if (entry->lwp)
+		return;
+	if (_proc_read(entry)) {
+		_prec_tab_add(&entry->prec);
+		return;
+	}
+
+	entry_ptr = &proc_hash[pid % PROC_HASH_SIZE];
+	while (*entry_ptr != entry)
+		entry_ptr = &(*entry_ptr)->next;
+	_proc_close(entry_ptr);
+	/* the pid may belong to a new process since the last tick */
+	if (reused)
+		_proc_sample(pid);
+}
+
+/* Forget the pids which were not listed at this tick */
+static void _proc_purge(void)
+{
+	proc_entry_t **entry_ptr;
+	int i;
+
+	for (i = 0; i < PROC_HASH_SIZE; i++) {
+		entry_ptr = &proc_hash[i];
+		while (*entry_ptr) {
+			if ((*entry_ptr)->tick != proc_tick)
+				_proc_close(entry_ptr);
+			else
+				entry_ptr = &(*entry_ptr)->next;
+		}
+	}
+}
+
+static void _proc_fini(void)
+{
+	int i;
+
+	slurm_mutex_lock(&reading_mutex);
+	for (i = 0; i < PROC_HASH_SIZE; i++) {
+		while (proc_hash[i])
+			_proc_close(&proc_hash[i]);
+	}
+	slurm_mutex_unlock(&reading_mutex);
 }
 
 static void _task_sleep(int rem)
@@ -583,11 +1040,19 @@ static void *_watch_tasks(void *arg)
 }
 
 
-static void _destroy_prec(void *object)
+/* The tasks are gone, remove their cgroups (the step ones are left to
+ * the plugin that created them) */
+static void _destroy_cgroup_task(void *object)
 {
-	prec_t *prec = (prec_t *)object;
-	xfree(prec);
-	return;
+	cgroup_task_t *cgt = (cgroup_task_t *)object;
+
+	xcgroup_delete(&cgt->cpuacct_cg);
+	xcgroup_destroy(&cgt->cpuacct_cg);
+	if (cgt->memory_cg.path) {
+		xcgroup_delete(&cgt->memory_cg);
+		xcgroup_destroy(&cgt->memory_cg);
+	}
+	xfree(cgt);
 }
 
 /*
@@ -682,6 +1147,7 @@ extern int jobacct_gather_p_startpoll(uint16_t frequency)
 	jobacct_shutdown = false;
 
 	task_list = list_create(jobacct_common_free_jobacct);
+	_cgroup_init();
 
 	if (frequency == 0) {	/* don't want dynamic monitoring? */
 		debug2("jobacct-gather LINUX dynamic logging disabled");
@@ -721,7 +1187,14 @@ extern int jobacct_gather_p_endpoll()
 		(void) closedir(slash_proc);
 		slurm_mutex_unlock(&reading_mutex);
 	}
+	_proc_fini();
+	_cgroup_fini();
 
+	if (tick_cnt) {
+		verbose("jobacct-gather: %u samples taken in %"PRIu64" usec "
+			"on average, %u usec at most", tick_cnt,
+			tick_usec_tot / tick_cnt, tick_usec_max);
+	}
 
 	return SLURM_SUCCESS;
 }
@@ -790,6 +1263,7 @@ extern int jobacct_gather_p_add_task(pid_t pid, jobacct_id_t *jobacct_id)
 {
 	if (jobacct_shutdown)
 		return SLURM_ERROR;
+	_cgroup_add_task(pid, jobacct_id);
 	return jobacct_common_add_task(pid, jobacct_id, task_list);
 }
 
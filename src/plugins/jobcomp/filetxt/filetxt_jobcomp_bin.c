@@ -0,0 +1,865 @@
+/*****************************************************************************\
+ *  filetxt_jobcomp_bin.c - binary job completion log of jobcomp/filetxt.
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/common/fd.h"
+#include "src/common/log.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "filetxt_jobcomp_bin.h"
+
+#define USE_ISO8601 1
+
+#define JOB_FORMAT "JobId=%lu UserId=%s(%lu) GroupId=%s(%lu) Name=%s JobState=%s Partition=%s "\
+		"TimeLimit=%s StartTime=%s EndTime=%s NodeList=%s NodeCnt=%u ProcCnt=%u "\
+		"WorkDir=%s %s\n"
+
+#define LOG_MAGIC		0x534a434c	/* "SJCL" */
+#define LOG_VERSION		1
+#define LOG_HDR_SIZE		8
+#define LOG_REC_FIXED_SIZE	52
+#define LOG_REC_MAX_SIZE	(1024 * 1024)
+#define LOG_REC_STR_CNT		7
+
+#define INDEX_MAGIC		0x534a4349	/* "SJCI" */
+#define INDEX_VERSION		1
+#define INDEX_HDR_SIZE		14
+#define INDEX_BLOCK_HDR_SIZE	20
+#define INDEX_ENTRY_SIZE	16
+
+/* fixed size part of a log record, followed by LOG_REC_STR_CNT
+ * strings each ending with '\0' */
+typedef struct {
+	uint32_t rec_size;	/* of the whole record */
+	uint32_t job_id;
+	uint32_t user_id;
+	uint32_t group_id;
+	uint32_t job_state;
+	uint32_t time_limit;
+	uint64_t start_time;
+	uint64_t end_time;
+	uint32_t node_cnt;
+	uint32_t cpus;
+	uint32_t null_mask;	/* bit set for each string that is NULL */
+} log_rec_t;
+
+typedef struct {
+	uint32_t job_id;
+	uint32_t end_time;
+	uint64_t offset;
+} index_entry_t;
+
+typedef struct {
+	uint32_t entry_cnt;
+	uint32_t min_end;
+	uint32_t max_end;
+	uint64_t data_end;	/* log offset after the last record */
+} index_block_t;
+
+static int            index_fd = -1;
+static uint64_t       log_offset = 0;	/* where the next record goes */
+static index_entry_t *pending = NULL;	/* records not in a block yet */
+static uint32_t       pending_alloc = 0;
+static uint32_t       pending_cnt = 0;
+static time_t         pending_time = 0;	/* last block written */
+
+static void _pack_u32(char *p, uint32_t val)
+{
+	val = htonl(val);
+	memcpy(p, &val, 4);
+}
+
+static uint32_t _unpack_u32(const char *p)
+{
+	uint32_t val;
+
+	memcpy(&val, p, 4);
+	return ntohl(val);
+}
+
+static void _pack_u64(char *p, uint64_t val)
+{
+	_pack_u32(p, (uint32_t)(val >> 32));
+	_pack_u32(p + 4, (uint32_t)val);
+}
+
+static uint64_t _unpack_u64(const char *p)
+{
+	return ((uint64_t)_unpack_u32(p) << 32) | _unpack_u32(p + 4);
+}
+
+static void _pack_log_hdr(char *p)
+{
+	uint16_t u16 = htons(LOG_VERSION);
+
+	_pack_u32(p, LOG_MAGIC);
+	memcpy(p + 4, &u16, 2);
+	memset(p + 6, 0, 2);
+}
+
+static void _pack_index_hdr(char *p, ino_t log_inode)
+{
+	uint16_t u16 = htons(INDEX_VERSION);
+
+	_pack_u32(p, INDEX_MAGIC);
+	memcpy(p + 4, &u16, 2);
+	_pack_u64(p + 6, (uint64_t)log_inode);
+}
+
+static void _unpack_log_rec(const char *p, log_rec_t *rec)
+{
+	rec->rec_size   = _unpack_u32(p);
+	rec->job_id     = _unpack_u32(p + 4);
+	rec->user_id    = _unpack_u32(p + 8);
+	rec->group_id   = _unpack_u32(p + 12);
+	rec->job_state  = _unpack_u32(p + 16);
+	rec->time_limit = _unpack_u32(p + 20);
+	rec->start_time = _unpack_u64(p + 24);
+	rec->end_time   = _unpack_u64(p + 32);
+	rec->node_cnt   = _unpack_u32(p + 40);
+	rec->cpus       = _unpack_u32(p + 44);
+	rec->null_mask  = _unpack_u32(p + 48);
+}
+
+static void _unpack_block(const char *p, index_block_t *block)
+{
+	block->entry_cnt = _unpack_u32(p);
+	block->min_end   = _unpack_u32(p + 4);
+	block->max_end   = _unpack_u32(p + 8);
+	block->data_end  = _unpack_u64(p + 12);
+}
+
+static void _unpack_entry(const char *p, index_entry_t *entry)
+{
+	entry->job_id   = _unpack_u32(p);
+	entry->end_time = _unpack_u32(p + 4);
+	entry->offset   = _unpack_u64(p + 8);
+}
+
+/* RET true if a record of rec_size fits at offset of a log of log_size */
+static bool _rec_fits(uint32_t rec_size, uint64_t offset, uint64_t log_size)
+{
+	if ((rec_size < LOG_REC_FIXED_SIZE) || (rec_size > LOG_REC_MAX_SIZE))
+		return false;
+	return (offset + rec_size) <= log_size;
+}
+
+static int _write_all(int fd, char *buf, int len)
+{
+	int rc;
+
+	while (len > 0) {
+		rc = write(fd, buf, len);
+		if (rc < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			return SLURM_ERROR;
+		}
+		buf += rc;
+		len -= rc;
+	}
+	return SLURM_SUCCESS;
+}
+
+static int _read_all(int fd, char *buf, int len, off_t offset)
+{
+	int rc;
+
+	while (len > 0) {
+		rc = pread(fd, buf, len, offset);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return SLURM_ERROR;
+		}
+		if (rc == 0)
+			return SLURM_ERROR;
+		buf += rc;
+		len -= rc;
+		offset += rc;
+	}
+	return SLURM_SUCCESS;
+}
+
+/* This is a variation of slurm_make_time_str() in src/common/parse_time.h
+ * This version uses ISO8601 format by default. */
+static void _make_time_str (time_t *time, char *string, int size)
+{
+	struct tm time_tm;
+
+	localtime_r(time, &time_tm);
+	if ( *time == (time_t) 0 ) {
+		snprintf(string, size, "Unknown");
+	} else {
+#if USE_ISO8601
+		/* Format YYYY-MM-DDTHH:MM:SS, ISO8601 standard format,
+		 * NOTE: This is expected to break Maui, Moab and LSF
+		 * schedulers management of SLURM. */
+		snprintf(string, size,
+			"%4.4u-%2.2u-%2.2uT%2.2u:%2.2u:%2.2u",
+			(time_tm.tm_year + 1900), (time_tm.tm_mon+1),
+			time_tm.tm_mday, time_tm.tm_hour, time_tm.tm_min,
+			time_tm.tm_sec);
+#else
+		/* Format MM/DD-HH:MM:SS */
+		snprintf(string, size,
+			"%2.2u/%2.2u-%2.2u:%2.2u:%2.2u",
+			(time_tm.tm_mon+1), time_tm.tm_mday,
+			time_tm.tm_hour, time_tm.tm_min, time_tm.tm_sec);
+
+#endif
+	}
+}
+
+extern void filetxt_jobcomp_rec_to_line(filetxt_jobcomp_rec_t *rec,
+					char *line, int size)
+{
+	char start_str[32], end_str[32], lim_str[32];
+
+	if (rec->time_limit == INFINITE)
+		strcpy(lim_str, "UNLIMITED");
+	else {
+		snprintf(lim_str, sizeof(lim_str), "%lu",
+			 (unsigned long) rec->time_limit);
+	}
+	_make_time_str(&rec->start_time, start_str, sizeof(start_str));
+	_make_time_str(&rec->end_time, end_str, sizeof(end_str));
+
+	snprintf(line, size, JOB_FORMAT,
+		 (unsigned long) rec->job_id, rec->user_name,
+		 (unsigned long) rec->user_id, rec->group_name,
+		 (unsigned long) rec->group_id, rec->name,
+		 job_state_string(rec->job_state), rec->partition, lim_str,
+		 start_str, end_str, rec->nodes, rec->node_cnt,
+		 rec->cpus, rec->work_dir, rec->select_info);
+}
+
+static void _add_pending(uint32_t job_id, time_t end_time, uint64_t offset)
+{
+	if (pending_cnt >= pending_alloc) {
+		pending_alloc += FILETXT_BIN_FLUSH_CNT;
+		xrealloc(pending, sizeof(index_entry_t) * pending_alloc);
+	}
+	pending[pending_cnt].job_id = job_id;
+	pending[pending_cnt].end_time = (uint32_t) end_time;
+	pending[pending_cnt].offset = offset;
+	pending_cnt++;
+}
+
+static int _sort_entries(const void *a, const void *b)
+{
+	const index_entry_t *entry_a = a;
+	const index_entry_t *entry_b = b;
+
+	if (entry_a->job_id != entry_b->job_id)
+		return (entry_a->job_id < entry_b->job_id) ? -1 : 1;
+	if (entry_a->offset != entry_b->offset)
+		return (entry_a->offset < entry_b->offset) ? -1 : 1;
+	return 0;
+}
+
+/* Write the pending entries out as a block of the index */
+static void _flush_pending(void)
+{
+	char *buf, *p;
+	uint32_t i, min_end = 0, max_end = 0;
+	int len;
+
+	pending_time = time(NULL);
+	if (!pending_cnt || (index_fd < 0)) {
+		pending_cnt = 0;
+		return;
+	}
+
+	qsort(pending, pending_cnt, sizeof(index_entry_t), _sort_entries);
+	len = INDEX_BLOCK_HDR_SIZE + (pending_cnt * INDEX_ENTRY_SIZE);
+	buf = xmalloc(len);
+	p = buf + INDEX_BLOCK_HDR_SIZE;
+	for (i = 0; i < pending_cnt; i++) {
+		if (!i || (pending[i].end_time < min_end))
+			min_end = pending[i].end_time;
+		if (pending[i].end_time > max_end)
+			max_end = pending[i].end_time;
+		_pack_u32(p, pending[i].job_id);
+		_pack_u32(p + 4, pending[i].end_time);
+		_pack_u64(p + 8, pending[i].offset);
+		p += INDEX_ENTRY_SIZE;
+	}
+	_pack_u32(buf, pending_cnt);
+	_pack_u32(buf + 4, min_end);
+	_pack_u32(buf + 8, max_end);
+	_pack_u64(buf + 12, log_offset);
+
+	/* A torn block only costs readers the blocks after it, they read
+	 * the log from the last good block on. */
+	if (_write_all(index_fd, buf, len) != SLURM_SUCCESS)
+		error("jobcomp/filetxt: can't write index: %m");
+	xfree(buf);
+	pending_cnt = 0;
+}
+
+/* Open the index of the log, dropping anything in it that is not
+ * whole, and index the records written after its last block.
+ * RET log offset up to which the log holds whole records */
+static uint64_t _index_open(int log_fd, char *log_file, struct stat *log_st)
+{
+	char hdr[INDEX_HDR_SIZE], buf[INDEX_HDR_SIZE];
+	char block_buf[INDEX_BLOCK_HDR_SIZE], rec_buf[LOG_REC_FIXED_SIZE];
+	char *index_file;
+	struct stat st;
+	index_block_t block;
+	log_rec_t rec;
+	uint64_t data_end = LOG_HDR_SIZE, index_end = INDEX_HDR_SIZE, offset;
+
+	index_file = xstrdup_printf("%s%s", log_file,
+				    FILETXT_BIN_INDEX_SUFFIX);
+	index_fd = open(index_file, O_RDWR | O_CREAT, 0644);
+	if (index_fd < 0) {
+		error("jobcomp/filetxt: can't open %s: %m", index_file);
+		xfree(index_file);
+		return log_st->st_size;
+	}
+	fd_set_close_on_exec(index_fd);
+	fstat(index_fd, &st);
+
+	_pack_index_hdr(hdr, log_st->st_ino);
+	if ((st.st_size < INDEX_HDR_SIZE)
+	    || (_read_all(index_fd, buf, INDEX_HDR_SIZE, 0) != SLURM_SUCCESS)
+	    || memcmp(hdr, buf, INDEX_HDR_SIZE)) {
+		if (st.st_size)
+			info("jobcomp/filetxt: rebuilding index %s",
+			     index_file);
+		if (ftruncate(index_fd, 0)
+		    || (_write_all(index_fd, hdr, INDEX_HDR_SIZE)
+			!= SLURM_SUCCESS))
+			error("jobcomp/filetxt: can't write %s: %m",
+			      index_file);
+	} else {
+		while ((index_end + INDEX_BLOCK_HDR_SIZE) <= st.st_size) {
+			if (_read_all(index_fd, block_buf,
+				      INDEX_BLOCK_HDR_SIZE, index_end)
+			    != SLURM_SUCCESS)
+				break;
+			_unpack_block(block_buf, &block);
+			if ((index_end + INDEX_BLOCK_HDR_SIZE
+			     + ((uint64_t) block.entry_cnt * INDEX_ENTRY_SIZE))
+			    > st.st_size)
+				break;
+			if ((block.data_end < data_end)
+			    || (block.data_end > log_st->st_size))
+				break;
+			index_end += INDEX_BLOCK_HDR_SIZE
+				+ ((uint64_t) block.entry_cnt
+				   * INDEX_ENTRY_SIZE);
+			data_end = block.data_end;
+		}
+		if ((index_end < st.st_size) && ftruncate(index_fd, index_end))
+			error("jobcomp/filetxt: can't truncate %s: %m",
+			      index_file);
+	}
+	lseek(index_fd, 0, SEEK_END);
+	xfree(index_file);
+
+	/* index what was written after the last block */
+	for (offset = data_end; (offset + LOG_REC_FIXED_SIZE)
+		     <= log_st->st_size; offset += rec.rec_size) {
+		if (_read_all(log_fd, rec_buf, LOG_REC_FIXED_SIZE, offset)
+		    != SLURM_SUCCESS)
+			break;
+		_unpack_log_rec(rec_buf, &rec);
+		if (!_rec_fits(rec.rec_size, offset, log_st->st_size))
+			break;
+		_add_pending(rec.job_id, (time_t) rec.end_time, offset);
+	}
+	return offset;
+}
+
+extern int filetxt_jobcomp_bin_open(int log_fd, char *log_file,
+				    bool want_binary)
+{
+	char hdr[LOG_HDR_SIZE], buf[LOG_HDR_SIZE];
+	struct stat st;
+
+	filetxt_jobcomp_bin_close();
+
+	if (fstat(log_fd, &st)) {
+		error("jobcomp/filetxt: can't stat %s: %m", log_file);
+		return -1;
+	}
+	_pack_log_hdr(hdr);
+	if (st.st_size == 0) {
+		if (!want_binary)
+			return 0;
+		if (_write_all(log_fd, hdr, LOG_HDR_SIZE) != SLURM_SUCCESS) {
+			error("jobcomp/filetxt: can't write %s: %m", log_file);
+			return -1;
+		}
+		st.st_size = LOG_HDR_SIZE;
+	} else if ((st.st_size < LOG_HDR_SIZE)
+		   || (_read_all(log_fd, buf, LOG_HDR_SIZE, 0)
+		       != SLURM_SUCCESS)
+		   || (_unpack_u32(buf) != LOG_MAGIC)) {
+		if (want_binary)
+			error("jobcomp/filetxt: %s is a text log, "
+			      "not writing it in binary", log_file);
+		return 0;
+	} else if (memcmp(hdr, buf, LOG_HDR_SIZE)) {
+		error("jobcomp/filetxt: %s is a binary log of an unknown "
+		      "version", log_file);
+		return -1;
+	} else if (!want_binary)
+		info("jobcomp/filetxt: %s is a binary log, "
+		     "continuing it in binary", log_file);
+
+	log_offset = _index_open(log_fd, log_file, &st);
+	if (log_offset < (uint64_t) st.st_size) {
+		error("jobcomp/filetxt: dropping %"PRIu64" bytes of partial "
+		      "record at the end of %s",
+		      (uint64_t) st.st_size - log_offset, log_file);
+		if (ftruncate(log_fd, log_offset))
+			error("jobcomp/filetxt: can't truncate %s: %m",
+			      log_file);
+	}
+	_flush_pending();
+
+	return 1;
+}
+
+extern int filetxt_jobcomp_bin_write(int log_fd, filetxt_jobcomp_rec_t *rec)
+{
+	char *strs[LOG_REC_STR_CNT];
+	char *buf, *p;
+	uint32_t null_mask = 0, rec_size = LOG_REC_FIXED_SIZE;
+	int i, len[LOG_REC_STR_CNT];
+
+	strs[0] = rec->user_name;
+	strs[1] = rec->group_name;
+	strs[2] = rec->name;
+	strs[3] = rec->partition;
+	strs[4] = rec->nodes;
+	strs[5] = rec->work_dir;
+	strs[6] = rec->select_info;
+	for (i = 0; i < LOG_REC_STR_CNT; i++) {
+		if (!strs[i]) {
+			null_mask |= (1 << i);
+			strs[i] = "";
+		}
+		len[i] = strlen(strs[i]) + 1;
+		rec_size += len[i];
+	}
+	if (rec_size > LOG_REC_MAX_SIZE) {
+		error("jobcomp/filetxt: record of job %u too large",
+		      rec->job_id);
+		return SLURM_ERROR;
+	}
+
+	buf = xmalloc(rec_size);
+	_pack_u32(buf, rec_size);
+	_pack_u32(buf + 4, rec->job_id);
+	_pack_u32(buf + 8, rec->user_id);
+	_pack_u32(buf + 12, rec->group_id);
+	_pack_u32(buf + 16, rec->job_state);
+	_pack_u32(buf + 20, rec->time_limit);
+	_pack_u64(buf + 24, (uint64_t) rec->start_time);
+	_pack_u64(buf + 32, (uint64_t) rec->end_time);
+	_pack_u32(buf + 40, rec->node_cnt);
+	_pack_u32(buf + 44, rec->cpus);
+	_pack_u32(buf + 48, null_mask);
+	p = buf + LOG_REC_FIXED_SIZE;
+	for (i = 0; i < LOG_REC_STR_CNT; i++) {
+		memcpy(p, strs[i], len[i]);
+		p += len[i];
+	}
+
+	if (_write_all(log_fd, buf, rec_size) != SLURM_SUCCESS) {
+		xfree(buf);
+		/* don't leave part of a record for the next to follow */
+		if (ftruncate(log_fd, log_offset))
+			error("jobcomp/filetxt: can't truncate log: %m");
+		return SLURM_ERROR;
+	}
+	xfree(buf);
+
+	_add_pending(rec->job_id, rec->end_time, log_offset);
+	log_offset += rec_size;
+	if ((pending_cnt >= FILETXT_BIN_FLUSH_CNT)
+	    || (difftime(time(NULL), pending_time) >= FILETXT_BIN_FLUSH_TIME))
+		_flush_pending();
+
+	return SLURM_SUCCESS;
+}
+
+extern void filetxt_jobcomp_bin_close(void)
+{
+	_flush_pending();
+	if (index_fd >= 0) {
+		close(index_fd);
+		index_fd = -1;
+	}
+	xfree(pending);
+	pending_alloc = 0;
+	log_offset = 0;
+}
+
+/* Reader side */
+
+typedef struct {
+	char *log;		/* mapped log */
+	uint64_t log_size;
+	char *index;		/* mapped index, NULL if none */
+	uint64_t index_size;
+	uint32_t *job_ids;	/* sorted job ids asked for */
+	int job_id_cnt;
+	time_t start;		/* end time window asked for, 0 if none */
+	time_t end;
+	index_entry_t *hits;	/* records to read */
+	uint32_t hit_alloc;
+	uint32_t hit_cnt;
+} bin_read_t;
+
+static int _sort_u32(const void *a, const void *b)
+{
+	uint32_t u32_a = *(const uint32_t *) a;
+	uint32_t u32_b = *(const uint32_t *) b;
+
+	if (u32_a < u32_b)
+		return -1;
+	if (u32_a > u32_b)
+		return 1;
+	return 0;
+}
+
+static int _sort_hits(const void *a, const void *b)
+{
+	const index_entry_t *entry_a = a;
+	const index_entry_t *entry_b = b;
+
+	if (entry_a->offset < entry_b->offset)
+		return -1;
+	if (entry_a->offset > entry_b->offset)
+		return 1;
+	return 0;
+}
+
+static bool _want_time(bin_read_t *bin, time_t end_time)
+{
+	if (bin->start && (end_time < bin->start))
+		return false;
+	if (bin->end && (end_time > bin->end))
+		return false;
+	return true;
+}
+
+static void _add_hit(bin_read_t *bin, uint32_t job_id, uint64_t offset)
+{
+	if (bin->hit_cnt >= bin->hit_alloc) {
+		bin->hit_alloc = bin->hit_alloc ? (bin->hit_alloc * 2) : 1024;
+		xrealloc(bin->hits, sizeof(index_entry_t) * bin->hit_alloc);
+	}
+	bin->hits[bin->hit_cnt].job_id = job_id;
+	bin->hits[bin->hit_cnt].offset = offset;
+	bin->hit_cnt++;
+}
+
+/* Find the records of a block of the index we want, entries points at
+ * the block's entries sorted by job id */
+static void _search_block(bin_read_t *bin, index_block_t *block,
+			  const char *entries)
+{
+	index_entry_t entry;
+	uint32_t i, lo, hi, mid;
+	int j;
+
+	if ((bin->start && (block->max_end < bin->start))
+	    || (bin->end && (block->min_end > bin->end)))
+		return;
+
+	if (!bin->job_id_cnt) {
+		for (i = 0; i < block->entry_cnt; i++) {
+			_unpack_entry(entries + (i * INDEX_ENTRY_SIZE),
+				      &entry);
+			if (_want_time(bin, entry.end_time))
+				_add_hit(bin, entry.job_id, entry.offset);
+		}
+		return;
+	}
+
+	for (j = 0; j < bin->job_id_cnt; j++) {
+		/* first entry of the job id */
+		lo = 0;
+		hi = block->entry_cnt;
+		while (lo < hi) {
+			mid = lo + ((hi - lo) / 2);
+			_unpack_entry(entries + (mid * INDEX_ENTRY_SIZE),
+				      &entry);
+			if (entry.job_id < bin->job_ids[j])
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		for (i = lo; i < block->entry_cnt; i++) {
+			_unpack_entry(entries + (i * INDEX_ENTRY_SIZE),
+				      &entry);
+			if (entry.job_id != bin->job_ids[j])
+				break;
+			if (_want_time(bin, entry.end_time))
+				_add_hit(bin, entry.job_id, entry.offset);
+		}
+	}
+}
+
+/* RET log offset after the last record indexed */
+static uint64_t _search_index(bin_read_t *bin, ino_t log_inode)
+{
+	char hdr[INDEX_HDR_SIZE];
+	index_block_t block;
+	uint64_t data_end = LOG_HDR_SIZE, index_end = INDEX_HDR_SIZE;
+	uint64_t block_size;
+
+	_pack_index_hdr(hdr, log_inode);
+	if (!bin->index || (bin->index_size < INDEX_HDR_SIZE)
+	    || memcmp(bin->index, hdr, INDEX_HDR_SIZE))
+		return data_end;
+
+	while ((index_end + INDEX_BLOCK_HDR_SIZE) <= bin->index_size) {
+		_unpack_block(bin->index + index_end, &block);
+		block_size = INDEX_BLOCK_HDR_SIZE
+			+ ((uint64_t) block.entry_cnt * INDEX_ENTRY_SIZE);
+		if (((index_end + block_size) > bin->index_size)
+		    || (block.data_end < data_end)
+		    || (block.data_end > bin->log_size))
+			break;
+		_search_block(bin, &block,
+			      bin->index + index_end + INDEX_BLOCK_HDR_SIZE);
+		index_end += block_size;
+		data_end = block.data_end;
+	}
+	return data_end;
+}
+
+/* Find the records we want from offset on by reading the log */
+static void _search_log(bin_read_t *bin, uint64_t offset)
+{
+	log_rec_t rec;
+
+	while ((offset + LOG_REC_FIXED_SIZE) <= bin->log_size) {
+		_unpack_log_rec(bin->log + offset, &rec);
+		if (!_rec_fits(rec.rec_size, offset, bin->log_size))
+			break;
+		if ((!bin->job_id_cnt
+		     || bsearch(&rec.job_id, bin->job_ids, bin->job_id_cnt,
+				sizeof(uint32_t), _sort_u32))
+		    && _want_time(bin, (time_t) rec.end_time))
+			_add_hit(bin, rec.job_id, offset);
+		offset += rec.rec_size;
+	}
+}
+
+/* Format the record at offset as a line of the text log
+ * RET false if the record is not whole */
+static bool _rec_line(bin_read_t *bin, uint64_t offset, char *line, int size,
+		      uint32_t *job_id)
+{
+	filetxt_jobcomp_rec_t job;
+	log_rec_t rec;
+	char *strs[LOG_REC_STR_CNT], *p, *rec_end;
+	int i;
+
+	if ((offset + LOG_REC_FIXED_SIZE) > bin->log_size)
+		return false;
+	_unpack_log_rec(bin->log + offset, &rec);
+	if (!_rec_fits(rec.rec_size, offset, bin->log_size))
+		return false;
+
+	p = bin->log + offset + LOG_REC_FIXED_SIZE;
+	rec_end = bin->log + offset + rec.rec_size;
+	for (i = 0; i < LOG_REC_STR_CNT; i++) {
+		strs[i] = (rec.null_mask & (1 << i)) ? NULL : p;
+		if (!(p = memchr(p, '\0', rec_end - p)))
+			return false;
+		p++;
+	}
+
+	job.job_id      = rec.job_id;
+	job.user_id     = rec.user_id;
+	job.group_id    = rec.group_id;
+	job.job_state   = rec.job_state;
+	job.time_limit  = rec.time_limit;
+	job.start_time  = (time_t) rec.start_time;
+	job.end_time    = (time_t) rec.end_time;
+	job.node_cnt    = rec.node_cnt;
+	job.cpus        = rec.cpus;
+	job.user_name   = strs[0];
+	job.group_name  = strs[1];
+	job.name        = strs[2];
+	job.partition   = strs[3];
+	job.nodes       = strs[4];
+	job.work_dir    = strs[5];
+	job.select_info = strs[6];
+	filetxt_jobcomp_rec_to_line(&job, line, size);
+	*job_id = rec.job_id;
+
+	return true;
+}
+
+static char *_map_file(int fd, uint64_t size)
+{
+	char *map;
+
+	if (!size)
+		return NULL;
+	map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		return NULL;
+	return map;
+}
+
+extern List filetxt_jobcomp_bin_read(char *log_file,
+				     slurmdb_job_cond_t *job_cond)
+{
+	char hdr[LOG_HDR_SIZE], buf[LOG_HDR_SIZE], line[1024];
+	char *index_file = NULL;
+	int log_fd, fd;
+	struct stat st;
+	bin_read_t bin;
+	slurmdb_selected_step_t *selected_step;
+	ListIterator itr;
+	List line_list = NULL;
+	uint64_t data_end;
+	uint32_t i, job_id;
+	bool use_index = true;
+
+	if ((log_fd = open(log_file, O_RDONLY)) < 0)
+		return NULL;
+	_pack_log_hdr(hdr);
+	if (fstat(log_fd, &st) || (st.st_size < LOG_HDR_SIZE)
+	    || (_read_all(log_fd, buf, LOG_HDR_SIZE, 0) != SLURM_SUCCESS)
+	    || (_unpack_u32(buf) != LOG_MAGIC)) {
+		close(log_fd);
+		return NULL;
+	}
+	if (memcmp(hdr, buf, LOG_HDR_SIZE)) {
+		error("%s is a binary log of an unknown version", log_file);
+		close(log_fd);
+		return list_create(slurm_destroy_char);
+	}
+
+	memset(&bin, 0, sizeof(bin_read_t));
+	bin.log_size = st.st_size;
+	if (!(bin.log = _map_file(log_fd, bin.log_size))) {
+		error("Can't map %s: %m", log_file);
+		close(log_fd);
+		return list_create(slurm_destroy_char);
+	}
+	close(log_fd);
+
+	index_file = xstrdup_printf("%s%s", log_file,
+				    FILETXT_BIN_INDEX_SUFFIX);
+	if ((fd = open(index_file, O_RDONLY)) >= 0) {
+		struct stat index_st;
+		if (!fstat(fd, &index_st)) {
+			bin.index_size = index_st.st_size;
+			bin.index = _map_file(fd, bin.index_size);
+		}
+		close(fd);
+	}
+	xfree(index_file);
+
+	if (job_cond && job_cond->step_list
+	    && list_count(job_cond->step_list)) {
+		bin.job_ids = xmalloc(sizeof(uint32_t)
+				      * list_count(job_cond->step_list));
+		itr = list_iterator_create(job_cond->step_list);
+		while ((selected_step = list_next(itr)))
+			bin.job_ids[bin.job_id_cnt++] = selected_step->jobid;
+		list_iterator_destroy(itr);
+		qsort(bin.job_ids, bin.job_id_cnt, sizeof(uint32_t),
+		      _sort_u32);
+	}
+	if (job_cond) {
+		bin.start = job_cond->usage_start;
+		bin.end = job_cond->usage_end;
+	}
+
+again:
+	line_list = list_create(slurm_destroy_char);
+	bin.hit_cnt = 0;
+	data_end = LOG_HDR_SIZE;
+	if (use_index)
+		data_end = _search_index(&bin, st.st_ino);
+	_search_log(&bin, data_end);
+	qsort(bin.hits, bin.hit_cnt, sizeof(index_entry_t), _sort_hits);
+
+	for (i = 0; i < bin.hit_cnt; i++) {
+		if (i && (bin.hits[i].offset == bin.hits[i - 1].offset))
+			continue;
+		if (!_rec_line(&bin, bin.hits[i].offset, line, sizeof(line),
+			       &job_id)
+		    || (job_id != bin.hits[i].job_id)) {
+			if (!use_index) {
+				error("Bad record at offset %"PRIu64" of %s",
+				      bin.hits[i].offset, log_file);
+				continue;
+			}
+			error("Index of %s does not match it, "
+			      "reading the whole log", log_file);
+			use_index = false;
+			list_destroy(line_list);
+			goto again;
+		}
+		list_append(line_list, xstrdup(line));
+	}
+	debug("%d of the records in %s read, %"PRIu64" bytes not indexed",
+	      list_count(line_list), log_file, bin.log_size - data_end);
+
+	xfree(bin.hits);
+	xfree(bin.job_ids);
+	munmap(bin.log, bin.log_size);
+	if (bin.index)
+		munmap(bin.index, bin.index_size);
+
+	return line_list;
+}
@@ -0,0 +1,128 @@
+/*****************************************************************************\
+ *  filetxt_jobcomp_bin.h - binary job completion log of jobcomp/filetxt.
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_FILETXT_JOBCOMP_BIN_H
+#define _HAVE_FILETXT_JOBCOMP_BIN_H
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#if HAVE_STDINT_H
+#  include <stdint.h>
+#endif
+#if HAVE_INTTYPES_H
+#  include <inttypes.h>
+#endif
+
+#include <stdbool.h>
+#include <time.h>
+
+#include "src/common/list.h"
+#include "src/common/slurm_accounting_storage.h"
+
+/*
+ * With JobCompParams=binary the log is a file header followed by one
+ * record per job: a fixed size part holding the numbers (job id, uid,
+ * gid, state, times, counts) and a table of the job's strings.  The
+ * index lives next to it in "<log>.idx" and is a series of blocks,
+ * each holding the job id, end time and offset of the records written
+ * since the previous block, sorted by job id.  slurmctld adds a block
+ * every FILETXT_BIN_FLUSH_CNT records or FILETXT_BIN_FLUSH_TIME
+ * seconds; records not in a block yet are found by reading the end of
+ * the log.  sacct maps both files and searches the blocks for the job
+ * ids or the end time window asked for.
+ */
+#define FILETXT_BIN_INDEX_SUFFIX	".idx"
+#define FILETXT_BIN_FLUSH_CNT		1024
+#define FILETXT_BIN_FLUSH_TIME		60
+
+/* A job completion as written to the log, in either format */
+typedef struct {
+	uint32_t cpus;
+	time_t end_time;
+	char *group_name;
+	uint32_t group_id;
+	uint32_t job_id;
+	uint32_t job_state;
+	char *name;
+	uint32_t node_cnt;
+	char *nodes;
+	char *partition;
+	char *select_info;
+	time_t start_time;	/* 0 if not known */
+	uint32_t time_limit;
+	char *user_name;
+	uint32_t user_id;
+	char *work_dir;
+} filetxt_jobcomp_rec_t;
+
+/* Format a record as a line of the text log */
+extern void filetxt_jobcomp_rec_to_line(filetxt_jobcomp_rec_t *rec,
+					char *line, int size);
+
+/* Writer side, all called with the log file lock held */
+
+/*
+ * filetxt_jobcomp_bin_open - get ready to append to the log open on
+ *	log_fd.  An empty log is started in binary if want_binary, an
+ *	existing one keeps its format.  The index of a binary log is
+ *	brought up to date with it.
+ * RET 1 if the log is binary, 0 if it is text, -1 on error
+ */
+extern int filetxt_jobcomp_bin_open(int log_fd, char *log_file,
+				    bool want_binary);
+
+/* Append a record to the binary log and index it */
+extern int filetxt_jobcomp_bin_write(int log_fd, filetxt_jobcomp_rec_t *rec);
+
+/* Write out the index of the records not in a block yet */
+extern void filetxt_jobcomp_bin_close(void);
+
+/* Reader side */
+
+/*
+ * filetxt_jobcomp_bin_read - get the records of a binary log matching
+ *	the job ids in job_cond->step_list and ending within
+ *	job_cond->usage_start and usage_end (if set)
+ * RET List of lines (char *) as in the text log in log order, NULL if
+ *	log_file is not a binary log
+ */
+extern List filetxt_jobcomp_bin_read(char *log_file,
+				     slurmdb_job_cond_t *job_cond);
+
+#endif
@@ -47,6 +47,7 @@
 #include "src/common/xstring.h"
 #include "src/common/xmalloc.h"
 #include "src/common/slurm_jobcomp.h"
+#include "filetxt_jobcomp_bin.h"
 #include "filetxt_jobcomp_process.h"
 
 typedef struct {
@@ -182,21 +183,107 @@ static jobcomp_job_rec_t *_parse_line(List job_info_list)
 	return job;
 }
 
-extern List filetxt_jobcomp_process_get_jobs(slurmdb_job_cond_t *job_cond)
+/* Break a line of the log into NULL-terminated strings and add the
+ * job to job_list if it is one asked for. */
+static void _process_line(char *line, int lc, slurmdb_job_cond_t *job_cond,
+			  int fdump_flag, List job_list)
 {
-	char line[BUFFER_SIZE];
-	char *fptr = NULL, *filein = NULL;
+	char *fptr = line;
 	int jobid = 0;
 	char *partition = NULL;
-	FILE *fd = NULL;
-	int lc = 0;
 	jobcomp_job_rec_t *job = NULL;
 	slurmdb_selected_step_t *selected_step = NULL;
 	char *selected_part = NULL;
 	ListIterator itr = NULL;
 	List job_info_list = NULL;
 	filetxt_jobcomp_info_t *jobcomp_info = NULL;
+
+	job_info_list = list_create(_destroy_filetxt_jobcomp_info);
+	while(fptr) {
+		jobcomp_info =
+			xmalloc(sizeof(filetxt_jobcomp_info_t));
+		list_append(job_info_list, jobcomp_info);
+		jobcomp_info->name = fptr;
+		fptr = strstr(fptr, "=");
+		*fptr++ = 0;
+		jobcomp_info->val = fptr;
+		fptr = strstr(fptr, " ");
+		if(!strcasecmp("JobId", jobcomp_info->name))
+			jobid = atoi(jobcomp_info->val);
+		else if(!strcasecmp("Partition",
+				    jobcomp_info->name))
+			partition = jobcomp_info->val;
+
+
+		if(!fptr) {
+			fptr = strstr(jobcomp_info->val, "\n");
+			if (fptr)
+				*fptr = 0;
+			break;
+		} else {
+			*fptr++ = 0;
+			if(*fptr == '\n') {
+				*fptr = 0;
+				break;
+			}
+		}
+	}
+
+	if (job_cond->step_list && list_count(job_cond->step_list)) {
+		if(!jobid)
+			goto end_it;
+		itr = list_iterator_create(job_cond->step_list);
+		while((selected_step = list_next(itr))) {
+			if (selected_step->jobid != jobid)
+				continue;
+			/* job matches */
+			list_iterator_destroy(itr);
+			goto foundjob;
+		}
+		list_iterator_destroy(itr);
+		goto end_it;	/* no match */
+	}
+foundjob:
+
+	if (job_cond->partition_list
+	    && list_count(job_cond->partition_list)) {
+		if(!partition)
+			goto end_it;
+		itr = list_iterator_create(job_cond->partition_list);
+		while((selected_part = list_next(itr)))
+			if (!strcasecmp(selected_part, partition)) {
+				list_iterator_destroy(itr);
+				goto foundp;
+			}
+		list_iterator_destroy(itr);
+		goto end_it;	/* no match */
+	}
+foundp:
+
+	if (fdump_flag) {
+		_do_fdump(job_info_list, lc);
+		goto end_it;
+	}
+
+
+	job = _parse_line(job_info_list);
+
+	if(job)
+		list_append(job_list, job);
+end_it:
+	list_destroy(job_info_list);
+}
+
+extern List filetxt_jobcomp_process_get_jobs(slurmdb_job_cond_t *job_cond)
+{
+	char line[BUFFER_SIZE];
+	char *filein = NULL;
+	FILE *fd = NULL;
+	int lc = 0;
 	List job_list = list_create(jobcomp_destroy_job);
+	List line_list = NULL;
+	ListIterator itr = NULL;
+	char *bin_line = NULL;
 	int fdump_flag = 0;
 
 	/* we grab the fdump only for the filetxt plug through the
@@ -210,93 +297,27 @@ extern List filetxt_jobcomp_process_get_jobs(slurmdb_job_cond_t *job_cond)
 	}
 
 	filein = slurm_get_jobcomp_loc();
+
+	/* a binary log hands back only the lines of the jobs asked
+	   for, the text log is read whole */
+	if ((line_list = filetxt_jobcomp_bin_read(filein, job_cond))) {
+		itr = list_iterator_create(line_list);
+		while ((bin_line = list_next(itr)))
+			_process_line(bin_line, ++lc, job_cond, fdump_flag,
+				      job_list);
+		list_iterator_destroy(itr);
+		list_destroy(line_list);
+		xfree(filein);
+		return job_list;
+	}
+
 	fd = _open_log_file(filein);
 
 	while (fgets(line, BUFFER_SIZE, fd)) {
 		lc++;
-		fptr = line;	/* break the record into NULL-
-				   terminated strings */
-		if(job_info_list)
-			list_destroy(job_info_list);
-		jobid = 0;
-		partition = NULL;
-		job_info_list = list_create(_destroy_filetxt_jobcomp_info);
-		while(fptr) {
-			jobcomp_info =
-				xmalloc(sizeof(filetxt_jobcomp_info_t));
-			list_append(job_info_list, jobcomp_info);
-			jobcomp_info->name = fptr;
-			fptr = strstr(fptr, "=");
-			*fptr++ = 0;
-			jobcomp_info->val = fptr;
-			fptr = strstr(fptr, " ");
-			if(!strcasecmp("JobId", jobcomp_info->name))
-				jobid = atoi(jobcomp_info->val);
-			else if(!strcasecmp("Partition",
-					    jobcomp_info->name))
-				partition = jobcomp_info->val;
-
-
-			if(!fptr) {
-				fptr = strstr(jobcomp_info->val, "\n");
-				if (fptr)
-					*fptr = 0;
-				break;
-			} else {
-				*fptr++ = 0;
-				if(*fptr == '\n') {
-					*fptr = 0;
-					break;
-				}
-			}
-		}
-
-		if (job_cond->step_list && list_count(job_cond->step_list)) {
-			if(!jobid)
-				continue;
-			itr = list_iterator_create(job_cond->step_list);
-			while((selected_step = list_next(itr))) {
-				if (selected_step->jobid == jobid)
-					continue;
-				/* job matches */
-				list_iterator_destroy(itr);
-				goto foundjob;
-			}
-			list_iterator_destroy(itr);
-			continue;	/* no match */
-		}
-	foundjob:
-
-		if (job_cond->partition_list
-		    && list_count(job_cond->partition_list)) {
-			if(!partition)
-				continue;
-			itr = list_iterator_create(job_cond->partition_list);
-			while((selected_part = list_next(itr)))
-				if (!strcasecmp(selected_part, partition)) {
-					list_iterator_destroy(itr);
-					goto foundp;
-				}
-			list_iterator_destroy(itr);
-			continue;	/* no match */
-		}
-	foundp:
-
-		if (fdump_flag) {
-			_do_fdump(job_info_list, lc);
-			continue;
-		}
-
-
-		job = _parse_line(job_info_list);
-
-		if(job)
-			list_append(job_list, job);
+		_process_line(line, lc, job_cond, fdump_flag, job_list);
 	}
 
-	if(job_info_list)
-		list_destroy(job_info_list);
-
 	if (ferror(fd)) {
 		perror(filein);
 		xfree(filein);
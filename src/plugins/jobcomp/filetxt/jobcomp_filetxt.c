@@ -48,6 +48,8 @@
 #endif
 
 #include <fcntl.h>
+#include <string.h>
+#include <strings.h>
 #include <pwd.h>
 #include <grp.h>
 #include <unistd.h>
@@ -55,10 +57,9 @@
 #include "src/common/slurm_jobcomp.h"
 #include "src/common/parse_time.h"
 #include "src/common/uid.h"
+#include "filetxt_jobcomp_bin.h"
 #include "filetxt_jobcomp_process.h"
 
-#define USE_ISO8601 1
-
 /*
  * These variables are required by the generic plugin interface.  If they
  * are not found in the plugin, the plugin loader will ignore it.
@@ -92,10 +93,6 @@ const char plugin_name[]       	= "Job completion text file logging plugin";
 const char plugin_type[]       	= "jobcomp/filetxt";
 const uint32_t plugin_version	= 100;
 
-#define JOB_FORMAT "JobId=%lu UserId=%s(%lu) GroupId=%s(%lu) Name=%s JobState=%s Partition=%s "\
-		"TimeLimit=%s StartTime=%s EndTime=%s NodeList=%s NodeCnt=%u ProcCnt=%u "\
-		"WorkDir=%s %s\n"
-
 /* Type for error string table entries */
 typedef struct {
 	int xe_number;
@@ -114,6 +111,8 @@ static int plugin_errno = SLURM_SUCCESS;
 static pthread_mutex_t  file_lock = PTHREAD_MUTEX_INITIALIZER;
 static char *           log_name  = NULL;
 static int              job_comp_fd = -1;
+static bool             binary_log = false;	/* log is binary */
+static bool             want_binary = false;	/* JobCompParams=binary */
 
 /* get the user name for the give user_id */
 static void
@@ -171,13 +170,29 @@ static char *_lookup_slurm_api_errtab(int errnum)
  */
 int init ( void )
 {
+	char *params = slurm_get_jobcomp_params();
+	char *tok, *last = NULL;
+
+	want_binary = false;
+	tok = params ? strtok_r(params, ",", &last) : NULL;
+	while (tok) {
+		if (!strcasecmp(tok, "binary"))
+			want_binary = true;
+		tok = strtok_r(NULL, ",", &last);
+	}
+	xfree(params);
 	return SLURM_SUCCESS;
 }
 
 int fini ( void )
 {
+	slurm_mutex_lock( &file_lock );
+	if (binary_log)
+		filetxt_jobcomp_bin_close();
 	if (job_comp_fd >= 0)
 		close(job_comp_fd);
+	job_comp_fd = -1;
+	slurm_mutex_unlock( &file_lock );
 	xfree(log_name);
 	return SLURM_SUCCESS;
 }
@@ -199,58 +214,45 @@ extern int slurm_jobcomp_set_location ( char * location )
 	log_name = xstrdup(location);
 
 	slurm_mutex_lock( &file_lock );
+	if (binary_log)
+		filetxt_jobcomp_bin_close();
 	if (job_comp_fd >= 0)
 		close(job_comp_fd);
-	job_comp_fd = open(location, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	job_comp_fd = open(location, O_RDWR | O_CREAT | O_APPEND, 0644);
 	if (job_comp_fd == -1) {
 		fatal("open %s: %m", location);
 		plugin_errno = errno;
 		rc = SLURM_ERROR;
-	} else
+	} else {
 		fchmod(job_comp_fd, 0644);
+		binary_log = false;
+		switch (filetxt_jobcomp_bin_open(job_comp_fd, location,
+						 want_binary)) {
+		case 1:
+			binary_log = true;
+			break;
+		case 0:
+			break;
+		default:
+			close(job_comp_fd);
+			job_comp_fd = -1;
+			plugin_errno = EINVAL;
+			rc = SLURM_ERROR;
+			break;
+		}
+	}
 	slurm_mutex_unlock( &file_lock );
 	return rc;
 }
 
-/* This is a variation of slurm_make_time_str() in src/common/parse_time.h
- * This version uses ISO8601 format by default. */
-static void _make_time_str (time_t *time, char *string, int size)
-{
-	struct tm time_tm;
-
-	localtime_r(time, &time_tm);
-	if ( *time == (time_t) 0 ) {
-		snprintf(string, size, "Unknown");
-	} else {
-#if USE_ISO8601
-		/* Format YYYY-MM-DDTHH:MM:SS, ISO8601 standard format,
-		 * NOTE: This is expected to break Maui, Moab and LSF
-		 * schedulers management of SLURM. */
-		snprintf(string, size,
-			"%4.4u-%2.2u-%2.2uT%2.2u:%2.2u:%2.2u",
-			(time_tm.tm_year + 1900), (time_tm.tm_mon+1),
-			time_tm.tm_mday, time_tm.tm_hour, time_tm.tm_min,
-			time_tm.tm_sec);
-#else
-		/* Format MM/DD-HH:MM:SS */
-		snprintf(string, size,
-			"%2.2u/%2.2u-%2.2u:%2.2u:%2.2u",
-			(time_tm.tm_mon+1), time_tm.tm_mday,
-			time_tm.tm_hour, time_tm.tm_min, time_tm.tm_sec);
-
-#endif
-	}
-}
-
 extern int slurm_jobcomp_log_record ( struct job_record *job_ptr )
 {
 	int rc = SLURM_SUCCESS;
 	char job_rec[1024];
-	char usr_str[32], grp_str[32], start_str[32], end_str[32], lim_str[32];
-	char select_buf[128], *state_string, *work_dir;
+	char usr_str[32], grp_str[32];
+	char select_buf[128];
 	size_t offset = 0, tot_size, wrote;
-	enum job_states job_state;
-	uint32_t time_limit;
+	filetxt_jobcomp_rec_t rec;
 
 	if ((log_name == NULL) || (job_comp_fd < 0)) {
 		error("JobCompLoc log file %s not open", log_name);
@@ -261,64 +263,67 @@ extern int slurm_jobcomp_log_record ( struct job_record *job_ptr )
 	_get_user_name(job_ptr->user_id, usr_str, sizeof(usr_str));
 	_get_group_name(job_ptr->group_id, grp_str, sizeof(grp_str));
 
+	memset(&rec, 0, sizeof(filetxt_jobcomp_rec_t));
+	rec.job_id = job_ptr->job_id;
+	rec.user_id = job_ptr->user_id;
+	rec.user_name = usr_str;
+	rec.group_id = job_ptr->group_id;
+	rec.group_name = grp_str;
+	rec.name = job_ptr->name;
+	rec.partition = job_ptr->partition;
+	rec.nodes = job_ptr->nodes;
+	rec.node_cnt = job_ptr->node_cnt;
+	rec.cpus = job_ptr->total_cpus;
+
 	if ((job_ptr->time_limit == NO_VAL) && job_ptr->part_ptr)
-		time_limit = job_ptr->part_ptr->max_time;
+		rec.time_limit = job_ptr->part_ptr->max_time;
 	else
-		time_limit = job_ptr->time_limit;
-	if (time_limit == INFINITE)
-		strcpy(lim_str, "UNLIMITED");
-	else {
-		snprintf(lim_str, sizeof(lim_str), "%lu",
-			 (unsigned long) time_limit);
-	}
+		rec.time_limit = job_ptr->time_limit;
 
 	if (job_ptr->job_state & JOB_RESIZING) {
-		time_t now = time(NULL);
-		state_string = job_state_string(job_ptr->job_state);
-		if (job_ptr->resize_time) {
-			_make_time_str(&job_ptr->resize_time, start_str,
-				       sizeof(start_str));
-		} else {
-			_make_time_str(&job_ptr->start_time, start_str,
-				       sizeof(start_str));
-		}
-		_make_time_str(&now, end_str, sizeof(end_str));
+		rec.job_state = job_ptr->job_state;
+		if (job_ptr->resize_time)
+			rec.start_time = job_ptr->resize_time;
+		else
+			rec.start_time = job_ptr->start_time;
+		rec.end_time = time(NULL);
 	} else {
 		/* Job state will typically have JOB_COMPLETING or JOB_RESIZING
 		 * flag set when called. We remove the flags to get the eventual
 		 * completion state: JOB_FAILED, JOB_TIMEOUT, etc. */
-		job_state = job_ptr->job_state & JOB_STATE_BASE;
-		state_string = job_state_string(job_state);
+		rec.job_state = job_ptr->job_state & JOB_STATE_BASE;
 		if (job_ptr->resize_time) {
-			_make_time_str(&job_ptr->resize_time, start_str,
-				       sizeof(start_str));
+			rec.start_time = job_ptr->resize_time;
 		} else if (job_ptr->start_time > job_ptr->end_time) {
 			/* Job cancelled while pending and
 			 * expected start time is in the future. */
-			snprintf(start_str, sizeof(start_str), "Unknown");
+			rec.start_time = 0;
 		} else {
-			_make_time_str(&job_ptr->start_time, start_str,
-				       sizeof(start_str));
+			rec.start_time = job_ptr->start_time;
 		}
-		_make_time_str(&job_ptr->end_time, end_str, sizeof(end_str));
+		rec.end_time = job_ptr->end_time;
 	}
 
 	if (job_ptr->details && job_ptr->details->work_dir)
-		work_dir = job_ptr->details->work_dir;
+		rec.work_dir = job_ptr->details->work_dir;
 	else
-		work_dir = "unknown";
+		rec.work_dir = "unknown";
 
 	select_g_select_jobinfo_sprint(job_ptr->select_jobinfo,
 		select_buf, sizeof(select_buf), SELECT_PRINT_MIXED);
+	rec.select_info = select_buf;
+
+	if (binary_log) {
+		if (filetxt_jobcomp_bin_write(job_comp_fd, &rec)
+		    != SLURM_SUCCESS) {
+			plugin_errno = errno;
+			rc = SLURM_ERROR;
+		}
+		slurm_mutex_unlock( &file_lock );
+		return rc;
+	}
 
-	snprintf(job_rec, sizeof(job_rec), JOB_FORMAT,
-		 (unsigned long) job_ptr->job_id, usr_str,
-		 (unsigned long) job_ptr->user_id, grp_str,
-		 (unsigned long) job_ptr->group_id, job_ptr->name,
-		 state_string, job_ptr->partition, lim_str, start_str,
-		 end_str, job_ptr->nodes, job_ptr->node_cnt,
-		 job_ptr->total_cpus, work_dir,
-		 select_buf);
+	filetxt_jobcomp_rec_to_line(&rec, job_rec, sizeof(job_rec));
 	tot_size = strlen(job_rec);
 
 	while ( offset < tot_size ) {
@@ -59,12 +59,27 @@
  *  CONNECT_TYPE	Connection type: small, torus or mesh
  *  GEOMETRY		Requested geometry of the job, "#x#x#" where "#"
  *			represents the X, Y and Z dimension sizes
+ *
+ *  With JobCompParams=batch=# the script is instead run once for up to
+ *  that many jobs. It gets one line per job on stdin, each line holding
+ *  the variables above as space separated NAME=VALUE words. A space or
+ *  backslash in a value is preceded by a backslash, so the shell "read"
+ *  builtin splits the words correctly, and a tab or newline is written
+ *  as "\t" or "\n". The same file is named by the script's first
+ *  argument and by these environment variables:
+ *
+ *  JOBCOMP_BATCH_COUNT	Number of jobs (lines) in the batch
+ *  JOBCOMP_BATCH_FILE	Name of the file holding the batch
 \*****************************************************************************/
 
 #ifdef HAVE_CONFIG_H
 #  include "config.h"
 #endif
 
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE	/* for mkostemp() */
+#endif
+
 #if HAVE_STDINT_H
 #  include <stdint.h>
 #endif
@@ -76,8 +91,10 @@
 #  include <paths.h>
 #endif
 
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdarg.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -89,6 +106,7 @@
 #include "slurm/slurm.h"
 #include "slurm/slurm_errno.h"
 
+#include "src/common/fd.h"
 #include "src/common/slurm_jobcomp.h"
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/xmalloc.h"
@@ -130,14 +148,29 @@ const char plugin_name[]       	= "Job completion logging script plugin";
 const char plugin_type[]       	= "jobcomp/script";
 const uint32_t plugin_version	= 100;
 
+#define MAX_SCRIPT_WORKERS	32	/* most JobCompParams=workers */
+#define MAX_SCRIPT_BATCH	10000	/* most JobCompParams=batch */
+#define LAG_WARN_SECS		60	/* log if completions this far behind */
+#define LAG_WARN_INTERVAL	300	/* but only this often */
+
 static char * script = NULL;
 static List comp_list = NULL;
+static int script_workers = 1;
+static int script_batch = 1;
 
-static pthread_t script_thread = 0;
+static pthread_t *script_threads = NULL;
 static pthread_mutex_t thread_flag_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t comp_list_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t comp_list_cond = PTHREAD_COND_INITIALIZER;
 static int agent_exit = 0;
+static int agent_cnt = 0;	/* running script threads */
+
+/* Queue statistics, protected by comp_list_mutex */
+static int    comp_queue_max = 0;	/* highest queue depth */
+static time_t comp_lag_max = 0;		/* highest lag in seconds */
+static time_t comp_lag_warn = 0;	/* time of last lag message */
+static uint32_t comp_job_cnt = 0;	/* jobs given to the script */
+static uint32_t comp_run_cnt = 0;	/* times the script was run */
 
 /*
  *  Local plugin errno
@@ -180,6 +213,7 @@ struct jobcomp_info {
 	uint32_t nprocs;
 	uint32_t nnodes;
 	uint16_t batch_flag;
+	time_t queued;
 	time_t submit;
 	time_t start;
 	time_t end;
@@ -205,6 +239,7 @@ static struct jobcomp_info * _jobcomp_info_create (struct job_record *job)
 	j->uid = job->user_id;
 	j->gid = job->group_id;
 	j->name = xstrdup (job->name);
+	j->queued = time(NULL);
 
 	if (IS_JOB_RESIZING(job)) {
 		state = JOB_RESIZING;
@@ -355,10 +390,12 @@ static int _env_append_fmt (char ***envp, const char *name,
 	return (_env_append (envp, name, val));
 }
 
-static char ** _create_environment (struct jobcomp_info *job)
+/*
+ *  Build the job's NAME=VALUE variables, also used for batch lines
+ */
+static char ** _create_job_env (struct jobcomp_info *job)
 {
 	char **env;
-	char *tz;
 
 	env = xmalloc (1 * sizeof (*env));
 	env[0] = NULL;
@@ -392,17 +429,40 @@ static char ** _create_environment (struct jobcomp_info *job)
 		_env_append_fmt (&env, "LIMIT", "%lu",
 		                 (unsigned long) job->limit);
 
+	return (env);
+}
+
+static void _env_add_common (char ***envp)
+{
+	char *tz;
+
 	if ((tz = getenv ("TZ")))
-		_env_append_fmt (&env, "TZ", "%s", tz);
+		_env_append_fmt (envp, "TZ", "%s", tz);
 #ifdef _PATH_STDPATH
-	_env_append (&env, "PATH", _PATH_STDPATH);
+	_env_append (envp, "PATH", _PATH_STDPATH);
 #else
-	_env_append (&env, "PATH", "/bin:/usr/bin");
+	_env_append (envp, "PATH", "/bin:/usr/bin");
 #endif
+}
+
+static char ** _create_environment (struct jobcomp_info *job)
+{
+	char **env = _create_job_env (job);
+
+	_env_add_common (&env);
 
 	return (env);
 }
 
+static void _env_free (char **env)
+{
+	char **ep;
+
+	for (ep = env; *ep; ep++)
+		xfree (*ep);
+	xfree (env);
+}
+
 static int _redirect_stdio (void)
 {
 	int devnull;
@@ -489,10 +549,211 @@ static int _jobcomp_exec_child (char *script, struct jobcomp_info *job)
 
 
 /*
- * Thread function that executes a script
+ *  Append str to *line, escaping characters the shell "read" builtin
+ *   would split on or interpret
+ */
+static void _batch_append_escaped (char **line, const char *str)
+{
+	char *buf = xmalloc (strlen (str) * 2 + 1);
+	char *p = buf;
+
+	for (; *str; str++) {
+		switch (*str) {
+		case '\\':
+		case ' ':
+			*p++ = '\\';
+			*p++ = *str;
+			break;
+		case '\t':
+			*p++ = '\\';
+			*p++ = 't';
+			break;
+		case '\n':
+			*p++ = '\\';
+			*p++ = 'n';
+			break;
+		default:
+			*p++ = *str;
+		}
+	}
+	xstrcat (*line, buf);
+	xfree (buf);
+}
+
+/*
+ *  Write one line per job in batch to fd
+ */
+static int _batch_write (int fd, List batch)
+{
+	ListIterator itr = list_iterator_create (batch);
+	struct jobcomp_info *job;
+	char *data = NULL, **env, **ep;
+	int len, offset = 0, rc = 0;
+
+	while ((job = list_next (itr))) {
+		env = _create_job_env (job);
+		for (ep = env; *ep; ep++) {
+			if (ep != env)
+				xstrcat (data, " ");
+			_batch_append_escaped (&data, *ep);
+		}
+		xstrcat (data, "\n");
+		_env_free (env);
+	}
+	list_iterator_destroy (itr);
+
+	len = strlen (data);
+	while (offset < len) {
+		ssize_t n = write (fd, data + offset, len - offset);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			rc = error ("jobcomp/script: batch write: %m");
+			break;
+		}
+		offset += n;
+	}
+	xfree (data);
+
+	return (rc);
+}
+
+static void _jobcomp_batch_child (char *script, char *path, int fd, int cnt)
+{
+	char * args[] = {script, path, NULL};
+	const char *tmpdir;
+	char **env;
+
+#ifdef _PATH_TMP
+	tmpdir = _PATH_TMP;
+#else
+	tmpdir = "/tmp";
+#endif
+	log_reinit ();
+
+	if (_redirect_stdio () < 0)
+		exit (1);
+	if (dup2 (fd, STDIN_FILENO) < 0) {
+		error ("jobcomp/script: Failed to redirect stdin: %m");
+		exit (1);
+	}
+
+	if (chdir (tmpdir) != 0) {
+		error ("jobcomp/script: chdir (%s): %m", tmpdir);
+		exit(1);
+	}
+
+	env = xmalloc (1 * sizeof (*env));
+	env[0] = NULL;
+	_env_append_fmt (&env, "JOBCOMP_BATCH_COUNT", "%d", cnt);
+	_env_append (&env, "JOBCOMP_BATCH_FILE", path);
+	_env_add_common (&env);
+
+	execve(script, args, env);
+
+	error ("jobcomp/script: execve(%s): %m", script);
+	exit (1);
+}
+
+/*
+ *  Run the script once for all jobs in batch, which it reads from a
+ *   temporary file given as its standard input
+ */
+static int _jobcomp_exec_batch (char *script, List batch)
+{
+	char path[PATH_MAX];
+	const char *tmpdir;
+	pid_t pid;
+	int fd, status = 0;
+
+	if (script == NULL)
+		return (-1);
+
+#ifdef _PATH_TMP
+	tmpdir = _PATH_TMP;	/* includes the trailing "/" */
+#else
+	tmpdir = "/tmp/";
+#endif
+	snprintf (path, sizeof (path), "%sslurm_jobcomp.XXXXXX", tmpdir);
+	/* Keep other workers' scripts from inheriting it, they may
+	 * fork before close-on-exec could be set on its own */
+#ifdef O_CLOEXEC
+	fd = mkostemp (path, O_CLOEXEC);
+#else
+	if ((fd = mkstemp (path)) >= 0)
+		fd_set_close_on_exec (fd);
+#endif
+	if (fd < 0) {
+		error ("jobcomp/script: mkstemp(%s): %m", path);
+		return (-1);
+	}
+
+	if ((_batch_write (fd, batch) < 0) ||
+	    (lseek (fd, 0, SEEK_SET) < 0)) {
+		close (fd);
+		unlink (path);
+		return (-1);
+	}
+
+	if ((pid = fork()) < 0) {
+		error ("jobcomp/script: fork: %m");
+		close (fd);
+		unlink (path);
+		return (-1);
+	}
+
+	if (pid == 0)
+		_jobcomp_batch_child (script, path, fd, list_count (batch));
+
+	close (fd);
+	if (waitpid(pid, &status, 0) < 0)
+		error ("jobcomp/script: waitpid: %m");
+	unlink (path);
+
+	if (WEXITSTATUS(status))
+		error ("jobcomp/script: script %s exited with status %d "
+		       "for %d jobs", script, WEXITSTATUS(status),
+		       list_count (batch));
+
+	return (0);
+}
+
+/*
+ *  Note a batch taken from comp_list, and log if the script is falling
+ *   behind. Called with comp_list_mutex held.
+ */
+static void _batch_stats (List batch)
+{
+	struct jobcomp_info *job = list_peek (batch);
+	time_t now = time (NULL);
+	time_t lag = now - job->queued;
+	int cnt = list_count (batch), queued = list_count (comp_list);
+
+	comp_job_cnt += cnt;
+	comp_run_cnt++;
+	if (lag > comp_lag_max)
+		comp_lag_max = lag;
+
+	debug2 ("jobcomp/script: running script for %d jobs, "
+		"%d queued, lag %ld secs", cnt, queued, (long) lag);
+
+	if ((lag >= LAG_WARN_SECS) &&
+	    (difftime (now, comp_lag_warn) >= LAG_WARN_INTERVAL)) {
+		info ("jobcomp/script: completions are %ld secs behind, "
+		      "%d queued (most %d), %u jobs in %u runs so far",
+		      (long) lag, queued, comp_queue_max, comp_job_cnt,
+		      comp_run_cnt);
+		comp_lag_warn = now;
+	}
+}
+
+/*
+ * Thread function that executes a script, one of script_workers
  */
 static void * _script_agent (void *args)
 {
+	List batch = list_create ((ListDelF) _jobcomp_info_destroy);
+
 	while (1) {
 		struct jobcomp_info *job;
 
@@ -502,15 +763,23 @@ static void * _script_agent (void *args)
 			pthread_cond_wait(&comp_list_cond, &comp_list_mutex);
 
 		/*
-		 * It is safe to unlock list mutex here. List has its
-		 *  own internal mutex that protects the comp_list itself
+		 * Take everything queued up to the batch size, so a
+		 *  backlog is run with fewer forks
 		 */
+		while ((list_count(batch) < script_batch) &&
+		       (job = list_pop(comp_list)))
+			list_append(batch, job);
+		if (!list_is_empty(batch))
+			_batch_stats(batch);
+
 		pthread_mutex_unlock(&comp_list_mutex);
 
-		if ((job = list_pop(comp_list))) {
+		if (script_batch > 1) {
+			if (!list_is_empty(batch))
+				_jobcomp_exec_batch (script, batch);
+		} else if ((job = list_peek(batch)))
 			_jobcomp_exec_child (script, job);
-			_jobcomp_info_destroy (job);
-		}
+		list_flush(batch);
 
 		/*
 		 *  Exit if flag is set and we have no more entries to log
@@ -519,9 +788,51 @@ static void * _script_agent (void *args)
 			break;
 	}
 
+	list_destroy(batch);
+
+	pthread_mutex_lock(&comp_list_mutex);
+	agent_cnt--;
+	pthread_mutex_unlock(&comp_list_mutex);
+
 	return NULL;
 }
 
+/*
+ * Read the JobCompParams options: workers=# and batch=#
+ */
+static void _read_params (void)
+{
+	char *params = slurm_get_jobcomp_params();
+	char *tok, *last = NULL;
+
+	script_workers = 1;
+	script_batch = 1;
+	/* other plugins' options may share the comma separated list */
+	tok = params ? strtok_r(params, ",", &last) : NULL;
+	while (tok) {
+		if (!strncasecmp(tok, "workers=", 8))
+			script_workers = atoi(tok + 8);
+		else if (!strncasecmp(tok, "batch=", 6))
+			script_batch = atoi(tok + 6);
+		tok = strtok_r(NULL, ",", &last);
+	}
+	xfree(params);
+
+	if ((script_workers < 1) || (script_workers > MAX_SCRIPT_WORKERS)) {
+		error("jobcomp/script: invalid JobCompParams workers=%d, "
+		      "using 1", script_workers);
+		script_workers = 1;
+	}
+	if ((script_batch < 1) || (script_batch > MAX_SCRIPT_BATCH)) {
+		error("jobcomp/script: invalid JobCompParams batch=%d, "
+		      "using 1", script_batch);
+		script_batch = 1;
+	}
+	if ((script_workers > 1) || (script_batch > 1))
+		verbose("jobcomp/script: %d workers, up to %d jobs per run",
+			script_workers, script_batch);
+}
+
 /*
  * init() is called when the plugin is loaded, before any other functions
  * are called.  Put global initialization here.
@@ -529,6 +840,7 @@ static void * _script_agent (void *args)
 extern int init (void)
 {
 	pthread_attr_t attr;
+	int i;
 
 	verbose("jobcomp/script plugin loaded init");
 
@@ -541,15 +853,27 @@ extern int init (void)
 		return SLURM_ERROR;
 	}
 
-	if (script_thread) {
+	if (script_threads) {
 		debug2( "Script thread already running, not starting another");
 		pthread_mutex_unlock(&thread_flag_mutex);
 		return SLURM_ERROR;
 	}
 
+	_read_params();
+	script_threads = xmalloc(sizeof(pthread_t) * script_workers);
+
 	slurm_attr_init(&attr);
 	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-	pthread_create(&script_thread, &attr, _script_agent, NULL);
+	for (i = 0; i < script_workers; i++) {
+		if (pthread_create(&script_threads[i], &attr, _script_agent,
+				   NULL)) {
+			error("jobcomp/script: pthread_create: %m");
+			break;
+		}
+		pthread_mutex_lock(&comp_list_mutex);
+		agent_cnt++;
+		pthread_mutex_unlock(&comp_list_mutex);
+	}
 
 	pthread_mutex_unlock(&thread_flag_mutex);
 	slurm_attr_destroy(&attr);
@@ -585,6 +909,8 @@ int slurm_jobcomp_log_record (struct job_record *record)
 
 	pthread_mutex_lock(&comp_list_mutex);
 	list_append(comp_list, job);
+	if (list_count(comp_list) > comp_queue_max)
+		comp_queue_max = list_count(comp_list);
 	pthread_cond_broadcast(&comp_list_cond);
 	pthread_mutex_unlock(&comp_list_mutex);
 
@@ -603,14 +929,19 @@ extern const char * slurm_jobcomp_strerror(int errnum)
 	return _jobcomp_script_strerror (errnum);
 }
 
-static int _wait_for_thread (pthread_t thread_id)
+static int _wait_for_threads (void)
 {
-	int i;
+	int i, running;
 
 	for (i=0; i<20; i++) {
+		pthread_mutex_lock(&comp_list_mutex);
 		pthread_cond_broadcast(&comp_list_cond);
+		pthread_mutex_unlock(&comp_list_mutex);
 		usleep(1000 * i);
-		if (pthread_kill(thread_id, 0))
+		pthread_mutex_lock(&comp_list_mutex);
+		running = agent_cnt;
+		pthread_mutex_unlock(&comp_list_mutex);
+		if (running == 0)
 			return SLURM_SUCCESS;
 	}
 
@@ -624,11 +955,14 @@ extern int fini ( void )
 	int rc = SLURM_SUCCESS;
 
 	pthread_mutex_lock(&thread_flag_mutex);
-	if (script_thread) {
+	if (script_threads) {
 		verbose("Script Job Completion plugin shutting down");
 		agent_exit = 1;
-		rc = _wait_for_thread(script_thread);
-		script_thread = 0;
+		rc = _wait_for_threads();
+		xfree(script_threads);
+		verbose("jobcomp/script: %u jobs in %u script runs, "
+			"most queued %d, most lag %ld secs", comp_job_cnt,
+			comp_run_cnt, comp_queue_max, (long) comp_lag_max);
 	}
 	pthread_mutex_unlock(&thread_flag_mutex);
 
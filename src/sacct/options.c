@@ -902,7 +902,10 @@ void parse_command_line(int argc, char **argv)
 	job_cond->duplicates = params.opt_dup;
 	job_cond->without_steps = params.opt_allocs;
 
-	if(!job_cond->usage_start && !job_cond->step_list) {
+	/* The job completion logs are not limited to today by default,
+	 * only when --starttime or --endtime is given. */
+	if(!job_cond->usage_start && !job_cond->step_list
+	   && !params.opt_completion) {
 		struct tm start_tm;
 		job_cond->usage_start = time(NULL);
 
@@ -106,6 +106,14 @@ print_field_t fields[] = {
 
 List jobs = NULL;
 
+static void _free_jobs(void)
+{
+	if (jobs) {
+		list_destroy(jobs);
+		jobs = NULL;
+	}
+}
+
 int main(int argc, char **argv)
 {
 	enum {
@@ -134,14 +142,23 @@ int main(int argc, char **argv)
 		op = SACCT_LIST;
 
 
+	/* Get the jobs from the database a page at a time and print
+	 * each page as we get it, so a large query does not need all
+	 * of them in memory at once. */
+	if (!params.opt_completion && !params.opt_fdump)
+		params.job_cond->page_size = JOB_PAGE_SIZE;
+
 	switch (op) {
 	case SACCT_DUMP:
-		if(get_data() == SLURM_ERROR)
-			exit(errno);
-		if(params.opt_completion)
-			do_dump_completion();
-		else
-			do_dump();
+		do {
+			if(get_data() == SLURM_ERROR)
+				exit(errno);
+			if(params.opt_completion)
+				do_dump_completion();
+			else
+				do_dump();
+			_free_jobs();
+		} while (params.job_cond->page_cluster);
 		break;
 	case SACCT_FDUMP:
 		if(get_data() == SLURM_ERROR)
@@ -149,12 +166,15 @@ int main(int argc, char **argv)
 		break;
 	case SACCT_LIST:
 		print_fields_header(print_fields_list);
-		if(get_data() == SLURM_ERROR)
-			exit(errno);
-		if(params.opt_completion)
-			do_list_completion();
-		else
-			do_list();
+		do {
+			if(get_data() == SLURM_ERROR)
+				exit(errno);
+			if(params.opt_completion)
+				do_list_completion();
+			else
+				do_list();
+			_free_jobs();
+		} while (params.job_cond->page_cluster);
 		break;
 	case SACCT_HELP:
 		do_help();
@@ -76,6 +76,7 @@
 #define STATE_COUNT 10
 
 #define MAX_PRINTFIELDS 100
+#define JOB_PAGE_SIZE 10000	/* job records gotten and printed at once */
 #define FORMAT_STRING_SIZE 34
 
 #define SECONDS_IN_MINUTE 60
@@ -497,9 +497,14 @@ extern int sacctmgr_archive_load(int argc, char *argv[])
 		   || !strncasecmp (argv[i], "File", MAX(command_len, 1))) {
 			arch_rec->archive_file =
 				strip_quotes(argv[i]+end, NULL, 0);
+		} else if (!strncasecmp (argv[i], "End", MAX(command_len, 1))) {
+			arch_rec->period_end = parse_time(argv[i]+end, 1);
 		} else if (!strncasecmp (argv[i], "Insert",
 					 MAX(command_len, 2))) {
 			arch_rec->insert = strip_quotes(argv[i]+end, NULL, 1);
+		} else if (!strncasecmp (argv[i], "Start",
+					 MAX(command_len, 1))) {
+			arch_rec->period_start = parse_time(argv[i]+end, 1);
 		} else {
 			exit_code=1;
 			fprintf(stderr, " Unknown option: %s\n", argv[i]);
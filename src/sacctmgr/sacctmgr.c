@@ -911,7 +911,7 @@ sacctmgr [<OPTION>] [<COMMAND>]                                            \n\
                             PurgeStepAfter=, PurgeSuspendAfter=,           \n\
                             Script=, Steps, and Suspend                    \n\
                                                                            \n\
-       archive load       - File=, or Insert=                              \n\
+       archive load       - End=, File=, Insert=, and Start=               \n\
                                                                            \n\
   Format options are different for listing each entity pair.               \n\
                                                                            \n\
@@ -53,6 +53,7 @@
 #include "src/common/fd.h"
 #include "src/common/forward.h"
 #include "src/common/hostlist.h"
+#include "src/common/io_hdr.h"
 #include "src/common/net.h"
 #include "src/common/slurm_auth.h"
 #include "src/common/slurm_cred.h"
@@ -166,9 +167,11 @@ int sattach(int argc, char *argv[])
 					opt.uid, hosts, layout->node_cnt);
 	mts = _msg_thr_create(layout->node_cnt, layout->task_cnt);
 
+	/* The step's stdout/err message size was chosen by the srun
+	 * that launched it, so be ready for the largest one */
 	io = client_io_handler_create(opt.fds, layout->task_cnt,
 				      layout->node_cnt, fake_cred,
-				      opt.labelio);
+				      opt.labelio, MAX_IO_MSG_LEN);
 	client_io_handler_start(io);
 
 	if (opt.pty) {
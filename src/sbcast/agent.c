@@ -46,6 +46,7 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "slurm/slurm_errno.h"
@@ -64,19 +65,63 @@
 #define MAX_RETRIES     10
 #define MAX_THREADS      8	/* These can be huge messages, so
 				 * only run MAX_THREADS at one time */
+
+/* One block of the file being sent to the nodes */
+typedef struct block {
+	file_bcast_msg_t msg;	/* copy of the caller's message */
+	int threads_left;	/* agent threads still sending it */
+} block_t;
+
 typedef struct thd {
 	pthread_t thread;	/* thread ID */
 	slurm_msg_t msg;	/* message to send */
-	int rc;			/* highest return codes from RPC */
+	block_t *block;		/* block being sent */
 	char *nodelist;
 } thd_t;
 
 static pthread_mutex_t agent_cnt_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cnt_cond  = PTHREAD_COND_INITIALIZER;
 static int agent_cnt = 0;
+static int blocks_in_flight = 0;
+static int agent_rc = 0;	/* highest return code from any RPC */
+
+/* Preserve the node list split across calls for better performance */
+static int threads_used = 0;
+static char *thread_nodes[MAX_THREADS];
+
+/* Nodes which still need blocks of a deduplicated transfer */
+static hostlist_t need_all = NULL;	/* need every block */
+static hostlist_t *need_block = NULL;	/* need block [i] */
+static uint32_t need_cnt = 0;
 
 static void *_agent_thread(void *args);
 
+/* Note which blocks of the manifest a node still needs */
+static void _record_missing(ret_data_info_t *ret_data_info)
+{
+	file_bcast_resp_msg_t *resp;
+	uint32_t i, inx;
+
+	slurm_mutex_lock(&agent_cnt_mutex);
+	if ((ret_data_info->type != RESPONSE_FILE_BCAST) ||
+	    (((file_bcast_resp_msg_t *) ret_data_info->data)->missing_cnt ==
+	     need_cnt)) {
+		hostlist_push_host(need_all, ret_data_info->node_name);
+	} else {
+		resp = (file_bcast_resp_msg_t *) ret_data_info->data;
+		for (i = 0; i < resp->missing_cnt; i++) {
+			inx = resp->missing[i];
+			if (inx >= need_cnt)
+				continue;
+			if (!need_block[inx])
+				need_block[inx] = hostlist_create(NULL);
+			hostlist_push_host(need_block[inx],
+					   ret_data_info->node_name);
+		}
+	}
+	slurm_mutex_unlock(&agent_cnt_mutex);
+}
+
 static void *_agent_thread(void *args)
 {
 	List ret_list = NULL;
@@ -97,8 +142,11 @@ static void *_agent_thread(void *args)
 	while ((ret_data_info = list_next(itr))) {
 		msg_rc = slurm_get_return_code(ret_data_info->type,
 					       ret_data_info->data);
-		if (msg_rc == SLURM_SUCCESS)
+		if (msg_rc == SLURM_SUCCESS) {
+			if (thread_ptr->block->msg.digest_cnt)
+				_record_missing(ret_data_info);
 			continue;
+		}
 
 		error("REQUEST_FILE_BCAST(%s): %s",
 		      ret_data_info->node_name,
@@ -106,76 +154,114 @@ static void *_agent_thread(void *args)
 		rc = MAX(rc, msg_rc);
 	}
 
-	thread_ptr->rc = rc;
 	list_iterator_destroy(itr);
 	if (ret_list)
 		list_destroy(ret_list);
 	slurm_mutex_lock(&agent_cnt_mutex);
+	agent_rc = MAX(agent_rc, rc);
+	if (--thread_ptr->block->threads_left == 0) {
+		xfree(thread_ptr->block);
+		blocks_in_flight--;
+	}
 	agent_cnt--;
 	pthread_cond_broadcast(&agent_cnt_cond);
 	slurm_mutex_unlock(&agent_cnt_mutex);
+	xfree(thread_ptr->nodelist);
+	xfree(thread_ptr);
 	return NULL;
 }
 
-/* Issue the RPC to transfer the file's data */
-extern void send_rpc(file_bcast_msg_t *bcast_msg,
-		     job_sbcast_cred_msg_t *sbcast_cred)
+/* Split node_list between up to MAX_THREADS agent threads,
+ * RET number of threads used */
+static int _split_nodes(char *node_list, int node_cnt, char **nodes)
 {
-	/* Preserve some data structures across calls for better performance */
-	static int threads_used = 0;
-	static thd_t thread_info[MAX_THREADS];
+	hostlist_t hl;
+	hostlist_t new_hl;
+	int *span = NULL;
+	char *name = NULL;
+	int i, fanout, thread_cnt = 0;
 
-	int i, fanout, rc = SLURM_SUCCESS;
-	int retries = 0;
-	pthread_attr_t attr;
-
-	if (threads_used == 0) {
-		hostlist_t hl;
-		hostlist_t new_hl;
-		int *span = NULL;
-		char *name = NULL;
-
-		if (params.fanout)
-			fanout = MIN(MAX_THREADS, params.fanout);
-		else
-			fanout = MAX_THREADS;
+	if (params.fanout)
+		fanout = MIN(MAX_THREADS, params.fanout);
+	else
+		fanout = MAX_THREADS;
 
-		span = set_span(sbcast_cred->node_cnt, fanout);
+	span = set_span(node_cnt, fanout);
 
-		hl = hostlist_create(sbcast_cred->node_list);
+	hl = hostlist_create(node_list);
 
-		i = 0;
-		while (i < sbcast_cred->node_cnt) {
-			int j = 0;
+	i = 0;
+	while (i < node_cnt) {
+		int j = 0;
+		name = hostlist_shift(hl);
+		if(!name) {
+			debug3("no more nodes to send to");
+			break;
+		}
+		new_hl = hostlist_create(name);
+		free(name);
+		i++;
+		for(j = 0; j < span[thread_cnt]; j++) {
 			name = hostlist_shift(hl);
-			if(!name) {
-				debug3("no more nodes to send to");
+			if(!name)
 				break;
-			}
-			new_hl = hostlist_create(name);
+			hostlist_push(new_hl, name);
 			free(name);
 			i++;
-			for(j = 0; j < span[threads_used]; j++) {
-				name = hostlist_shift(hl);
-				if(!name)
-					break;
-				hostlist_push(new_hl, name);
-				free(name);
-				i++;
-			}
-			thread_info[threads_used].nodelist = 
-				hostlist_ranged_string_xmalloc(new_hl);
-			hostlist_destroy(new_hl);
-			slurm_msg_t_init(&thread_info[threads_used].msg);
-			thread_info[threads_used].msg.msg_type =
-				REQUEST_FILE_BCAST;
-			threads_used++;
 		}
-		xfree(span);
-		hostlist_destroy(hl);
-		debug("using %d threads", threads_used);
+		nodes[thread_cnt] = hostlist_ranged_string_xmalloc(new_hl);
+		hostlist_destroy(new_hl);
+		thread_cnt++;
+	}
+	xfree(span);
+	hostlist_destroy(hl);
+	return thread_cnt;
+}
+
+/* Wait until no more than max_blocks blocks are still being sent,
+ * exit if any node failed to write a block */
+static void _wait_for_blocks(int max_blocks)
+{
+	slurm_mutex_lock(&agent_cnt_mutex);
+	while ((blocks_in_flight > max_blocks) && (agent_rc == 0))
+		pthread_cond_wait(&agent_cnt_cond, &agent_cnt_mutex);
+	slurm_mutex_unlock(&agent_cnt_mutex);
+
+	if (agent_rc)
+		exit(1);
+}
+
+/* Start agent threads sending one block to every node, or only to the
+ * nodes in node_list if set. Do not wait for them. */
+static void _start_block(file_bcast_msg_t *bcast_msg,
+			 job_sbcast_cred_msg_t *sbcast_cred,
+			 hostlist_t node_list)
+{
+	block_t *block;
+	thd_t *thread_ptr;
+	int i, retries = 0, thread_cnt;
+	char *sub_nodes[MAX_THREADS], *list_str;
+	pthread_attr_t attr;
+
+	if (node_list) {
+		list_str = hostlist_ranged_string_xmalloc(node_list);
+		thread_cnt = _split_nodes(list_str, hostlist_count(node_list),
+					  sub_nodes);
+		xfree(list_str);
+	} else {
+		if (threads_used == 0) {
+			threads_used = _split_nodes(sbcast_cred->node_list,
+						    sbcast_cred->node_cnt,
+						    thread_nodes);
+			debug("using %d threads", threads_used);
+		}
+		thread_cnt = threads_used;
 	}
 
+	block = xmalloc(sizeof(block_t));
+	memcpy(&block->msg, bcast_msg, sizeof(file_bcast_msg_t));
+	block->threads_left = thread_cnt;
+
 	slurm_attr_init(&attr);
 	if (pthread_attr_setstacksize(&attr, 3 * 1024*1024))
 		error("pthread_attr_setstacksize: %m");
@@ -183,32 +269,88 @@ extern void send_rpc(file_bcast_msg_t *bcast_msg,
 			PTHREAD_CREATE_DETACHED))
 		error("pthread_attr_setdetachstate error %m");
 
-	for (i=0; i<threads_used; i++) {
-		thread_info[i].msg.data = bcast_msg;
-		slurm_mutex_lock(&agent_cnt_mutex);
-		agent_cnt++;
-		slurm_mutex_unlock(&agent_cnt_mutex);
+	slurm_mutex_lock(&agent_cnt_mutex);
+	blocks_in_flight++;
+	agent_cnt += thread_cnt;
+	slurm_mutex_unlock(&agent_cnt_mutex);
+
+	for (i=0; i<thread_cnt; i++) {
+		thread_ptr = xmalloc(sizeof(thd_t));
+		if (node_list)
+			thread_ptr->nodelist = sub_nodes[i];
+		else
+			thread_ptr->nodelist = xstrdup(thread_nodes[i]);
+		thread_ptr->block = block;
+		slurm_msg_t_init(&thread_ptr->msg);
+		thread_ptr->msg.msg_type = REQUEST_FILE_BCAST;
+		/* compressed if CommunicationParameters allow */
+		thread_ptr->msg.flags = SLURM_MSG_COMPRESSED;
+		thread_ptr->msg.data = &block->msg;
 
-		while (pthread_create(&thread_info[i].thread,
+		while (pthread_create(&thread_ptr->thread,
 				      &attr, _agent_thread,
-				      (void *) &thread_info[i])) {
+				      (void *) thread_ptr)) {
 			error("pthread_create error %m");
 			if (++retries > MAX_RETRIES)
 				fatal("Can't create pthread");
 			sleep(1);	/* sleep and retry */
 		}
 	}
-
-	/* wait until pthreads complete */
-	slurm_mutex_lock(&agent_cnt_mutex);
-	while (agent_cnt)
-		pthread_cond_wait(&agent_cnt_cond, &agent_cnt_mutex);
-	slurm_mutex_unlock(&agent_cnt_mutex);
 	pthread_attr_destroy(&attr);
+}
+
+/* Issue the RPC to transfer the file's data, once every block sent
+ * earlier has been written and return after this one has been written */
+extern void send_rpc(file_bcast_msg_t *bcast_msg,
+		     job_sbcast_cred_msg_t *sbcast_cred)
+{
+	_wait_for_blocks(0);
+	_start_block(bcast_msg, sbcast_cred, NULL);
+	_wait_for_blocks(0);
+}
 
-	for (i=0; i<threads_used; i++)
-		 rc = MAX(rc, thread_info[i].rc);
+/* Issue the RPC to transfer the file's data and return as soon as fewer
+ * than params.pipeline blocks are in flight. The block's data must remain
+ * valid until a later send_rpc() returns. */
+extern void send_rpc_nowait(file_bcast_msg_t *bcast_msg,
+			    job_sbcast_cred_msg_t *sbcast_cred)
+{
+	_wait_for_blocks(MAX(params.pipeline, 1) - 1);
+	_start_block(bcast_msg, sbcast_cred, NULL);
+}
 
-	if (rc)
-		exit(1);
+/* Send the manifest of a deduplicated transfer to every node and record
+ * which blocks each of them still needs */
+extern void send_rpc_manifest(file_bcast_msg_t *bcast_msg,
+			      job_sbcast_cred_msg_t *sbcast_cred)
+{
+	need_cnt = bcast_msg->digest_cnt;
+	need_all = hostlist_create(NULL);
+	need_block = xmalloc(sizeof(hostlist_t) * need_cnt);
+	send_rpc(bcast_msg, sbcast_cred);
+}
+
+/* Like send_rpc_nowait(), but only to the nodes which need block
+ * block_inx of the manifest. RET false if no node needs it. */
+extern bool send_rpc_missing(file_bcast_msg_t *bcast_msg,
+			     job_sbcast_cred_msg_t *sbcast_cred,
+			     uint32_t block_inx)
+{
+	hostlist_t hl;
+
+	hl = hostlist_copy(need_all);
+	if (need_block[block_inx]) {
+		hostlist_push_list(hl, need_block[block_inx]);
+		hostlist_destroy(need_block[block_inx]);
+		need_block[block_inx] = NULL;
+	}
+	if (hostlist_count(hl) == 0) {
+		hostlist_destroy(hl);
+		return false;
+	}
+
+	_wait_for_blocks(MAX(params.pipeline, 1) - 1);
+	_start_block(bcast_msg, sbcast_cred, hl);
+	hostlist_destroy(hl);
+	return true;
 }
@@ -81,8 +81,10 @@ extern void parse_command_line(int argc, char *argv[])
 	int option_index;
 	static struct option long_options[] = {
 		{"compress",  no_argument,       0, 'C'},
+		{"dedup",     no_argument,       0, 'd'},
 		{"fanout",    required_argument, 0, 'F'},
 		{"force",     no_argument,       0, 'f'},
+		{"pipeline",  required_argument, 0, 'P'},
 		{"preserve",  no_argument,       0, 'p'},
 		{"size",      required_argument, 0, 's'},
 		{"timeout",   required_argument, 0, 't'},
@@ -93,12 +95,18 @@ extern void parse_command_line(int argc, char *argv[])
 		{NULL,        0,                 0, 0}
 	};
 
+	params.pipeline = DEFAULT_PIPELINE;
+
 	if (getenv("SBCAST_COMPRESS"))
 		params.compress = true;
+	if (getenv("SBCAST_DEDUP"))
+		params.dedup = true;
 	if ( ( env_val = getenv("SBCAST_FANOUT") ) )
 		params.fanout = atoi(env_val);
 	if (getenv("SBCAST_FORCE"))
 		params.force = true;
+	if ( ( env_val = getenv("SBCAST_PIPELINE") ) )
+		params.pipeline = atoi(env_val);
 	if (getenv("SBCAST_PRESERVE"))
 		params.preserve = true;
 	if ( ( env_val = getenv("SBCAST_SIZE") ) )
@@ -107,7 +115,7 @@ extern void parse_command_line(int argc, char *argv[])
 		params.timeout = (atoi(env_val) * 1000);
 
 	optind = 0;
-	while((opt_char = getopt_long(argc, argv, "CfF:ps:t:vV",
+	while((opt_char = getopt_long(argc, argv, "CdfF:pP:s:t:vV",
 			long_options, &option_index)) != -1) {
 		switch (opt_char) {
 		case (int)'?':
@@ -118,6 +126,9 @@ extern void parse_command_line(int argc, char *argv[])
 		case (int)'C':
 			params.compress = true;
 			break;
+		case (int)'d':
+			params.dedup = true;
+			break;
 		case (int)'f':
 			params.force = true;
 			break;
@@ -127,6 +138,9 @@ extern void parse_command_line(int argc, char *argv[])
 		case (int)'p':
 			params.preserve = true;
 			break;
+		case (int)'P':
+			params.pipeline = atoi(optarg);
+			break;
 		case (int) 's':
 			params.block_size = _map_size(optarg);
 			break;
@@ -197,8 +211,10 @@ static void _print_options( void )
 	info("-----------------------------");
 	info("block_size = %u", params.block_size);
 	info("compress   = %s", params.compress ? "true" : "false");
+	info("dedup      = %s", params.dedup ? "true" : "false");
 	info("force      = %s", params.force ? "true" : "false");
 	info("fanout     = %d", params.fanout);
+	info("pipeline   = %d", params.pipeline);
 	info("preserve   = %s", params.preserve ? "true" : "false");
 	info("timeout    = %d", params.timeout);
 	info("verbose    = %d", params.verbose);
@@ -210,7 +226,7 @@ static void _print_options( void )
 
 static void _usage( void )
 {
-	printf("Usage: sbcast [-CfFpvV] SOURCE DEST\n");
+	printf("Usage: sbcast [-CdfFpPvV] SOURCE DEST\n");
 }
 
 static void _help( void )
@@ -218,9 +234,11 @@ static void _help( void )
 	printf ("\
 Usage: sbcast [OPTIONS] SOURCE DEST\n\
   -C, --compress      compress the file being transmitted\n\
+  -d, --dedup         only send blocks the nodes do not already have\n\
   -f, --force         replace destination file as required\n\
   -F, --fanout=num    specify message fanout\n\
   -p, --preserve      preserve modes and times of source file\n\
+  -P, --pipeline=num  number of blocks to have in flight at once\n\
   -s, --size=num      block size in bytes (rounded off)\n\
   -t, --timeout=secs  specify message timeout (seconds)\n\
   -v, --verbose       provide detailed event logging\n\
@@ -47,16 +47,19 @@
 #include <stdlib.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
 #include "slurm/slurm_errno.h"
+#include "src/common/digest.h"
 #include "src/common/forward.h"
 #include "src/common/hostlist.h"
 #include "src/common/log.h"
 #include "src/common/slurm_cred.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
+#include "src/common/timers.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/sbcast/sbcast.h"
@@ -147,18 +150,8 @@ static void _get_job_info(void)
  * return number of bytes read, zero on end of file */
 static ssize_t _get_block(char *buffer, size_t buf_size)
 {
-	static int fd = 0;
 	ssize_t buf_used = 0, rc;
 
-	if (!fd) {
-		fd = open(params.src_fname, O_RDONLY);
-		if (!fd) {
-			error("Can't open `%s`: %s",
-			      params.src_fname, strerror(errno));
-			exit(1);
-		}
-	}
-
 	while (buf_size) {
 		rc = read(fd, buffer, buf_size);
 		if (rc == -1) {
@@ -179,13 +172,90 @@ static ssize_t _get_block(char *buffer, size_t buf_size)
 	return buf_used;
 }
 
+/* map the whole file to broadcast, return NULL if it can not be mapped */
+static char *_map_file(void)
+{
+	void *addr;
+
+	if ((f_stat.st_size == 0) ||
+	    ((off_t) (size_t) f_stat.st_size != f_stat.st_size))
+		return NULL;
+
+	addr = mmap(NULL, f_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		verbose("Can't mmap `%s`: %s, reading it instead",
+			params.src_fname, strerror(errno));
+		return NULL;
+	}
+	(void) madvise(addr, f_stat.st_size, MADV_SEQUENTIAL);
+	return (char *) addr;
+}
+
+/*
+ * Broadcast the mapped file, sending each node only the blocks it lacks.
+ * The first message carries a digest of every block, the nodes fill in
+ * the blocks they already have and reply with those they still need.
+ * A final empty block sets the file's attributes on every node.
+ */
+static void _bcast_file_dedup(file_bcast_msg_t *bcast_msg, char *map,
+			      int buf_size)
+{
+	slurm_digest_t digest;
+	uint32_t i, block_cnt, sent = 0;
+	off_t offset;
+	DEF_TIMERS;
+
+	block_cnt = (f_stat.st_size + buf_size - 1) / buf_size;
+	bcast_msg->digests = xmalloc(sizeof(uint64_t) * 2 * block_cnt);
+	START_TIMER;
+	for (i = 0, offset = 0; i < block_cnt; i++, offset += buf_size) {
+		slurm_digest(map + offset,
+			     MIN(buf_size, f_stat.st_size - offset), &digest);
+		bcast_msg->digests[i * 2]     = digest.h1;
+		bcast_msg->digests[i * 2 + 1] = digest.h2;
+	}
+	END_TIMER;
+	verbose("digests of %u blocks computed in %s", block_cnt, TIME_STR);
+
+	bcast_msg->digest_cnt	= block_cnt;
+	bcast_msg->block_size	= buf_size;
+	bcast_msg->file_size	= f_stat.st_size;
+	bcast_msg->block_no	= 1;
+	bcast_msg->block_offset	= 0;
+	bcast_msg->block_len	= 0;
+	bcast_msg->block	= NULL;
+	send_rpc_manifest(bcast_msg, sbcast_cred);
+	xfree(bcast_msg->digests);
+	bcast_msg->digest_cnt	= 0;
+
+	for (i = 0, offset = 0; i < block_cnt; i++, offset += buf_size) {
+		/* block_no 1 would create the file again */
+		bcast_msg->block_no	= MIN(i + 2, 0xffff);
+		bcast_msg->block_offset	= offset;
+		bcast_msg->block	= map + offset;
+		bcast_msg->block_len	= MIN(buf_size,
+					      f_stat.st_size - offset);
+		if (send_rpc_missing(bcast_msg, sbcast_cred, i))
+			sent++;
+	}
+
+	bcast_msg->block_no	= MIN(block_cnt + 2, 0xffff);
+	bcast_msg->block_offset	= f_stat.st_size;
+	bcast_msg->block	= NULL;
+	bcast_msg->block_len	= 0;
+	bcast_msg->last_block	= 1;
+	send_rpc(bcast_msg, sbcast_cred);
+	verbose("%u of %u blocks sent, the nodes had the others",
+		sent, block_cnt);
+}
+
 /* read and broadcast the file */
 static void _bcast_file(void)
 {
 	int buf_size;
-	ssize_t size_read = 0;
+	off_t size_read = 0;
 	file_bcast_msg_t bcast_msg;
-	char *buffer;
+	char *buffer = NULL, *map;
 
 	if (params.block_size)
 		buf_size = MIN(params.block_size, f_stat.st_size);
@@ -199,10 +269,12 @@ static void _bcast_file(void)
 	bcast_msg.modes		= f_stat.st_mode;
 	bcast_msg.uid		= f_stat.st_uid;
 	bcast_msg.gid		= f_stat.st_gid;
-	buffer			= xmalloc(buf_size);
-	bcast_msg.block		= buffer;
 	bcast_msg.block_len	= 0;
 	bcast_msg.cred          = sbcast_cred->sbcast_cred;
+	bcast_msg.digest_cnt	= 0;
+	bcast_msg.digests	= NULL;
+	bcast_msg.block_size	= 0;
+	bcast_msg.file_size	= 0;
 
 	if (params.preserve) {
 		bcast_msg.atime     = f_stat.st_atime;
@@ -212,19 +284,46 @@ static void _bcast_file(void)
 		bcast_msg.mtime     = 0;
 	}
 
+	/* Blocks are sent straight from the mapped file. Only then can
+	 * several of them be in flight, a read buffer is reused. */
+	if (!(map = _map_file())) {
+		buffer = xmalloc(buf_size);
+		params.pipeline = 1;
+	} else if (params.dedup) {
+		_bcast_file_dedup(&bcast_msg, map, buf_size);
+		munmap(map, f_stat.st_size);
+		return;
+	}
+
 	while (1) {
-		bcast_msg.block_len = _get_block(buffer, buf_size);
+		bcast_msg.block_offset = size_read;
+		if (map) {
+			bcast_msg.block = map + size_read;
+			bcast_msg.block_len = MIN(buf_size,
+						  f_stat.st_size - size_read);
+		} else {
+			bcast_msg.block = buffer;
+			bcast_msg.block_len = _get_block(buffer, buf_size);
+		}
 		debug("block %d, size %u", bcast_msg.block_no,
 		      bcast_msg.block_len);
 		size_read += bcast_msg.block_len;
 		if (size_read >= f_stat.st_size)
 			bcast_msg.last_block = 1;
 
-		send_rpc(&bcast_msg, sbcast_cred);
+		/* The first block creates the file and the last one sets
+		 * its modes, so those are never sent with others in flight */
+		if ((bcast_msg.block_no == 1) || bcast_msg.last_block ||
+		    (params.pipeline <= 1))
+			send_rpc(&bcast_msg, sbcast_cred);
+		else
+			send_rpc_nowait(&bcast_msg, sbcast_cred);
 		if (bcast_msg.last_block)
 			break;	/* end of file */
 		bcast_msg.block_no++;
 	}
 
+	if (map)
+		munmap(map, f_stat.st_size);
 	xfree(buffer);
 }
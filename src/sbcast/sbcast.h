@@ -48,11 +48,16 @@
 #include "src/common/macros.h"
 #include "src/common/slurm_protocol_defs.h"
 
+/* blocks in flight at once unless --pipeline is given */
+#define DEFAULT_PIPELINE 4
+
 struct sbcast_parameters {
 	uint32_t block_size;
 	bool compress;
+	bool dedup;
 	int  fanout;
 	bool force;
+	int  pipeline;
 	bool preserve;
 	int  timeout;
 	int  verbose;
@@ -65,5 +70,12 @@ extern struct sbcast_parameters params;
 extern void parse_command_line(int argc, char *argv[]);
 extern void send_rpc(file_bcast_msg_t *bcast_msg,
 		     job_sbcast_cred_msg_t *sbcast_cred);
+extern void send_rpc_nowait(file_bcast_msg_t *bcast_msg,
+			    job_sbcast_cred_msg_t *sbcast_cred);
+extern void send_rpc_manifest(file_bcast_msg_t *bcast_msg,
+			      job_sbcast_cred_msg_t *sbcast_cred);
+extern bool send_rpc_missing(file_bcast_msg_t *bcast_msg,
+			     job_sbcast_cred_msg_t *sbcast_cred,
+			     uint32_t block_inx);
 
 #endif
@@ -4520,7 +4520,13 @@ _copy_job_desc_to_job_record(job_desc_msg_t * job_desc,
 	job_ptr->mail_user = xstrdup(job_desc->mail_user);
 
 	job_ptr->ckpt_interval = job_desc->ckpt_interval;
-	job_ptr->spank_job_env = job_desc->spank_job_env;
+	if (xmalloc_in_arena(job_desc->spank_job_env)) {
+		/* RPC memory, released with the message */
+		job_ptr->spank_job_env = xduparray(
+			job_desc->spank_job_env_size + 1,
+			job_desc->spank_job_env);
+	} else
+		job_ptr->spank_job_env = job_desc->spank_job_env;
 	job_ptr->spank_job_env_size = job_desc->spank_job_env_size;
 	job_desc->spank_job_env = (char **) NULL; /* nothing left to free */
 	job_desc->spank_job_env_size = 0;         /* nothing left to free */
@@ -4534,7 +4540,12 @@ _copy_job_desc_to_job_record(job_desc_msg_t * job_desc,
 
 	detail_ptr = job_ptr->details;
 	detail_ptr->argc = job_desc->argc;
-	detail_ptr->argv = job_desc->argv;
+	if (xmalloc_in_arena(job_desc->argv)) {
+		/* RPC memory, released with the message */
+		detail_ptr->argv = xduparray(job_desc->argc + 1,
+					     job_desc->argv);
+	} else
+		detail_ptr->argv = job_desc->argv;
 	job_desc->argv   = (char **) NULL; /* nothing left to free */
 	job_desc->argc   = 0;		   /* nothing left to free */
 	detail_ptr->acctg_freq = job_desc->acctg_freq;
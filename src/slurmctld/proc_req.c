@@ -87,6 +87,22 @@
 
 #include "src/plugins/select/bluegene/bg_enums.h"
 
+/*
+ * Epilog completions waiting to be applied. The RPC thread which finds
+ * no other thread applying them applies all those queued, including any
+ * arriving meanwhile, under one job write lock per pass.
+ */
+typedef struct epilog_comp {
+	uint32_t job_id;
+	char    *node_name;
+	uint32_t return_code;
+} epilog_comp_t;
+
+static List            epilog_comp_list  = NULL;
+static bool            epilog_comp_busy  = false;
+static pthread_mutex_t epilog_comp_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void         _epilog_comp_del(void *x);
 static void         _fill_ctld_conf(slurm_ctl_conf_t * build_ptr);
 static void         _kill_job_on_msg_fail(uint32_t job_id);
 static int 	    _launch_batch_step(job_desc_msg_t *job_desc_msg,
@@ -464,6 +480,7 @@ void _fill_ctld_conf(slurm_ctl_conf_t * conf_ptr)
 
 	conf_ptr->checkpoint_type     = xstrdup(conf->checkpoint_type);
 	conf_ptr->cluster_name        = xstrdup(conf->cluster_name);
+	conf_ptr->comm_params         = xstrdup(conf->comm_params);
 	conf_ptr->complete_wait       = conf->complete_wait;
 	conf_ptr->control_addr        = xstrdup(conf->control_addr);
 	conf_ptr->control_machine     = xstrdup(conf->control_machine);
@@ -496,6 +513,7 @@ void _fill_ctld_conf(slurm_ctl_conf_t * conf_ptr)
 	conf_ptr->job_ckpt_dir        = xstrdup(conf->job_ckpt_dir);
 	conf_ptr->job_comp_host       = xstrdup(conf->job_comp_host);
 	conf_ptr->job_comp_loc        = xstrdup(conf->job_comp_loc);
+	conf_ptr->job_comp_params     = xstrdup(conf->job_comp_params);
 	conf_ptr->job_comp_port       = conf->job_comp_port;
 	conf_ptr->job_comp_type       = xstrdup(conf->job_comp_type);
 	conf_ptr->job_comp_user       = xstrdup(conf->job_comp_user);
@@ -516,6 +534,7 @@ void _fill_ctld_conf(slurm_ctl_conf_t * conf_ptr)
 	conf_ptr->licenses            = xstrdup(conf->licenses);
 
 	conf_ptr->mail_prog           = xstrdup(conf->mail_prog);
+	conf_ptr->max_dbd_msgs        = conf->max_dbd_msgs;
 	conf_ptr->max_job_cnt         = conf->max_job_cnt;
 	conf_ptr->max_job_id          = conf->max_job_id;
 	conf_ptr->max_mem_per_cpu     = conf->max_mem_per_cpu;
@@ -595,6 +614,7 @@ void _fill_ctld_conf(slurm_ctl_conf_t * conf_ptr)
 	conf_ptr->slurmd_port         = conf->slurmd_port;
 	conf_ptr->slurmd_spooldir     = xstrdup(conf->slurmd_spooldir);
 	conf_ptr->slurmd_timeout      = conf->slurmd_timeout;
+	conf_ptr->slurmstepd_pool_size = conf->slurmstepd_pool_size;
 	conf_ptr->slurmd_user_id      = conf->slurmd_user_id;
 	conf_ptr->slurmd_user_name    = xstrdup(conf->slurmd_user_name);
 	conf_ptr->slurm_conf          = xstrdup(conf->slurm_conf);
@@ -1245,8 +1265,20 @@ static void _slurm_rpc_dump_partitions(slurm_msg_t * msg)
 	}
 }
 
+static void _epilog_comp_del(void *x)
+{
+	epilog_comp_t *comp = (epilog_comp_t *) x;
+
+	if (comp) {
+		xfree(comp->node_name);
+		xfree(comp);
+	}
+}
+
 /* _slurm_rpc_epilog_complete - process RPC noting the completion of
- * the epilog denoting the completion of a job it its entirety */
+ * the epilog denoting the completion of a job it its entirety.
+ * Completions arriving together, as when a large job ends, are applied
+ * in batches under a single lock and followed by a single schedule(). */
 static void  _slurm_rpc_epilog_complete(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
@@ -1256,32 +1288,69 @@ static void  _slurm_rpc_epilog_complete(slurm_msg_t * msg)
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 	epilog_complete_msg_t *epilog_msg =
 		(epilog_complete_msg_t *) msg->data;
+	epilog_comp_t *comp;
+	List comp_list;
+	int comp_cnt = 0, pass_cnt = 0;
 	bool run_scheduler = false;
 
-	START_TIMER;
 	debug2("Processing RPC: MESSAGE_EPILOG_COMPLETE uid=%d", uid);
-	lock_slurmctld(job_write_lock);
 	if (!validate_slurm_user(uid)) {
-		unlock_slurmctld(job_write_lock);
 		error("Security violation, EPILOG_COMPLETE RPC from uid=%d",
 		      uid);
 		return;
 	}
 
-	if (job_epilog_complete(epilog_msg->job_id, epilog_msg->node_name,
-				epilog_msg->return_code))
-		run_scheduler = true;
-	unlock_slurmctld(job_write_lock);
-	END_TIMER2("_slurm_rpc_epilog_complete");
+	comp = xmalloc(sizeof(epilog_comp_t));
+	comp->job_id      = epilog_msg->job_id;
+	comp->node_name   = xstrdup(epilog_msg->node_name);
+	comp->return_code = epilog_msg->return_code;
+
+	slurm_mutex_lock(&epilog_comp_mutex);
+	if (epilog_comp_list == NULL)
+		epilog_comp_list = list_create(_epilog_comp_del);
+	list_append(epilog_comp_list, comp);
+	if (epilog_comp_busy) {
+		/* The thread applying completions will get to this one */
+		slurm_mutex_unlock(&epilog_comp_mutex);
+		return;
+	}
+	epilog_comp_busy = true;
 
-	if (epilog_msg->return_code)
-		error("_slurm_rpc_epilog_complete JobId=%u Node=%s Err=%s %s",
-		      epilog_msg->job_id, epilog_msg->node_name,
-		      slurm_strerror(epilog_msg->return_code), TIME_STR);
-	else
-		debug2("_slurm_rpc_epilog_complete JobId=%u Node=%s %s",
-		       epilog_msg->job_id, epilog_msg->node_name,
-		       TIME_STR);
+	START_TIMER;
+	while (list_count(epilog_comp_list)) {
+		comp_list = epilog_comp_list;
+		epilog_comp_list = list_create(_epilog_comp_del);
+		slurm_mutex_unlock(&epilog_comp_mutex);
+
+		lock_slurmctld(job_write_lock);
+		while ((comp = list_pop(comp_list))) {
+			if (job_epilog_complete(comp->job_id, comp->node_name,
+						comp->return_code))
+				run_scheduler = true;
+			if (comp->return_code) {
+				error("_slurm_rpc_epilog_complete JobId=%u "
+				      "Node=%s Err=%s", comp->job_id,
+				      comp->node_name,
+				      slurm_strerror(comp->return_code));
+			} else {
+				debug2("_slurm_rpc_epilog_complete JobId=%u "
+				       "Node=%s", comp->job_id,
+				       comp->node_name);
+			}
+			_epilog_comp_del(comp);
+			comp_cnt++;
+		}
+		unlock_slurmctld(job_write_lock);
+		list_destroy(comp_list);
+		pass_cnt++;
+
+		slurm_mutex_lock(&epilog_comp_mutex);
+	}
+	epilog_comp_busy = false;
+	slurm_mutex_unlock(&epilog_comp_mutex);
+	END_TIMER2("_slurm_rpc_epilog_complete");
+	debug2("_slurm_rpc_epilog_complete: %d epilogs in %d passes %s",
+	       comp_cnt, pass_cnt, TIME_STR);
 
 	/* Functions below provide their own locking */
 	if (run_scheduler) {
@@ -3492,7 +3561,7 @@ inline static void  _slurm_rpc_checkpoint_task_comp(slurm_msg_t * msg)
 /* Copy an array of type char **, xmalloc() the array and xstrdup() the
  * strings in the array */
 extern char **
-xduparray(uint16_t size, char ** array)
+xduparray(uint32_t size, char ** array)
 {
 	int i;
 	char ** result;
@@ -3510,7 +3579,7 @@ xduparray(uint16_t size, char ** array)
 /* Like xduparray(), but performs one xmalloc().  The output format of this
  * must be identical to _read_data_array_from_file() */
 static char **
-_xduparray2(uint16_t size, char ** array)
+_xduparray2(uint32_t size, char ** array)
 {
 	int i, len = 0;
 	char *ptr, ** result;
@@ -0,0 +1,915 @@
+/*****************************************************************************\
+ *  src/slurmd/slurmd/file_bcast.c - write sbcast file blocks as the requesting user
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/poll.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "src/common/digest.h"
+#include "src/common/fd.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/uid.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmd/slurmd/file_bcast.h"
+#include "src/slurmd/slurmd/slurmd.h"
+
+/* A writer nobody has used for this long is closed by slurmd, a writer
+ * which has not heard from slurmd for twice as long exits by itself */
+#define WRITER_IDLE_TIME 300
+
+#define CACHE_SIZE	65536	/* blocks remembered by the block cache */
+#define CACHE_BUCKETS	4096
+
+/* What a writer is sent ahead of each block's data */
+typedef struct bcast_hdr {
+	uint64_t offset;	/* file offset or SBCAST_APPEND_OFFSET */
+	uint32_t len;		/* length of the data that follows */
+	uint16_t last_block;	/* set the file attributes below */
+	uint16_t modes;
+	uint32_t uid;
+	uint32_t gid;
+	time_t atime;
+	time_t mtime;
+} bcast_hdr_t;
+
+typedef struct bcast_writer {
+	uint32_t job_id;
+	uid_t uid;
+	char *fname;
+	int to_writer;		/* write end of the writer's request pipe */
+	int from_writer;	/* read end of the writer's reply pipe */
+	pthread_mutex_t mutex;	/* one block at a time to each writer */
+	int refcnt;		/* threads using this writer */
+	bool dead;		/* removed from writer_list */
+	time_t last_used;
+	uint32_t digest_cnt;	/* manifest of a deduplicated transfer */
+	uint64_t *digests;
+	uint32_t block_size;
+	uint64_t file_size;
+	struct bcast_writer *next;
+} bcast_writer_t;
+
+/* Where a block of known content was last written on this node. Entries
+ * are only used for transfers by the same user, and every block copied
+ * from one is checked against its digest first. */
+typedef struct cache_ent {
+	uid_t uid;
+	slurm_digest_t digest;
+	uint32_t len;
+	uint64_t offset;
+	char *fname;
+	struct cache_ent *next;	/* next in hash bucket */
+} cache_ent_t;
+
+/* Protects writer_list, each writer's refcnt and dead, and the block
+ * cache, so that a writer is forked with a consistent copy of the cache */
+static pthread_mutex_t writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bcast_writer_t *writer_list = NULL;
+static cache_ent_t *cache_ring = NULL;	/* oldest entry at cache_next */
+static cache_ent_t *cache_hash[CACHE_BUCKETS];
+static int cache_next = 0;
+
+static int
+_init_groups(uid_t my_uid, gid_t my_gid)
+{
+	char *user_name = uid_to_string(my_uid);
+	int rc;
+
+	if (user_name == NULL) {
+		error("sbcast: Could not find uid %ld", (long)my_uid);
+		return -1;
+	}
+
+	rc = initgroups(user_name, my_gid);
+	if (rc) {
+		error("sbcast: Error in initgroups(%s, %ld): %m",
+		      user_name, (long)my_gid);
+	}
+	xfree(user_name);
+	return 0;
+}
+
+/* Switch the calling process to the requesting user's identity,
+ * RET SLURM_SUCCESS or an errno value */
+static int
+_become_user(uid_t req_uid, gid_t req_gid)
+{
+	if (_init_groups(req_uid, req_gid) < 0) {
+		error("sbcast: initgroups(%u): %m", req_uid);
+		return errno;
+	}
+	if (setgid(req_gid) < 0) {
+		error("sbcast: uid:%u setgid(%u): %s", req_uid, req_gid,
+		      strerror(errno));
+		return errno;
+	}
+	if (setuid(req_uid) < 0) {
+		error("sbcast: getuid(%u): %s", req_uid, strerror(errno));
+		return errno;
+	}
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Open the destination file for a block. If reuse is set (the writer of a
+ * deduplicated transfer), an existing file is not truncated so its
+ * content can be checked against the manifest.
+ */
+static int
+_open_file(file_bcast_msg_t *req, uid_t req_uid, bool reuse, int *fd)
+{
+	int flags = reuse ? O_RDWR : O_WRONLY;
+
+	if (req->block_no == 1) {
+		flags |= O_CREAT;
+		if (!req->force)
+			flags |= O_EXCL;
+		else if (!reuse)
+			flags |= O_TRUNC;
+	} else if (req->block_offset == SBCAST_APPEND_OFFSET)
+		flags |= O_APPEND;
+
+	*fd = open(req->fname, flags, 0700);
+	if (*fd == -1) {
+		int rc = errno;
+		/* Deduplicated transfers check an existing file first */
+		if ((rc != EEXIST) || !req->digest_cnt)
+			error("sbcast: uid:%u can't open `%s`: %s",
+			      req_uid, req->fname, strerror(rc));
+		return rc;
+	}
+	return SLURM_SUCCESS;
+}
+
+static int
+_write_block(int fd, uid_t req_uid, char *fname, uint64_t block_offset,
+	     char *block, uint32_t block_len)
+{
+	uint32_t offset = 0;
+	ssize_t inx;
+
+	while (block_len - offset) {
+		if (block_offset == SBCAST_APPEND_OFFSET) {
+			inx = write(fd, &block[offset], (block_len - offset));
+		} else {
+			inx = pwrite(fd, &block[offset], (block_len - offset),
+				     (off_t) (block_offset + offset));
+		}
+		if (inx == -1) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			error("sbcast: uid:%u can't write `%s`: %s",
+			      req_uid, fname, strerror(errno));
+			return errno;
+		}
+		offset += inx;
+	}
+	return SLURM_SUCCESS;
+}
+
+/* Close the file, setting its attributes after the last block */
+static void
+_close_file(int fd, uid_t req_uid, char *fname, bcast_hdr_t *hdr)
+{
+	if (hdr->last_block && fchmod(fd, (hdr->modes & 0777))) {
+		error("sbcast: uid:%u can't chmod `%s`: %s",
+		      req_uid, fname, strerror(errno));
+	}
+	if (hdr->last_block && fchown(fd, hdr->uid, hdr->gid)) {
+		error("sbcast: uid:%u can't chown `%s`: %s",
+		      req_uid, fname, strerror(errno));
+	}
+	close(fd);
+	if (hdr->last_block && hdr->atime) {
+		struct utimbuf time_buf;
+		time_buf.actime  = hdr->atime;
+		time_buf.modtime = hdr->mtime;
+		if (utime(fname, &time_buf)) {
+			error("sbcast: uid:%u can't utime `%s`: %s",
+			      req_uid, fname, strerror(errno));
+		}
+	}
+}
+
+static void
+_init_hdr(file_bcast_msg_t *req, bcast_hdr_t *hdr)
+{
+	memset(hdr, 0, sizeof(bcast_hdr_t));
+	hdr->offset	= req->block_offset;
+	hdr->len	= req->block_len;
+	hdr->last_block	= req->last_block;
+	hdr->modes	= req->modes;
+	hdr->uid	= req->uid;
+	hdr->gid	= req->gid;
+	hdr->atime	= req->atime;
+	hdr->mtime	= req->mtime;
+}
+
+static void
+_manifest_block(uint32_t block_size, uint64_t file_size, uint64_t *digests,
+		uint32_t inx, uint64_t *offset, uint32_t *len,
+		slurm_digest_t *digest)
+{
+	*offset = (uint64_t) inx * block_size;
+	*len = MIN(block_size, file_size - *offset);
+	digest->h1 = digests[inx * 2];
+	digest->h2 = digests[inx * 2 + 1];
+}
+
+/* Callers must hold writer_mutex, or be a writer process */
+static cache_ent_t *
+_cache_find(uid_t uid, slurm_digest_t *digest, uint32_t len)
+{
+	cache_ent_t *ent;
+
+	ent = cache_hash[digest->h1 % CACHE_BUCKETS];
+	for ( ; ent; ent = ent->next) {
+		if ((ent->uid == uid) && (ent->len == len) &&
+		    slurm_digest_eq(&ent->digest, digest))
+			return ent;
+	}
+	return NULL;
+}
+
+/* Callers must hold writer_mutex */
+static void
+_cache_add(uid_t uid, slurm_digest_t *digest, char *fname,
+	   uint64_t offset, uint32_t len)
+{
+	cache_ent_t *ent, **ep;
+
+	if ((ent = _cache_find(uid, digest, len))) {
+		/* Remember the latest copy */
+		if (strcmp(ent->fname, fname)) {
+			xfree(ent->fname);
+			ent->fname = xstrdup(fname);
+		}
+		ent->offset = offset;
+		return;
+	}
+
+	if (!cache_ring)
+		cache_ring = xmalloc(sizeof(cache_ent_t) * CACHE_SIZE);
+	ent = &cache_ring[cache_next];
+	cache_next = (cache_next + 1) % CACHE_SIZE;
+	if (ent->fname) {
+		/* Evict the oldest entry */
+		ep = &cache_hash[ent->digest.h1 % CACHE_BUCKETS];
+		for ( ; *ep; ep = &(*ep)->next) {
+			if (*ep == ent) {
+				*ep = ent->next;
+				break;
+			}
+		}
+		xfree(ent->fname);
+	}
+
+	ent->uid = uid;
+	ent->digest = *digest;
+	ent->len = len;
+	ent->offset = offset;
+	ent->fname = xstrdup(fname);
+	ent->next = cache_hash[digest->h1 % CACHE_BUCKETS];
+	cache_hash[digest->h1 % CACHE_BUCKETS] = ent;
+}
+
+/* Record every block of a completed deduplicated transfer.
+ * Callers must hold writer_mutex */
+static void
+_cache_file(bcast_writer_t *writer)
+{
+	slurm_digest_t digest;
+	uint64_t offset;
+	uint32_t i, len;
+
+	for (i = 0; i < writer->digest_cnt; i++) {
+		_manifest_block(writer->block_size, writer->file_size,
+				writer->digests, i, &offset, &len, &digest);
+		_cache_add(writer->uid, &digest, writer->fname, offset, len);
+	}
+}
+
+/* Read len bytes at offset of fd into buf, return true if they match
+ * digest */
+static bool
+_read_match(int fd, uint64_t offset, uint32_t len, slurm_digest_t *digest,
+	    char *buf)
+{
+	slurm_digest_t found;
+	uint32_t done = 0;
+	ssize_t inx;
+
+	while (done < len) {
+		inx = pread(fd, buf + done, len - done,
+			    (off_t) (offset + done));
+		if (inx == -1) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			return false;
+		} else if (inx == 0)
+			return false;
+		done += inx;
+	}
+	slurm_digest(buf, len, &found);
+	return slurm_digest_eq(&found, digest);
+}
+
+/*
+ * In a writer process of a deduplicated transfer, fill in every block of
+ * the manifest which is already in the destination file or can be copied
+ * from a file in the block cache (read as the user, so only files the
+ * user can read are used).
+ * RET the indexes of the blocks which must still be sent
+ */
+static uint32_t *
+_fill_blocks(int fd, file_bcast_msg_t *req, uid_t req_uid,
+	     uint32_t *missing_cnt)
+{
+	slurm_digest_t digest;
+	struct stat stat_buf;
+	cache_ent_t *ent;
+	uint64_t old_size = 0, offset;
+	uint32_t i, len, *missing, reused = 0;
+	char *buf, *src_name = NULL;
+	int src_fd = -1;
+
+	if (fstat(fd, &stat_buf) == 0)
+		old_size = stat_buf.st_size;
+	buf = xmalloc(req->block_size);
+	missing = xmalloc(sizeof(uint32_t) * req->digest_cnt);
+	*missing_cnt = 0;
+
+	for (i = 0; i < req->digest_cnt; i++) {
+		_manifest_block(req->block_size, req->file_size,
+				req->digests, i, &offset, &len, &digest);
+		if (((offset + len) <= old_size) &&
+		    _read_match(fd, offset, len, &digest, buf)) {
+			reused++;
+			continue;
+		}
+
+		ent = _cache_find(req_uid, &digest, len);
+		if (ent && (!src_name || strcmp(src_name, ent->fname))) {
+			if (src_fd >= 0)
+				close(src_fd);
+			src_name = ent->fname;
+			src_fd = open(src_name, O_RDONLY);
+		}
+		if (ent && (src_fd >= 0) &&
+		    _read_match(src_fd, ent->offset, len, &digest, buf) &&
+		    (_write_block(fd, req_uid, req->fname, offset, buf, len)
+		     == SLURM_SUCCESS)) {
+			reused++;
+			continue;
+		}
+
+		missing[(*missing_cnt)++] = i;
+	}
+	if (src_fd >= 0)
+		close(src_fd);
+	xfree(buf);
+
+	if (ftruncate(fd, (off_t) req->file_size)) {
+		error("sbcast: uid:%u can't truncate `%s`: %s",
+		      req_uid, req->fname, strerror(errno));
+	}
+	debug("sbcast: `%s` %u of %u blocks already present",
+	      req->fname, reused, req->digest_cnt);
+	return missing;
+}
+
+/*
+ * Check if the existing destination file of a deduplicated transfer is
+ * the one being sent: same size, same mtime if it is preserved, and
+ * every block matching the manifest. Called as the user.
+ */
+static bool
+_same_file(file_bcast_msg_t *req)
+{
+	slurm_digest_t digest;
+	struct stat stat_buf;
+	uint64_t offset;
+	uint32_t i, len;
+	char *buf;
+	bool same = true;
+	int fd;
+
+	if ((fd = open(req->fname, O_RDONLY)) < 0)
+		return false;
+	if ((fstat(fd, &stat_buf) < 0) || !S_ISREG(stat_buf.st_mode) ||
+	    ((uint64_t) stat_buf.st_size != req->file_size) ||
+	    (req->mtime && (stat_buf.st_mtime != req->mtime))) {
+		close(fd);
+		return false;
+	}
+	buf = xmalloc(req->block_size);
+	for (i = 0; same && (i < req->digest_cnt); i++) {
+		_manifest_block(req->block_size, req->file_size,
+				req->digests, i, &offset, &len, &digest);
+		same = _read_match(fd, offset, len, &digest, buf);
+	}
+	xfree(buf);
+	close(fd);
+	return same;
+}
+
+/* Write one block from a child forked for it alone */
+static int
+_fork_write(file_bcast_msg_t *req, uid_t req_uid, gid_t req_gid)
+{
+	bcast_hdr_t hdr;
+	int fd, rc;
+	pid_t child;
+
+	child = fork();
+	if (child == -1) {
+		error("sbcast: fork failure");
+		return errno;
+	} else if (child > 0) {
+		waitpid(child, &rc, 0);
+		return WEXITSTATUS(rc);
+	}
+
+	/* The child actually performs the I/O and exits with
+	 * a return code, do not return! */
+	if ((rc = _become_user(req_uid, req_gid)))
+		exit(rc);
+	rc = _open_file(req, req_uid, false, &fd);
+	if ((rc == EEXIST) && req->digest_cnt) {
+		if (_same_file(req))
+			exit(SLURM_SUCCESS);
+		error("sbcast: uid:%u can't open `%s`: %s",
+		      req_uid, req->fname, strerror(rc));
+	}
+	if (rc)
+		exit(rc);
+	rc = _write_block(fd, req_uid, req->fname, req->block_offset,
+			  req->block, req->block_len);
+	if (rc) {
+		close(fd);
+		exit(rc);
+	}
+	_init_hdr(req, &hdr);
+	_close_file(fd, req_uid, req->fname, &hdr);
+	exit(SLURM_SUCCESS);
+}
+
+/*
+ * Writer process: open the file, report the result (and for a
+ * deduplicated transfer, the blocks still needed) and then write each
+ * block slurmd sends, replying with the result of each. Exits after the
+ * last block, an error, or when slurmd closes the pipe.
+ */
+static void
+_writer_main(file_bcast_msg_t *req, uid_t req_uid, gid_t req_gid,
+	     int in, int out)
+{
+	struct pollfd pfd;
+	bcast_hdr_t hdr;
+	char *block = NULL;
+	uint32_t block_size = 0;
+	int fd = -1, rc;
+	bool unchanged = false;
+
+	if ((rc = _become_user(req_uid, req_gid)) == SLURM_SUCCESS)
+		rc = _open_file(req, req_uid, (req->digest_cnt > 0), &fd);
+	if ((rc == EEXIST) && req->digest_cnt) {
+		if (_same_file(req)) {
+			/* Already there, nothing is written, not even
+			 * the attributes set after the last block */
+			debug("sbcast: `%s` already present", req->fname);
+			unchanged = true;
+			rc = SLURM_SUCCESS;
+		} else {
+			error("sbcast: uid:%u can't open `%s`: %s",
+			      req_uid, req->fname, strerror(rc));
+		}
+	}
+	fd_write_n(out, &rc, sizeof(int));
+	if (rc)
+		exit(rc);
+
+	if (unchanged) {
+		uint32_t missing_cnt = 0;
+		fd_write_n(out, &missing_cnt, sizeof(uint32_t));
+	} else if (req->digest_cnt) {
+		uint32_t missing_cnt, *missing;
+		missing = _fill_blocks(fd, req, req_uid, &missing_cnt);
+		fd_write_n(out, &missing_cnt, sizeof(uint32_t));
+		fd_write_n(out, missing, sizeof(uint32_t) * missing_cnt);
+		xfree(missing);
+	}
+
+	while (1) {
+		pfd.fd = in;
+		pfd.events = POLLIN;
+		rc = poll(&pfd, 1, WRITER_IDLE_TIME * 2 * 1000);
+		if ((rc < 0) && (errno == EINTR))
+			continue;
+		if (rc <= 0)
+			break;
+		if (fd_read_n(in, &hdr, sizeof(hdr)) != sizeof(hdr))
+			break;
+		if (hdr.len > block_size) {
+			block_size = hdr.len;
+			xrealloc(block, block_size);
+		}
+		if (fd_read_n(in, block, hdr.len) != (ssize_t) hdr.len)
+			break;
+
+		if (unchanged)
+			rc = SLURM_SUCCESS;
+		else
+			rc = _write_block(fd, req_uid, req->fname, hdr.offset,
+					  block, hdr.len);
+		if ((rc == SLURM_SUCCESS) && hdr.last_block && !unchanged) {
+			_close_file(fd, req_uid, req->fname, &hdr);
+			fd = -1;
+		}
+		fd_write_n(out, &rc, sizeof(int));
+		if (rc || hdr.last_block)
+			break;
+	}
+	if (fd >= 0)
+		close(fd);
+	exit(0);
+}
+
+/* Close every file descriptor above stderr except in and out */
+static void
+_close_fds_except(int in, int out)
+{
+	int fd, fdlimit = sysconf(_SC_OPEN_MAX);
+
+	for (fd = STDERR_FILENO + 1; fd < fdlimit; fd++) {
+		if ((fd != in) && (fd != out))
+			close(fd);
+	}
+}
+
+/*
+ * Start a writer for req's file. Forks twice so the writer's parent is
+ * init and it need not be reaped.
+ * Callers must hold writer_mutex.
+ */
+static int
+_spawn_writer(file_bcast_msg_t *req, uid_t req_uid, gid_t req_gid,
+	      bcast_writer_t *writer)
+{
+	int to_writer[2] = {-1, -1};
+	int from_writer[2] = {-1, -1};
+	pid_t pid;
+
+	if (pipe(to_writer) < 0) {
+		error("sbcast: writer pipe failed: %m");
+		return SLURM_ERROR;
+	}
+	if (pipe(from_writer) < 0) {
+		error("sbcast: writer pipe failed: %m");
+		close(to_writer[0]);
+		close(to_writer[1]);
+		return SLURM_ERROR;
+	}
+	fd_set_close_on_exec(to_writer[1]);
+	fd_set_close_on_exec(from_writer[0]);
+
+	if ((pid = fork()) < 0) {
+		error("sbcast: writer fork failure: %m");
+		close(to_writer[0]);
+		close(to_writer[1]);
+		close(from_writer[0]);
+		close(from_writer[1]);
+		return SLURM_ERROR;
+	} else if (pid == 0) {
+		/* The writer may outlive slurmd's use of any other file
+		 * it inherited: other writers and spare slurmstepd must
+		 * see EOF when slurmd closes their pipes, and slurmd must
+		 * be able to restart, so keep only our own pipe ends */
+		_close_fds_except(to_writer[0], from_writer[1]);
+
+		if ((pid = fork()) < 0) {
+			error("sbcast: Unable to fork writer: %m");
+			exit(1);
+		} else if (pid > 0) {
+			exit(0);
+		}
+		_writer_main(req, req_uid, req_gid,
+			     to_writer[0], from_writer[1]);
+	}
+
+	close(to_writer[0]);
+	close(from_writer[1]);
+	if (waitpid(pid, NULL, 0) < 0)
+		error("sbcast: Unable to reap slurmd child process");
+
+	writer->to_writer = to_writer[1];
+	writer->from_writer = from_writer[0];
+	return SLURM_SUCCESS;
+}
+
+/* Callers must hold writer_mutex */
+static void
+_free_writer(bcast_writer_t *writer)
+{
+	/* The writer exits when it reads EOF */
+	close(writer->to_writer);
+	close(writer->from_writer);
+	slurm_mutex_destroy(&writer->mutex);
+	xfree(writer->fname);
+	xfree(writer->digests);
+	xfree(writer);
+}
+
+/* Remove a writer from writer_list, it is freed once no longer in use.
+ * Callers must hold writer_mutex */
+static void
+_unlink_writer(bcast_writer_t *writer)
+{
+	bcast_writer_t **wp;
+
+	for (wp = &writer_list; *wp; wp = &(*wp)->next) {
+		if (*wp == writer) {
+			*wp = writer->next;
+			break;
+		}
+	}
+	writer->dead = true;
+	if (writer->refcnt == 0)
+		_free_writer(writer);
+}
+
+/* Callers must hold writer_mutex */
+static void
+_purge_idle_writers(void)
+{
+	bcast_writer_t *w, *next;
+	time_t now = time(NULL);
+
+	for (w = writer_list; w; w = next) {
+		next = w->next;
+		if ((w->refcnt == 0) &&
+		    (difftime(now, w->last_used) > WRITER_IDLE_TIME)) {
+			debug("sbcast: closing idle writer for `%s`",
+			      w->fname);
+			_unlink_writer(w);
+		}
+	}
+}
+
+/* Callers must hold writer_mutex */
+static bcast_writer_t *
+_find_writer(uint32_t job_id, uid_t req_uid, char *fname)
+{
+	bcast_writer_t *w;
+
+	for (w = writer_list; w; w = w->next) {
+		if ((w->job_id == job_id) && (w->uid == req_uid) &&
+		    !strcmp(w->fname, fname))
+			return w;
+	}
+	return NULL;
+}
+
+/* Give up a writer returned by _get_writer(), removing it if done */
+static void
+_put_writer(bcast_writer_t *writer, bool done)
+{
+	writer->last_used = time(NULL);
+	slurm_mutex_unlock(&writer->mutex);
+
+	slurm_mutex_lock(&writer_mutex);
+	writer->refcnt--;
+	if (writer->dead) {
+		if (writer->refcnt == 0)
+			_free_writer(writer);
+	} else if (done)
+		_unlink_writer(writer);
+	slurm_mutex_unlock(&writer_mutex);
+}
+
+/*
+ * Find or start the writer for req's file and lock it. A writer started
+ * for a deduplicated transfer returns the blocks it still needs in
+ * *missing.
+ * RET the writer, or NULL with *rc set to SLURM_ERROR if no writer could
+ * be used or to an errno value if the file could not be opened
+ */
+static bcast_writer_t *
+_get_writer(file_bcast_msg_t *req, uint32_t job_id, uid_t req_uid,
+	    gid_t req_gid, int *rc, uint32_t **missing, uint32_t *missing_cnt)
+{
+	bcast_writer_t *writer;
+	int status;
+
+	slurm_mutex_lock(&writer_mutex);
+	_purge_idle_writers();
+	writer = _find_writer(job_id, req_uid, req->fname);
+	if (writer && (req->block_no == 1)) {
+		/* The file is being sent again, the old writer is stale */
+		_unlink_writer(writer);
+		writer = NULL;
+	}
+	if (writer) {
+		writer->refcnt++;
+		slurm_mutex_unlock(&writer_mutex);
+		slurm_mutex_lock(&writer->mutex);
+		return writer;
+	}
+
+	writer = xmalloc(sizeof(bcast_writer_t));
+	if (_spawn_writer(req, req_uid, req_gid, writer) != SLURM_SUCCESS) {
+		slurm_mutex_unlock(&writer_mutex);
+		xfree(writer);
+		*rc = SLURM_ERROR;
+		return NULL;
+	}
+	writer->job_id = job_id;
+	writer->uid = req_uid;
+	writer->fname = xstrdup(req->fname);
+	if (req->digest_cnt) {
+		writer->digest_cnt = req->digest_cnt;
+		writer->digests = xmalloc(sizeof(uint64_t) * 2 *
+					  req->digest_cnt);
+		memcpy(writer->digests, req->digests,
+		       sizeof(uint64_t) * 2 * req->digest_cnt);
+		writer->block_size = req->block_size;
+		writer->file_size = req->file_size;
+	}
+	slurm_mutex_init(&writer->mutex);
+	writer->refcnt = 1;
+	writer->next = writer_list;
+	writer_list = writer;
+	slurm_mutex_lock(&writer->mutex);
+	slurm_mutex_unlock(&writer_mutex);
+
+	if (fd_read_n(writer->from_writer, &status, sizeof(int)) !=
+	    sizeof(int))
+		status = SLURM_ERROR;
+	if ((status == SLURM_SUCCESS) && req->digest_cnt) {
+		if ((fd_read_n(writer->from_writer, missing_cnt,
+			       sizeof(uint32_t)) != sizeof(uint32_t)) ||
+		    (*missing_cnt > req->digest_cnt)) {
+			status = SLURM_ERROR;
+		} else {
+			*missing = xmalloc(sizeof(uint32_t) *
+					   (*missing_cnt + 1));
+			if (fd_read_n(writer->from_writer, *missing,
+				      sizeof(uint32_t) * *missing_cnt) !=
+			    (ssize_t) (sizeof(uint32_t) * *missing_cnt)) {
+				xfree(*missing);
+				status = SLURM_ERROR;
+			}
+		}
+	}
+	if (status == SLURM_SUCCESS)
+		return writer;
+
+	_put_writer(writer, true);
+	*rc = status;
+	return NULL;
+}
+
+/* Send one block to a locked writer,
+ * RET the writer's result, or SLURM_ERROR if it is gone */
+static int
+_send_block(bcast_writer_t *writer, file_bcast_msg_t *req)
+{
+	bcast_hdr_t hdr;
+	int rc;
+
+	_init_hdr(req, &hdr);
+	if ((fd_write_n(writer->to_writer, &hdr, sizeof(hdr)) !=
+	     sizeof(hdr)) ||
+	    (fd_write_n(writer->to_writer, req->block, req->block_len) !=
+	     (ssize_t) req->block_len) ||
+	    (fd_read_n(writer->from_writer, &rc, sizeof(int)) !=
+	     sizeof(int)))
+		return SLURM_ERROR;
+	return rc;
+}
+
+/* Check that a manifest describes the whole file */
+static bool
+_valid_manifest(file_bcast_msg_t *req)
+{
+	uint64_t block_cnt;
+
+	if (req->block_size == 0)
+		return false;
+	block_cnt = (req->file_size + req->block_size - 1) / req->block_size;
+	return (block_cnt == req->digest_cnt);
+}
+
+extern int
+file_bcast_write(file_bcast_msg_t *req, uint32_t job_id,
+		 uid_t req_uid, gid_t req_gid,
+		 uint32_t **missing, uint32_t *missing_cnt)
+{
+	bcast_writer_t *writer;
+	int rc = SLURM_SUCCESS;
+	uint32_t i;
+
+	if (req->digest_cnt) {
+		if ((req->block_no != 1) || !_valid_manifest(req)) {
+			error("sbcast: uid:%u invalid manifest for `%s`",
+			      req_uid, req->fname);
+			return EINVAL;
+		}
+		*missing = NULL;
+		*missing_cnt = 0;
+	}
+
+	writer = _get_writer(req, job_id, req_uid, req_gid, &rc,
+			     missing, missing_cnt);
+	if (writer) {
+		/* A manifest carries no data, the writer has already
+		 * filled in what it could */
+		if (!req->digest_cnt)
+			rc = _send_block(writer, req);
+		if ((rc == SLURM_SUCCESS) && req->last_block &&
+		    writer->digest_cnt) {
+			slurm_mutex_lock(&writer_mutex);
+			_cache_file(writer);
+			slurm_mutex_unlock(&writer_mutex);
+		}
+		_put_writer(writer, (rc != SLURM_SUCCESS) || req->last_block);
+	}
+	if (rc == SLURM_ERROR) {
+		debug("sbcast: no writer for `%s`, forking for block %u",
+		      req->fname, req->block_no);
+		rc = _fork_write(req, req_uid, req_gid);
+		if ((rc == SLURM_SUCCESS) && req->digest_cnt) {
+			/* Nothing could be checked, so send every block */
+			xfree(*missing);
+			*missing = xmalloc(sizeof(uint32_t) *
+					   req->digest_cnt);
+			for (i = 0; i < req->digest_cnt; i++)
+				(*missing)[i] = i;
+			*missing_cnt = req->digest_cnt;
+		}
+	}
+	if ((rc != SLURM_SUCCESS) && req->digest_cnt)
+		xfree(*missing);
+	return rc;
+}
+
+extern void
+file_bcast_fini(void)
+{
+	slurm_mutex_lock(&writer_mutex);
+	while (writer_list)
+		_unlink_writer(writer_list);
+	slurm_mutex_unlock(&writer_mutex);
+}
@@ -0,0 +1,69 @@
+/*****************************************************************************\
+ *  src/slurmd/slurmd/file_bcast.h - write sbcast file blocks as the requesting user
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMD_FILE_BCAST_H
+#define _SLURMD_FILE_BCAST_H
+
+#include <sys/types.h>
+
+#include "src/common/slurm_protocol_defs.h"
+
+/*
+ * Write one block of a file being broadcast by sbcast, as user uid/gid.
+ * Blocks of a file are written by a writer process which keeps the file
+ * open between blocks and exits after the last one (or when idle). If no
+ * writer can be used, the block is written by a child forked for it alone.
+ *
+ * The first message of a deduplicated transfer carries a manifest of block
+ * digests instead of data. Blocks already in the destination file, or in
+ * a file this user was sent earlier, are then filled in locally and only
+ * the others need to be sent.
+ *
+ * IN req - the REQUEST_FILE_BCAST message, with a validated credential
+ * IN job_id - job the credential was issued to
+ * OUT missing - for a manifest, xmalloc'ed indexes of the blocks to send
+ * OUT missing_cnt - for a manifest, number of entries in missing
+ * RET SLURM_SUCCESS or an errno value
+ */
+extern int file_bcast_write(file_bcast_msg_t *req, uint32_t job_id,
+			    uid_t uid, gid_t gid,
+			    uint32_t **missing, uint32_t *missing_cnt);
+
+/* Close the pipes to every writer, which then exit */
+extern void file_bcast_fini(void);
+
+#endif /* !_SLURMD_FILE_BCAST_H */
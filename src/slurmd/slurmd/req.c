@@ -53,7 +53,6 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
-#include <utime.h>
 #include <grp.h>
 
 #include "src/common/env.h"
@@ -74,13 +73,17 @@
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
 #include "src/common/stepd_api.h"
+#include "src/common/timers.h"
 #include "src/common/uid.h"
 #include "src/common/util-net.h"
 #include "src/common/xstring.h"
 #include "src/common/xmalloc.h"
 
+#include "src/slurmd/slurmd/file_bcast.h"
 #include "src/slurmd/slurmd/slurmd.h"
 #include "src/slurmd/slurmd/reverse_tree_math.h"
+#include "src/slurmd/slurmd/step_registry.h"
+#include "src/slurmd/slurmd/stepd_pool.h"
 #include "src/slurmd/slurmd/xcpu.h"
 
 #include "src/slurmd/common/proctrack.h"
@@ -129,7 +132,6 @@ static bool _slurm_authorized_user(uid_t uid);
 static void _job_limits_free(void *x);
 static int  _job_limits_match(void *x, void *key);
 static bool _job_still_running(uint32_t job_id);
-static int  _init_groups(uid_t my_uid, gid_t my_gid);
 static int  _kill_all_active_steps(uint32_t jobid, int sig, bool batch);
 static int  _step_limits_match(void *x, void *key);
 static int  _terminate_all_steps(uint32_t jobid, bool batch);
@@ -149,7 +151,7 @@ static void _rpc_update_time(slurm_msg_t *);
 static void _rpc_shutdown(slurm_msg_t *msg);
 static void _rpc_reconfig(slurm_msg_t *msg);
 static void _rpc_pid2jid(slurm_msg_t *msg);
-static int  _rpc_file_bcast(slurm_msg_t *msg);
+static void _rpc_file_bcast(slurm_msg_t *msg);
 static int  _rpc_ping(slurm_msg_t *);
 static int  _rpc_health_check(slurm_msg_t *);
 static int  _rpc_step_complete(slurm_msg_t *msg);
@@ -169,13 +171,14 @@ static int  _waiter_complete (uint32_t jobid);
 
 static bool _steps_completed_now(uint32_t jobid);
 static int  _valid_sbcast_cred(file_bcast_msg_t *req, uid_t req_uid,
-			       uint16_t block_no);
+			       uint16_t block_no, uint32_t *job_id);
 static void _wait_state_completed(uint32_t jobid, int max_delay);
 static long _get_job_uid(uint32_t jobid);
 
 static gids_t *_gids_cache_lookup(char *user, gid_t gid);
 
 static int  _add_starting_step(slurmd_step_type_t type, void *req);
+static void _register_step(slurmd_step_type_t type, void *req);
 static int  _remove_starting_step(slurmd_step_type_t type, void *req);
 static int  _compare_starting_steps(void *s0, void *s1);
 static int  _wait_for_starting_step(uint32_t job_id, uint32_t step_id);
@@ -337,8 +340,7 @@ slurmd_req(slurm_msg_t *msg)
 		slurm_free_job_id_request_msg(msg->data);
 		break;
 	case REQUEST_FILE_BCAST:
-		rc = _rpc_file_bcast(msg);
-		slurm_send_rc_msg(msg, rc);
+		_rpc_file_bcast(msg);
 		slurm_free_file_bcast_msg(msg->data);
 		break;
 	case REQUEST_STEP_COMPLETE:
@@ -373,7 +375,7 @@ slurmd_req(slurm_msg_t *msg)
 static int
 _send_slurmstepd_init(int fd, slurmd_step_type_t type, void *req,
 		      slurm_addr_t *cli, slurm_addr_t *self,
-		      hostset_t step_hset)
+		      hostset_t step_hset, bool send_conf)
 {
 	int len = 0;
 	Buf buffer = NULL;
@@ -453,13 +455,16 @@ _send_slurmstepd_init(int fd, slurmd_step_type_t type, void *req,
 	safe_write(fd, &max_depth, sizeof(int));
 	safe_write(fd, &parent_addr, sizeof(slurm_addr_t));
 
-	/* send conf over to slurmstepd */
-	buffer = init_buf(0);
-	pack_slurmd_conf_lite(conf, buffer);
-	len = get_buf_offset(buffer);
-	safe_write(fd, &len, sizeof(int));
-	safe_write(fd, get_buf_data(buffer), len);
-	free_buf(buffer);
+	/* send conf over to slurmstepd, a spare one already has it */
+	if (send_conf) {
+		buffer = init_buf(0);
+		pack_slurmd_conf_lite(conf, buffer);
+		len = get_buf_offset(buffer);
+		safe_write(fd, &len, sizeof(int));
+		safe_write(fd, get_buf_data(buffer), len);
+		free_buf(buffer);
+		buffer = NULL;
+	}
 
 	/* send cli address over to slurmstepd */
 	buffer = init_buf(0);
@@ -556,9 +561,9 @@ rwfail:
  * will be init, not slurmd.
  */
 static int
-_forkexec_slurmstepd(slurmd_step_type_t type, void *req,
-		     slurm_addr_t *cli, slurm_addr_t *self,
-		     const hostset_t step_hset)
+_forkexec_new_slurmstepd(slurmd_step_type_t type, void *req,
+			 slurm_addr_t *cli, slurm_addr_t *self,
+			 const hostset_t step_hset)
 {
 	pid_t pid;
 	int to_stepd[2] = {-1, -1};
@@ -597,7 +602,7 @@ _forkexec_slurmstepd(slurmd_step_type_t type, void *req,
 
 		if ((rc = _send_slurmstepd_init(to_stepd[1], type,
 						req, cli, self,
-						step_hset)) != 0) {
+						step_hset, true)) != 0) {
 			error("Unable to init slurmstepd");
 			goto done;
 		}
@@ -615,6 +620,9 @@ _forkexec_slurmstepd(slurmd_step_type_t type, void *req,
 		}
 
 	done:
+		/* registered before it stops being a starting step so
+		 * there is no time where slurmd could miss it */
+		_register_step(type, req);
 		if (_remove_starting_step(type, req))
 			error("Error cleaning up starting_step list");
 
@@ -689,6 +697,82 @@ _forkexec_slurmstepd(slurmd_step_type_t type, void *req,
 }
 
 
+/*
+ * Hand the step to a spare slurmstepd from the pool, if one is ready.
+ * The spare already received the slurmd configuration when it started.
+ * RET true if a spare was used, with its return code in *rc
+ */
+static bool
+_use_spare_slurmstepd(slurmd_step_type_t type, void *req,
+		      slurm_addr_t *cli, slurm_addr_t *self,
+		      const hostset_t step_hset, int *rc)
+{
+	int to_stepd, to_slurmd;
+
+	while (stepd_pool_get(&to_stepd, &to_slurmd) == SLURM_SUCCESS) {
+		if (_add_starting_step(type, req)) {
+			error("_use_spare_slurmstepd failed in "
+			      "_add_starting_step: %m");
+			close(to_stepd);
+			close(to_slurmd);
+			*rc = SLURM_FAILURE;
+			return true;
+		}
+		*rc = _send_slurmstepd_init(to_stepd, type, req, cli, self,
+					    step_hset, false);
+		if ((*rc == 0) &&
+		    (read(to_slurmd, rc, sizeof(int)) != sizeof(int))) {
+			error("Error reading return code message "
+			      "from spare slurmstepd: %m");
+			*rc = SLURM_FAILURE;
+		}
+		if (*rc != EPIPE)
+			_register_step(type, req);
+		if (_remove_starting_step(type, req))
+			error("Error cleaning up starting_step list");
+		close(to_stepd);
+		close(to_slurmd);
+
+		/* A spare that exited before getting any data can just
+		 * be replaced by the next one */
+		if (*rc != EPIPE)
+			return true;
+		debug("spare slurmstepd exited, trying another");
+	}
+
+	return false;
+}
+
+/*
+ * Start a slurmstepd for a job step or batch job, using a spare one from
+ * the pool when available, and log how long it took.  Callers hold
+ * launch_mutex, which also protects the latency statistics.
+ */
+static int
+_forkexec_slurmstepd(slurmd_step_type_t type, void *req,
+		     slurm_addr_t *cli, slurm_addr_t *self,
+		     const hostset_t step_hset)
+{
+	static uint32_t launch_cnt[2] = {0, 0};
+	static uint64_t launch_usec[2] = {0, 0};
+	int rc, spare;
+	DEF_TIMERS;
+
+	START_TIMER;
+	spare = _use_spare_slurmstepd(type, req, cli, self, step_hset, &rc);
+	if (!spare)
+		rc = _forkexec_new_slurmstepd(type, req, cli, self, step_hset);
+	END_TIMER;
+
+	launch_cnt[spare]++;
+	launch_usec[spare] += DELTA_TIMER;
+	debug("slurmstepd launch from %s took %s, average usec=%"PRIu64
+	      " over %u launches", spare ? "pool" : "exec", TIME_STR,
+	      launch_usec[spare] / launch_cnt[spare], launch_cnt[spare]);
+
+	return rc;
+}
+
 /*
  * The job(step) credential is the only place to get a definitive
  * list of the nodes allocated to a job step.  We need to return
@@ -1387,7 +1471,7 @@ _rpc_job_notify(slurm_msg_t *msg)
 		return;
 	}
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		if ((stepd->jobid  != req->job_id) ||
@@ -1397,8 +1481,7 @@ _rpc_job_notify(slurm_msg_t *msg)
 
 		step_cnt++;
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			debug3("Unable to connect to step %u.%u",
 			       stepd->jobid, stepd->stepid);
@@ -1533,15 +1616,14 @@ _load_job_limits(void)
 		job_limits_list = list_create(_job_limits_free);
 	job_limits_loaded = true;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	step_iter = list_iterator_create(steps);
 	while ((stepd = list_next(step_iter))) {
 		job_limits_ptr = list_find_first(job_limits_list,
 						 _step_limits_match, stepd);
 		if (job_limits_ptr)	/* already processed */
 			continue;
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1)
 			continue;	/* step completed */
 		stepd_info_ptr = stepd_get_info(fd);
@@ -1660,7 +1742,7 @@ _enforce_job_mem_limit(void)
 		job_mem_info_ptr[i].vsize_limit *= (vsize_factor / 100.0);
 	}
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	step_iter = list_iterator_create(steps);
 	while ((stepd = list_next(step_iter))) {
 		for (job_inx=0; job_inx<job_cnt; job_inx++) {
@@ -1670,8 +1752,7 @@ _enforce_job_mem_limit(void)
 		if (job_inx >= job_cnt)
 			continue;	/* job/step not being tracked */
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1)
 			continue;	/* step completed */
 		acct_req.job_id  = stepd->jobid;
@@ -2026,12 +2107,11 @@ _get_step_list(void)
 	ListIterator i;
 	step_loc_t *stepd;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		int fd;
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1)
 			continue;
 		if (stepd_state(fd) == SLURMSTEPD_NOT_RUNNING) {
@@ -2078,6 +2158,7 @@ _rpc_daemon_status(slurm_msg_t *msg)
 	resp->booted             = startup;
 	resp->hostname           = xstrdup(conf->node_name);
 	resp->step_list          = _get_step_list();
+	resp->rpc_lanes          = slurmd_rpc_lane_status();
 	resp->last_slurmctld_msg = last_slurmctld_msg;
 	resp->pid                = conf->pid;
 	resp->slurmd_debug       = conf->debug_level;
@@ -2321,12 +2402,11 @@ static void  _rpc_pid2jid(slurm_msg_t *msg)
 	ListIterator i;
 	step_loc_t *stepd;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		int fd;
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1)
 			continue;
 		if (stepd_pid_in_container(fd, req->job_pid)
@@ -2357,42 +2437,20 @@ static void  _rpc_pid2jid(slurm_msg_t *msg)
 	}
 }
 
-static int
-_init_groups(uid_t my_uid, gid_t my_gid)
-{
-	char *user_name = uid_to_string(my_uid);
-	int rc;
-
-	if (user_name == NULL) {
-		error("sbcast: Could not find uid %ld", (long)my_uid);
-		return -1;
-	}
-
-	rc = initgroups(user_name, my_gid);
-	xfree(user_name);
-	if (rc) {
- 		error("sbcast: Error in initgroups(%s, %ld): %m",
-		      user_name, (long)my_gid);
-//		return -1;
-	}
-	return 0;
-
-}
-
 /* Validate sbcast credential.
  * NOTE: We can only perform the full credential validation once with
  * Munge without generating a credential replay error
  * RET SLURM_SUCCESS or an error code */
 static int
-_valid_sbcast_cred(file_bcast_msg_t *req, uid_t req_uid, uint16_t block_no)
+_valid_sbcast_cred(file_bcast_msg_t *req, uid_t req_uid, uint16_t block_no,
+		   uint32_t *job_id)
 {
 	int rc = SLURM_SUCCESS;
-	uint32_t job_id;
 	char *nodes = NULL;
 	hostset_t hset = NULL;
 
 	rc = extract_sbcast_cred(conf->vctx, req->cred, block_no,
-				 &job_id, &nodes);
+				 job_id, &nodes);
 	if (rc != 0) {
 		error("Security violation: Invalid sbcast_cred from uid %d",
 		      req_uid);
@@ -2416,14 +2474,16 @@ _valid_sbcast_cred(file_bcast_msg_t *req, uid_t req_uid, uint16_t block_no)
 	return rc;
 }
 
-static int
+static void
 _rpc_file_bcast(slurm_msg_t *msg)
 {
 	file_bcast_msg_t *req = msg->data;
-	int fd, flags, offset, inx, rc;
+	file_bcast_resp_msg_t resp;
+	slurm_msg_t resp_msg;
+	int rc;
+	uint32_t job_id;
 	uid_t req_uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 	gid_t req_gid = g_slurm_auth_get_gid(msg->auth_cred, NULL);
-	pid_t child;
 
 #if 0
 	info("last_block=%u force=%u modes=%o",
@@ -2438,88 +2498,28 @@ _rpc_file_bcast(slurm_msg_t *msg)
 #endif
 #endif
 
-	if ((rc = _valid_sbcast_cred(req, req_uid, req->block_no)) !=
-	    SLURM_SUCCESS)
-		return rc;
+	if ((rc = _valid_sbcast_cred(req, req_uid, req->block_no, &job_id))
+	    != SLURM_SUCCESS) {
+		slurm_send_rc_msg(msg, rc);
+		return;
+	}
 
 	info("sbcast req_uid=%u fname=%s block_no=%u",
 	     req_uid, req->fname, req->block_no);
-	child = fork();
-	if (child == -1) {
-		error("sbcast: fork failure");
-		return errno;
-	} else if (child > 0) {
-		waitpid(child, &rc, 0);
-		return WEXITSTATUS(rc);
-	}
-
-	/* The child actually performs the I/O and exits with
-	 * a return code, do not return! */
-	if (_init_groups(req_uid, req_gid) < 0) {
-		error("sbcast: initgroups(%u): %m", req_uid);
-		exit(errno);
-	}
-	if (setgid(req_gid) < 0) {
-		error("sbcast: uid:%u setgid(%u): %s", req_uid, req_gid,
-		      strerror(errno));
-		exit(errno);
-	}
-	if (setuid(req_uid) < 0) {
-		error("sbcast: getuid(%u): %s", req_uid, strerror(errno));
-		exit(errno);
-	}
-
-	flags = O_WRONLY;
-	if (req->block_no == 1) {
-		flags |= O_CREAT;
-		if (req->force)
-			flags |= O_TRUNC;
-		else
-			flags |= O_EXCL;
-	} else
-		flags |= O_APPEND;
-
-	fd = open(req->fname, flags, 0700);
-	if (fd == -1) {
-		error("sbcast: uid:%u can't open `%s`: %s",
-		      req_uid, req->fname, strerror(errno));
-		exit(errno);
+	memset(&resp, 0, sizeof(file_bcast_resp_msg_t));
+	rc = file_bcast_write(req, job_id, req_uid, req_gid,
+			      &resp.missing, &resp.missing_cnt);
+	if ((rc != SLURM_SUCCESS) || (req->digest_cnt == 0)) {
+		slurm_send_rc_msg(msg, rc);
+		return;
 	}
 
-	offset = 0;
-	while (req->block_len - offset) {
-		inx = write(fd, &req->block[offset],
-			    (req->block_len - offset));
-		if (inx == -1) {
-			if ((errno == EINTR) || (errno == EAGAIN))
-				continue;
-			error("sbcast: uid:%u can't write `%s`: %s",
-			      req_uid, req->fname, strerror(errno));
-			close(fd);
-			exit(errno);
-		}
-		offset += inx;
-	}
-	if (req->last_block && fchmod(fd, (req->modes & 0777))) {
-		error("sbcast: uid:%u can't chmod `%s`: %s",
-		      req_uid, req->fname, strerror(errno));
-	}
-	if (req->last_block && fchown(fd, req->uid, req->gid)) {
-		error("sbcast: uid:%u can't chown `%s`: %s",
-		      req_uid, req->fname, strerror(errno));
-	}
-	close(fd);
-	fd = 0;
-	if (req->last_block && req->atime) {
-		struct utimbuf time_buf;
-		time_buf.actime  = req->atime;
-		time_buf.modtime = req->mtime;
-		if (utime(req->fname, &time_buf)) {
-			error("sbcast: uid:%u can't utime `%s`: %s",
-			      req_uid, req->fname, strerror(errno));
-		}
-	}
-	exit(SLURM_SUCCESS);
+	/* Tell sbcast which blocks of the manifest must still be sent */
+	slurm_msg_t_copy(&resp_msg, msg);
+	resp_msg.msg_type = RESPONSE_FILE_BCAST;
+	resp_msg.data     = &resp;
+	slurm_send_node_msg(msg->conn_fd, &resp_msg);
+	xfree(resp.missing);
 }
 
 static void
@@ -2634,7 +2634,7 @@ _get_job_uid(uint32_t jobid)
 	int fd;
 	long uid = -1;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		if (stepd->jobid != jobid) {
@@ -2642,8 +2642,7 @@ _get_job_uid(uint32_t jobid)
 			continue;
 		}
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			debug3("Unable to connect to step %u.%u",
 			       stepd->jobid, stepd->stepid);
@@ -2683,7 +2682,7 @@ _kill_all_active_steps(uint32_t jobid, int sig, bool batch)
 	int step_cnt  = 0;
 	int fd;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		if (stepd->jobid != jobid) {
@@ -2698,8 +2697,7 @@ _kill_all_active_steps(uint32_t jobid, int sig, bool batch)
 
 		step_cnt++;
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			debug3("Unable to connect to step %u.%u",
 			       stepd->jobid, stepd->stepid);
@@ -2734,7 +2732,7 @@ _terminate_all_steps(uint32_t jobid, bool batch)
 	int step_cnt  = 0;
 	int fd;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		if (stepd->jobid != jobid) {
@@ -2749,8 +2747,7 @@ _terminate_all_steps(uint32_t jobid, bool batch)
 
 		step_cnt++;
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			debug3("Unable to connect to step %u.%u",
 			       stepd->jobid, stepd->stepid);
@@ -2778,13 +2775,12 @@ _job_still_running(uint32_t job_id)
 	ListIterator i;
 	step_loc_t  *s     = NULL;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 	while ((s = list_next(i))) {
 		if (s->jobid == job_id) {
 			int fd;
-			fd = stepd_connect(s->directory, s->nodename,
-					   s->jobid, s->stepid);
+			fd = step_registry_connect(s);
 			if (fd == -1)
 				continue;
 			if (stepd_state(fd) != SLURMSTEPD_NOT_RUNNING) {
@@ -2835,13 +2831,12 @@ _steps_completed_now(uint32_t jobid)
 	step_loc_t *stepd;
 	bool rc = true;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		if (stepd->jobid == jobid) {
 			int fd;
-			fd = stepd_connect(stepd->directory, stepd->nodename,
-					   stepd->jobid, stepd->stepid);
+			fd = step_registry_connect(stepd);
 			if (fd == -1)
 				continue;
 			if (stepd_state(fd) != SLURMSTEPD_NOT_RUNNING) {
@@ -2951,7 +2946,7 @@ _rpc_signal_job(slurm_msg_t *msg)
 	 * Loop through all job steps for this job and signal the
 	 * step's process group through the slurmstepd.
 	 */
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		if (stepd->jobid != req->job_id) {
@@ -2968,8 +2963,7 @@ _rpc_signal_job(slurm_msg_t *msg)
 
 		step_cnt++;
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			debug3("Unable to connect to step %u.%u",
 			       stepd->jobid, stepd->stepid);
@@ -3124,7 +3118,7 @@ _rpc_suspend_job(slurm_msg_t *msg)
 	 * as appropriate. Since the "suspend" action contains a 'sleep 1',
 	 * suspend multiple jobsteps in parallel.
 	 */
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 
 	while (1) {
@@ -3140,9 +3134,7 @@ _rpc_suspend_job(slurm_msg_t *msg)
 			}
 			step_cnt++;
 
-			fd[fdi] = stepd_connect(stepd->directory,
-						stepd->nodename, stepd->jobid,
-						stepd->stepid);
+			fd[fdi] = step_registry_connect(stepd);
 			if (fd[fdi] == -1) {
 				debug3("Unable to connect to step %u.%u",
 				       stepd->jobid, stepd->stepid);
@@ -4119,6 +4111,21 @@ fail:
 }
 
 
+/* Record the slurmstepd just launched in the step registry */
+static void
+_register_step(slurmd_step_type_t type, void *req)
+{
+	if (type == LAUNCH_BATCH_JOB) {
+		step_registry_add(((batch_job_launch_msg_t *)req)->job_id,
+				  ((batch_job_launch_msg_t *)req)->step_id);
+	} else {
+		step_registry_add(((launch_tasks_request_msg_t *)req)->job_id,
+				  ((launch_tasks_request_msg_t *)req)->
+				  job_step_id);
+	}
+}
+
+
 static int
 _remove_starting_step(slurmd_step_type_t type, void *req)
 {
@@ -92,7 +92,10 @@
 
 #include "src/slurmd/slurmd/slurmd.h"
 #include "src/slurmd/slurmd/req.h"
+#include "src/slurmd/slurmd/file_bcast.h"
 #include "src/slurmd/slurmd/get_mach_stat.h"
+#include "src/slurmd/slurmd/step_registry.h"
+#include "src/slurmd/slurmd/stepd_pool.h"
 #include "src/slurmd/common/proctrack.h"
 
 #define GETOPT_ARGS	"cCd:Df:hL:Mn:N:vV"
@@ -103,6 +106,20 @@
 
 #define MAX_THREADS		130
 
+/*
+ * Limits on the threads running RPCs of each lane (see rpc_lane_t).
+ * Together they leave some of MAX_THREADS free to receive messages.
+ */
+#define MAX_FAST_THREADS	24
+#define MAX_HEAVY_THREADS	96
+
+/*
+ * Limits on the RPCs waiting in each lane's queue. Each one holds its
+ * connection open, so once a queue is full new RPCs for it are refused.
+ */
+#define MAX_FAST_QUEUED		256
+#define MAX_HEAVY_QUEUED	256
+
 /* global, copied to STDERR_FILENO in tasks before the exec */
 int devnull = -1;
 slurmd_conf_t * conf;
@@ -116,11 +133,55 @@ static pthread_cond_t  active_cond    = PTHREAD_COND_INITIALIZER;
 
 static pthread_mutex_t fork_mutex     = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Saved credential state: a snapshot in "cred_state" and the changes
+ * made since, appended to "cred_state.log". Both carry a generation
+ * number so a log is only replayed over its own snapshot. A new snapshot
+ * is written once the log outgrows both CRED_LOG_MIN_SIZE and the last
+ * snapshot, so restoring reads at most about twice the live state.
+ */
+#define CRED_LOG_MIN_SIZE	(64 * 1024)
+static int      cred_log_fd     = -1;
+static uint32_t cred_log_gen    = 0;
+static off_t    cred_log_size   = 0;
+static off_t    cred_state_size = 0;
+
 typedef struct connection {
 	slurm_fd_t fd;
 	slurm_addr_t *cli_addr;
+	slurm_msg_t *msg;
 } conn_t;
 
+/*
+ * Received RPCs are run in one of two lanes, each with its own limit
+ * on the threads running its RPCs. Once a lane is full its RPCs wait
+ * on the lane's queue and are run in turn by the lane's threads, so a
+ * storm of launch or terminate requests can not hold up pings.
+ * Queued RPCs hold no thread, only threads receiving or running RPCs
+ * count against MAX_THREADS, and a full queue refuses RPCs with EAGAIN.
+ */
+enum {
+	RPC_LANE_FAST,		/* pings, registration, step completion */
+	RPC_LANE_HEAVY,		/* launches, job signals and termination,
+				 * file broadcasts */
+	RPC_LANE_CNT
+};
+
+typedef struct rpc_lane {
+	char    *name;
+	int      max_busy;	/* limit on threads running its RPCs */
+	int      busy;		/* threads running its RPCs */
+	int      max_queued;	/* limit on RPCs waiting in queue */
+	List     queue;		/* conn_t of RPCs waiting to run */
+	uint32_t queue_max;	/* largest queue depth seen */
+} rpc_lane_t;
+
+static rpc_lane_t rpc_lanes[RPC_LANE_CNT] = {
+	{ "fast",  MAX_FAST_THREADS,  0, MAX_FAST_QUEUED,  NULL, 0 },
+	{ "heavy", MAX_HEAVY_THREADS, 0, MAX_HEAVY_QUEUED, NULL, 0 }
+};
+static pthread_mutex_t rpc_lane_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 
 
 /*
@@ -135,6 +196,7 @@ static void      _atfork_final(void);
 static void      _atfork_prepare(void);
 static void      _create_msg_socket(void);
 static void      _decrement_thd_count(void);
+static void      _finish_connection(conn_t *con);
 static void      _destroy_conf(void);
 static int       _drain_node(char *reason);
 static void      _fill_registration_msg(slurm_node_registration_status_msg_t *);
@@ -144,6 +206,10 @@ static void      _increment_thd_count(void);
 static void      _init_conf(void);
 static void      _install_fork_handlers(void);
 static void 	 _kill_old_slurmd(void);
+static void      _lane_fini(void);
+static void      _lane_init(void);
+static int       _lane_inx(uint16_t msg_type);
+static void      _lane_run(conn_t *con);
 static void      _msg_engine(void);
 static void      _print_conf(void);
 static void      _print_config(void);
@@ -151,7 +217,10 @@ static void      _process_cmdline(int ac, char **av);
 static void      _read_config(void);
 static void      _reconfigure(void);
 static void     *_registration_engine(void *arg);
+static Buf       _read_spool_file(char *file_name);
 static int       _restore_cred_state(slurm_cred_ctx_t ctx);
+static int       _save_cred_log(Buf buffer);
+static int       _save_cred_snapshot(slurm_cred_ctx_t ctx);
 static void     *_service_connection(void *);
 static int       _set_slurmd_spooldir(void);
 static int       _set_topo_info(void);
@@ -312,8 +381,12 @@ main (int argc, char *argv[])
 	list_install_fork_handlers();
 	slurm_conf_install_fork_handlers();
 
+	step_registry_init();
 	_spawn_registration_engine();
+	stepd_pool_init();
 	_msg_engine();
+	stepd_pool_fini();
+	file_bcast_fini();
 
 	/*
 	 * Close fd here, otherwise we'll deadlock since create_pidfile()
@@ -325,6 +398,7 @@ main (int argc, char *argv[])
 		error("Unable to remove pidfile `%s': %m", conf->pidfile);
 
 	_wait_for_all_threads();
+	step_registry_fini();
 
 	interconnect_node_fini();
 
@@ -396,6 +470,7 @@ _msg_engine(void)
 
 	msg_pthread = pthread_self();
 	slurmd_req(NULL);	/* initialize timer */
+	_lane_init();
 	while (!_shutdown) {
 		if (_reconfig) {
 			verbose("got reconfigure request");
@@ -511,6 +586,7 @@ _service_connection(void *arg)
 
 	debug3("in the service_connection");
 	slurm_msg_t_init(msg);
+	con->msg = msg;
 	if((rc = slurm_receive_msg_and_forward(con->fd, con->cli_addr, msg, 0))
 	   != SLURM_SUCCESS) {
 		error("service_connection: slurm_receive_msg: %m");
@@ -518,20 +594,151 @@ _service_connection(void *arg)
 		   to are taken care of and sent back. This way the control
 		   also has a better idea what happened to us */
 		slurm_send_rc_msg(msg, rc);
-		goto cleanup;
+		_finish_connection(con);
+	} else {
+		debug2("got this type of message %d", msg->msg_type);
+		_lane_run(con);
 	}
-	debug2("got this type of message %d", msg->msg_type);
-	slurmd_req(msg);
 
-cleanup:
+	_decrement_thd_count();
+	return NULL;
+}
+
+/* Close the connection and free con along with its message */
+static void
+_finish_connection(conn_t *con)
+{
+	slurm_msg_t *msg = con->msg;
+
 	if ((msg->conn_fd >= 0) && slurm_close_accepted_conn(msg->conn_fd) < 0)
 		error ("close(%d): %m", con->fd);
 
 	xfree(con->cli_addr);
 	xfree(con);
 	slurm_free_msg(msg);
-	_decrement_thd_count();
-	return NULL;
+}
+
+static void
+_lane_init(void)
+{
+	int i;
+
+	slurm_mutex_lock(&rpc_lane_mutex);
+	for (i = 0; i < RPC_LANE_CNT; i++) {
+		if (rpc_lanes[i].queue == NULL)
+			rpc_lanes[i].queue = list_create(NULL);
+	}
+	slurm_mutex_unlock(&rpc_lane_mutex);
+}
+
+static void
+_lane_fini(void)
+{
+	conn_t *con;
+	int i;
+
+	slurm_mutex_lock(&rpc_lane_mutex);
+	for (i = 0; i < RPC_LANE_CNT; i++) {
+		if (rpc_lanes[i].queue == NULL)
+			continue;
+		while ((con = list_dequeue(rpc_lanes[i].queue)))
+			_finish_connection(con);
+		list_destroy(rpc_lanes[i].queue);
+		rpc_lanes[i].queue = NULL;
+	}
+	slurm_mutex_unlock(&rpc_lane_mutex);
+}
+
+/* Return the lane in which RPCs of type msg_type run */
+static int
+_lane_inx(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case REQUEST_PING:
+	case REQUEST_NODE_REGISTRATION_STATUS:
+	case REQUEST_HEALTH_CHECK:
+	case REQUEST_STEP_COMPLETE:
+	case REQUEST_UPDATE_JOB_TIME:
+	case REQUEST_JOB_ID:
+	case REQUEST_JOB_STEP_STAT:
+	case REQUEST_JOB_STEP_PIDS:
+	case REQUEST_DAEMON_STATUS:
+	case REQUEST_JOB_NOTIFY:
+	case REQUEST_RECONFIGURE:
+	case REQUEST_SHUTDOWN:
+		return RPC_LANE_FAST;
+	default:
+		return RPC_LANE_HEAVY;
+	}
+}
+
+/*
+ * Run the RPC received on con if its lane has room, otherwise queue it.
+ * A thread which runs an RPC goes on to run those queued in its lane.
+ * If the queue is full too the RPC is refused with EAGAIN.
+ */
+static void
+_lane_run(conn_t *con)
+{
+	rpc_lane_t *lane = &rpc_lanes[_lane_inx(con->msg->msg_type)];
+	uint32_t depth;
+
+	slurm_mutex_lock(&rpc_lane_mutex);
+	if ((lane->busy >= lane->max_busy) &&
+	    (list_count(lane->queue) >= lane->max_queued)) {
+		slurm_mutex_unlock(&rpc_lane_mutex);
+		error("%s RPC lane queue is full, refusing message type %u",
+		      lane->name, con->msg->msg_type);
+		slurm_send_rc_msg(con->msg, EAGAIN);
+		_finish_connection(con);
+		return;
+	}
+	if (lane->busy >= lane->max_busy) {
+		list_enqueue(lane->queue, con);
+		depth = list_count(lane->queue);
+		if (depth > lane->queue_max)
+			lane->queue_max = depth;
+		debug2("%s RPC lane is full, queued message type %u "
+		       "(%u queued)", lane->name, con->msg->msg_type, depth);
+		slurm_mutex_unlock(&rpc_lane_mutex);
+		return;
+	}
+
+	lane->busy++;
+	while (con) {
+		slurm_mutex_unlock(&rpc_lane_mutex);
+		slurmd_req(con->msg);
+		_finish_connection(con);
+		slurm_mutex_lock(&rpc_lane_mutex);
+		con = list_dequeue(lane->queue);
+	}
+	lane->busy--;
+	slurm_mutex_unlock(&rpc_lane_mutex);
+}
+
+/*
+ * Return a description of the busy threads and queued RPCs of each lane.
+ * Caller must xfree the return value.
+ */
+extern char *
+slurmd_rpc_lane_status(void)
+{
+	char *status = NULL;
+	int i;
+
+	slurm_mutex_lock(&rpc_lane_mutex);
+	for (i = 0; i < RPC_LANE_CNT; i++) {
+		xstrfmtcat(status,
+			   "%s%s:busy=%d/%d,queued=%d/%d,max_queued=%u",
+			   (i ? " " : ""), rpc_lanes[i].name,
+			   rpc_lanes[i].busy, rpc_lanes[i].max_busy,
+			   (rpc_lanes[i].queue ?
+			    list_count(rpc_lanes[i].queue) : 0),
+			   rpc_lanes[i].max_queued, rpc_lanes[i].queue_max);
+	}
+	slurm_mutex_unlock(&rpc_lane_mutex);
+
+	return status;
 }
 
 extern int
@@ -631,7 +838,7 @@ _fill_registration_msg(slurm_node_registration_status_msg_t *msg)
 			error("switch_g_build_node_info: %m");
 	}
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	msg->job_count = list_count(steps);
 	msg->job_id    = xmalloc(msg->job_count * sizeof(*msg->job_id));
 	/* Note: Running batch jobs will have step_id == NO_VAL */
@@ -641,8 +848,7 @@ _fill_registration_msg(slurm_node_registration_status_msg_t *msg)
 	n = 0;
 	while ((stepd = list_next(i))) {
 		int fd;
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			--(msg->job_count);
 			continue;
@@ -844,6 +1050,7 @@ _read_config(void)
 	if (cf->slurmctld_port == 0)
 		fatal("Unable to establish controller port");
 	conf->slurmd_timeout = cf->slurmd_timeout;
+	conf->stepd_pool_size = cf->slurmstepd_pool_size;
 	conf->use_pam = cf->use_pam;
 	conf->task_plugin_param = cf->task_plugin_param;
 
@@ -891,12 +1098,11 @@ _reconfigure(void)
 	 * file handle
 	 */
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list();
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		int fd;
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid);
+		fd = step_registry_connect(stepd);
 		if (fd == -1)
 			continue;
 		if(stepd_reconfig(fd) != SLURM_SUCCESS)
@@ -907,6 +1113,9 @@ _reconfigure(void)
 	list_iterator_destroy(i);
 	list_destroy(steps);
 
+	/* Spare slurmstepds hold the old configuration, replace them */
+	stepd_pool_init();
+
 	gres_plugin_reconfig(&did_change);
 	if (did_change) {
 		uint32_t cpu_cnt = MAX(conf->conf_cpus, conf->block_map_size);
@@ -1336,12 +1545,37 @@ _slurmd_init(void)
 	return SLURM_SUCCESS;
 }
 
+/* Read the whole of file_name, return NULL if it can not be opened */
+static Buf
+_read_spool_file(char *file_name)
+{
+	char *data = NULL;
+	uint32_t data_size = 0;
+	int fd, data_allocated, data_read = 0;
+
+	fd = open(file_name, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	data_allocated = 1024;
+	data = xmalloc(sizeof(char)*data_allocated);
+	while ((data_read = read(fd, &data[data_size], 1024)) == 1024) {
+		data_size += data_read;
+		data_allocated += 1024;
+		xrealloc(data, data_allocated);
+	}
+	if (data_read > 0)
+		data_size += data_read;
+	close(fd);
+	return create_buf(data, data_size);
+}
+
 static int
 _restore_cred_state(slurm_cred_ctx_t ctx)
 {
-	char *file_name = NULL, *data = NULL;
-	uint32_t data_size = 0;
-	int cred_fd, data_allocated, data_read = 0;
+	char *file_name = NULL;
+	uint32_t gen = 0, log_gen = 0;
+	int changes = 0;
 	Buf buffer = NULL;
 
 	if ( (mkdir(conf->spooldir, 0755) < 0) && (errno != EEXIST) ) {
@@ -1351,23 +1585,36 @@ _restore_cred_state(slurm_cred_ctx_t ctx)
 
 	file_name = xstrdup(conf->spooldir);
 	xstrcat(file_name, "/cred_state");
-	cred_fd = open(file_name, O_RDONLY);
-	if (cred_fd < 0)
+	if (!(buffer = _read_spool_file(file_name)))
 		goto cleanup;
 
-	data_allocated = 1024;
-	data = xmalloc(sizeof(char)*data_allocated);
-	while ((data_read = read(cred_fd, &data[data_size], 1024)) == 1024) {
-		data_size += data_read;
-		data_allocated += 1024;
-		xrealloc(data, data_allocated);
-	}
-	data_size += data_read;
-	close(cred_fd);
-	buffer = create_buf(data, data_size);
-
 	slurm_cred_ctx_unpack(ctx, buffer);
 
+	/* State saved by older versions has no change log */
+	if ((remaining_buf(buffer) < sizeof(uint32_t)) ||
+	    (unpack32(&gen, buffer) != SLURM_SUCCESS))
+		goto cleanup;
+	cred_log_gen = gen;
+	free_buf(buffer);
+
+	xstrcat(file_name, ".log");
+	if (!(buffer = _read_spool_file(file_name)))
+		goto cleanup;
+	if ((unpack32(&log_gen, buffer) != SLURM_SUCCESS) || (log_gen != gen)) {
+		info("%s does not match the saved credential state, "
+		     "ignoring it", file_name);
+		goto cleanup;
+	}
+	while (remaining_buf(buffer) > 0) {
+		if (slurm_cred_ctx_unpack_changes(ctx, buffer)) {
+			/* The last append was cut short */
+			info("%s is truncated", file_name);
+			break;
+		}
+		changes++;
+	}
+	debug("restored %d sets of credential state changes", changes);
+
 cleanup:
 	xfree(file_name);
 	if (buffer)
@@ -1390,6 +1637,7 @@ static int
 _slurmd_fini(void)
 {
 	save_cred_state(conf->vctx);
+	_lane_fini();
 	switch_fini();
 	slurmd_task_fini();
 	slurm_conf_destroy();
@@ -1412,19 +1660,72 @@ _slurmd_fini(void)
  */
 int save_cred_state(slurm_cred_ctx_t ctx)
 {
-	char *old_file, *new_file, *reg_file;
-	int cred_fd = -1, error_code = SLURM_SUCCESS, rc;
+	int error_code = SLURM_SUCCESS;
 	Buf buffer = NULL;
 	static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+	slurm_mutex_lock(&state_mutex);
+	if ((cred_log_fd >= 0) &&
+	    (cred_log_size < MAX(CRED_LOG_MIN_SIZE, cred_state_size))) {
+		buffer = init_buf(1024);
+		if ((slurm_cred_ctx_pack_changes(ctx, buffer) ==
+		     SLURM_SUCCESS) &&
+		    (_save_cred_log(buffer) == SLURM_SUCCESS))
+			goto cleanup;
+	}
+	error_code = _save_cred_snapshot(ctx);
+
+cleanup:
+	slurm_mutex_unlock(&state_mutex);
+	if (buffer)
+		free_buf(buffer);
+	return error_code;
+}
+
+/* Append the credential state changes in buffer to cred_state.log */
+static int _save_cred_log(Buf buffer)
+{
+	int rc;
+
+	if (get_buf_offset(buffer) == 0)
+		return SLURM_SUCCESS;
+
+	rc = write(cred_log_fd, get_buf_data(buffer), get_buf_offset(buffer));
+	if (rc != get_buf_offset(buffer)) {
+		error("write %s/cred_state.log error %m", conf->spooldir);
+		return SLURM_ERROR;
+	}
+	cred_log_size += rc;
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Write all of the credential state to cred_state, then start a new,
+ * empty cred_state.log for the changes which follow
+ */
+static int _save_cred_snapshot(slurm_cred_ctx_t ctx)
+{
+	char *old_file, *new_file, *reg_file, *log_file, *new_log_file;
+	int cred_fd = -1, log_fd = -1, error_code = SLURM_SUCCESS, rc;
+	uint32_t gen;
+	Buf buffer = NULL;
+
 	old_file = xstrdup(conf->spooldir);
 	xstrcat(old_file, "/cred_state.old");
 	reg_file = xstrdup(conf->spooldir);
 	xstrcat(reg_file, "/cred_state");
 	new_file = xstrdup(conf->spooldir);
 	xstrcat(new_file, "/cred_state.new");
+	log_file = xstrdup(conf->spooldir);
+	xstrcat(log_file, "/cred_state.log");
+	new_log_file = xstrdup(conf->spooldir);
+	xstrcat(new_log_file, "/cred_state.log.new");
+
+	/* Generations only increase, even across restarts */
+	gen = (uint32_t) time(NULL);
+	if (gen <= cred_log_gen)
+		gen = cred_log_gen + 1;
 
-	slurm_mutex_lock(&state_mutex);
 	if ((cred_fd = creat(new_file, 0600)) < 0) {
 		error("creat(%s): %m", new_file);
 		if (errno == ENOSPC)
@@ -1434,6 +1735,7 @@ int save_cred_state(slurm_cred_ctx_t ctx)
 	}
 	buffer = init_buf(1024);
 	slurm_cred_ctx_pack(ctx, buffer);
+	pack32(gen, buffer);
 	rc = write(cred_fd, get_buf_data(buffer), get_buf_offset(buffer));
 	if (rc != get_buf_offset(buffer)) {
 		error("write %s error %m", new_file);
@@ -1452,12 +1754,40 @@ int save_cred_state(slurm_cred_ctx_t ctx)
 		debug4("unable to create link for %s -> %s: %m",
 		       new_file, reg_file);
 	(void) unlink(new_file);
+	cred_log_gen    = gen;
+	cred_state_size = rc;
+
+	/* Until the new log is in place any old one is ignored, its
+	 * generation does not match the new state file */
+	if (cred_log_fd >= 0) {
+		close(cred_log_fd);
+		cred_log_fd = -1;
+	}
+	if ((log_fd = open(new_log_file, O_WRONLY | O_CREAT | O_TRUNC |
+			   O_APPEND, 0600)) < 0) {
+		error("open(%s): %m", new_log_file);
+		goto cleanup;
+	}
+	set_buf_offset(buffer, 0);
+	pack32(gen, buffer);
+	rc = write(log_fd, get_buf_data(buffer), get_buf_offset(buffer));
+	if ((rc != get_buf_offset(buffer)) ||
+	    (rename(new_log_file, log_file) < 0)) {
+		error("unable to create %s: %m", log_file);
+		(void) unlink(new_log_file);
+		close(log_fd);
+		goto cleanup;
+	}
+	fd_set_close_on_exec(log_fd);
+	cred_log_fd   = log_fd;
+	cred_log_size = rc;
 
 cleanup:
-	slurm_mutex_unlock(&state_mutex);
 	xfree(old_file);
 	xfree(reg_file);
 	xfree(new_file);
+	xfree(log_file);
+	xfree(new_log_file);
 	if (buffer)
 		free_buf(buffer);
 	if (cred_fd > 0)
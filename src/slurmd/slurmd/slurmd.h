@@ -127,6 +127,7 @@ typedef struct slurmd_config {
 	slurm_cred_ctx_t vctx;          /* slurm_cred_t verifier context   */
 
 	uint16_t	slurmd_timeout;	/* SlurmdTimeout                   */
+	uint16_t	stepd_pool_size; /* SlurmstepdPoolSize             */
 	uid_t           slurm_user_id;	/* UID that slurmctld runs as      */
 	pthread_mutex_t config_mutex;	/* lock for slurmd_config access   */
 	uint16_t        job_acct_gather_freq;
@@ -159,5 +160,12 @@ int send_registration_msg(uint32_t status, bool startup);
  */
 int save_cred_state(slurm_cred_ctx_t vctx);
 
+/*
+ * slurmd_rpc_lane_status - describe the busy threads and queue depth of
+ *	each RPC lane
+ * RET string which the caller must xfree
+ */
+extern char *slurmd_rpc_lane_status(void);
+
 
 #endif /* !_SLURMD_H */
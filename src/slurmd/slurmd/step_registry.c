@@ -0,0 +1,228 @@
+/*****************************************************************************\
+ *  src/slurmd/slurmd/step_registry.c - slurmstepds running on this node
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmd/slurmd/slurmd.h"
+#include "src/slurmd/slurmd/step_registry.h"
+
+/* How often the steps are checked for a slurmstepd which exited
+ * without slurmd noticing, in seconds */
+#define REGISTRY_SWEEP_TIME	60
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static List registry = NULL;		/* step_loc_t of running steps */
+static time_t last_sweep = (time_t) 0;
+
+static void
+_free_step_loc(void *object)
+{
+	step_loc_t *loc = (step_loc_t *) object;
+
+	xfree(loc->directory);
+	xfree(loc->nodename);
+	xfree(loc);
+}
+
+static step_loc_t *
+_copy_step_loc(step_loc_t *loc)
+{
+	step_loc_t *copy = xmalloc(sizeof(step_loc_t));
+
+	copy->jobid     = loc->jobid;
+	copy->stepid    = loc->stepid;
+	copy->nodename  = xstrdup(loc->nodename);
+	copy->directory = xstrdup(loc->directory);
+	return copy;
+}
+
+/* Return true if the slurmstepd's unix domain socket still exists */
+static bool
+_socket_exists(step_loc_t *loc)
+{
+	struct stat stat_buf;
+	char *path = NULL;
+	int rc;
+
+	xstrfmtcat(path, "%s/%s_%u.%u", loc->directory, loc->nodename,
+		   loc->jobid, loc->stepid);
+	rc = stat(path, &stat_buf);
+	xfree(path);
+	return ((rc == 0) || (errno != ENOENT));
+}
+
+/* Callers must hold registry_mutex */
+static void
+_remove_step(uint32_t job_id, uint32_t step_id)
+{
+	ListIterator itr;
+	step_loc_t *loc;
+
+	itr = list_iterator_create(registry);
+	while ((loc = list_next(itr))) {
+		if ((loc->jobid == job_id) && (loc->stepid == step_id)) {
+			debug3("step %u.%u removed from registry",
+			       job_id, step_id);
+			list_delete_item(itr);
+			break;
+		}
+	}
+	list_iterator_destroy(itr);
+}
+
+/* Forget the steps whose socket is gone, callers must hold registry_mutex */
+static void
+_sweep_registry(void)
+{
+	ListIterator itr;
+	step_loc_t *loc;
+
+	itr = list_iterator_create(registry);
+	while ((loc = list_next(itr))) {
+		if (!_socket_exists(loc)) {
+			debug3("step %u.%u removed from registry",
+			       loc->jobid, loc->stepid);
+			list_delete_item(itr);
+		}
+	}
+	list_iterator_destroy(itr);
+	last_sweep = time(NULL);
+}
+
+extern void
+step_registry_init(void)
+{
+	List steps;
+	step_loc_t *loc;
+
+	steps = stepd_available(conf->spooldir, conf->node_name);
+
+	slurm_mutex_lock(&registry_mutex);
+	if (registry)
+		list_destroy(registry);
+	registry = list_create(_free_step_loc);
+	while (steps && (loc = list_pop(steps)))
+		list_append(registry, loc);
+	debug("found %d running steps in %s", list_count(registry),
+	      conf->spooldir);
+	last_sweep = time(NULL);
+	slurm_mutex_unlock(&registry_mutex);
+
+	if (steps)
+		list_destroy(steps);
+}
+
+extern void
+step_registry_fini(void)
+{
+	slurm_mutex_lock(&registry_mutex);
+	if (registry) {
+		list_destroy(registry);
+		registry = NULL;
+	}
+	slurm_mutex_unlock(&registry_mutex);
+}
+
+extern void
+step_registry_add(uint32_t job_id, uint32_t step_id)
+{
+	step_loc_t *loc;
+
+	slurm_mutex_lock(&registry_mutex);
+	if (registry) {
+		/* A step relaunched on this node replaces the old entry */
+		_remove_step(job_id, step_id);
+		loc = xmalloc(sizeof(step_loc_t));
+		loc->jobid     = job_id;
+		loc->stepid    = step_id;
+		loc->nodename  = xstrdup(conf->node_name);
+		loc->directory = xstrdup(conf->spooldir);
+		list_append(registry, loc);
+		debug3("step %u.%u added to registry", job_id, step_id);
+	}
+	slurm_mutex_unlock(&registry_mutex);
+}
+
+extern List
+step_registry_list(void)
+{
+	List steps = list_create(_free_step_loc);
+	ListIterator itr;
+	step_loc_t *loc;
+
+	slurm_mutex_lock(&registry_mutex);
+	if (registry) {
+		if (difftime(time(NULL), last_sweep) >= REGISTRY_SWEEP_TIME)
+			_sweep_registry();
+		itr = list_iterator_create(registry);
+		while ((loc = list_next(itr)))
+			list_append(steps, _copy_step_loc(loc));
+		list_iterator_destroy(itr);
+	}
+	slurm_mutex_unlock(&registry_mutex);
+
+	return steps;
+}
+
+extern int
+step_registry_connect(step_loc_t *stepd)
+{
+	int fd;
+
+	fd = stepd_connect(stepd->directory, stepd->nodename,
+			   stepd->jobid, stepd->stepid);
+	if ((fd == -1) && !_socket_exists(stepd)) {
+		slurm_mutex_lock(&registry_mutex);
+		if (registry)
+			_remove_step(stepd->jobid, stepd->stepid);
+		slurm_mutex_unlock(&registry_mutex);
+	}
+	return fd;
+}
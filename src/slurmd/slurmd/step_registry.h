@@ -0,0 +1,71 @@
+/*****************************************************************************\
+ *  src/slurmd/slurmd/step_registry.h - slurmstepds running on this node
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMD_STEP_REGISTRY_H
+#define _SLURMD_STEP_REGISTRY_H
+
+#include "src/common/list.h"
+#include "src/common/stepd_api.h"
+
+/*
+ * Load the job steps whose slurmstepd is running from the spool
+ * directory.  This is the only time the spool directory is scanned,
+ * afterwards slurmd records the steps it launches itself.
+ */
+extern void step_registry_init(void);
+
+extern void step_registry_fini(void);
+
+/* Record a slurmstepd launched for job_id.step_id */
+extern void step_registry_add(uint32_t job_id, uint32_t step_id);
+
+/*
+ * Return the steps believed to be running on this node, as a List of
+ * step_loc_t like stepd_available() but without reading the spool
+ * directory.  A slurmstepd may have exited since, in which case
+ * step_registry_connect() fails and forgets the step.
+ */
+extern List step_registry_list(void);
+
+/*
+ * Connect to the slurmstepd of a step returned by step_registry_list(),
+ * see stepd_connect().  The step is removed from the registry if its
+ * socket is gone.
+ */
+extern int step_registry_connect(step_loc_t *stepd);
+
+#endif /* !_SLURMD_STEP_REGISTRY_H */
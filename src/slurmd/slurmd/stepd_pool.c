@@ -0,0 +1,305 @@
+/*****************************************************************************\
+ *  src/slurmd/slurmd/stepd_pool.c - pool of pre-started slurmstepd processes
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/param.h>		/* MAXPATHLEN */
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "src/common/fd.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmd/common/slurmstepd_init.h"
+#include "src/slurmd/slurmd/slurmd.h"
+#include "src/slurmd/slurmd/stepd_pool.h"
+
+typedef struct spare_stepd {
+	int to_stepd;		/* write end of the slurmstepd's stdin */
+	int to_slurmd;		/* read end of the slurmstepd's stdout */
+} spare_stepd_t;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pool_cond  = PTHREAD_COND_INITIALIZER;
+static spare_stepd_t  *pool = NULL;
+static int  pool_size  = 0;		/* number of spares wanted */
+static int  pool_count = 0;		/* number of spares in pool[] */
+static int  pool_gen   = 0;		/* changes when spares go stale */
+static bool pool_shutdown = false;
+static pthread_t pool_thread = (pthread_t) 0;
+
+static void
+_close_spare(spare_stepd_t *spare)
+{
+	/* The spare slurmstepd exits when it reads EOF */
+	if (close(spare->to_stepd) < 0)
+		error("close write to_stepd of spare slurmstepd: %m");
+	if (close(spare->to_slurmd) < 0)
+		error("close read to_slurmd of spare slurmstepd: %m");
+}
+
+/* Callers must hold pool_mutex */
+static void
+_drain_pool(void)
+{
+	while (pool_count > 0)
+		_close_spare(&pool[--pool_count]);
+	pool_gen++;
+}
+
+/*
+ * Child side of _spawn_spare(), as in _forkexec_slurmstepd(): fork again
+ * so the slurmstepd's parent is init, then exec it in "spare" mode.
+ */
+static void
+_exec_spare(int to_stepd[2], int to_slurmd[2])
+{
+	char slurm_stepd_path[MAXPATHLEN];
+	char *const argv[3] = { slurm_stepd_path, "spare", NULL };
+	pid_t pid;
+
+	if (conf->stepd_loc) {
+		snprintf(slurm_stepd_path, sizeof(slurm_stepd_path),
+			 "%s", conf->stepd_loc);
+	} else {
+		snprintf(slurm_stepd_path, sizeof(slurm_stepd_path),
+			 "%s/sbin/slurmstepd", SLURM_PREFIX);
+	}
+	setenv("SLURM_CONF", conf->conffile, 1);
+
+	if (setsid() < 0)
+		error("_exec_spare: setsid: %m");
+	if ((pid = fork()) < 0) {
+		error("_exec_spare: Unable to fork grandchild: %m");
+		exit(1);
+	} else if (pid > 0) {
+		exit(0);
+	}
+
+	slurm_shutdown_msg_engine(conf->lfd);
+
+	if (dup2(to_stepd[0], STDIN_FILENO) == -1) {
+		error("dup2 over STDIN_FILENO: %m");
+		exit(1);
+	}
+	fd_set_close_on_exec(to_stepd[0]);
+	if (dup2(to_slurmd[1], STDOUT_FILENO) == -1) {
+		error("dup2 over STDOUT_FILENO: %m");
+		exit(1);
+	}
+	fd_set_close_on_exec(to_slurmd[1]);
+	if (dup2(devnull, STDERR_FILENO) == -1) {
+		error("dup2 /dev/null to STDERR_FILENO: %m");
+		exit(1);
+	}
+	fd_set_noclose_on_exec(STDERR_FILENO);
+	log_fini();
+	execvp(argv[0], argv);
+	error("exec of spare slurmstepd failed: %m");
+	exit(2);
+}
+
+/*
+ * Start a spare slurmstepd and send it the slurmd configuration.
+ */
+static int
+_spawn_spare(spare_stepd_t *spare)
+{
+	int to_stepd[2] = {-1, -1};
+	int to_slurmd[2] = {-1, -1};
+	Buf buffer = NULL;
+	int len;
+	pid_t pid;
+
+	if (pipe(to_stepd) < 0) {
+		error("_spawn_spare pipe failed: %m");
+		return SLURM_ERROR;
+	}
+	if (pipe(to_slurmd) < 0) {
+		error("_spawn_spare pipe failed: %m");
+		close(to_stepd[0]);
+		close(to_stepd[1]);
+		return SLURM_ERROR;
+	}
+	/* Spares live a long time, keep their pipes out of every other
+	 * process the slurmd starts or closing them would not be seen */
+	fd_set_close_on_exec(to_stepd[1]);
+	fd_set_close_on_exec(to_slurmd[0]);
+
+	if ((pid = fork()) < 0) {
+		error("_spawn_spare: fork: %m");
+		close(to_stepd[0]);
+		close(to_stepd[1]);
+		close(to_slurmd[0]);
+		close(to_slurmd[1]);
+		return SLURM_ERROR;
+	} else if (pid == 0) {
+		_exec_spare(to_stepd, to_slurmd);
+	}
+
+	if (close(to_stepd[0]) < 0)
+		error("Unable to close read to_stepd in parent: %m");
+	if (close(to_slurmd[1]) < 0)
+		error("Unable to close write to_slurmd in parent: %m");
+	if (waitpid(pid, NULL, 0) < 0)
+		error("Unable to reap slurmd child process");
+
+	buffer = init_buf(0);
+	pack_slurmd_conf_lite(conf, buffer);
+	len = get_buf_offset(buffer);
+	safe_write(to_stepd[1], &len, sizeof(int));
+	safe_write(to_stepd[1], get_buf_data(buffer), len);
+	free_buf(buffer);
+
+	spare->to_stepd = to_stepd[1];
+	spare->to_slurmd = to_slurmd[0];
+	return SLURM_SUCCESS;
+
+rwfail:
+	error("Unable to send configuration to spare slurmstepd: %m");
+	free_buf(buffer);
+	close(to_stepd[1]);
+	close(to_slurmd[0]);
+	return SLURM_ERROR;
+}
+
+static void *
+_pool_agent(void *arg)
+{
+	spare_stepd_t spare;
+	int gen, rc;
+
+	slurm_mutex_lock(&pool_mutex);
+	while (!pool_shutdown) {
+		if (pool_count >= pool_size) {
+			pthread_cond_wait(&pool_cond, &pool_mutex);
+			continue;
+		}
+
+		gen = pool_gen;
+		slurm_mutex_unlock(&pool_mutex);
+		rc = _spawn_spare(&spare);
+		slurm_mutex_lock(&pool_mutex);
+
+		if (rc != SLURM_SUCCESS) {
+			/* Do not spin if slurmstepd can not be started */
+			slurm_mutex_unlock(&pool_mutex);
+			sleep(1);
+			slurm_mutex_lock(&pool_mutex);
+		} else if (pool_shutdown || (gen != pool_gen) ||
+			   (pool_count >= pool_size)) {
+			_close_spare(&spare);
+		} else {
+			pool[pool_count++] = spare;
+			debug3("spare slurmstepd ready, %d of %d",
+			       pool_count, pool_size);
+		}
+	}
+	slurm_mutex_unlock(&pool_mutex);
+
+	return NULL;
+}
+
+extern void
+stepd_pool_init(void)
+{
+	pthread_attr_t attr;
+
+	slurm_mutex_lock(&pool_mutex);
+	_drain_pool();
+	pool_size = conf->stepd_pool_size;
+	if (pool_size)
+		xrealloc(pool, sizeof(spare_stepd_t) * pool_size);
+
+	if (pool_size && !pool_thread && !pool_shutdown) {
+		slurm_attr_init(&attr);
+		if (pthread_create(&pool_thread, &attr, _pool_agent, NULL)) {
+			error("Unable to start slurmstepd pool thread: %m");
+			pool_thread = (pthread_t) 0;
+		}
+		slurm_attr_destroy(&attr);
+	}
+	pthread_cond_signal(&pool_cond);
+	slurm_mutex_unlock(&pool_mutex);
+
+	if (pool_size)
+		debug("keeping %d spare slurmstepd processes", pool_size);
+}
+
+extern void
+stepd_pool_fini(void)
+{
+	pthread_t thread;
+
+	slurm_mutex_lock(&pool_mutex);
+	pool_shutdown = true;
+	_drain_pool();
+	pthread_cond_signal(&pool_cond);
+	thread = pool_thread;
+	slurm_mutex_unlock(&pool_mutex);
+
+	if (thread)
+		pthread_join(thread, NULL);
+	xfree(pool);
+}
+
+extern int
+stepd_pool_get(int *to_stepd, int *to_slurmd)
+{
+	int rc = SLURM_ERROR;
+
+	slurm_mutex_lock(&pool_mutex);
+	if (pool_count > 0) {
+		pool_count--;
+		*to_stepd = pool[pool_count].to_stepd;
+		*to_slurmd = pool[pool_count].to_slurmd;
+		pthread_cond_signal(&pool_cond);
+		rc = SLURM_SUCCESS;
+	}
+	slurm_mutex_unlock(&pool_mutex);
+
+	return rc;
+}
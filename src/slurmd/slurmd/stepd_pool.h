@@ -0,0 +1,61 @@
+/*****************************************************************************\
+ *  src/slurmd/slurmd/stepd_pool.h - pool of pre-started slurmstepd processes
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMD_STEPD_POOL_H
+#define _SLURMD_STEPD_POOL_H
+
+/*
+ * Start (or restart after a reconfiguration) keeping conf->stepd_pool_size
+ * spare slurmstepd processes.  A spare has already been exec'd and has
+ * received the slurmd configuration, so a launch only needs to send it
+ * the per-step data.  Any existing spares are discarded, since they hold
+ * the old configuration.
+ */
+extern void stepd_pool_init(void);
+
+/* Discard all spares and stop refilling the pool */
+extern void stepd_pool_fini(void);
+
+/*
+ * Take a spare slurmstepd from the pool.
+ * OUT to_stepd - pipe to the slurmstepd's stdin
+ * OUT to_slurmd - pipe from the slurmstepd's stdout
+ * RET SLURM_SUCCESS, or SLURM_ERROR if no spare is ready
+ */
+extern int stepd_pool_get(int *to_stepd, int *to_slurmd);
+
+#endif /* !_SLURMD_STEPD_POOL_H */
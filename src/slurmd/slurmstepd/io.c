@@ -64,6 +64,7 @@
 #include <sys/poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -95,6 +96,9 @@ static bool _client_writable(eio_obj_t *);
 static int  _client_read(eio_obj_t *, List);
 static int  _client_write(eio_obj_t *, List);
 
+/* Most queued messages sent to a client in one writev() */
+#define CLIENT_WRITE_IOV 16
+
 struct io_operations client_ops = {
 	readable:	&_client_readable,
 	writable:	&_client_writable,
@@ -217,11 +221,33 @@ static void _route_msg_task_to_client(eio_obj_t *obj);
 static void _free_outgoing_msg(struct io_buf *msg, slurmd_job_t *job);
 static void _free_incoming_msg(struct io_buf *msg, slurmd_job_t *job);
 static void _free_all_outgoing_msgs(List msg_queue, slurmd_job_t *job);
+static void _requeue_outgoing_msgs(List msg_queue, struct io_buf **msg,
+				   int first, int last);
 static bool _incoming_buf_free(slurmd_job_t *job);
 static bool _outgoing_buf_free(slurmd_job_t *job);
 static int  _send_connection_okay_response(slurmd_job_t *job);
 static struct io_buf *_build_connection_okay_message(slurmd_job_t *job);
 
+/*
+ * Limits on outgoing buffers, scaled so that larger messages do not
+ * raise the memory a step may hold for stdout/err.
+ */
+static inline int
+_stdio_max_free_buf(slurmd_job_t *job)
+{
+	int scale = job->io_msg_len / MAX_MSG_LEN;
+
+	return MAX(STDIO_MAX_FREE_BUF / scale, 64);
+}
+
+static inline int
+_stdio_max_msg_cache(slurmd_job_t *job)
+{
+	int scale = job->io_msg_len / MAX_MSG_LEN;
+
+	return MAX(STDIO_MAX_MSG_CACHE / scale, 8);
+}
+
 /**********************************************************************
  * IO client socket functions
  **********************************************************************/
@@ -445,8 +471,10 @@ static int
 _client_write(eio_obj_t *obj, List objs)
 {
 	struct client_io_info *client = (struct client_io_info *) obj->arg;
-	void *buf;
-	int n;
+	struct iovec iov[CLIENT_WRITE_IOV];
+	struct io_buf *msg[CLIENT_WRITE_IOV];
+	int cnt, i;
+	ssize_t n;
 
 	xassert(client->magic == CLIENT_IO_MAGIC);
 
@@ -470,38 +498,73 @@ _client_write(eio_obj_t *obj, List objs)
 	debug5("  client->out_remaining = %d", client->out_remaining);
 
 	/*
-	 * Write message to socket.
+	 * Gather the partially sent message and the messages queued
+	 * behind it, so that a burst of small task writes goes out in
+	 * one system call.
 	 */
-	buf = client->out_msg->data +
+	msg[0] = client->out_msg;
+	iov[0].iov_base = client->out_msg->data +
 		(client->out_msg->length - client->out_remaining);
+	iov[0].iov_len = client->out_remaining;
+	for (cnt = 1; cnt < CLIENT_WRITE_IOV; cnt++) {
+		msg[cnt] = list_dequeue(client->msg_queue);
+		if (msg[cnt] == NULL)
+			break;
+		iov[cnt].iov_base = msg[cnt]->data;
+		iov[cnt].iov_len = msg[cnt]->length;
+	}
+
+	/*
+	 * Write messages to socket.
+	 */
 again:
-	if ((n = write(obj->fd, buf, client->out_remaining)) < 0) {
+	if ((n = writev(obj->fd, iov, cnt)) < 0) {
 		if (errno == EINTR) {
 			goto again;
 		} else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
 			debug5("_client_write returned EAGAIN");
-			return SLURM_SUCCESS;
+			_requeue_outgoing_msgs(client->msg_queue, msg, 1, cnt);
 		} else {
 			client->out_eof = true;
+			_requeue_outgoing_msgs(client->msg_queue, msg, 1, cnt);
 			_free_all_outgoing_msgs(client->msg_queue, client->job);
-			return SLURM_SUCCESS;
 		}
+		return SLURM_SUCCESS;
 	}
-	if (n < client->out_remaining) {
-		error("Only wrote %d of %d bytes to socket", 
-		      n, client->out_remaining);
-	} else
-		debug5("Wrote %d bytes to socket", n);
-	client->out_remaining -= n;
-	if (client->out_remaining > 0)
+	debug5("Wrote %d bytes from %d messages to socket", (int) n, cnt);
+
+	for (i = 0; i < cnt; i++) {
+		if (n < iov[i].iov_len)
+			break;
+		n -= iov[i].iov_len;
+		_free_outgoing_msg(msg[i], client->job);
+	}
+	if (i == cnt) {
+		client->out_msg = NULL;
 		return SLURM_SUCCESS;
+	}
 
-	_free_outgoing_msg(client->out_msg, client->job);
-	client->out_msg = NULL;
+	/* Resume within the first message that was not fully written */
+	client->out_msg = msg[i];
+	client->out_remaining = iov[i].iov_len - n;
+	_requeue_outgoing_msgs(client->msg_queue, msg, i + 1, cnt);
 
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Put messages msg[first..last-1] back at the head of the queue, in order.
+ */
+static void
+_requeue_outgoing_msgs(List msg_queue, struct io_buf **msg,
+		       int first, int last)
+{
+	int i;
+
+	for (i = last - 1; i >= first; i--)
+		list_push(msg_queue, msg[i]);
+}
+
 
 static bool
 _local_file_writable(eio_obj_t *obj)
@@ -725,7 +788,7 @@ _create_task_out_eio(int fd, uint16_t type,
 	out->gtaskid = task->gtid;
 	out->ltaskid = task->id;
 	out->job = job;
-	out->buf = cbuf_create(MAX_MSG_LEN, MAX_MSG_LEN*4);
+	out->buf = cbuf_create(job->io_msg_len, job->io_msg_len*4);
 	out->eof = false;
 	out->eof_msg_sent = false;
 	if (cbuf_opt_set(out->buf, CBUF_OPT_OVERWRITE, CBUF_NO_DROP) == -1)
@@ -1165,8 +1228,8 @@ _shrink_msg_cache(List cache, slurmd_job_t *job)
 	int i;
 
 	count = list_count(cache);
-	if (count > STDIO_MAX_MSG_CACHE)
-		over = count - STDIO_MAX_MSG_CACHE;
+	if (count > _stdio_max_msg_cache(job))
+		over = count - _stdio_max_msg_cache(job);
 
 	for (i = 0; i < over; i++) {
 		msg = list_dequeue(cache);
@@ -1711,7 +1774,7 @@ _send_eof_msg(struct task_read_info *out)
 		   a poll returns POLLHUP on the incoming task pipe,
 		   put there are no outgoing message buffers available,
 		   the slurmstepd will start spinning. */
-		msg = alloc_io_buf();
+		msg = alloc_io_buf(out->job->io_msg_len);
 	}
 
 	header.type = out->type;
@@ -1778,10 +1841,10 @@ _task_build_message(struct task_read_info *out, slurmd_job_t *job, cbuf_t cbuf)
 	ptr = msg->data + io_hdr_packed_size();
 
 	if (job->buffered_stdio) {
-		avail = cbuf_peek_line(cbuf, ptr, MAX_MSG_LEN, 1);
-		if (avail >= MAX_MSG_LEN)
+		avail = cbuf_peek_line(cbuf, ptr, job->io_msg_len, 1);
+		if (avail >= job->io_msg_len)
 			must_truncate = true;
-		else if (avail == 0 && cbuf_used(cbuf) >= MAX_MSG_LEN)
+		else if (avail == 0 && cbuf_used(cbuf) >= job->io_msg_len)
 			must_truncate = true;
 	}
 
@@ -1794,9 +1857,10 @@ _task_build_message(struct task_read_info *out, slurmd_job_t *job, cbuf_t cbuf)
 	 * Hence the "|| out->eof".
 	 */
 	if (must_truncate || !job->buffered_stdio || out->eof) {
-		n = cbuf_read(cbuf, ptr, MAX_MSG_LEN);
+		n = cbuf_read(cbuf, ptr, job->io_msg_len);
 	} else {
-		n = cbuf_read_line(cbuf, ptr, MAX_MSG_LEN, -1);
+		/* Coalesce every complete line that fits in one message */
+		n = cbuf_read_line(cbuf, ptr, job->io_msg_len, -1);
 		if (n == 0) {
 			debug5("  partial line in buffer, ignoring");
 			debug4("Leaving  _task_build_message");
@@ -1827,7 +1891,7 @@ _task_build_message(struct task_read_info *out, slurmd_job_t *job, cbuf_t cbuf)
 }
 
 struct io_buf *
-alloc_io_buf(void)
+alloc_io_buf(int size)
 {
 	struct io_buf *buf;
 
@@ -1838,7 +1902,7 @@ alloc_io_buf(void)
 	buf->length = 0;
 	/* The following "+ 1" is just temporary so I can stick a \0 at
 	   the end and do a printf of the data pointer */
-	buf->data = xmalloc(MAX_MSG_LEN + io_hdr_packed_size() + 1);
+	buf->data = xmalloc(size + io_hdr_packed_size() + 1);
 	if (!buf->data) {
 		xfree(buf);
 		return NULL;
@@ -1866,7 +1930,7 @@ _incoming_buf_free(slurmd_job_t *job)
 	if (list_count(job->free_incoming) > 0) {
 		return true;
 	} else if (job->incoming_count < STDIO_MAX_FREE_BUF) {
-		buf = alloc_io_buf();
+		buf = alloc_io_buf(MAX_MSG_LEN);
 		if (buf != NULL) {
 			list_enqueue(job->free_incoming, buf);
 			job->incoming_count++;
@@ -1884,8 +1948,8 @@ _outgoing_buf_free(slurmd_job_t *job)
 
 	if (list_count(job->free_outgoing) > 0) {
 		return true;
-	} else if (job->outgoing_count < STDIO_MAX_FREE_BUF) {
-		buf = alloc_io_buf();
+	} else if (job->outgoing_count < _stdio_max_free_buf(job)) {
+		buf = alloc_io_buf(job->io_msg_len);
 		if (buf != NULL) {
 			list_enqueue(job->free_outgoing, buf);
 			job->outgoing_count++;
@@ -46,7 +46,9 @@
 
 /*
  * The message cache uses up free message buffers, so STDIO_MAX_MSG_CACHE
- * must be a number smaller than STDIO_MAX_FREE_BUF.
+ * must be a number smaller than STDIO_MAX_FREE_BUF.  Both limits are for
+ * MAX_MSG_LEN sized messages and are scaled down when srun asks for a
+ * larger job->io_msg_len.
  */
 #define STDIO_MAX_FREE_BUF 1024
 #define STDIO_MAX_MSG_CACHE 128
@@ -74,7 +76,7 @@ typedef enum {
 } slurmd_filename_pattern_t;
 
 
-struct io_buf *alloc_io_buf(void);
+struct io_buf *alloc_io_buf(int size);
 void free_io_buf(struct io_buf *buf);
 
 /* 
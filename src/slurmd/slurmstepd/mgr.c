@@ -108,6 +108,7 @@
 #include "src/slurmd/slurmstepd/task.h"
 #include "src/slurmd/slurmstepd/io.h"
 #include "src/slurmd/slurmstepd/pdebug.h"
+#include "src/slurmd/slurmstepd/pmi_agg.h"
 #include "src/slurmd/slurmstepd/req.h"
 #include "src/slurmd/slurmstepd/pam_ses.h"
 #include "src/slurmd/slurmstepd/ulimits.h"
@@ -975,6 +976,13 @@ job_manager(slurmd_job_t *job)
 		goto fail2;
 	}
 
+	/* must precede _fork_all_tasks(), it sets up the tasks' env */
+	if (pmi_agg_init(job) != SLURM_SUCCESS) {
+		rc = ESLURMD_SETUP_ENVIRONMENT_ERROR;
+		io_close_task_fds(job);
+		goto fail2;
+	}
+
 	/* calls pam_setup() and requires pam_finish() if successful */
 	if (_fork_all_tasks(job) < 0) {
 		debug("_fork_all_tasks failed");
@@ -1001,6 +1009,7 @@ job_manager(slurmd_job_t *job)
 
 	_wait_for_all_tasks(job);
 	jobacct_gather_g_endpoll();
+	pmi_agg_fini();
 
 	job->state = SLURMSTEPD_STEP_ENDING;
 
@@ -0,0 +1,338 @@
+/*****************************************************************************\
+ *  pmi_agg.c - aggregate the PMI key-value exchange of a node's tasks
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "slurm/slurm_errno.h"
+#include "src/api/slurm_pmi.h"
+#include "src/common/env.h"
+#include "src/common/fd.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_auth.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmd/slurmstepd/pmi_agg.h"
+
+struct task_resp {
+	uint16_t port;
+	char *hostname;
+};				/* where a task waits for the barrier data */
+
+static slurmd_job_t *agg_job = NULL;
+static slurm_fd_t agg_fd = -1;
+static bool agg_shutdown = false;
+static struct kvs_comm_set *agg_kvs = NULL;  /* tasks' puts since barrier */
+static struct task_resp *agg_resp = NULL;    /* indexed by local task id */
+static uint32_t agg_resp_cnt = 0;	     /* tasks having reached barrier */
+
+static void *_agg_thread(void *arg);
+static void  _barrier_xmit(void);
+static int   _handle_barrier(kvs_get_msg_t *get_ptr);
+static void  _handle_put(struct kvs_comm_set *kvs_set_ptr);
+static void  _setenv_from_job(slurmd_job_t *job, const char *name);
+
+/* slurm_send_kvs_comm_set() and slurm_get_kvs_comm_set() read these from
+ * the environment, which for us is the step's */
+static void _setenv_from_job(slurmd_job_t *job, const char *name)
+{
+	char *val = getenvp(job->env, name);
+
+	if (val)
+		setenv(name, val, 1);
+}
+
+extern int pmi_agg_init(slurmd_job_t *job)
+{
+	slurm_addr_t addr;
+	pthread_attr_t attr;
+	pthread_t tid;
+
+	if (job->batch || (getenvp(job->env, "PMI_AGGREGATE") == NULL))
+		return SLURM_SUCCESS;
+	if ((getenvp(job->env, "SLURM_SRUN_COMM_HOST") == NULL) ||
+	    (getenvp(job->env, "SLURM_SRUN_COMM_PORT") == NULL)) {
+		error("PMI_AGGREGATE set without srun address");
+		return SLURM_ERROR;
+	}
+
+	if ((agg_fd = slurm_init_msg_engine_port(0)) < 0) {
+		error("pmi_agg: slurm_init_msg_engine_port: %m");
+		return SLURM_ERROR;
+	}
+	if (slurm_get_stream_addr(agg_fd, &addr) < 0) {
+		error("pmi_agg: slurm_get_stream_addr: %m");
+		slurm_shutdown_msg_engine(agg_fd);
+		agg_fd = -1;
+		return SLURM_ERROR;
+	}
+	fd_set_close_on_exec(agg_fd);
+
+	_setenv_from_job(job, "SLURM_SRUN_COMM_HOST");
+	_setenv_from_job(job, "SLURM_SRUN_COMM_PORT");
+	_setenv_from_job(job, "SLURM_PMI_RESP_IFHN");
+	_setenv_from_job(job, "PMI_TIME");
+
+	agg_job = job;
+	agg_resp = xmalloc(sizeof(struct task_resp) * job->node_tasks);
+
+	slurm_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&tid, &attr, _agg_thread, NULL)) {
+		error("pmi_agg: pthread_create: %m");
+		slurm_attr_destroy(&attr);
+		slurm_shutdown_msg_engine(agg_fd);
+		agg_fd = -1;
+		xfree(agg_resp);
+		return SLURM_ERROR;
+	}
+	slurm_attr_destroy(&attr);
+
+	env_array_overwrite_fmt(&job->env, "SLURM_PMI_STEPD_PORT", "%hu",
+				ntohs(addr.sin_port));
+	debug("pmi_agg: serving %u tasks on port %hu",
+	      job->node_tasks, ntohs(addr.sin_port));
+	return SLURM_SUCCESS;
+}
+
+extern void pmi_agg_fini(void)
+{
+	if (agg_fd < 0)
+		return;
+
+	/* Wakes up the thread in accept(), it may also be waiting on srun
+	 * for a barrier which will now never complete, so don't join it */
+	agg_shutdown = true;
+	shutdown(agg_fd, SHUT_RDWR);
+}
+
+static void *_agg_thread(void *arg)
+{
+	slurm_addr_t cli_addr;
+	slurm_msg_t msg;
+	slurm_fd_t fd;
+	uid_t req_uid, slurm_uid = slurm_get_slurm_user_id();
+	int rc;
+
+	while (!agg_shutdown) {
+		fd = slurm_accept_msg_conn(agg_fd, &cli_addr);
+		if (fd < 0) {
+			if ((errno != EINTR) && !agg_shutdown)
+				error("pmi_agg: slurm_accept_msg_conn: %m");
+			continue;
+		}
+
+		slurm_msg_t_init(&msg);
+		if (slurm_receive_msg(fd, &msg, 0) != 0) {
+			error("pmi_agg: slurm_receive_msg: %m");
+			slurm_close_accepted_conn(fd);
+			continue;
+		}
+
+		req_uid = g_slurm_auth_get_uid(msg.auth_cred, NULL);
+		if ((req_uid != slurm_uid) && (req_uid != 0) &&
+		    (req_uid != agg_job->uid)) {
+			error("Security violation, PMI message from uid %u",
+			      (unsigned int) req_uid);
+			rc = ESLURM_USER_ID_MISSING;
+		} else if (msg.msg_type == PMI_KVS_PUT_REQ) {
+			_handle_put((struct kvs_comm_set *) msg.data);
+			msg.data = NULL;	/* just moved the pointer */
+			rc = SLURM_SUCCESS;
+		} else if (msg.msg_type == PMI_KVS_GET_REQ) {
+			rc = _handle_barrier((kvs_get_msg_t *) msg.data);
+		} else {
+			error("pmi_agg: unexpected message type %u",
+			      msg.msg_type);
+			rc = SLURM_UNEXPECTED_MSG_ERROR;
+		}
+
+		/* The task must have its reply before it waits for the
+		 * barrier data */
+		slurm_send_rc_msg(&msg, rc);
+		slurm_close_accepted_conn(fd);
+		if (msg.msg_type == PMI_KVS_PUT_REQ)
+			slurm_free_kvs_comm_set(msg.data);
+		else if (msg.msg_type == PMI_KVS_GET_REQ)
+			slurm_free_get_kvs_msg(msg.data);
+		else
+			slurm_free_msg_data(msg.msg_type, msg.data);
+		if (msg.auth_cred)
+			(void) g_slurm_auth_destroy(msg.auth_cred);
+
+		if (agg_resp_cnt == agg_job->node_tasks)
+			_barrier_xmit();
+	}
+
+	slurm_shutdown_msg_engine(agg_fd);
+	return NULL;
+}
+
+/* Merge a task's puts with those of the other tasks on this node.
+ * NOTE: We just move pointers rather than copy data. Keys put by more than
+ * one task are left for srun to resolve. */
+static void _handle_put(struct kvs_comm_set *kvs_set_ptr)
+{
+	struct kvs_comm *kvs_new, *kvs_ptr;
+	int i, j, k;
+
+	if (agg_kvs == NULL) {
+		agg_kvs = kvs_set_ptr;
+		return;
+	}
+
+	for (i = 0; i < kvs_set_ptr->kvs_comm_recs; i++) {
+		kvs_new = kvs_set_ptr->kvs_comm_ptr[i];
+		kvs_ptr = NULL;
+		for (j = 0; j < agg_kvs->kvs_comm_recs; j++) {
+			if (!strcmp(agg_kvs->kvs_comm_ptr[j]->kvs_name,
+				    kvs_new->kvs_name)) {
+				kvs_ptr = agg_kvs->kvs_comm_ptr[j];
+				break;
+			}
+		}
+		if (kvs_ptr == NULL) {
+			xrealloc(agg_kvs->kvs_comm_ptr,
+				 sizeof(struct kvs_comm *) *
+				 (agg_kvs->kvs_comm_recs + 1));
+			agg_kvs->kvs_comm_ptr[agg_kvs->kvs_comm_recs++] =
+				kvs_new;
+			kvs_set_ptr->kvs_comm_ptr[i] = NULL;
+			continue;
+		}
+
+		xrealloc(kvs_ptr->kvs_keys, sizeof(char *) *
+			 (kvs_ptr->kvs_cnt + kvs_new->kvs_cnt));
+		xrealloc(kvs_ptr->kvs_values, sizeof(char *) *
+			 (kvs_ptr->kvs_cnt + kvs_new->kvs_cnt));
+		for (k = 0; k < kvs_new->kvs_cnt; k++) {
+			kvs_ptr->kvs_keys[kvs_ptr->kvs_cnt] =
+				kvs_new->kvs_keys[k];
+			kvs_ptr->kvs_values[kvs_ptr->kvs_cnt] =
+				kvs_new->kvs_values[k];
+			kvs_ptr->kvs_cnt++;
+			kvs_new->kvs_keys[k] = NULL;
+			kvs_new->kvs_values[k] = NULL;
+		}
+	}
+	slurm_free_kvs_comm_set(kvs_set_ptr);
+}
+
+/* Record where a task waits for the barrier data */
+static int _handle_barrier(kvs_get_msg_t *get_ptr)
+{
+	int i;
+
+	for (i = 0; i < agg_job->node_tasks; i++) {
+		if (agg_job->task[i]->gtid == get_ptr->task_id)
+			break;
+	}
+	if (i >= agg_job->node_tasks) {
+		error("pmi_agg: barrier request from task %u not on this node",
+		      get_ptr->task_id);
+		return SLURM_ERROR;
+	}
+
+	if (agg_resp[i].port == 0)
+		agg_resp_cnt++;
+	else {
+		error("pmi_agg: duplicate barrier request from task %u",
+		      get_ptr->task_id);
+		xfree(agg_resp[i].hostname);
+	}
+	agg_resp[i].port = get_ptr->port;
+	agg_resp[i].hostname = get_ptr->hostname;
+	get_ptr->hostname = NULL;	/* just moved the pointer */
+	return SLURM_SUCCESS;
+}
+
+/* All local tasks are at the barrier: send their puts to srun, enter the
+ * barrier on their behalf as rank nodeid of nnodes and hand srun's
+ * response (only the keys new since the last barrier) to each task */
+static void _barrier_xmit(void)
+{
+	struct kvs_comm_set *kvs_set_ptr = NULL;
+	slurm_msg_t msg_send;
+	int i, rc, msg_rc;
+
+	if (agg_kvs) {
+		rc = slurm_send_kvs_comm_set(agg_kvs, agg_job->nodeid,
+					     agg_job->nnodes);
+		if (rc != SLURM_SUCCESS)
+			error("pmi_agg: slurm_send_kvs_comm_set: %d", rc);
+		slurm_free_kvs_comm_set(agg_kvs);
+		agg_kvs = NULL;
+	}
+
+	rc = slurm_get_kvs_comm_set(&kvs_set_ptr, agg_job->nodeid,
+				    agg_job->nnodes);
+	if (rc != SLURM_SUCCESS) {
+		error("pmi_agg: slurm_get_kvs_comm_set: %d", rc);
+		goto fini;
+	}
+
+	for (i = 0; i < agg_job->node_tasks; i++) {
+		slurm_msg_t_init(&msg_send);
+		msg_send.msg_type = PMI_KVS_GET_RESP;
+		msg_send.data = (void *) kvs_set_ptr;
+		slurm_set_addr(&msg_send.address, agg_resp[i].port,
+			       agg_resp[i].hostname);
+		if (slurm_send_recv_rc_msg_only_one(&msg_send,
+						    &msg_rc, 0) < 0) {
+			error("pmi_agg: could not send KVS to task %u: %m",
+			      agg_job->task[i]->gtid);
+		} else if (msg_rc != SLURM_SUCCESS) {
+			error("pmi_agg: KVS confirm from task %u, rc=%d",
+			      agg_job->task[i]->gtid, msg_rc);
+		}
+	}
+	slurm_free_kvs_comm_set(kvs_set_ptr);
+
+fini:	for (i = 0; i < agg_job->node_tasks; i++) {
+		xfree(agg_resp[i].hostname);
+		agg_resp[i].port = 0;
+	}
+	agg_resp_cnt = 0;
+}
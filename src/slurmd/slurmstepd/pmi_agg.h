@@ -0,0 +1,59 @@
+/*****************************************************************************\
+ *  pmi_agg.h - aggregate the PMI key-value exchange of a node's tasks
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMSTEPD_PMI_AGG_H
+#define _SLURMSTEPD_PMI_AGG_H
+
+#include "src/slurmd/slurmstepd/slurmstepd_job.h"
+
+/*
+ * If PMI_AGGREGATE is set in the step's environment, start a thread which
+ * serves the PMI key-value exchange of this node's tasks. The tasks' puts
+ * are merged and sent to srun in a single RPC once all of them have reached
+ * a barrier, and srun's response is relayed to each task. Must be called
+ * before the tasks are forked, it adds SLURM_PMI_STEPD_PORT to job->env.
+ *
+ * RET SLURM_SUCCESS, also if aggregation is not requested
+ */
+extern int pmi_agg_init(slurmd_job_t *job);
+
+/*
+ * Stop the thread started by pmi_agg_init(), if any.
+ */
+extern void pmi_agg_fini(void);
+
+#endif /* !_SLURMSTEPD_PMI_AGG_H */
@@ -47,6 +47,7 @@
 #include <stdlib.h>
 #include <signal.h>
 
+#include "src/common/fd.h"
 #include "src/common/gres.h"
 #include "src/common/slurm_jobacct_gather.h"
 #include "src/common/slurm_rlimits_info.h"
@@ -64,9 +65,10 @@
 #include "src/slurmd/slurmstepd/slurmstepd.h"
 #include "src/slurmd/slurmstepd/slurmstepd_job.h"
 
-static int _init_from_slurmd(int sock, char **argv, slurm_addr_t **_cli,
-			     slurm_addr_t **_self, slurm_msg_t **_msg,
-			     int *_ngids, gid_t **_gids);
+static int _init_from_slurmd(int sock, char **argv, bool spare,
+			     slurm_addr_t **_cli, slurm_addr_t **_self,
+			     slurm_msg_t **_msg, int *_ngids, gid_t **_gids);
+static void _recv_conf_from_slurmd(int sock);
 
 static void _dump_user_env(void);
 static void _send_ok_to_slurmd(int sock);
@@ -95,12 +97,16 @@ main (int argc, char *argv[])
 	int ngids;
 	gid_t *gids;
 	int rc = 0;
+	bool spare = false;
 
 	if ((argc == 2) && (strcmp(argv[1], "getenv") == 0)) {
 		print_rlimits();
 		_dump_user_env();
 		exit(0);
 	}
+	/* Started ahead of time by the slurmd's slurmstepd pool */
+	if ((argc == 2) && (strcmp(argv[1], "spare") == 0))
+		spare = true;
 	xsignal_block(slurmstepd_blocked_signals);
 	conf = xmalloc(sizeof(*conf));
 	conf->argv = &argv;
@@ -110,7 +116,7 @@ main (int argc, char *argv[])
 		fatal( "failed to initialize node selection plugin" );
 
 	/* Receive job parameters from the slurmd */
-	_init_from_slurmd(STDIN_FILENO, argv, &cli, &self, &msg,
+	_init_from_slurmd(STDIN_FILENO, argv, spare, &cli, &self, &msg,
 			  &ngids, &gids);
 
 	/* Fancy way of closing stdin that keeps STDIN_FILENO from being
@@ -201,44 +207,14 @@ rwfail:
 }
 
 /*
- *  This function handles the initialization information from slurmd
- *  sent by _send_slurmstepd_init() in src/slurmd/slurmd/req.c.
+ *  Receive the slurmd's configuration and set up logging from it.
  */
-static int
-_init_from_slurmd(int sock, char **argv,
-		  slurm_addr_t **_cli, slurm_addr_t **_self, slurm_msg_t **_msg,
-		  int *_ngids, gid_t **_gids)
+static void
+_recv_conf_from_slurmd(int sock)
 {
 	char *incoming_buffer = NULL;
 	Buf buffer;
-	int step_type;
 	int len;
-	slurm_addr_t *cli = NULL;
-	slurm_addr_t *self = NULL;
-	slurm_msg_t *msg = NULL;
-	int ngids = 0;
-	gid_t *gids = NULL;
-	uint16_t port;
-	char buf[16];
-	log_options_t lopts = LOG_OPTS_INITIALIZER;
-
-	log_init(argv[0], lopts, LOG_DAEMON, NULL);
-
-	/* receive job type from slurmd */
-	safe_read(sock, &step_type, sizeof(int));
-	debug3("step_type = %d", step_type);
-
-	/* receive reverse-tree info from slurmd */
-	pthread_mutex_lock(&step_complete.lock);
-	safe_read(sock, &step_complete.rank, sizeof(int));
-	safe_read(sock, &step_complete.parent_rank, sizeof(int));
-	safe_read(sock, &step_complete.children, sizeof(int));
-	safe_read(sock, &step_complete.depth, sizeof(int));
-	safe_read(sock, &step_complete.max_depth, sizeof(int));
-	safe_read(sock, &step_complete.parent_addr, sizeof(slurm_addr_t));
-	step_complete.bits = bit_alloc(step_complete.children);
-	step_complete.jobacct = jobacct_gather_g_create(NULL);
-	pthread_mutex_unlock(&step_complete.lock);
 
 	/* receive conf from slurmd */
 	safe_read(sock, &len, sizeof(int));
@@ -274,6 +250,66 @@ _init_from_slurmd(int sock, char **argv,
 	jobacct_gather_g_startpoll(conf->job_acct_gather_freq);
 
 	switch_g_slurmd_step_init();
+	return;
+
+rwfail:
+	fatal("Error reading configuration from slurmd");
+	exit(1);
+}
+
+/*
+ *  This function handles the initialization information from slurmd
+ *  sent by _send_slurmstepd_init() in src/slurmd/slurmd/req.c.
+ *
+ *  A spare slurmstepd gets the configuration as soon as it is started,
+ *  then waits here until the slurmd hands it a step.  It exits quietly
+ *  if the slurmd closes the pipe instead.
+ */
+static int
+_init_from_slurmd(int sock, char **argv, bool spare,
+		  slurm_addr_t **_cli, slurm_addr_t **_self, slurm_msg_t **_msg,
+		  int *_ngids, gid_t **_gids)
+{
+	char *incoming_buffer = NULL;
+	Buf buffer;
+	int step_type;
+	int len;
+	slurm_addr_t *cli = NULL;
+	slurm_addr_t *self = NULL;
+	slurm_msg_t *msg = NULL;
+	int ngids = 0;
+	gid_t *gids = NULL;
+	uint16_t port;
+	char buf[16];
+	log_options_t lopts = LOG_OPTS_INITIALIZER;
+
+	log_init(argv[0], lopts, LOG_DAEMON, NULL);
+
+	if (spare) {
+		_recv_conf_from_slurmd(sock);
+		debug3("spare slurmstepd waiting for a step");
+		if (fd_read_n(sock, &step_type, sizeof(int)) != sizeof(int))
+			exit(0);
+	} else {
+		/* receive job type from slurmd */
+		safe_read(sock, &step_type, sizeof(int));
+	}
+	debug3("step_type = %d", step_type);
+
+	/* receive reverse-tree info from slurmd */
+	pthread_mutex_lock(&step_complete.lock);
+	safe_read(sock, &step_complete.rank, sizeof(int));
+	safe_read(sock, &step_complete.parent_rank, sizeof(int));
+	safe_read(sock, &step_complete.children, sizeof(int));
+	safe_read(sock, &step_complete.depth, sizeof(int));
+	safe_read(sock, &step_complete.max_depth, sizeof(int));
+	safe_read(sock, &step_complete.parent_addr, sizeof(slurm_addr_t));
+	step_complete.bits = bit_alloc(step_complete.children);
+	step_complete.jobacct = jobacct_gather_g_create(NULL);
+	pthread_mutex_unlock(&step_complete.lock);
+
+	if (!spare)
+		_recv_conf_from_slurmd(sock);
 
 	slurm_get_ip_str(&step_complete.parent_addr, &port, buf, 16);
 	debug3("slurmstepd rank %d, parent address = %s, port = %u",
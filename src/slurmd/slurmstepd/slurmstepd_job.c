@@ -53,7 +53,9 @@
 #include "src/common/eio.h"
 #include "src/common/fd.h"
 #include "src/common/gres.h"
+#include "src/common/io_hdr.h"
 #include "src/common/log.h"
+#include "src/common/macros.h"
 #include "src/common/node_select.h"
 #include "src/common/slurm_jobacct_gather.h"
 #include "src/common/slurm_protocol_api.h"
@@ -267,6 +269,11 @@ job_create(launch_tasks_request_msg_t *msg)
 
 	job->buffered_stdio = msg->buffered_stdio;
 	job->labelio = msg->labelio;
+	if (msg->io_msg_len == 0)
+		job->io_msg_len = MAX_MSG_LEN;
+	else
+		job->io_msg_len = MIN(MAX(msg->io_msg_len, MAX_MSG_LEN),
+				      MAX_IO_MSG_LEN);
 
 	job->task_prolog = xstrdup(msg->task_prolog);
 	job->task_epilog = xstrdup(msg->task_epilog);
@@ -374,6 +381,7 @@ job_batch_job_create(batch_job_launch_msg_t *msg)
 	job->stepid  = msg->step_id;
 
 	job->batch   = true;
+	job->io_msg_len = MAX_MSG_LEN;
 	if (msg->acctg_freq != (uint16_t) NO_VAL)
 		jobacct_gather_g_change_poll(msg->acctg_freq);
 	job->multi_prog = 0;
@@ -178,6 +178,7 @@ typedef struct slurmd_job {
 				 * 0 for no buffering
 				 */
 	uint8_t labelio;	/* 1 for labelling output with the task id */
+	uint32_t io_msg_len;	/* max stdout/err message payload */
 
 	pthread_t      ioid;  /* pthread id of IO thread                    */
 	pthread_t      msgid; /* pthread id of message thread               */
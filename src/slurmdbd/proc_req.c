@@ -46,9 +46,14 @@
 #include "src/common/uid.h"
 #include "src/slurmdbd/read_config.h"
 #include "src/slurmdbd/rpc_mgr.h"
+#include "src/slurmdbd/rpc_pool.h"
 #include "src/slurmdbd/proc_req.h"
 #include "src/slurmctld/slurmctld.h"
 
+/* Maximum number of records from a DBD_SEND_MULT_MSG stored in one
+ * transaction */
+#define MAX_MULT_BATCH 1000
+
 /* Local functions */
 static int   _add_accounts(slurmdbd_conn_t *slurmdbd_conn,
 			   Buf in_buffer, Buf *out_buffer, uint32_t *uid);
@@ -1316,8 +1321,12 @@ static int _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn,
 		slurmdbd_conn->db_conn, *uid, cond_msg->cond);
 
 	if (!errno) {
+		slurmdb_job_cond_t *job_cond = cond_msg->cond;
 		if (!list_msg.my_list)
 			list_msg.my_list = list_create(NULL);
+		/* The client picks up after the last job sent */
+		list_msg.return_code =
+			(job_cond && job_cond->page_cluster) ? 1 : 0;
 		*out_buffer = init_buf(1024);
 		pack16((uint16_t) DBD_GOT_JOBS, *out_buffer);
 		slurmdbd_pack_list_msg(&list_msg, slurmdbd_conn->rpc_version,
@@ -1777,6 +1786,7 @@ static int _init_conn(slurmdbd_conn_t *slurmdbd_conn,
 	slurmdbd_conn->db_conn = acct_storage_g_get_connection(
 		false, slurmdbd_conn->newsockfd, init_msg->rollback,
 		slurmdbd_conn->cluster_name);
+	slurmdbd_conn->rollback = init_msg->rollback;
 	slurmdbd_conn->rpc_version = init_msg->version;
 	if (errno) {
 		rc = errno;
@@ -3409,6 +3419,249 @@ static int   _send_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
 	return SLURM_SUCCESS;
 }
 
+/* One lane of a batch of a DBD_SEND_MULT_MSG stored in parallel */
+typedef struct {
+	slurmdbd_conn_t *conn;	 /* the connection or lane_conn */
+	slurmdbd_conn_t lane_conn; /* copy using a lane's db_conn */
+	int *inx;		 /* records of this lane, in order */
+	int cnt;
+	Buf *req_bufs;		 /* all records of the batch */
+	Buf *ret_bufs;		 /* and their replies */
+	uint32_t uid;
+	bool started;		 /* storage batch begun */
+	bool commit;		 /* end the storage batch with commit */
+	int rc;
+} mult_lane_t;
+
+/* Return the lane a record of a multiple message goes in. Records of
+ * one job always go in the same lane so they are stored in order, all
+ * others (node states, reservations, ...) go in the first. */
+static int _mult_msg_lane(uint16_t rpc_version, Buf req_buf, int lanes)
+{
+	Buf buffer = create_buf(get_buf_data(req_buf), size_buf(req_buf));
+	uint16_t msg_type;
+	uint32_t job_id = 0;
+	void *msg = NULL;
+
+	safe_unpack16(&msg_type, buffer);
+	switch (msg_type) {
+	case DBD_JOB_COMPLETE:
+		if (slurmdbd_unpack_job_complete_msg(
+			    (dbd_job_comp_msg_t **)&msg, rpc_version, buffer)
+		    != SLURM_SUCCESS)
+			break;
+		job_id = ((dbd_job_comp_msg_t *)msg)->job_id;
+		slurmdbd_free_job_complete_msg(msg);
+		break;
+	case DBD_JOB_START:
+		if (slurmdbd_unpack_job_start_msg(&msg, rpc_version, buffer)
+		    != SLURM_SUCCESS)
+			break;
+		job_id = ((dbd_job_start_msg_t *)msg)->job_id;
+		slurmdbd_free_job_start_msg(msg);
+		break;
+	case DBD_JOB_SUSPEND:
+		if (slurmdbd_unpack_job_suspend_msg(
+			    (dbd_job_suspend_msg_t **)&msg, rpc_version,
+			    buffer) != SLURM_SUCCESS)
+			break;
+		job_id = ((dbd_job_suspend_msg_t *)msg)->job_id;
+		slurmdbd_free_job_suspend_msg(msg);
+		break;
+	case DBD_STEP_COMPLETE:
+		if (slurmdbd_unpack_step_complete_msg(
+			    (dbd_step_comp_msg_t **)&msg, rpc_version, buffer)
+		    != SLURM_SUCCESS)
+			break;
+		job_id = ((dbd_step_comp_msg_t *)msg)->job_id;
+		slurmdbd_free_step_complete_msg(msg);
+		break;
+	case DBD_STEP_START:
+		if (slurmdbd_unpack_step_start_msg(
+			    (dbd_step_start_msg_t **)&msg, rpc_version, buffer)
+		    != SLURM_SUCCESS)
+			break;
+		job_id = ((dbd_step_start_msg_t *)msg)->job_id;
+		slurmdbd_free_step_start_msg(msg);
+		break;
+	default:
+		break;
+	}
+
+unpack_error:
+	xfer_buf_data(buffer);
+	return job_id % lanes;
+}
+
+/* Begin a storage batch on the lane's connection and store its records */
+static void _mult_lane_store(void *arg)
+{
+	mult_lane_t *lane = (mult_lane_t *) arg;
+	Buf req_buf;
+	int i, inx;
+
+	if ((lane->rc = jobacct_storage_g_batch(lane->conn->db_conn,
+						true, true))
+	    != SLURM_SUCCESS)
+		return;
+	lane->started = true;
+
+	for (i = 0; i < lane->cnt; i++) {
+		inx = lane->inx[i];
+		req_buf = lane->req_bufs[inx];
+		lane->rc = proc_req(lane->conn, get_buf_data(req_buf),
+				    size_buf(req_buf), 0,
+				    &lane->ret_bufs[inx], &lane->uid);
+		if (lane->rc != SLURM_SUCCESS)
+			break;
+	}
+}
+
+/* Commit or discard the lane's storage batch */
+static void _mult_lane_end(void *arg)
+{
+	mult_lane_t *lane = (mult_lane_t *) arg;
+	int rc;
+
+	if (!lane->started)
+		return;
+	lane->started = false;
+	rc = jobacct_storage_g_batch(lane->conn->db_conn, false,
+				     lane->commit);
+	if (lane->commit && (rc != SLURM_SUCCESS))
+		lane->rc = rc;
+}
+
+/* Return how many lanes the records of a multiple message on this
+ * connection can be stored in, opening the database connections of
+ * the lanes after the first as needed */
+static int _mult_lanes(slurmdbd_conn_t *slurmdbd_conn)
+{
+	int i, lanes = ingest_pool_lanes();
+	void *db_conn;
+
+	/* Other plugins store records in order on one connection, and a
+	 * rollback connection's changes must all be on that connection */
+	if ((lanes <= 1) || slurmdbd_conn->rollback ||
+	    !slurmdbd_conf->storage_type ||
+	    !strstr(slurmdbd_conf->storage_type, "mysql"))
+		return 1;
+
+	for (i = slurmdbd_conn->lane_cnt; i < (lanes - 1); i++) {
+		errno = 0;
+		db_conn = acct_storage_g_get_connection(
+			false, slurmdbd_conn->newsockfd, false,
+			slurmdbd_conn->cluster_name);
+		if (errno) {
+			error("CONN:%u unable to open another database "
+			      "connection, storing records with %d",
+			      slurmdbd_conn->newsockfd, i + 1);
+			acct_storage_g_close_connection(&db_conn);
+			break;
+		}
+		xrealloc(slurmdbd_conn->lane_conns,
+			 sizeof(void *) * (i + 1));
+		slurmdbd_conn->lane_conns[i] = db_conn;
+		slurmdbd_conn->lane_cnt = i + 1;
+	}
+
+	return MIN(lanes, slurmdbd_conn->lane_cnt + 1);
+}
+
+/* Store a batch of records of a multiple message, cnt of them starting
+ * at req_bufs, in lanes that run in parallel in the ingest pool.  As
+ * when they are stored in order, the replies are added to ret_list
+ * only if every lane commits; otherwise a single error reply is. */
+static int _store_mult_parallel(slurmdbd_conn_t *slurmdbd_conn,
+				Buf *req_bufs, int cnt, int lanes,
+				uint32_t uid, List ret_list)
+{
+	mult_lane_t *lane_array = xmalloc(sizeof(mult_lane_t) * lanes);
+	void **lane_args = xmalloc(sizeof(void *) * lanes);
+	Buf *ret_bufs = xmalloc(sizeof(Buf) * cnt);
+	int *lane_of = xmalloc(sizeof(int) * cnt);
+	int i, used = 0, rc = SLURM_SUCCESS;
+	char *comment = NULL;
+	mult_lane_t *lane;
+
+	for (i = 0; i < cnt; i++) {
+		lane_of[i] = _mult_msg_lane(slurmdbd_conn->rpc_version,
+					    req_bufs[i], lanes);
+		lane_array[lane_of[i]].cnt++;
+	}
+	for (i = 0; i < lanes; i++) {
+		lane = &lane_array[i];
+		if (!lane->cnt)
+			continue;
+		if (i == 0)
+			lane->conn = slurmdbd_conn;
+		else {
+			lane->lane_conn = *slurmdbd_conn;
+			lane->lane_conn.db_conn =
+				slurmdbd_conn->lane_conns[i - 1];
+			lane->conn = &lane->lane_conn;
+		}
+		lane->inx = xmalloc(sizeof(int) * lane->cnt);
+		lane->cnt = 0;
+		lane->req_bufs = req_bufs;
+		lane->ret_bufs = ret_bufs;
+		lane->uid = uid;
+		lane_args[used++] = lane;
+	}
+	for (i = 0; i < cnt; i++) {
+		lane = &lane_array[lane_of[i]];
+		lane->inx[lane->cnt++] = i;
+	}
+
+	ingest_pool_run(_mult_lane_store, lane_args, used);
+	for (i = 0; i < lanes; i++) {
+		if ((rc = lane_array[i].rc) != SLURM_SUCCESS) {
+			comment = "Record failed, batch discarded";
+			break;
+		}
+	}
+	for (i = 0; i < lanes; i++)
+		lane_array[i].commit = (rc == SLURM_SUCCESS);
+	ingest_pool_run(_mult_lane_end, lane_args, used);
+	if (rc == SLURM_SUCCESS) {
+		for (i = 0; i < lanes; i++) {
+			if ((rc = lane_array[i].rc) != SLURM_SUCCESS) {
+				/* Lanes already committed will see
+				 * their records again, which is no
+				 * different to a lost reply. */
+				comment = "Failed to commit batch of records";
+				error("CONN:%u %s", slurmdbd_conn->newsockfd,
+				      comment);
+				break;
+			}
+		}
+	}
+
+	debug2("DBD_SEND_MULT_MSG: stored %d records in %d lanes",
+	       cnt, used);
+	for (i = 0; i < cnt; i++) {
+		if (!ret_bufs[i])
+			continue;
+		if (rc == SLURM_SUCCESS)
+			list_append(ret_list, ret_bufs[i]);
+		else
+			free_buf(ret_bufs[i]);
+	}
+	if (rc != SLURM_SUCCESS)
+		list_append(ret_list,
+			    make_dbd_rc_msg(slurmdbd_conn->rpc_version,
+					    rc, comment, DBD_SEND_MULT_MSG));
+
+	for (i = 0; i < lanes; i++)
+		xfree(lane_array[i].inx);
+	xfree(lane_array);
+	xfree(lane_args);
+	xfree(ret_bufs);
+	xfree(lane_of);
+
+	return rc;
+}
+
 static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer,
 			    uint32_t *uid)
@@ -3417,8 +3670,10 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 	dbd_list_msg_t list_msg;
 	char *comment = NULL;
 	ListIterator itr = NULL;
+	List batch_list = NULL;
 	Buf req_buf = NULL, ret_buf = NULL;
-	int rc = SLURM_SUCCESS;
+	Buf *req_bufs = NULL;
+	int cnt, lanes, rc = SLURM_SUCCESS;
 
 	if (*uid != slurmdbd_conf->slurm_user_id) {
 		comment = "DBD_SEND_MULT_MSG message from invalid uid";
@@ -3442,18 +3697,83 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 
 	list_msg.my_list = list_create(slurmdbd_free_buffer);
 
+	/* Records of different jobs can be stored in parallel, one
+	 * transaction per lane for each batch */
+	if ((list_count(get_msg->my_list) > 1) &&
+	    ((lanes = _mult_lanes(slurmdbd_conn)) > 1)) {
+		req_bufs = xmalloc(sizeof(Buf) * MAX_MULT_BATCH);
+		itr = list_iterator_create(get_msg->my_list);
+		while (rc == SLURM_SUCCESS) {
+			for (cnt = 0; cnt < MAX_MULT_BATCH; cnt++) {
+				if (!(req_buf = list_next(itr)))
+					break;
+				req_bufs[cnt] = req_buf;
+			}
+			if (cnt == 0)
+				break;
+			rc = _store_mult_parallel(slurmdbd_conn, req_bufs,
+						  cnt, lanes, *uid,
+						  list_msg.my_list);
+		}
+		list_iterator_destroy(itr);
+		xfree(req_bufs);
+		goto send_reply;
+	}
+
+	batch_list = list_create(slurmdbd_free_buffer);
+
+	/* Store the records MAX_MULT_BATCH at a time, each batch in
+	 * one transaction.  The replies of a batch are only sent back
+	 * once it is committed, if anything in it fails the whole
+	 * batch is discarded and the slurmctld will send it again. */
 	itr = list_iterator_create(get_msg->my_list);
-	while ((req_buf = list_next(itr))) {
-		ret_buf = NULL;
-		rc = proc_req(slurmdbd_conn, get_buf_data(req_buf),
-			      size_buf(req_buf), 0, &ret_buf, uid);
-		if (ret_buf)
-			list_append(list_msg.my_list, ret_buf);
-		if (rc != SLURM_SUCCESS)
+	while (rc == SLURM_SUCCESS) {
+		if ((rc = jobacct_storage_g_batch(slurmdbd_conn->db_conn,
+						  true, true))
+		    != SLURM_SUCCESS) {
+			comment = "Failed to start batch of records";
+			error("CONN:%u %s", slurmdbd_conn->newsockfd, comment);
+			list_append(list_msg.my_list,
+				    make_dbd_rc_msg(slurmdbd_conn->rpc_version,
+						    rc, comment,
+						    DBD_SEND_MULT_MSG));
+			break;
+		}
+		while ((list_count(batch_list) < MAX_MULT_BATCH)
+		       && (req_buf = list_next(itr))) {
+			ret_buf = NULL;
+			rc = proc_req(slurmdbd_conn, get_buf_data(req_buf),
+				      size_buf(req_buf), 0, &ret_buf, uid);
+			if (ret_buf)
+				list_append(batch_list, ret_buf);
+			if (rc != SLURM_SUCCESS)
+				break;
+		}
+		if (jobacct_storage_g_batch(slurmdbd_conn->db_conn, false,
+					    (rc == SLURM_SUCCESS))
+		    != SLURM_SUCCESS) {
+			if (rc == SLURM_SUCCESS) {
+				comment = "Failed to commit batch of records";
+				error("CONN:%u %s", slurmdbd_conn->newsockfd,
+				      comment);
+				rc = SLURM_ERROR;
+			} else
+				comment = "Record failed, batch discarded";
+			list_flush(batch_list);
+			list_append(list_msg.my_list,
+				    make_dbd_rc_msg(slurmdbd_conn->rpc_version,
+						    rc, comment,
+						    DBD_SEND_MULT_MSG));
+			break;
+		}
+		list_transfer(list_msg.my_list, batch_list);
+		if (!req_buf)
 			break;
 	}
 	list_iterator_destroy(itr);
+	list_destroy(batch_list);
 
+send_reply:
 	slurmdbd_free_list_msg(get_msg);
 
 	*out_buffer = init_buf(1024);
@@ -49,8 +49,12 @@ typedef struct {
 	uint16_t ctld_port; /* slurmctld_port */
 	void *db_conn; /* database connection */
 	char ip[32];
+	int lane_cnt; /* count of lane_conns */
+	void **lane_conns; /* more database connections to store a
+			    * multiple message's records in parallel */
 	slurm_fd_t newsockfd; /* socket connection descriptor */
 	uint16_t orig_port;
+	bool rollback; /* db_conn rolls back its changes */
 	uint16_t rpc_version; /* version of rpc */
 } slurmdbd_conn_t;
 
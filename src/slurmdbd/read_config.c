@@ -95,6 +95,7 @@ static void _clear_slurmdbd_conf(void)
 		slurmdbd_conf->dbd_port = 0;
 		slurmdbd_conf->debug_level = 0;
 		xfree(slurmdbd_conf->default_qos);
+		slurmdbd_conf->ingest_threads = 0;
 		xfree(slurmdbd_conf->log_file);
 		xfree(slurmdbd_conf->pid_file);
 		xfree(slurmdbd_conf->plugindir);
@@ -103,6 +104,7 @@ static void _clear_slurmdbd_conf(void)
 		slurmdbd_conf->purge_job = 0;
 		slurmdbd_conf->purge_step = 0;
 		slurmdbd_conf->purge_suspend = 0;
+		slurmdbd_conf->query_threads = 0;
 		slurmdbd_conf->slurm_user_id = NO_VAL;
 		xfree(slurmdbd_conf->slurm_user_name);
 		xfree(slurmdbd_conf->storage_backup_host);
@@ -140,6 +142,7 @@ extern int read_slurmdbd_conf(void)
 		{"DbdPort", S_P_UINT16},
 		{"DebugLevel", S_P_UINT16},
 		{"DefaultQOS", S_P_STRING},
+		{"IngestThreads", S_P_UINT16},
 		{"JobPurge", S_P_UINT32},
 		{"LogFile", S_P_STRING},
 		{"MessageTimeout", S_P_UINT16},
@@ -154,6 +157,7 @@ extern int read_slurmdbd_conf(void)
 		{"PurgeJobMonths", S_P_UINT32},
 		{"PurgeStepMonths", S_P_UINT32},
 		{"PurgeSuspendMonths", S_P_UINT32},
+		{"QueryThreads", S_P_UINT16},
 		{"SlurmUser", S_P_STRING},
 		{"StepPurge", S_P_UINT32},
 		{"StorageBackupHost", S_P_STRING},
@@ -214,6 +218,12 @@ extern int read_slurmdbd_conf(void)
 		s_p_get_uint16(&slurmdbd_conf->dbd_port, "DbdPort", tbl);
 		s_p_get_uint16(&slurmdbd_conf->debug_level, "DebugLevel", tbl);
 		s_p_get_string(&slurmdbd_conf->default_qos, "DefaultQOS", tbl);
+		if (!s_p_get_uint16(&slurmdbd_conf->ingest_threads,
+				    "IngestThreads", tbl))
+			slurmdbd_conf->ingest_threads =
+				DEFAULT_SLURMDBD_INGEST_THREADS;
+		else if (slurmdbd_conf->ingest_threads == 0)
+			slurmdbd_conf->ingest_threads = 1;
 		if (s_p_get_uint32(&slurmdbd_conf->purge_job,
 				   "JobPurge", tbl)) {
 			if (!slurmdbd_conf->purge_job)
@@ -331,6 +341,11 @@ extern int read_slurmdbd_conf(void)
 					|= SLURMDB_PURGE_MONTHS;
 		}
 
+		if (!s_p_get_uint16(&slurmdbd_conf->query_threads,
+				    "QueryThreads", tbl))
+			slurmdbd_conf->query_threads =
+				DEFAULT_SLURMDBD_QUERY_THREADS;
+
 		s_p_get_string(&slurmdbd_conf->slurm_user_name,
 			       "SlurmUser", tbl);
 
@@ -493,6 +508,7 @@ extern void log_config(void)
 	debug2("DbdPort           = %u", slurmdbd_conf->dbd_port);
 	debug2("DebugLevel        = %u", slurmdbd_conf->debug_level);
 	debug2("DefaultQOS        = %s", slurmdbd_conf->default_qos);
+	debug2("IngestThreads     = %u", slurmdbd_conf->ingest_threads);
 
 	debug2("LogFile           = %s", slurmdbd_conf->log_file);
 	debug2("MessageTimeout    = %u", slurmdbd_conf->msg_timeout);
@@ -532,6 +548,8 @@ extern void log_config(void)
 		sprintf(tmp_str, "NONE");
 	debug2("PurgeSuspendAfter     = %s", tmp_str);
 
+	debug2("QueryThreads      = %u", slurmdbd_conf->query_threads);
+
 	debug2("SlurmUser         = %s(%u)",
 	       slurmdbd_conf->slurm_user_name, slurmdbd_conf->slurm_user_id);
 
@@ -690,6 +708,12 @@ extern List dump_config(void)
 	key_pair->value = xstrdup(slurmdbd_conf->default_qos);
 	list_append(my_list, key_pair);
 
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("IngestThreads");
+	key_pair->value = xmalloc(32);
+	snprintf(key_pair->value, 32, "%u", slurmdbd_conf->ingest_threads);
+	list_append(my_list, key_pair);
+
 	key_pair = xmalloc(sizeof(config_key_pair_t));
 	key_pair->name = xstrdup("LogFile");
 	key_pair->value = xstrdup(slurmdbd_conf->log_file);
@@ -758,6 +782,12 @@ extern List dump_config(void)
 		key_pair->value = xstrdup("NONE");
 	list_append(my_list, key_pair);
 
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("QueryThreads");
+	key_pair->value = xmalloc(32);
+	snprintf(key_pair->value, 32, "%u", slurmdbd_conf->query_threads);
+	list_append(my_list, key_pair);
+
 	key_pair = xmalloc(sizeof(config_key_pair_t));
 	key_pair->name = xstrdup("SLURMDBD_CONF");
 	key_pair->value = _get_conf_path();
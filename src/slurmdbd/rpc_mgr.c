@@ -57,6 +57,7 @@
 #include "src/slurmdbd/proc_req.h"
 #include "src/slurmdbd/read_config.h"
 #include "src/slurmdbd/rpc_mgr.h"
+#include "src/slurmdbd/rpc_pool.h"
 #include "src/slurmdbd/slurmdbd.h"
 
 #define MAX_THREAD_COUNT 100
@@ -111,6 +112,8 @@ extern void *rpc_mgr(void *no_data)
 	    == SLURM_SOCKET_ERROR)
 		fatal("slurm_init_msg_engine_port error %m");
 
+	rpc_pool_init();
+
 	/* Prepare to catch SIGUSR1 to interrupt accept().
 	 * This signal is generated by the slurmdbd signal
 	 * handler thread upon receipt of SIGABRT, SIGINT,
@@ -162,6 +165,7 @@ extern void *rpc_mgr(void *no_data)
 	slurm_attr_destroy(&thread_attr_rpc_req);
 	(void) slurm_shutdown_msg_engine(sockfd);
 	_wait_for_thread_fini();
+	rpc_pool_fini();
 	pthread_exit((void *) 0);
 	return NULL;
 }
@@ -187,9 +191,9 @@ static void * _service_connection(void *arg)
 	uint32_t nw_size = 0, msg_size = 0, uid = NO_VAL;
 	char *msg = NULL;
 	ssize_t msg_read = 0, offset = 0;
-	bool fini = false, first = true;
+	bool fini = false, first = true, query;
 	Buf buffer = NULL;
-	int rc = SLURM_SUCCESS;
+	int i, rc = SLURM_SUCCESS;
 
 	debug2("Opened connection %d from %s", conn->newsockfd, conn->ip);
 
@@ -227,8 +231,16 @@ static void * _service_connection(void *arg)
 			offset += msg_read;
 		}
 		if (msg_size == offset) {
+			/* Users' RPCs wait for a slot in the query pool,
+			 * the slurmctld's (SlurmUser) are never held up */
+			query = (!first &&
+				 (uid != slurmdbd_conf->slurm_user_id));
+			if (query)
+				query_pool_enter();
 			rc = proc_req(
 				conn, msg, msg_size, first, &buffer, &uid);
+			if (query)
+				query_pool_exit();
 			first = false;
 			if (rc != SLURM_SUCCESS && rc != ACCOUNTING_FIRST_REG) {
 				error("Processing last message from "
@@ -259,6 +271,9 @@ static void * _service_connection(void *arg)
 		clusteracct_storage_g_fini_ctld(conn->db_conn, &cluster_rec);
 	}
 
+	for (i = 0; i < conn->lane_cnt; i++)
+		acct_storage_g_close_connection(&conn->lane_conns[i]);
+	xfree(conn->lane_conns);
 	acct_storage_g_close_connection(&conn->db_conn);
 	if (slurm_close_accepted_conn(conn->newsockfd) < 0)
 		error("close(%d): %m(%s)",  conn->newsockfd, conn->ip);
@@ -0,0 +1,336 @@
+/*****************************************************************************\
+ *  rpc_pool.c - slurmdbd query and ingest work pools.
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+#if HAVE_INTTYPES_H
+#  include <inttypes.h>
+#endif
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmdbd/read_config.h"
+#include "src/slurmdbd/rpc_pool.h"
+
+#define MAX_INGEST_THREADS	64
+#define POOL_REPORT_INTERVAL	600	/* seconds between statistics logs */
+
+/* Queue statistics of a pool, protected by pool_lock */
+typedef struct {
+	char *name;
+	uint32_t active;	/* being processed */
+	uint32_t queued;	/* waiting to be processed */
+	uint32_t queued_max;	/* most waiting at once */
+	uint32_t done;		/* processed since last report */
+	uint32_t waited;	/* of those, how many had to wait */
+	uint64_t wait_usec;	/* total time they waited */
+	uint64_t wait_max;	/* longest time one waited */
+} pool_stats_t;
+
+/* A set of tasks passed to ingest_pool_run() */
+typedef struct {
+	int remaining;		/* tasks not yet finished */
+	pthread_cond_t cond;	/* signaled as the last one finishes */
+} ingest_set_t;
+
+typedef struct {
+	void (*func)(void *arg);
+	void *arg;
+	ingest_set_t *set;
+	struct timeval queued;
+} ingest_task_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  ingest_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  query_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t      *ingest_threads = NULL;
+static int             ingest_thread_cnt = 0;
+static List            ingest_list = NULL;	/* ingest_task_t */
+static bool            pool_shutdown = false;
+static pool_stats_t    ingest_stats = { "ingest" };
+static pool_stats_t    query_stats = { "query" };
+static time_t          last_report = 0;
+
+static uint64_t _usec_since(struct timeval *start)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (uint64_t) (now.tv_sec - start->tv_sec) * 1000000 +
+		(now.tv_usec - start->tv_usec);
+}
+
+/* Count an item taken from a pool's queue after waiting wait_usec.
+ * Call with pool_lock held. */
+static void _stats_start(pool_stats_t *stats, uint64_t wait_usec)
+{
+	stats->active++;
+	stats->done++;
+	if (wait_usec >= 1000) {
+		stats->waited++;
+		stats->wait_usec += wait_usec;
+		if (wait_usec > stats->wait_max)
+			stats->wait_max = wait_usec;
+	}
+}
+
+static void _stats_log(pool_stats_t *stats)
+{
+	info("%s pool: %u active, %u queued (most %u), %u done, "
+	     "%u waited avg %"PRIu64" max %"PRIu64" msec",
+	     stats->name, stats->active, stats->queued, stats->queued_max,
+	     stats->done, stats->waited,
+	     stats->waited ? (stats->wait_usec / stats->waited / 1000) : 0,
+	     stats->wait_max / 1000);
+	stats->queued_max = stats->queued;
+	stats->done = 0;
+	stats->waited = 0;
+	stats->wait_usec = 0;
+	stats->wait_max = 0;
+}
+
+/* Log the statistics of both pools if it is time to, or force is set.
+ * Call with pool_lock held. */
+static void _stats_report(bool force)
+{
+	time_t now = time(NULL);
+
+	if (!force) {
+		if (difftime(now, last_report) < POOL_REPORT_INTERVAL)
+			return;
+		if (!ingest_stats.done && !query_stats.done)
+			return;
+	}
+	_stats_log(&query_stats);
+	_stats_log(&ingest_stats);
+	last_report = now;
+}
+
+/* Run a task taken from ingest_list. Call with pool_lock held, it is
+ * released while the task runs. */
+static void _ingest_task_run(ingest_task_t *task)
+{
+	ingest_set_t *set = task->set;
+
+	ingest_stats.queued--;
+	_stats_start(&ingest_stats, _usec_since(&task->queued));
+	slurm_mutex_unlock(&pool_lock);
+
+	(task->func)(task->arg);
+	xfree(task);
+
+	slurm_mutex_lock(&pool_lock);
+	ingest_stats.active--;
+	if (--set->remaining == 0)
+		pthread_cond_signal(&set->cond);
+}
+
+static void *_ingest_thread(void *no_data)
+{
+	ingest_task_t *task;
+
+	slurm_mutex_lock(&pool_lock);
+	while (1) {
+		if ((task = list_pop(ingest_list))) {
+			_ingest_task_run(task);
+			continue;
+		}
+		if (pool_shutdown)
+			break;
+		pthread_cond_wait(&ingest_cond, &pool_lock);
+	}
+	slurm_mutex_unlock(&pool_lock);
+
+	return NULL;
+}
+
+extern void rpc_pool_init(void)
+{
+	pthread_attr_t attr;
+	int i;
+
+	slurm_mutex_lock(&pool_lock);
+	pool_shutdown = false;
+	last_report = time(NULL);
+	if (!ingest_list)
+		ingest_list = list_create(NULL);
+
+	ingest_thread_cnt = MIN(slurmdbd_conf->ingest_threads,
+				MAX_INGEST_THREADS);
+	if (ingest_thread_cnt <= 1) {
+		ingest_thread_cnt = 0;
+		slurm_mutex_unlock(&pool_lock);
+		return;
+	}
+	ingest_threads = xmalloc(sizeof(pthread_t) * ingest_thread_cnt);
+	slurm_attr_init(&attr);
+	for (i = 0; i < ingest_thread_cnt; i++) {
+		if (pthread_create(&ingest_threads[i], &attr,
+				   _ingest_thread, NULL))
+			fatal("pthread_create %m");
+	}
+	slurm_attr_destroy(&attr);
+	slurm_mutex_unlock(&pool_lock);
+
+	debug("%d ingest threads, at most %u queries at once",
+	      ingest_thread_cnt, slurmdbd_conf->query_threads);
+}
+
+extern void rpc_pool_fini(void)
+{
+	int i;
+
+	slurm_mutex_lock(&pool_lock);
+	pool_shutdown = true;
+	pthread_cond_broadcast(&ingest_cond);
+	pthread_cond_broadcast(&query_cond);
+	slurm_mutex_unlock(&pool_lock);
+
+	for (i = 0; i < ingest_thread_cnt; i++)
+		pthread_join(ingest_threads[i], NULL);
+
+	slurm_mutex_lock(&pool_lock);
+	xfree(ingest_threads);
+	ingest_thread_cnt = 0;
+	_stats_report(true);
+	slurm_mutex_unlock(&pool_lock);
+}
+
+extern void query_pool_enter(void)
+{
+	struct timeval start;
+
+	gettimeofday(&start, NULL);
+	slurm_mutex_lock(&pool_lock);
+	if (slurmdbd_conf->query_threads &&
+	    (query_stats.active >= slurmdbd_conf->query_threads)) {
+		query_stats.queued++;
+		if (query_stats.queued > query_stats.queued_max)
+			query_stats.queued_max = query_stats.queued;
+		while (!pool_shutdown && (query_stats.active >=
+					  slurmdbd_conf->query_threads))
+			pthread_cond_wait(&query_cond, &pool_lock);
+		query_stats.queued--;
+	}
+	_stats_start(&query_stats, _usec_since(&start));
+	slurm_mutex_unlock(&pool_lock);
+}
+
+extern void query_pool_exit(void)
+{
+	slurm_mutex_lock(&pool_lock);
+	query_stats.active--;
+	pthread_cond_signal(&query_cond);
+	_stats_report(false);
+	slurm_mutex_unlock(&pool_lock);
+}
+
+extern int ingest_pool_lanes(void)
+{
+	int lanes;
+
+	slurm_mutex_lock(&pool_lock);
+	lanes = ingest_thread_cnt ? ingest_thread_cnt : 1;
+	slurm_mutex_unlock(&pool_lock);
+
+	return lanes;
+}
+
+static int _find_set_task(void *x, void *key)
+{
+	ingest_task_t *task = (ingest_task_t *) x;
+
+	return (task->set == (ingest_set_t *) key);
+}
+
+/* Remove and return a task of set from ingest_list, NULL if none is left
+ * there. Call with pool_lock held. */
+static ingest_task_t *_take_set_task(ingest_set_t *set)
+{
+	ListIterator itr = list_iterator_create(ingest_list);
+	ingest_task_t *task;
+
+	if ((task = list_find(itr, _find_set_task, set)))
+		list_remove(itr);
+	list_iterator_destroy(itr);
+
+	return task;
+}
+
+extern void ingest_pool_run(void (*func)(void *arg), void **args, int cnt)
+{
+	ingest_set_t set;
+	ingest_task_t *task;
+	struct timeval now;
+	int i;
+
+	if (cnt <= 0)
+		return;
+
+	set.remaining = cnt;
+	pthread_cond_init(&set.cond, NULL);
+	gettimeofday(&now, NULL);
+
+	slurm_mutex_lock(&pool_lock);
+	for (i = 0; i < cnt; i++) {
+		task = xmalloc(sizeof(ingest_task_t));
+		task->func = func;
+		task->arg = args[i];
+		task->set = &set;
+		task->queued = now;
+		list_append(ingest_list, task);
+	}
+	ingest_stats.queued += cnt;
+	if (ingest_stats.queued > ingest_stats.queued_max)
+		ingest_stats.queued_max = ingest_stats.queued;
+	pthread_cond_broadcast(&ingest_cond);
+
+	/* Help with our own tasks rather than wait for a free thread */
+	while ((task = _take_set_task(&set)))
+		_ingest_task_run(task);
+	while (set.remaining)
+		pthread_cond_wait(&set.cond, &pool_lock);
+	_stats_report(false);
+	slurm_mutex_unlock(&pool_lock);
+
+	pthread_cond_destroy(&set.cond);
+}
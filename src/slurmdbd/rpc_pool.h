@@ -0,0 +1,73 @@
+/*****************************************************************************\
+ *  rpc_pool.h - slurmdbd query and ingest work pools.
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _RPC_POOL_H
+#define _RPC_POOL_H
+
+/*
+ * The slurmdbd keeps two pools of work apart so that users' queries
+ * do not slow down the storing of the slurmctlds' job records:
+ *
+ * query  - RPCs from users other than SlurmUser, at most QueryThreads
+ *	    of them are processed at once and the rest wait their turn.
+ * ingest - threads storing the records of a slurmctld's multiple
+ *	    message in parallel, see _send_mult_msg() in proc_req.c.
+ *
+ * The queue depth and waiting time of each pool are logged at info
+ * level every ten minutes while there is activity, and at shutdown.
+ */
+
+/* Start the ingest threads, called when the RPC manager starts */
+extern void rpc_pool_init(void);
+
+/* Stop the ingest threads once their queue is empty, log statistics */
+extern void rpc_pool_fini(void);
+
+/* Wait for, and then release, a slot to process a user's RPC */
+extern void query_pool_enter(void);
+extern void query_pool_exit(void);
+
+/* Number of lanes a multiple message's records may be spread over,
+ * 1 if they are to be stored in order by the connection's thread */
+extern int ingest_pool_lanes(void);
+
+/* Run func(args[i]) for each of cnt args using the ingest threads and
+ * return once all have finished. The calling thread runs any that no
+ * ingest thread has started, so this never waits for a free thread. */
+extern void ingest_pool_run(void (*func)(void *arg), void **args, int cnt);
+
+#endif /* !_RPC_POOL_H */
@@ -72,6 +72,7 @@
 #include <sys/types.h>
 #include <sys/utsname.h>
 
+#include "src/common/io_hdr.h"
 #include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/mpi.h"
@@ -182,6 +183,8 @@
 #define LONG_OPT_TIME_MIN        0x150
 #define LONG_OPT_GRES            0x151
 #define LONG_OPT_ALPS            0x152
+#define LONG_OPT_IO_MSG_SIZE     0x153
+#define LONG_OPT_IO_LOCAL        0x154
 
 extern char **environ;
 
@@ -377,6 +380,8 @@ static void _opt_default()
 
 	opt.labelio = false;
 	opt.unbuffered = false;
+	opt.io_msg_size = 0;
+	opt.io_local = false;
 	opt.overcommit = false;
 	opt.shared = (uint16_t)NO_VAL;
 	opt.exclusive = false;
@@ -491,6 +496,8 @@ env_vars_t env_vars[] = {
 {"SLURM_GEOMETRY",      OPT_GEOMETRY,   NULL,               NULL             },
 {"SLURM_IMMEDIATE",     OPT_IMMEDIATE,  NULL,               NULL             },
 {"SLURM_IOLOAD_IMAGE",  OPT_STRING,     &opt.ramdiskimage,  NULL             },
+{"SLURM_IO_LOCAL",      OPT_INT,        &opt.io_local,      NULL             },
+{"SLURM_IO_MSG_SIZE",   OPT_INT,        &opt.io_msg_size,   NULL             },
 /* SLURM_JOBID was used in slurm version 1.3 and below, it is now vestigial */
 {"SLURM_JOBID",         OPT_INT,        &opt.jobid,         NULL             },
 {"SLURM_JOB_ID",        OPT_INT,        &opt.jobid,         NULL             },
@@ -778,6 +785,8 @@ static void set_options(const int argc, char **argv)
 		{"gres",             required_argument, 0, LONG_OPT_GRES},
 		{"help",             no_argument,       0, LONG_OPT_HELP},
 		{"hint",             required_argument, 0, LONG_OPT_HINT},
+		{"io-local",         no_argument,       0, LONG_OPT_IO_LOCAL},
+		{"io-msg-size",      required_argument, 0, LONG_OPT_IO_MSG_SIZE},
 		{"ioload-image",     required_argument, 0, LONG_OPT_RAMDISK_IMAGE},
 		{"jobid",            required_argument, 0, LONG_OPT_JOBID},
 		{"linux-image",      required_argument, 0, LONG_OPT_LINUX_IMAGE},
@@ -1421,6 +1430,13 @@ static void set_options(const int argc, char **argv)
 			opt.acctg_freq = _get_int(optarg, "acctg-freq",
                                 false);
 			break;
+		case LONG_OPT_IO_MSG_SIZE:
+			opt.io_msg_size = _get_int(optarg, "io-msg-size",
+						   false);
+			break;
+		case LONG_OPT_IO_LOCAL:
+			opt.io_local = true;
+			break;
 		case LONG_OPT_WCKEY:
 			xfree(opt.wckey);
 			opt.wckey = xstrdup(optarg);
@@ -2033,6 +2049,14 @@ static bool _opt_verify(void)
 		exit(error_exit);
 	}
 
+	/* zero leaves the default size */
+	if ((opt.io_msg_size < 0) || (opt.io_msg_size > MAX_IO_MSG_LEN)
+	    || (opt.io_msg_size && (opt.io_msg_size < MAX_MSG_LEN))) {
+		error("--io-msg-size must be between %d and %d bytes",
+		      MAX_MSG_LEN, MAX_IO_MSG_LEN);
+		exit(error_exit);
+	}
+
 	/*
 	 * --wait always overrides hidden max_exit_timeout
 	 */
@@ -2282,6 +2306,9 @@ static void _opt_list()
 		info("immediate      : %d secs", (opt.immediate - 1));
 	info("label output   : %s", tf_(opt.labelio));
 	info("unbuffered IO  : %s", tf_(opt.unbuffered));
+	if (opt.io_msg_size)
+		info("io_msg_size    : %d", opt.io_msg_size);
+	info("io_local       : %s", tf_(opt.io_local));
 	info("overcommit     : %s", tf_(opt.overcommit));
 	info("threads        : %d", opt.max_threads);
 	if (opt.time_limit == INFINITE)
@@ -2477,6 +2504,9 @@ static void _help(void)
 "  -t, --time=minutes          time limit\n"
 "      --time-min=minutes      minimum time limit (if distinct)\n"
 "  -u, --unbuffered            do not line-buffer stdout/err\n"
+"      --io-local              write a single -o/-e file directly from\n"
+"                              each node rather than through srun\n"
+"      --io-msg-size=bytes     largest stdout/err message sent to srun\n"
 "  -v, --verbose               verbose mode (multiple -v's increase verbosity)\n"
 "  -W, --wait=sec              seconds to wait after first task exits\n"
 "                              before killing job\n"
@@ -158,6 +158,8 @@ typedef struct srun_options {
 	bool hold;		/* --hold, -H			*/
 	bool labelio;		/* --label-output, -l		*/
 	bool unbuffered;        /* --unbuffered,   -u           */
+	int io_msg_size;	/* --io-msg-size=bytes		*/
+	int io_local;		/* --io-local			*/
 	bool allocate;		/* --allocate, 	   -A		*/
 	bool noshell;		/* --no-shell                   */
 	bool overcommit;	/* --overcommit,   -O		*/
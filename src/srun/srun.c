@@ -152,6 +152,7 @@ static int   _run_srun_script (srun_job_t *job, char *script);
 static void  _set_cpu_env_var(resource_allocation_response_msg_t *resp);
 static void  _set_exit_code(void);
 static void  _step_opt_exclusive(void);
+static void  _set_io_local(srun_job_t *job);
 static void  _set_stdio_fds(srun_job_t *job, slurm_step_io_fds_t *cio_fds);
 static void  _set_submit_dir_env(void);
 static void  _set_prio_process_env(void);
@@ -458,6 +459,9 @@ int srun(int ac, char **av)
 	launch_params.slurmd_debug = opt.slurmd_debug;
 	launch_params.buffered_stdio = !opt.unbuffered;
 	launch_params.labelio = opt.labelio ? true : false;
+	launch_params.io_msg_len = opt.io_msg_size;
+	if (opt.io_local)
+		_set_io_local(job);
 	launch_params.remote_output_filename =fname_remote_string(job->ofname);
 	launch_params.remote_input_filename = fname_remote_string(job->ifname);
 	launch_params.remote_error_filename = fname_remote_string(job->efname);
@@ -981,10 +985,9 @@ _is_local_file (fname_t *fname)
 	return ((fname->type != IO_PER_TASK) && (fname->type != IO_ONE));
 }
 
-static void
-_set_stdio_fds(srun_job_t *job, slurm_step_io_fds_t *cio_fds)
+static int
+_output_file_flags(void)
 {
-	bool err_shares_out = false;
 	int file_flags;
 
 	if (opt.open_mode == OPEN_MODE_APPEND)
@@ -1001,6 +1004,43 @@ _set_stdio_fds(srun_job_t *job, slurm_step_io_fds_t *cio_fds)
 		slurm_conf_unlock();
 	}
 
+	return file_flags;
+}
+
+/*
+ * With --io-local, have every slurmstepd append a single named output
+ * file itself instead of forwarding the output to srun.  srun creates
+ * (and truncates if requested) the file once, so the remote opens must
+ * all append.
+ */
+static void
+_set_io_local(srun_job_t *job)
+{
+	fname_t *fnames[2] = { job->ofname, job->efname };
+	int file_flags = _output_file_flags();
+	int i, fd;
+
+	for (i = 0; i < 2; i++) {
+		if ((fnames[i]->type != IO_ALL) || (fnames[i]->name == NULL))
+			continue;
+		fd = open(fnames[i]->name, file_flags, 0644);
+		if (fd == -1) {
+			error("Could not open output file %s: %m",
+			      fnames[i]->name);
+			exit(error_exit);
+		}
+		close(fd);
+		fnames[i]->type = IO_PER_TASK;
+	}
+	opt.open_mode = OPEN_MODE_APPEND;
+}
+
+static void
+_set_stdio_fds(srun_job_t *job, slurm_step_io_fds_t *cio_fds)
+{
+	bool err_shares_out = false;
+	int file_flags = _output_file_flags();
+
 	/*
 	 * create stdin file descriptor
 	 */
@@ -0,0 +1,161 @@
+/*****************************************************************************\
+ *  test7.15.prog.c - Time the PMI key-value exchange of a job step.
+ *
+ *  Usage: test7.15.prog [barriers [puts_per_barrier]]
+ *
+ *  Every task puts puts_per_barrier keys before each of the barriers, then
+ *  reads back one key of every task. Task 0 reports the time spent. Run it
+ *  with and without PMI_AGGREGATE set (and with many tasks per node using
+ *  srun's --overcommit option to simulate a large job on few nodes) to
+ *  compare the two PMI key-value exchange modes.
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <slurm/pmi.h>
+#include <sys/time.h>
+
+#define BARRIER_CNT		4
+#define PUTS_PER_BARRIER	2
+
+static long _delta_usec(struct timeval *tv1, struct timeval *tv2)
+{
+	return ((tv2->tv_sec - tv1->tv_sec) * 1000000) +
+	       (tv2->tv_usec - tv1->tv_usec);
+}
+
+int main (int argc, char **argv)
+{
+	int barrier_cnt = BARRIER_CNT, puts_per_barrier = PUTS_PER_BARRIER;
+	int i, j, rc, spawned, pmi_rank, pmi_size;
+	int kvs_name_len, key_len, val_len;
+	char *key, *val, *kvs_name;
+	struct timeval tv0, tv1, tv2;
+	long put_usec = 0, barrier_usec = 0, get_usec = 0;
+
+	if (argc > 1)
+		barrier_cnt = atoi(argv[1]);
+	if (argc > 2)
+		puts_per_barrier = atoi(argv[2]);
+	if ((barrier_cnt < 1) || (puts_per_barrier < 1)) {
+		printf("FAILURE: Usage: %s [barriers [puts_per_barrier]]\n",
+		       argv[0]);
+		exit(1);
+	}
+
+	gettimeofday(&tv0, NULL);
+	if ((rc = PMI_Init(&spawned)) != PMI_SUCCESS) {
+		printf("FAILURE: PMI_Init: %d\n", rc);
+		exit(1);
+	}
+	if (((rc = PMI_Get_rank(&pmi_rank)) != PMI_SUCCESS) ||
+	    ((rc = PMI_Get_size(&pmi_size)) != PMI_SUCCESS)) {
+		printf("FAILURE: PMI_Get_rank/size: %d\n", rc);
+		exit(1);
+	}
+	if (((rc = PMI_KVS_Get_name_length_max(&kvs_name_len))
+	     != PMI_SUCCESS) ||
+	    ((rc = PMI_KVS_Get_key_length_max(&key_len)) != PMI_SUCCESS) ||
+	    ((rc = PMI_KVS_Get_value_length_max(&val_len)) != PMI_SUCCESS)) {
+		printf("FAILURE: PMI_KVS_Get_*_length_max: %d, task %d\n",
+		       rc, pmi_rank);
+		exit(1);
+	}
+	kvs_name = malloc(kvs_name_len);
+	key = malloc(key_len);
+	val = malloc(val_len);
+	if ((rc = PMI_KVS_Get_my_name(kvs_name, kvs_name_len)) != PMI_SUCCESS) {
+		printf("FAILURE: PMI_KVS_Get_my_name: %d, task %d\n", rc,
+		       pmi_rank);
+		exit(1);
+	}
+
+	for (i = 0; i < barrier_cnt; i++) {
+		gettimeofday(&tv1, NULL);
+		for (j = 0; j < puts_per_barrier; j++) {
+			snprintf(key, key_len, "KEY_%d_%d_%d", i, j, pmi_rank);
+			snprintf(val, val_len, "VAL_%d_%d_%d", i, j, pmi_rank);
+			if ((rc = PMI_KVS_Put(kvs_name, key, val))
+			    != PMI_SUCCESS) {
+				printf("FAILURE: PMI_KVS_Put(%s): %d, "
+				       "task %d\n", key, rc, pmi_rank);
+				exit(1);
+			}
+		}
+		if ((rc = PMI_KVS_Commit(kvs_name)) != PMI_SUCCESS) {
+			printf("FAILURE: PMI_KVS_Commit: %d, task %d\n", rc,
+			       pmi_rank);
+			exit(1);
+		}
+		gettimeofday(&tv2, NULL);
+		put_usec += _delta_usec(&tv1, &tv2);
+
+		if ((rc = PMI_Barrier()) != PMI_SUCCESS) {
+			printf("FAILURE: PMI_Barrier: %d, task %d\n", rc,
+			       pmi_rank);
+			exit(1);
+		}
+		gettimeofday(&tv1, NULL);
+		barrier_usec += _delta_usec(&tv2, &tv1);
+
+		for (j = 0; j < pmi_size; j++) {
+			char expect[64];
+
+			snprintf(key, key_len, "KEY_%d_%d_%d", i,
+				 (j % puts_per_barrier), j);
+			if ((rc = PMI_KVS_Get(kvs_name, key, val, val_len))
+			    != PMI_SUCCESS) {
+				printf("FAILURE: PMI_KVS_Get(%s): %d, "
+				       "task %d\n", key, rc, pmi_rank);
+				exit(1);
+			}
+			snprintf(expect, sizeof(expect), "VAL_%d_%d_%d", i,
+				 (j % puts_per_barrier), j);
+			if (strcmp(val, expect)) {
+				printf("FAILURE: Bad keypair %s=%s, task %d\n",
+				       key, val, pmi_rank);
+				exit(1);
+			}
+		}
+		gettimeofday(&tv2, NULL);
+		get_usec += _delta_usec(&tv1, &tv2);
+	}
+
+	if ((rc = PMI_Finalize()) != PMI_SUCCESS) {
+		printf("FAILURE: PMI_Finalize: %d, task %d\n", rc, pmi_rank);
+		exit(1);
+	}
+	gettimeofday(&tv1, NULL);
+
+	if (pmi_rank == 0) {
+		printf("PMI exchange: tasks=%d barriers=%d puts=%d "
+		       "aggregate=%s\n", pmi_size, barrier_cnt,
+		       puts_per_barrier, getenv("PMI_AGGREGATE") ? "yes":"no");
+		printf("PMI time usec: put=%ld barrier=%ld get=%ld "
+		       "total=%ld\n", put_usec, barrier_usec, get_usec,
+		       _delta_usec(&tv0, &tv1));
+	}
+	exit(0);
+}
@@ -0,0 +1,222 @@
+/* $Id$ */
+
+/* Recover a slurmdbd agent spool written by an older rpc_version that
+ * holds more records than fit in one spool segment.  They must all be
+ * repacked into new segments, in order, and the old segments removed. */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#if HAVE_INTTYPES_H
+#  include <inttypes.h>
+#else
+#  if HAVE_STDINT_H
+#    include <stdint.h>
+#  endif
+#endif
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <src/common/pack.h>
+#include <src/common/slurmdbd_defs.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+#include <testsuite/dejagnu.h>
+
+#define TEST(_tst, _msg) do {			\
+	if (_tst) 				\
+		fail( _msg );       \
+	else					\
+		pass( _msg );       \
+} while (0)
+
+#define DBD_MAGIC	0xDEAD3219
+#define NODES_LEN	(64 * 1024)
+#define OLD_SEGS	2
+#define OLD_RECS	160	/* per segment, 20MB in all */
+
+static void _write_rec(int fd, Buf buffer)
+{
+	uint32_t size = get_buf_offset(buffer), magic = DBD_MAGIC;
+
+	if ((write(fd, &size, sizeof(size)) != sizeof(size)) ||
+	    (write(fd, get_buf_data(buffer), size) != size) ||
+	    (write(fd, &magic, sizeof(magic)) != sizeof(magic))) {
+		perror("write");
+		exit(1);
+	}
+}
+
+/* Write spool segment id holding recs DBD_CLUSTER_CPUS records packed
+ * with SLURMDBD_VERSION_MIN, their cpu_count numbered from first */
+static void _write_old_seg(char *dir, uint32_t id, int first, int recs)
+{
+	dbd_cluster_cpus_msg_t cpus_msg;
+	slurmdbd_msg_t msg;
+	char *fname, ver_str[10];
+	Buf buffer;
+	int fd, i;
+
+	fname = xstrdup_printf("%s/seg.%u", dir, id);
+	fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		perror(fname);
+		exit(1);
+	}
+	xfree(fname);
+
+	snprintf(ver_str, sizeof(ver_str), "VER%d", SLURMDBD_VERSION_MIN);
+	buffer = init_buf(0);
+	packstr(ver_str, buffer);
+	_write_rec(fd, buffer);
+	free_buf(buffer);
+
+	memset(&cpus_msg, 0, sizeof(cpus_msg));
+	cpus_msg.cluster_nodes = xmalloc(NODES_LEN);
+	memset(cpus_msg.cluster_nodes, 'n', NODES_LEN - 1);
+	cpus_msg.event_time = time(NULL);
+	msg.msg_type = DBD_CLUSTER_CPUS;
+	msg.data = &cpus_msg;
+	for (i = 0; i < recs; i++) {
+		cpus_msg.cpu_count = first + i;
+		buffer = pack_slurmdbd_msg(&msg, SLURMDBD_VERSION_MIN);
+		_write_rec(fd, buffer);
+		free_buf(buffer);
+	}
+	xfree(cpus_msg.cluster_nodes);
+	close(fd);
+}
+
+/* Read back every spool segment in id order.  RET the number of old
+ * segments left, sets *recs to the record count and *in_order if the
+ * DBD_CLUSTER_CPUS records are numbered consecutively from zero */
+static int _read_spool(char *dir, int *recs, int *in_order)
+{
+	dbd_cluster_cpus_msg_t *cpus_msg;
+	char *fname, *ver_str;
+	uint32_t id, size, magic, len;
+	uint16_t msg_type;
+	int fd, old = 0;
+	Buf buffer;
+
+	*recs = 0;
+	*in_order = 1;
+	for (id = 1; id < 100; id++) {
+		fname = xstrdup_printf("%s/seg.%u", dir, id);
+		fd = open(fname, O_RDONLY);
+		xfree(fname);
+		if (fd < 0)
+			continue;
+		for (len = 0; read(fd, &size, sizeof(size)) == sizeof(size);
+		     len++) {
+			buffer = init_buf(size);
+			if ((read(fd, get_buf_data(buffer), size) != size) ||
+			    (read(fd, &magic, sizeof(magic)) != sizeof(magic)) ||
+			    (magic != DBD_MAGIC)) {
+				*in_order = 0;
+				free_buf(buffer);
+				break;
+			}
+			set_buf_offset(buffer, 0);
+			if (len == 0) {
+				unpackstr_xmalloc(&ver_str, &size, buffer);
+				if (atoi(ver_str + 3) != SLURMDBD_VERSION)
+					old++;
+				xfree(ver_str);
+			} else if ((unpack16(&msg_type, buffer)
+				    == SLURM_SUCCESS) &&
+				   (msg_type == DBD_CLUSTER_CPUS)) {
+				if (slurmdbd_unpack_cluster_cpus_msg(
+					    &cpus_msg, SLURMDBD_VERSION,
+					    buffer) != SLURM_SUCCESS) {
+					*in_order = 0;
+				} else {
+					if (cpus_msg->cpu_count != *recs)
+						*in_order = 0;
+					slurmdbd_free_cluster_cpus_msg(
+						cpus_msg);
+					(*recs)++;
+				}
+			}
+			free_buf(buffer);
+		}
+		close(fd);
+	}
+	return old;
+}
+
+int main (int argc, char *argv[])
+{
+	char dir[] = "/tmp/spool-test.XXXXXX", *conf, *spool, *fname;
+	dbd_cluster_cpus_msg_t cpus_msg;
+	slurmdbd_msg_t msg;
+	int i, old, recs, in_order;
+	FILE *fp;
+
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return 1;
+	}
+	conf = xstrdup_printf("%s/slurm.conf", dir);
+	if (!(fp = fopen(conf, "w"))) {
+		perror(conf);
+		return 1;
+	}
+	fprintf(fp, "ControlMachine=localhost\n"
+		"ClusterName=spooltest\n"
+		"AccountingStorageType=accounting_storage/slurmdbd\n"
+		"AccountingStorageHost=localhost\n"
+		"AccountingStoragePort=1\n"
+		"PluginDir=%s\n"
+		"StateSaveLocation=%s\n", dir, dir);
+	fclose(fp);
+	setenv("SLURM_CONF", conf, 1);
+
+	spool = xstrdup_printf("%s/dbd.spool", dir);
+	if (mkdir(spool, 0700) < 0) {
+		perror(spool);
+		return 1;
+	}
+	for (i = 0; i < OLD_SEGS; i++)
+		_write_old_seg(spool, i + 1, i * OLD_RECS, OLD_RECS);
+
+	/* Opening the agent recovers the spool, a hang here is a failure */
+	alarm(120);
+	memset(&cpus_msg, 0, sizeof(cpus_msg));
+	cpus_msg.cpu_count = OLD_SEGS * OLD_RECS;
+	msg.msg_type = DBD_CLUSTER_CPUS;
+	msg.data = &cpus_msg;
+	TEST(slurm_send_slurmdbd_msg(SLURMDBD_VERSION, &msg) != SLURM_SUCCESS,
+	     "spool recovered and new message queued");
+	alarm(0);
+
+	old = _read_spool(spool, &recs, &in_order);
+	TEST(old != 0, "old version segments removed");
+	TEST(recs != (OLD_SEGS * OLD_RECS) + 1, "all records recovered");
+	TEST(!in_order, "records kept in order");
+	printf("recovered %d records\n", recs);
+
+	for (i = 1; i < 100; i++) {
+		fname = xstrdup_printf("%s/seg.%d", spool, i);
+		(void) unlink(fname);
+		xfree(fname);
+	}
+	fname = xstrdup_printf("%s/head", spool);
+	(void) unlink(fname);
+	xfree(fname);
+	(void) rmdir(spool);
+	(void) unlink(conf);
+	(void) rmdir(dir);
+	xfree(spool);
+	xfree(conf);
+
+	totals();
+	return failed;
+}